@@ -0,0 +1,35 @@
+#pragma once
+
+/**
+ * @brief Fixed-size block of mono samples handed from the AudioThread to
+ * background analysis workers through an SpscRing.
+ */
+struct AudioBlock
+{
+    static constexpr int kMaxFrames = 1024;
+
+    int frames = 0;
+    float samples[kMaxFrames];
+
+    /**
+     * @brief Downmixes up to kMaxFrames interleaved frames into this block.
+     * @return Number of frames consumed.
+     */
+    int assign(const float* interleaved, int numFrames, int channels)
+    {
+        frames = numFrames < kMaxFrames ? numFrames : kMaxFrames;
+        if (channels <= 1) {
+            for (int i = 0; i < frames; ++i)
+                samples[i] = interleaved[i];
+        } else {
+            const float scale = 1.0f / channels;
+            for (int i = 0; i < frames; ++i) {
+                float sum = 0.0f;
+                for (int ch = 0; ch < channels; ++ch)
+                    sum += interleaved[i * channels + ch];
+                samples[i] = sum * scale;
+            }
+        }
+        return frames;
+    }
+};
@@ -0,0 +1,203 @@
+#include "audiometer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIOMETER_SSE 1
+#endif
+
+namespace {
+const double kPi = 3.14159265358979323846;
+}
+
+// ----------------------------------------------------------
+// 1. MeterReading
+// ----------------------------------------------------------
+
+void MeterReading::merge(const MeterReading& other)
+{
+    if (other.frames <= 0)
+        return;
+    if (frames <= 0) {
+        *this = other;
+        return;
+    }
+
+    const int n = std::min(channels, other.channels);
+    const float total = static_cast<float>(frames + other.frames);
+    for (int ch = 0; ch < n; ++ch) {
+        peak[ch]     = std::max(peak[ch], other.peak[ch]);
+        truePeak[ch] = std::max(truePeak[ch], other.truePeak[ch]);
+        float power  = rms[ch] * rms[ch] * frames + other.rms[ch] * other.rms[ch] * other.frames;
+        rms[ch]      = std::sqrt(power / total);
+    }
+    frames += other.frames;
+}
+
+float MeterReading::maxPeak() const
+{
+    float v = 0.0f;
+    for (int ch = 0; ch < channels; ++ch) v = std::max(v, peak[ch]);
+    return v;
+}
+
+float MeterReading::maxRms() const
+{
+    float v = 0.0f;
+    for (int ch = 0; ch < channels; ++ch) v = std::max(v, rms[ch]);
+    return v;
+}
+
+float MeterReading::maxTruePeak() const
+{
+    float v = 0.0f;
+    for (int ch = 0; ch < channels; ++ch) v = std::max(v, truePeak[ch]);
+    return v;
+}
+
+// ----------------------------------------------------------
+// 2. AudioMeter
+// ----------------------------------------------------------
+
+AudioMeter::AudioMeter()
+    : m_channels(1)
+{
+    // Windowed-sinc 4x interpolator (Blackman window), split into
+    // kOversample phases of kTaps taps, each phase normalized to unity DC gain.
+    const int length = kTaps * kOversample;
+    const double center = (length - 1) / 2.0;
+    double phaseSum[kOversample] = {};
+    double h[kTaps * kOversample];
+    for (int n = 0; n < length; ++n) {
+        double x = (n - center) / kOversample;
+        double sinc = (std::fabs(x) < 1e-9) ? 1.0 : std::sin(kPi * x) / (kPi * x);
+        double w = 0.42 - 0.5 * std::cos(2.0 * kPi * n / (length - 1))
+                   + 0.08 * std::cos(4.0 * kPi * n / (length - 1));
+        h[n] = sinc * w;
+        phaseSum[n % kOversample] += h[n];
+    }
+    for (int k = 0; k < kTaps; ++k) {
+        for (int p = 0; p < kOversample; ++p) {
+            m_coeffs[k][p] = static_cast<float>(h[k * kOversample + p] / phaseSum[p]);
+        }
+    }
+
+    std::memset(m_history, 0, sizeof(m_history));
+    std::memset(m_scratch, 0, sizeof(m_scratch));
+}
+
+void AudioMeter::setChannels(int channels)
+{
+    m_channels = std::clamp(channels, 1, kMaxMeterChannels);
+    std::memset(m_history, 0, sizeof(m_history));
+}
+
+void AudioMeter::process(const float* samples, int frames)
+{
+    if (!samples || frames <= 0)
+        return;
+
+    MeterReading* reading = m_ring.beginWrite();
+    if (!reading)
+        return; // UI is not keeping up; drop this block rather than wait
+
+    reading->channels = m_channels;
+    reading->frames   = frames;
+    for (int ch = 0; ch < m_channels; ++ch) {
+        meterChannel(samples, ch, frames, *reading);
+    }
+    m_ring.commitWrite();
+}
+
+bool AudioMeter::read(MeterReading& reading)
+{
+    bool gotAny = false;
+    reading = MeterReading();
+    while (const MeterReading* next = m_ring.beginRead()) {
+        reading.merge(*next);
+        m_ring.commitRead();
+        gotAny = true;
+    }
+    return gotAny;
+}
+
+void AudioMeter::meterChannel(const float* samples, int channel, int frames, MeterReading& reading)
+{
+    const int history = kTaps - 1;
+    float* x = m_scratch + history;
+
+    std::memcpy(m_scratch, m_history[channel], sizeof(m_history[channel]));
+
+    float peak = 0.0f;
+    float truePeak = 0.0f;
+    double sumSquares = 0.0;
+
+    for (int offset = 0; offset < frames; offset += kChunk) {
+        const int n = std::min(kChunk, frames - offset);
+
+        // De-interleave this channel behind the filter history
+        const float* src = samples + static_cast<size_t>(offset) * m_channels + channel;
+        for (int i = 0; i < n; ++i) {
+            x[i] = src[static_cast<size_t>(i) * m_channels];
+        }
+
+        int i = 0;
+#ifdef AUDIOMETER_SSE
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        __m128 vPeak = _mm_setzero_ps();
+        __m128 vSum  = _mm_setzero_ps();
+        for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_loadu_ps(x + i);
+            vPeak = _mm_max_ps(vPeak, _mm_and_ps(v, absMask));
+            vSum  = _mm_add_ps(vSum, _mm_mul_ps(v, v));
+        }
+
+        // True peak: one broadcast sample times a 4-wide coefficient row
+        // yields all four interpolated phases at once
+        __m128 vTrue = _mm_setzero_ps();
+        for (int j = 0; j < n; ++j) {
+            __m128 acc = _mm_setzero_ps();
+            for (int k = 0; k < kTaps; ++k) {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(x[j - k]),
+                                                 _mm_load_ps(m_coeffs[k])));
+            }
+            vTrue = _mm_max_ps(vTrue, _mm_and_ps(acc, absMask));
+        }
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, vPeak);
+        peak = std::max({peak, lanes[0], lanes[1], lanes[2], lanes[3]});
+        _mm_store_ps(lanes, vSum);
+        sumSquares += static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+        _mm_store_ps(lanes, vTrue);
+        truePeak = std::max({truePeak, lanes[0], lanes[1], lanes[2], lanes[3]});
+#else
+        for (int j = 0; j < n; ++j) {
+            for (int p = 0; p < kOversample; ++p) {
+                float acc = 0.0f;
+                for (int k = 0; k < kTaps; ++k) {
+                    acc += x[j - k] * m_coeffs[k][p];
+                }
+                truePeak = std::max(truePeak, std::fabs(acc));
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            peak = std::max(peak, std::fabs(x[i]));
+            sumSquares += static_cast<double>(x[i]) * x[i];
+        }
+
+        // Carry the tail over as history for the next chunk
+        std::memmove(m_scratch, m_scratch + n, history * sizeof(float));
+    }
+
+    std::memcpy(m_history[channel], m_scratch, sizeof(m_history[channel]));
+
+    reading.peak[channel]     = peak;
+    reading.rms[channel]      = static_cast<float>(std::sqrt(sumSquares / frames));
+    // The interpolator can ring slightly below a sample peak; never report less
+    reading.truePeak[channel] = std::max(truePeak, peak);
+}
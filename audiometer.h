@@ -0,0 +1,72 @@
+#pragma once
+
+#include "spscring.h"
+
+/// Maximum number of channels metered individually.
+constexpr int kMaxMeterChannels = 8;
+
+/**
+ * @brief One metering result: per-channel sample peak, RMS and true peak
+ * (4x oversampled inter-sample peak), all linear in [0, 1+].
+ */
+struct MeterReading
+{
+    int channels = 0;
+    int frames   = 0;     ///< Number of frames the reading covers
+    float peak[kMaxMeterChannels]     = {};
+    float rms[kMaxMeterChannels]      = {};
+    float truePeak[kMaxMeterChannels] = {};
+
+    /// Folds a later reading into this one (max of peaks, power-average of RMS).
+    void merge(const MeterReading& other);
+
+    float maxPeak() const;
+    float maxRms() const;
+    float maxTruePeak() const;
+};
+
+/**
+ * @brief Computes meter readings on the audio thread and publishes them
+ * to the UI through a lock-free ring.
+ *
+ * process() is real-time safe: no locks, no allocations. The UI thread calls
+ * read() at display rate and gets everything produced since the last poll
+ * merged into a single reading.
+ */
+class AudioMeter
+{
+public:
+    AudioMeter();
+
+    /**
+     * @brief Sets the interleaved channel count and clears filter history.
+     * Call before the processing loop starts.
+     */
+    void setChannels(int channels);
+
+    /// Audio thread: meters one interleaved block and publishes the result.
+    void process(const float* samples, int frames);
+
+    /// UI thread: drains pending readings into @p reading. False if none arrived.
+    bool read(MeterReading& reading);
+
+private:
+    static constexpr int kOversample = 4;
+    static constexpr int kTaps       = 12;   ///< Taps per polyphase branch
+    static constexpr int kChunk      = 512;  ///< Frames metered per pass
+
+    void meterChannel(const float* samples, int channel, int frames, MeterReading& reading);
+
+    int m_channels;
+
+    /// Polyphase interpolator, laid out [tap][phase] so one tap feeds all phases at once.
+    alignas(16) float m_coeffs[kTaps][kOversample];
+
+    /// Last kTaps-1 input samples of every channel (true-peak filter state).
+    float m_history[kMaxMeterChannels][kTaps - 1];
+
+    /// History followed by one de-interleaved chunk of the current channel.
+    alignas(16) float m_scratch[kTaps - 1 + kChunk];
+
+    SpscRing<MeterReading, 64> m_ring;
+};
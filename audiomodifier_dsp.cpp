@@ -0,0 +1,180 @@
+// audiomodifier_dsp.cpp
+
+#include "audiomodifier_dsp.h"
+#include "dspchain.h"
+
+#include <vector>
+
+// Every entry point catches everything: an exception (bad_alloc, or
+// runtime_error from SoundTouch) must never unwind into a C caller
+
+static_assert(AM_DSP_MAX_CHANNELS == DspChain::kMaxChannels, "C API and chain channel limits differ");
+
+struct am_dsp
+{
+    DspChain chain;
+};
+
+namespace {
+DspParameters toParameters(const am_dsp_params& params)
+{
+    DspParameters p;
+    p.gateEnabled     = params.gate_enabled != 0;
+    p.gateThresholdDb = params.gate_threshold_db;
+    p.pitchSemitones  = params.pitch_semitones;
+    p.distortionGain  = params.distortion_gain;
+    p.filter          = (params.filter >= AM_DSP_FILTER_NONE && params.filter <= AM_DSP_FILTER_NOTCH)
+                      ? static_cast<DspFilter>(params.filter) : DspFilter::None;
+    p.lowFreq         = params.low_freq;
+    p.highFreq        = params.high_freq;
+    return p;
+}
+}
+
+void am_dsp_default_params(am_dsp_params* params)
+{
+    if (!params)
+        return;
+    const DspParameters defaults;
+    params->gate_enabled      = defaults.gateEnabled ? 1 : 0;
+    params->gate_threshold_db = defaults.gateThresholdDb;
+    params->pitch_semitones   = defaults.pitchSemitones;
+    params->distortion_gain   = defaults.distortionGain;
+    params->filter            = static_cast<int>(defaults.filter);
+    params->low_freq          = defaults.lowFreq;
+    params->high_freq         = defaults.highFreq;
+}
+
+int am_dsp_set_interpolation(int algorithm)
+{
+    SoundTouchInterpolation interpolation;
+    switch (algorithm) {
+    case AM_DSP_INTERP_LINEAR:
+        interpolation = SoundTouchInterpolation::Linear;
+        break;
+    case AM_DSP_INTERP_CUBIC:
+        interpolation = SoundTouchInterpolation::Cubic;
+        break;
+    case AM_DSP_INTERP_SHANNON:
+        interpolation = SoundTouchInterpolation::Shannon;
+        break;
+    default:
+        return -1;
+    }
+    try {
+        SoundTouchPitchEngine::setInterpolation(interpolation);
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+am_dsp* am_dsp_create(int channels, int sample_rate)
+{
+    if (channels < 1 || channels > AM_DSP_MAX_CHANNELS
+        || sample_rate < AM_DSP_MIN_SAMPLE_RATE || sample_rate > AM_DSP_MAX_SAMPLE_RATE)
+        return nullptr;
+    am_dsp* dsp = nullptr;
+    try {
+        dsp = new am_dsp;
+        dsp->chain.setFormat(channels, sample_rate);
+    } catch (...) {
+        delete dsp;
+        return nullptr;
+    }
+    return dsp;
+}
+
+void am_dsp_destroy(am_dsp* dsp)
+{
+    try {
+        delete dsp;
+    } catch (...) {
+    }
+}
+
+void am_dsp_set_params(am_dsp* dsp, const am_dsp_params* params)
+{
+    if (!dsp || !params)
+        return;
+    try {
+        dsp->chain.setParameters(toParameters(*params));
+    } catch (...) {
+    }
+}
+
+int am_dsp_set_pitch_engine(am_dsp* dsp, int engine)
+{
+    if (!dsp)
+        return -1;
+    PitchEngineType type;
+    switch (engine) {
+    case AM_DSP_PITCH_GRANULAR:
+        type = PitchEngineType::Granular;
+        break;
+    case AM_DSP_PITCH_SOUNDTOUCH:
+        type = PitchEngineType::SoundTouch;
+        break;
+    case AM_DSP_PITCH_PHASE_VOCODER:
+        type = PitchEngineType::PhaseVocoder;
+        break;
+    default:
+        return -1;
+    }
+    try {
+        dsp->chain.setPitchEngine(type);
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+int am_dsp_set_impulse_response(am_dsp* dsp, const float* interleaved, int frames,
+                                int channels, int sample_rate)
+{
+    if (!dsp)
+        return -1;
+    try {
+        if (!interleaved || frames <= 0) {
+            dsp->chain.clearImpulseResponse();
+            return 0;
+        }
+        if (channels <= 0 || sample_rate <= 0)
+            return -1;
+        const std::vector<float> ir(interleaved, interleaved + static_cast<size_t>(frames) * channels);
+        return dsp->chain.setImpulseResponse(ir, channels, sample_rate) ? 0 : -1;
+    } catch (...) {
+        return -1;
+    }
+}
+
+void am_dsp_set_convolution_mix(am_dsp* dsp, float wet)
+{
+    if (!dsp)
+        return;
+    try {
+        dsp->chain.setConvolutionMix(wet);
+    } catch (...) {
+    }
+}
+
+void am_dsp_process(am_dsp* dsp, const float* in, float* out, int frames)
+{
+    if (!dsp)
+        return;
+    try {
+        dsp->chain.process(in, out, frames);
+    } catch (...) {
+    }
+}
+
+int am_dsp_latency_frames(const am_dsp* dsp)
+{
+    if (!dsp)
+        return 0;
+    try {
+        return dsp->chain.latencyFrames();
+    } catch (...) {
+        return 0;
+    }
+}
@@ -0,0 +1,113 @@
+/* audiomodifier_dsp.h */
+#ifndef AUDIOMODIFIER_DSP_H
+#define AUDIOMODIFIER_DSP_H
+
+/*
+ * C interface of the headless effect chain (DspChain), for servers and
+ * bindings that cannot use the C++ class directly. Buffers are interleaved
+ * 32-bit float; nothing here touches audio devices, widgets or an event loop.
+ *
+ * Each channel runs through its own gate, filter and pitch state, for up
+ * to AM_DSP_MAX_CHANNELS channels. No function lets a C++ exception escape:
+ * failures come back as NULL or -1, or leave the chain unchanged.
+ *
+ * Threading: am_dsp_process() and am_dsp_set_params() belong to one
+ * processing thread. The remaining setters may be called from one other
+ * thread at any time; they prepare their data there and hand it over
+ * lock-free.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct am_dsp am_dsp;
+
+/* Stream layouts am_dsp_create() accepts */
+#define AM_DSP_MAX_CHANNELS     8
+#define AM_DSP_MIN_SAMPLE_RATE  8000
+#define AM_DSP_MAX_SAMPLE_RATE  384000
+
+/* Band filter modes */
+enum
+{
+    AM_DSP_FILTER_NONE = 0,
+    AM_DSP_FILTER_LOW_PASS,     /* cutoff at low_freq */
+    AM_DSP_FILTER_HIGH_PASS,    /* cutoff at high_freq */
+    AM_DSP_FILTER_BAND_PASS,    /* low_freq .. high_freq */
+    AM_DSP_FILTER_NOTCH         /* low_freq .. high_freq */
+};
+
+/* Pitch shifter engines, cheapest first */
+enum
+{
+    AM_DSP_PITCH_GRANULAR = 0,
+    AM_DSP_PITCH_SOUNDTOUCH,
+    AM_DSP_PITCH_PHASE_VOCODER
+};
+
+/* Interpolation of the SoundTouch pitch engine */
+enum
+{
+    AM_DSP_INTERP_LINEAR = 0,
+    AM_DSP_INTERP_CUBIC,        /* default */
+    AM_DSP_INTERP_SHANNON       /* band-limited 8-tap sinc */
+};
+
+typedef struct am_dsp_params
+{
+    int gate_enabled;
+    float gate_threshold_db;
+    float pitch_semitones;      /* 0 bypasses the pitch stage */
+    float distortion_gain;      /* 1 bypasses the distortion stage */
+    int filter;                 /* AM_DSP_FILTER_* */
+    float low_freq;
+    float high_freq;
+} am_dsp_params;
+
+/* Fills @p params with a neutral chain (every stage bypassed). */
+void am_dsp_default_params(am_dsp_params* params);
+
+/*
+ * Process-wide: applies to SoundTouch pitch engines created afterwards, so
+ * call it before am_dsp_create(). Returns 0 on success, -1 on an unknown
+ * algorithm.
+ */
+int am_dsp_set_interpolation(int algorithm);
+
+/*
+ * Not real-time safe. Returns NULL unless 1 <= channels <= AM_DSP_MAX_CHANNELS
+ * and AM_DSP_MIN_SAMPLE_RATE <= sample_rate <= AM_DSP_MAX_SAMPLE_RATE, or
+ * if the chain cannot be set up.
+ */
+am_dsp* am_dsp_create(int channels, int sample_rate);
+void am_dsp_destroy(am_dsp* dsp);
+
+/* Processing thread, between blocks. */
+void am_dsp_set_params(am_dsp* dsp, const am_dsp_params* params);
+
+/* Returns 0 on success, -1 on an unknown engine or if it cannot be set up. */
+int am_dsp_set_pitch_engine(am_dsp* dsp, int engine);
+
+/*
+ * Loads an impulse response into the convolution stage (resampled to the
+ * chain rate). NULL or zero frames clears it. Returns 0 on success.
+ */
+int am_dsp_set_impulse_response(am_dsp* dsp, const float* interleaved, int frames,
+                                int channels, int sample_rate);
+void am_dsp_set_convolution_mix(am_dsp* dsp, float wet);
+
+/*
+ * Processes @p frames interleaved frames; @p in and @p out may be the same
+ * buffer. Real-time safe.
+ */
+void am_dsp_process(am_dsp* dsp, const float* in, float* out, int frames);
+
+/* Delay of the pitch stage in frames, 0 while it is bypassed. */
+int am_dsp_latency_frames(const am_dsp* dsp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIOMODIFIER_DSP_H */
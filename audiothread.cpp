@@ -7,177 +7,36 @@
 #include <QDebug>
 #include <QElapsedTimer>
 #include <QThread>
+#include <algorithm>
 #include <cmath>
 #include <vector>
 #include <QtMath> // For M_PI
 
-#include <SoundTouch.h>
 #include <samplerate.h>
 
 #include <QFile>
-#include <QAudioBuffer>
-#include <QAudioDecoder>
 #include "audiothread.h"
+#include "spectrumanalyzer.h"
+#include "beattracker.h"
+#include "wavfile.h"
+#include "realtime.h"
+#include "rtsanitizer.h"
 #include <QMutex>
 
-using namespace soundtouch;
+namespace {
+// Voice-activity threshold: anything above digital silence
+const float kSilenceThresholdDb = -90.0f;
 
-Q_LOGGING_CATEGORY(audioCategory, "audio")
+// A closed gate at or below this gain mutes, so its threshold may end the block
+const float kMutingGateFloor = 0.001f;
 
-// ----------------------------------------------------------
-// 1. Biquad Filter Class Implementation
-// ----------------------------------------------------------
-
-Biquad::Biquad()
-    : b0(1.0f), b1(0.0f), b2(0.0f),
-    a0(1.0f), a1(0.0f), a2(0.0f),
-    z1(0.0f), z2(0.0f)
-{
-}
-
-void Biquad::setupLowPass(float cutoff, float sampleRate, float Q)
-{
-    float omega = 2.0f * M_PI * cutoff / sampleRate;
-    float alpha = sinf(omega) / (2.0f * Q);
-
-    float cos_omega = cosf(omega);
-    float a0_inv = 1.0f / (1.0f + alpha);
-
-    b0 = (1.0f - cos_omega) / 2.0f;
-    b1 = 1.0f - cos_omega;
-    b2 = (1.0f - cos_omega) / 2.0f;
-    a0 = 1.0f + alpha;
-    a1 = -2.0f * cos_omega;
-    a2 = 1.0f - alpha;
-
-    b0 *= a0_inv;
-    b1 *= a0_inv;
-    b2 *= a0_inv;
-    a1 *= a0_inv;
-    a2 *= a0_inv;
-}
-
-void Biquad::setupHighPass(float cutoff, float sampleRate, float Q)
-{
-    float omega = 2.0f * M_PI * cutoff / sampleRate;
-    float alpha = sinf(omega) / (2.0f * Q);
-
-    float cos_omega = cosf(omega);
-    float a0_inv = 1.0f / (1.0f + alpha);
-
-    b0 = (1.0f + cos_omega) / 2.0f;
-    b1 = -(1.0f + cos_omega);
-    b2 = (1.0f + cos_omega) / 2.0f;
-    a0 = 1.0f + alpha;
-    a1 = -2.0f * cos_omega;
-    a2 = 1.0f - alpha;
-
-    b0 *= a0_inv;
-    b1 *= a0_inv;
-    b2 *= a0_inv;
-    a1 *= a0_inv;
-    a2 *= a0_inv;
-}
-
-void Biquad::setupBandPass(float centerFreq, float bandwidth, float sampleRate, float Q)
-{
-    float omega = 2.0f * M_PI * centerFreq / sampleRate;
-    float alpha = sinf(omega) * sinhf(logf(2.0f) / 2.0f * bandwidth * omega / sinf(omega));
-
-    float cos_omega = cosf(omega);
-    float a0_inv = 1.0f / (1.0f + alpha);
-
-    b0 = alpha;
-    b1 = 0.0f;
-    b2 = -alpha;
-    a0 = 1.0f + alpha;
-    a1 = -2.0f * cos_omega;
-    a2 = 1.0f - alpha;
-
-    b0 *= a0_inv;
-    b1 *= a0_inv;
-    b2 *= a0_inv;
-    a1 *= a0_inv;
-    a2 *= a0_inv;
-}
-
-void Biquad::setupNotch(float centerFreq, float bandwidth, float sampleRate, float Q)
-{
-    float omega = 2.0f * M_PI * centerFreq / sampleRate;
-    float alpha = sinf(omega) * sinhf(logf(2.0f) / 2.0f * bandwidth * omega / sinf(omega));
-
-    float cos_omega = cosf(omega);
-    float a0_inv = 1.0f / (1.0f + alpha);
-
-    b0 = 1.0f;
-    b1 = -2.0f * cos_omega;
-    b2 = 1.0f;
-    a0 = 1.0f + alpha;
-    a1 = -2.0f * cos_omega;
-    a2 = 1.0f - alpha;
-
-    b0 *= a0_inv;
-    b1 *= a0_inv;
-    b2 *= a0_inv;
-    a1 *= a0_inv;
-    a2 *= a0_inv;
-}
-
-float Biquad::process(float in)
-{
-    float out = b0 * in + b1 * z1 + b2 * z2
-                - a1 * z1 - a2 * z2;
-    z2 = z1;
-    z1 = out;
-    return out;
-}
-
-void Biquad::applyLowPass(std::vector<float> &buffer, float cutoffHz, int sampleRate)
-{
-    if (cutoffHz <= 0.f || cutoffHz >= sampleRate * 0.5f) {
-        return; // Invalid or trivial
-    }
-    setupLowPass(cutoffHz, sampleRate);
-    for (auto &sample : buffer) {
-        sample = process(sample);
-    }
-}
-
-void Biquad::applyHighPass(std::vector<float> &buffer, float cutoffHz, int sampleRate)
-{
-    if (cutoffHz <= 0.f || cutoffHz >= sampleRate * 0.5f) {
-        return;
-    }
-    setupHighPass(cutoffHz, sampleRate);
-    for (auto &sample : buffer) {
-        sample = process(sample);
-    }
-}
-
-void Biquad::applyBandPass(std::vector<float> &buffer, float centerFreq, float bandwidth, int sampleRate)
-{
-    if (centerFreq <= 0.f || centerFreq >= sampleRate * 0.5f) {
-        return;
-    }
-    setupBandPass(centerFreq, bandwidth, sampleRate);
-    for (auto &sample : buffer) {
-        sample = process(sample);
-    }
-}
-
-void Biquad::applyBandStop(std::vector<float> &buffer, float centerFreq, float bandwidth, int sampleRate)
-{
-    if (centerFreq <= 0.f || centerFreq >= sampleRate * 0.5f) {
-        return;
-    }
-    setupNotch(centerFreq, bandwidth, sampleRate);
-    for (auto &sample : buffer) {
-        sample = process(sample);
-    }
+// Memory for both capture rings together: an hour of 48 kHz mono in and out
+// at 16 bit, with room for the save headroom
+const qint64 kCaptureBudgetBytes = qint64(1024) * 1024 * 1024;
 }
 
 // ----------------------------------------------------------
-// 2. AudioThread Class Implementation
+// 1. AudioThread Class Implementation
 // ----------------------------------------------------------
 
 AudioThread::AudioThread(MainWindow* mainWin, QObject* parent)
@@ -191,11 +50,22 @@ AudioThread::AudioThread(MainWindow* mainWin, QObject* parent)
     , m_inChannels(0)
     , m_outChannels(0)
     , m_chunkSize(0)
+    , m_requestedProcessingRate(0)
+    , m_processingRate(0)
     , m_paused(false)
     , m_sampleRateConverter(nullptr)
-    , m_isGateClosed(false)
-    , m_holdCounter(0)
-    , m_gain(1.0f)
+    , m_spectrumAnalyzer(nullptr)
+    , m_beatTracker(nullptr)
+    , m_fileInput(false)
+    , m_captureMinutes(0)
+    , m_captureFloat(false)
+    , m_captureReady(false)
+    , m_netOutputPort(0)
+    , m_netInputPort(0)
+    , m_netInput(false)
+    , m_idleFrameRemainder(0)
+    , m_chainRunning(true)
+    , m_noiseGate(0)
     , noiseGateDB(-20)
 {
 }
@@ -204,18 +74,23 @@ AudioThread::~AudioThread()
 {
     stop();
     wait(); // Ensure the thread has finished
+    stopRecording();
 }
 
 void AudioThread::stop()
 {
     qCDebug(audioCategory) << "Stopping AudioThread";
+    QMutexLocker lock(&m_pauseMutex);
     m_running = false;
+    m_pauseCondition.wakeAll();
 }
 
 void AudioThread::run()
 {
     // Set thread priority to highest to minimize preemption
     QThread::currentThread()->setPriority(QThread::TimeCriticalPriority);
+    // SCHED_FIFO, affinity and FTZ/DAZ as configured on the command line
+    Realtime::promoteCurrentThread("Audio");
 
     m_running = true;
     qCDebug(audioCategory) << "AudioThread started";
@@ -236,7 +111,7 @@ void AudioThread::run()
     }
 
     // ----------------------------------------------------------
-    // 2) Initialize Audio Effects: SoundTouch and libsamplerate
+    // 2) Initialize Audio Effects: pitch engine and libsamplerate
     // ----------------------------------------------------------
     initializeAudioEffects();
 
@@ -253,17 +128,20 @@ void AudioThread::run()
     // ----------------------------------------------------------
     // 4) Start Audio Streams
     // ----------------------------------------------------------
-    QIODevice* inputIO = m_audioSource->start();
+    const bool fileInput = m_fileInput.load();
+    const bool netInput = m_netInput.load();
+    const bool pulledInput = fileInput || netInput;
+    QIODevice* inputIO = pulledInput ? nullptr : m_audioSource->start();
     QIODevice* outputIO = m_audioSink->start();
 
-    if (!inputIO) {
+    if (!inputIO && !pulledInput) {
         qCWarning(audioCategory) << "Failed to start QAudioSource!";
     }
     if (!outputIO) {
         qCWarning(audioCategory) << "Failed to start QAudioSink!";
     }
 
-    if (!inputIO || !outputIO) {
+    if ((!inputIO && !pulledInput) || !outputIO) {
         qCWarning(audioCategory) << "Failed to start QAudioSource or QAudioSink input/output!";
         m_running = false;
         cleanup();
@@ -275,22 +153,35 @@ void AudioThread::run()
     // ----------------------------------------------------------
     qCDebug(audioCategory) << "AudioThread: Starting main loop";
     int counter = 0;
+    bool resyncDrift = false;
+    const int inputRate = m_inputFormat.sampleRate();
+    const int processingRate = m_processingRate;
 
     while (m_running) {
-        bool was_pitched = false;
-        bool was_distorted = false;
-        bool was_filtered = false;
+        bool was_processed = false;
 
         if (m_paused) {
-            QThread::msleep(10);
+            waitWhilePaused();
+            resyncDrift = true;
             continue;
         }
 
-        if (m_audioSource->bytesAvailable() == 0) {
+        if (pulledInput) {
+            // A file has no clock of its own, and the network input is
+            // resampled onto ours: produce a block whenever the sink has
+            // drained to half its buffer
+            if (m_audioSink->bytesFree() < m_audioSink->bufferSize() / 2) {
+                QThread::msleep(2);
+                continue;
+            }
+        } else if (m_audioSource->bytesAvailable() == 0) {
             QThread::msleep(5);
             continue;
         }
 
+        // Everything from here to the end of the block must be real-time safe
+        RtSanitizer::Section rtSection;
+
         // Fetch latest parameters before processing
         float pitchFactor;
         float distortionGain;
@@ -305,21 +196,50 @@ void AudioThread::run()
             highFreq        = static_cast<float>(m_mainWindow->m_highBandFreq);
         }
 
-        // Update SoundTouch pitch if changed
-        if (std::fabs(pitchFactor - 1.0f) > 0.0001f) {
-            float pitchSemiTones = 12.0f * qLn(pitchFactor) / qLn(2.0f);
-            m_soundTouch.setPitchSemiTones(pitchSemiTones);
-        } else {
-            m_soundTouch.setPitchSemiTones(0.0f);
-        }
+        const bool pitchShifted = std::fabs(pitchFactor - 1.0f) > 0.0001f;
+        const bool gateEnabled = m_noiseGate.load(std::memory_order_relaxed) < 0;
+
+        // The chain redesigns its filter and re-selects the fused
+        // kernels only when the parameters change
+        DspParameters parameters;
+        parameters.gateEnabled     = gateEnabled;
+        parameters.gateThresholdDb = static_cast<float>(noiseGateDB);
+        parameters.pitchSemitones  = pitchShifted ? 12.0f * qLn(pitchFactor) / qLn(2.0f) : 0.0f;
+        parameters.distortionGain  = distortionGain;
+        parameters.filter          = static_cast<DspFilter>(currentFilterIdx);
+        parameters.lowFreq         = lowFreq;
+        parameters.highFreq        = highFreq;
+        m_dsp.setParameters(parameters);
+        const bool chainActive = m_dsp.isActive();
 
         // ---------------------------
-        //  Read from microphone
+        //  Read from microphone (or
+        //  straight out of the mapped file,
+        //  or the network jitter buffer)
         // ---------------------------
         QByteArray inputBuffer;
-        qint64 readSize = qMin(m_audioSource->bytesAvailable(), m_chunkSize);
-        inputBuffer.resize(readSize);
-        qint64 len = inputIO->read(inputBuffer.data(), readSize);
+        qint64 len = 0;
+        if (netInput) {
+            // Always a full block; lost or late packets are concealed
+            inputBuffer.resize(m_chunkSize);
+            m_netReceiver.read(reinterpret_cast<qint16*>(inputBuffer.data()),
+                               m_chunkSize / (m_inChannels * m_inBytesPerSample));
+            len = m_chunkSize;
+        } else if (fileInput) {
+            inputBuffer.resize(m_chunkSize);
+            const int frames = m_fileSource.read(reinterpret_cast<qint16*>(inputBuffer.data()),
+                                                 m_chunkSize / (m_inChannels * m_inBytesPerSample));
+            len = static_cast<qint64>(frames) * m_inChannels * m_inBytesPerSample;
+            if (len <= 0) {
+                // End of a file that does not loop; wait for a seek
+                QThread::msleep(5);
+                continue;
+            }
+        } else {
+            qint64 readSize = qMin(m_audioSource->bytesAvailable(), m_chunkSize);
+            inputBuffer.resize(readSize);
+            len = inputIO->read(inputBuffer.data(), readSize);
+        }
         if (len <= 0) {
             QThread::msleep(1);
             continue;
@@ -334,89 +254,168 @@ void AudioThread::run()
         }
 
         // ---------------------------
-        // Convert Int16 to Float +
-        //  Sample Rate Conversion if needed
+        // Voice activity: once the input has
+        //  stayed at digital silence (or below
+        //  a gate that mutes) for longer than
+        //  the chain's tail, skip conversion
+        //  and effects and send silence. A gate
+        //  that only lowers the level must not
+        //  end the block: its output is input *
+        //  floor, not zeros
         // ---------------------------
-        QByteArray convertedBuffer;
-        if (m_inputFormat.sampleRate() != m_outputFormat.sampleRate()) {
-            // Always convert to float
-            performSampleRateConversionToFloat(
-                inputBuffer, convertedBuffer,
-                m_inputFormat.sampleRate(),
-                m_outputFormat.sampleRate(),
-                m_inChannels
-                );
+        const qint16* pcm = reinterpret_cast<const qint16*>(inputBuffer.constData());
+        const int pcmSamples = static_cast<int>(len / sizeof(qint16));
+        const int inputFrames = pcmSamples / std::max(m_inChannels, 1);
+        const bool gateMutes = gateEnabled && m_dsp.gateFloor() <= kMutingGateFloor;
+        m_voiceActivity.setThreshold(gateMutes ? static_cast<float>(noiseGateDB) : kSilenceThresholdDb);
+        m_voiceActivity.setHangover(static_cast<int>(
+            static_cast<qint64>(m_dsp.tailFrames()) * inputRate / processingRate));
+        const bool voiceActive = m_voiceActivity.process(pcm, pcmSamples, m_inChannels);
+        m_dryRecorder.write(pcm, inputFrames);
+        m_inputCapture.write(pcm, inputFrames);
+
+        int numSamples = 0;
+        if (!voiceActive) {
+            // The tail has rung out and the input is silent or muted by the
+            // gate, so every stage is (close to) silent; emit the matching
+            // number of zero frames at the processing rate
+            const qint64 scaled = static_cast<qint64>(inputFrames) * processingRate + m_idleFrameRemainder;
+            m_idleFrameRemainder = scaled % inputRate;
+            numSamples = static_cast<int>(scaled / inputRate) * m_inChannels;
+            m_blockBuffer.assign(numSamples, 0.0f);
+            m_dsp.bypass();
+        } else if (!chainActive && inputRate == processingRate) {
+            // ---------------------------
+            // Pass-through: nothing to apply,
+            //  so the one Int16 -> float
+            //  conversion writes the block directly
+            // ---------------------------
+            numSamples = pcmSamples;
+            m_blockBuffer.resize(numSamples);
+            const float scale = 1.0f / 32768.0f;
+            for (int i = 0; i < numSamples; ++i)
+                m_blockBuffer[i] = pcm[i] * scale;
+            m_dsp.bypass();
         } else {
-            // If sample rates match, just do int16->float here
-            convertedBuffer = int16ToFloat(inputBuffer, m_inChannels);
-        }
+            // ---------------------------
+            // Convert Int16 to Float +
+            //  Sample Rate Conversion to the
+            //  processing rate if needed
+            // ---------------------------
+            QByteArray convertedBuffer;
+            if (inputRate != processingRate) {
+                // Always convert to float
+                performSampleRateConversionToFloat(
+                    inputBuffer, convertedBuffer,
+                    inputRate,
+                    processingRate,
+                    m_inChannels
+                    );
+            } else {
+                // If sample rates match, just do int16->float here
+                convertedBuffer = int16ToFloat(inputBuffer, m_inChannels);
+            }
 
-        // ---------------------------
-        // Apply Noise Gate (float)
-        // ---------------------------
-        int dBValue = m_mainWindow->getNoiseGate();
-        if (dBValue < 0) {
-            applyNoiseGate(convertedBuffer, m_outputFormat.sampleRate());
+            // ---------------------------
+            // Convert to float array
+            // ---------------------------
+            numSamples = convertedBuffer.size() / sizeof(float);
+            const float* converted = reinterpret_cast<const float*>(convertedBuffer.constData());
+            m_blockBuffer.assign(converted, converted + numSamples);
+            float* samples = m_blockBuffer.data();
+            const int frames = numSamples / std::max(m_inChannels, 1);
+
+            // ---------------------------
+            // Gate -> pitch -> distortion ->
+            //  band filter -> EQ -> convolution
+            // ---------------------------
+            m_dsp.process(samples, samples, frames);
+            was_processed = true;
         }
 
-        // ---------------------------
-        // Convert to float array
-        // ---------------------------
-        int numSamples = convertedBuffer.size() / sizeof(float);
-        std::vector<float> inputSamples(numSamples);
-        std::memcpy(inputSamples.data(), convertedBuffer.constData(), numSamples * sizeof(float));
-
-        // ---------------------------
-        // Pitch Shifting
-        // ---------------------------
-        if (std::fabs(pitchFactor - 1.0f) > 0.0001f) {
-            applyPitchShifting(inputSamples.data(), numSamples, convertedBuffer);
-            // Re-copy pitched samples back into inputSamples
-            std::memcpy(inputSamples.data(), convertedBuffer.data(), numSamples * sizeof(float));
-            was_pitched = true;
+        if (voiceActive != m_chainRunning) {
+            m_chainRunning = voiceActive;
+            qCDebug(audioCategory) << (voiceActive ? "Voice activity: effect chain running"
+                                                   : "Silence: effect chain bypassed");
         }
 
         // ---------------------------
-        // Distortion
+        // Clock-drift compensation:
+        //  keep the sink fill level constant by
+        //  resampling with a PI-controlled ratio
+        //  (also the one conversion from the
+        //  processing rate to the sink rate)
         // ---------------------------
-        if (std::fabs(distortionGain - 1.0f) > 0.0001f) {
-            applyDistortion(inputSamples.data(), numSamples, distortionGain);
-            was_distorted = true;
-        }
+        const float* processed = m_blockBuffer.data();
+        const int processedFrames = numSamples / std::max(m_inChannels, 1);
+        const char* outData = reinterpret_cast<const char*>(processed);
+        qint64 outBytes = static_cast<qint64>(numSamples) * sizeof(float);
+        if (m_driftCompensator.isValid() && m_inChannels > 0) {
+            if (resyncDrift) {
+                // The sink drained while paused; re-latch the target fill
+                m_driftCompensator.reset();
+                resyncDrift = false;
+            }
+            int queuedBytes = m_audioSink->bufferSize() - m_audioSink->bytesFree();
+            int queuedFrames = std::max(queuedBytes, 0) / m_outputFormat.bytesPerFrame();
+            m_driftCompensator.update(queuedFrames, processedFrames);
 
-        // ---------------------------
-        // Band Filter (Float)
-        // ---------------------------
-        if (currentFilterIdx != 0) {
-            applyBandFilterFloat(inputSamples.data(), numSamples, currentFilterIdx,
-                                 lowFreq, highFreq, m_outputFormat.sampleRate());
-            was_filtered = true;
+            int outFrames = m_driftCompensator.process(processed, processedFrames, m_driftOutput);
+            outData  = reinterpret_cast<const char*>(m_driftOutput.data());
+            outBytes = static_cast<qint64>(outFrames) * m_inChannels * sizeof(float);
         }
 
-        // ---------------------------
-        // Copy final samples back to QByteArray
-        // for output to speakers
-        // ---------------------------
-        std::memcpy(convertedBuffer.data(), inputSamples.data(), numSamples * sizeof(float));
-
         // Write to speaker
-        qint64 bytesWritten = outputIO->write(convertedBuffer);
+        qint64 bytesWritten = outputIO->write(outData, outBytes);
         if (bytesWritten <= 0) {
-            qWarning() << "Failed to write audio data to output! Bytes queued:" << convertedBuffer.size();
+            qWarning() << "Failed to write audio data to output! Bytes queued:" << outBytes;
+        }
+        if (m_inChannels > 0) {
+            const float* written = reinterpret_cast<const float*>(outData);
+            const int writtenFrames = static_cast<int>(outBytes / (m_inChannels * sizeof(float)));
+            m_wetRecorder.write(written, writtenFrames);
+            m_outputCapture.write(written, writtenFrames);
+            m_sharedOutput.write(written, writtenFrames);
+            m_netSender.write(written, writtenFrames);
         }
 
-        // Emit audio level for UI level meter (float)
-        float level = computeLevel(convertedBuffer);
-        emit levelChanged(level);
+        // Publish meter readings and analysis blocks; the UI polls
+        // them at display rate, the FFT and tempo tracking run on their own threads
+        m_meter.process(processed, processedFrames);
+        if (m_spectrumAnalyzer) {
+            m_spectrumAnalyzer->pushSamples(processed, processedFrames, m_inChannels);
+        }
+        if (m_beatTracker) {
+            m_beatTracker->pushSamples(processed, processedFrames, m_inChannels);
+        }
 
         // Log occasional debug info (not every block)
         ++counter;
         if (counter >= 100) {
             counter = 0;
             qDebug("Wrote to output - Bytes: %lld", static_cast<long long>(bytesWritten));
-            if (was_pitched)    qDebug("Pitch shifted");
-            if (was_distorted)  qDebug("Distorted");
-            if (was_filtered)   qDebug("Filtered");
+            const PitchEngine* pitchEngine = was_processed ? m_dsp.activePitchEngine() : nullptr;
+            if (pitchEngine) {
+                qCDebug(audioCategory) << "Pitch shifted:" << pitchEngine->name()
+                                       << "latency" << pitchEngine->latencyFrames() << "frames,"
+                                       << pitchEngine->nsPerSample() << "ns/sample";
+            }
+            if (was_processed && parameters.distortionGain != 1.0f)     qDebug("Distorted");
+            if (was_processed && parameters.filter != DspFilter::None)  qDebug("Filtered");
+            qCDebug(audioCategory) << "Drift ratio:" << m_driftCompensator.ratio()
+                                   << "target fill:" << m_driftCompensator.targetFill();
+            if (netInput) {
+                const NetReceiverStats net = m_netReceiver.stats();
+                qCDebug(audioCategory) << "Network input: end-to-end" << net.endToEndMs() << "ms (transit"
+                                       << net.transitMs << "buffer" << net.bufferMs << "target" << net.targetMs
+                                       << ") jitter" << net.jitterMs << "ms, lost" << net.packetsLost
+                                       << "late" << net.packetsLate << "underruns" << net.underruns;
+            }
+            if (m_netSender.isOpen()) {
+                const NetSenderStats net = m_netSender.stats();
+                qCDebug(audioCategory) << "Network output:" << net.packetsSent << "packets sent,"
+                                       << net.packetsDropped << "dropped";
+            }
         }
     }
 
@@ -425,7 +424,7 @@ void AudioThread::run()
 }
 
 // ----------------------------------------------------------
-// 3. Additional Member Functions
+// 2. Additional Member Functions
 // ----------------------------------------------------------
 
 void AudioThread::setVolume(int value)
@@ -436,55 +435,104 @@ void AudioThread::setVolume(int value)
     }
 }
 
-void AudioThread::applyNoiseGate(QByteArray &inBuffer, int sampleRate)
+bool AudioThread::loadImpulseResponse(const QString& path, QString* error)
 {
-    if (inBuffer.isEmpty()) return;
+    std::vector<float> samples;
+    WavFormat format;
+    if (!readWavFile(path, samples, format, error)) {
+        qCWarning(audioCategory) << "Failed to read impulse response" << path;
+        return false;
+    }
+    if (!m_dsp.setImpulseResponse(samples, format.channels, format.sampleRate)) {
+        if (error)
+            *error = QStringLiteral("Impulse response is empty or could not be resampled");
+        return false;
+    }
+    qCDebug(audioCategory) << "Loaded impulse response" << path << format.frames() << "frames";
+    return true;
+}
 
-    // Convert from dB to linear
-    float thresholdLinear = std::pow(10.0f, noiseGateDB / 20.0f);
+bool AudioThread::startRecording(const QString& dryPath, const QString& wetPath, QString* error)
+{
+    stopRecording();
 
-    // Attack/Release in milliseconds
-    const int attackMs = 10;
-    const int releaseMs = 50;
-    int attackSamples  = static_cast<int>((sampleRate * attackMs) / 1000.0f);
-    int releaseSamples = static_cast<int>((sampleRate * releaseMs) / 1000.0f);
+    // The formats are known once the devices are open
+    if (m_processingRate.load() <= 0 || !m_outputFormat.isValid()) {
+        if (error)
+            *error = QStringLiteral("Audio is not running");
+        return false;
+    }
 
-    // The dynamic reduction based on noiseGateDB
-    float reduction = 1.0f - std::pow(10.0f, noiseGateDB / 20.0f);
-    reduction = std::clamp(reduction, 0.0f, 0.9f);
+    if (!dryPath.isEmpty() && !m_dryRecorder.start(dryPath, RecordFormat::Int16, m_inChannels,
+                                                   m_inputFormat.sampleRate(), error)) {
+        return false;
+    }
+    if (!wetPath.isEmpty() && !m_wetRecorder.start(wetPath, RecordFormat::Float32, m_inChannels,
+                                                   m_outputFormat.sampleRate(), error)) {
+        m_dryRecorder.stop();
+        return false;
+    }
+    return true;
+}
 
-    float *samples = reinterpret_cast<float*>(inBuffer.data());
-    int numSamples = inBuffer.size() / sizeof(float);
+void AudioThread::stopRecording()
+{
+    m_dryRecorder.stop();
+    m_wetRecorder.stop();
+    if (m_dryRecorder.droppedFrames() > 0 || m_wetRecorder.droppedFrames() > 0) {
+        qCWarning(audioCategory) << "Recording lost" << m_dryRecorder.droppedFrames() << "dry and"
+                                 << m_wetRecorder.droppedFrames() << "wet frames; the disk did not keep up";
+    }
+}
 
-    for (int i = 0; i < numSamples; ++i) {
-        float sample = samples[i];
-        float level = std::fabs(sample);
+double AudioThread::inputFileProgress() const
+{
+    if (!m_fileInput.load())
+        return -1.0;
+    const qint64 length = m_fileSource.lengthFrames();
+    return length > 0 ? static_cast<double>(m_fileSource.positionFrames()) / length : 0.0;
+}
 
-        if (level < thresholdLinear) {
-            if (!m_isGateClosed) {
-                m_isGateClosed = true;
-                m_holdCounter = 0;
-            }
-            if (m_gain > reduction) {
-                float gainStep = (1.0f - reduction) / static_cast<float>(releaseSamples);
-                m_gain -= gainStep;
-                m_gain = std::max(m_gain, reduction);
-            }
-        } else {
-            if (m_isGateClosed) {
-                m_holdCounter++;
-                if (m_holdCounter > attackSamples) {
-                    m_isGateClosed = false;
-                }
-            }
-            if (m_gain < 1.0f) {
-                float gainStep = (1.0f - reduction) / static_cast<float>(attackSamples);
-                m_gain += gainStep;
-                m_gain = std::min(m_gain, 1.0f);
-            }
-        }
-        samples[i] *= m_gain;
+void AudioThread::seekInputFile(double fraction)
+{
+    if (!m_fileInput.load())
+        return;
+    const double clamped = std::clamp(fraction, 0.0, 1.0);
+    m_fileSource.seek(static_cast<qint64>(clamped * m_fileSource.lengthFrames()));
+}
+
+bool AudioThread::saveCapture(const QString& dryPath, const QString& wetPath, QString* error)
+{
+    if (!m_captureReady.load(std::memory_order_acquire)) {
+        if (error)
+            *error = QStringLiteral("Capture is off");
+        return false;
     }
+    if (isSavingCapture()) {
+        if (error)
+            *error = QStringLiteral("A save is still running");
+        return false;
+    }
+
+    bool started = false;
+    if (m_inputCapture.isAllocated() && !dryPath.isEmpty())
+        started = m_inputCapture.save(dryPath, 0, error) || started;
+    if (m_outputCapture.isAllocated() && !wetPath.isEmpty())
+        started = m_outputCapture.save(wetPath, 0, error) || started;
+    return started;
+}
+
+bool AudioThread::captureSaveResult(QString* error)
+{
+    if (!m_captureReady.load(std::memory_order_acquire))
+        return true;
+    QString inputError;
+    QString outputError;
+    const bool inputOk = m_inputCapture.lastSaveResult(&inputError);
+    const bool outputOk = m_outputCapture.lastSaveResult(&outputError);
+    if (error)
+        *error = outputOk ? inputError : outputError;
+    return inputOk && outputOk;
 }
 
 void AudioThread::cleanup()
@@ -500,6 +548,10 @@ void AudioThread::cleanup()
     m_audioSource = nullptr;
     m_audioSink   = nullptr;
 
+    m_sharedOutput.close();
+    m_netSender.close();
+    m_netReceiver.close();
+
     // Cleanup libsamplerate
     if (m_sampleRateConverter) {
         src_delete(m_sampleRateConverter);
@@ -521,23 +573,47 @@ int AudioThread::getSampleRate() const
         qCWarning(audioCategory) << "[Error] Invalid Sample Rate!";
         return 0;
     }
-    return m_outputFormat.sampleRate();
+    const int rate = m_processingRate.load();
+    return rate > 0 ? rate : m_outputFormat.sampleRate();
 }
 
 void AudioThread::pause()
 {
     qDebug() << "[AudioThread] Paused.";
+    QMutexLocker lock(&m_pauseMutex);
     m_paused = true;
 }
 
 void AudioThread::resume()
 {
     qDebug() << "[AudioThread] Resumed.";
+    QMutexLocker lock(&m_pauseMutex);
     m_paused = false;
+    m_pauseCondition.wakeAll();
+}
+
+void AudioThread::waitWhilePaused()
+{
+    // Stop the devices and sleep until resume() or stop(); no polling
+    if (m_audioSource)
+        m_audioSource->suspend();
+    m_audioSink->suspend();
+    {
+        QMutexLocker lock(&m_pauseMutex);
+        while (m_paused && m_running)
+            m_pauseCondition.wait(&m_pauseMutex);
+    }
+    if (m_audioSource)
+        m_audioSource->resume();
+    m_audioSink->resume();
+
+    // Nothing before the pause belongs to the new audio
+    m_voiceActivity.reset();
+    m_dsp.bypass();
 }
 
 // ----------------------------------------------------------
-// 4. Initialization
+// 3. Initialization
 // ----------------------------------------------------------
 
 void AudioThread::initializeAudioDevices()
@@ -556,6 +632,31 @@ void AudioThread::initializeAudioDevices()
     m_inputFormat.setSampleFormat(QAudioFormat::Int16);
     m_outputFormat.setSampleFormat(QAudioFormat::Float);
 
+    // An input file replaces the microphone; its layout becomes the input format
+    if (!m_inputFilePath.isEmpty()) {
+        QString error;
+        if (m_fileSource.open(m_inputFilePath, &error)) {
+            m_inputFormat.setSampleRate(m_fileSource.format().sampleRate);
+            m_inputFormat.setChannelCount(m_fileSource.format().channels);
+            m_fileInput = true;
+        } else {
+            qCWarning(audioCategory) << "Cannot play" << m_inputFilePath << "-" << error
+                                     << "- using the microphone";
+        }
+    }
+
+    // So can a network stream; it is resampled to the input format, which
+    // therefore stays as the device prefers
+    if (!m_fileInput && m_netInputPort > 0) {
+        QString error;
+        if (m_netReceiver.open(m_netInputPort, m_inputFormat.channelCount(), m_inputFormat.sampleRate(), &error)) {
+            m_netInput = true;
+        } else {
+            qCWarning(audioCategory) << "No network input on port" << m_netInputPort << "-" << error
+                                     << "- using the microphone";
+        }
+    }
+
     // Debug logs for input format
     qCDebug(audioCategory) << "Input format in use:"
                            << "  SampleRate =" << m_inputFormat.sampleRate()
@@ -569,10 +670,14 @@ void AudioThread::initializeAudioDevices()
                            << "  SampleFormat ="<< m_outputFormat.sampleFormat();
 
     // Create QAudioSource and QAudioSink
-    m_audioSource = new QAudioSource(inputDevice, m_inputFormat, nullptr);
-    if (m_audioSource->isNull()) {
-        qCWarning(audioCategory) << "QAudioSource is not available!";
-        m_running = false;
+    if (!m_fileInput && !m_netInput) {
+        m_audioSource = new QAudioSource(inputDevice, m_inputFormat, nullptr);
+        if (m_audioSource->isNull()) {
+            qCWarning(audioCategory) << "QAudioSource is not available!";
+            m_running = false;
+        }
+        connect(m_audioSource, &QAudioSource::stateChanged, this, &AudioThread::handleAudioSourceStateChanged);
+        m_audioSource->setVolume(1.0);
     }
 
     m_audioSink = new QAudioSink(outputDevice, m_outputFormat, nullptr);
@@ -581,10 +686,8 @@ void AudioThread::initializeAudioDevices()
         m_running = false;
     }
 
-    connect(m_audioSource, &QAudioSource::stateChanged, this, &AudioThread::handleAudioSourceStateChanged);
     connect(m_audioSink,   &QAudioSink::stateChanged,   this, &AudioThread::handleAudioSinkStateChanged);
 
-    m_audioSource->setVolume(1.0);
     m_audioSink->setVolume(1.0);
 
     // Calculate bytes per sample and channels
@@ -607,16 +710,30 @@ void AudioThread::initializeAudioDevices()
 
 void AudioThread::initializeAudioEffects()
 {
-    // Initialize SoundTouch
-    m_soundTouch.setSampleRate(m_inputFormat.sampleRate());
-    m_soundTouch.setChannels(m_inputFormat.channelCount());
-    m_soundTouch.setPitchSemiTones(0.0f);
-    m_soundTouch.setTempo(1.0f);
-    m_soundTouch.setRate(1.0f);
-    m_soundTouch.setSetting(SETTING_USE_AA_FILTER, 1);
-    m_soundTouch.setSetting(SETTING_SEQUENCE_MS,   40);
-    m_soundTouch.setSetting(SETTING_SEEKWINDOW_MS, 15);
-    m_soundTouch.setSetting(SETTING_OVERLAP_MS,    8);
+    // Every stage below runs at the processing rate; only the input
+    // conversion and the drift compensator see the device rates
+    const int sinkRate = m_outputFormat.sampleRate();
+    m_processingRate = sinkRate;
+    if (m_requestedProcessingRate > 0 && m_requestedProcessingRate < sinkRate)
+        m_processingRate = m_requestedProcessingRate;
+
+    // Drift compensation runs on the processed stream and does the
+    // upsampling to the sink rate in the same pass. Its largest block is
+    // one input chunk after conversion to the processing rate, with the
+    // same 20% slack the input converter allows
+    const int inputRate = m_inputFormat.sampleRate();
+    const int chunkFrames = m_chunkSize / std::max(m_inChannels * m_inBytesPerSample, 1);
+    const int maxBlockFrames = static_cast<int>(
+        std::ceil(chunkFrames * static_cast<double>(m_processingRate) / std::max(inputRate, 1) * 1.2));
+    if (!m_driftCompensator.init(m_inChannels, m_processingRate, sinkRate, maxBlockFrames)) {
+        if (m_processingRate != sinkRate) {
+            qCWarning(audioCategory) << "No converter to the sink rate; processing at" << sinkRate << "Hz";
+            m_processingRate = sinkRate;
+        }
+        qCWarning(audioCategory) << "Drift compensator unavailable; running without clock-drift correction";
+    }
+    m_driftOutput.assign(static_cast<size_t>(m_driftCompensator.maxOutputFrames()) * m_inChannels, 0.0f);
+    qCDebug(audioCategory) << "Processing rate:" << m_processingRate << "Hz";
 
     int error;
     m_sampleRateConverter = src_new(SRC_SINC_FASTEST, m_inputFormat.channelCount(), &error);
@@ -624,46 +741,59 @@ void AudioThread::initializeAudioEffects()
         qCWarning(audioCategory) << "libsamplerate initialization failed:" << src_strerror(error);
         m_running = false;
     }
+
+    // Every effect stage, including the pitch engine (installed directly,
+    // the loop has not started yet)
+    m_dsp.setFormat(m_inChannels, m_processingRate);
+
+    m_meter.setChannels(m_inChannels);
+
+    // Shared-memory output at the sink rate, as written to the sink
+    if (!m_sharedOutputName.isEmpty()) {
+        QString error;
+        if (!m_sharedOutput.open(m_sharedOutputName, m_inChannels, sinkRate, 2.0, &error))
+            qCWarning(audioCategory) << "No shared output" << m_sharedOutputName << "-" << error;
+    }
+
+    // Network output, likewise at the sink rate
+    if (m_netOutputPort > 0) {
+        QString error;
+        if (!m_netSender.open(m_netOutputHost, m_netOutputPort, m_inChannels, sinkRate, 5.0, &error))
+            qCWarning(audioCategory) << "No network output to" << m_netOutputHost << m_netOutputPort << "-" << error;
+    }
+
+    // Capture rings, the budget split by data rate. Allocated here because
+    // the device formats are only known now; the UI thread touches the rings
+    // only once m_captureReady is set, which happens once, after both are
+    // allocated. They are released by the destructor, after the thread ends.
+    if (m_captureMinutes > 0 && !m_captureReady.load(std::memory_order_relaxed)) {
+        const int seconds = m_captureMinutes * 60;
+        const qint64 inputRate  = static_cast<qint64>(m_inputFormat.sampleRate()) * 2;
+        const qint64 outputRate = static_cast<qint64>(sinkRate) * (m_captureFloat ? 4 : 2);
+        const qint64 inputBudget = kCaptureBudgetBytes * inputRate / (inputRate + outputRate);
+        const bool inputOk = m_inputCapture.allocate(m_inChannels, m_inputFormat.sampleRate(), seconds,
+                                                     RecordFormat::Int16, inputBudget);
+        const bool outputOk = m_outputCapture.allocate(m_inChannels, sinkRate, seconds,
+                                                       m_captureFloat ? RecordFormat::Float32 : RecordFormat::Int16,
+                                                       kCaptureBudgetBytes - inputBudget);
+        m_captureReady.store(inputOk || outputOk, std::memory_order_release);
+    }
+    if (m_spectrumAnalyzer) {
+        m_spectrumAnalyzer->setSampleRate(m_processingRate);
+    }
+    if (m_beatTracker) {
+        m_beatTracker->setSampleRate(m_processingRate);
+    }
 }
 
 void AudioThread::initializeFilters()
 {
-    int filterIdx;
-    float lowFreq, highFreq;
-    {
-        QMutexLocker lock(&m_parametersMutex);
-        filterIdx = m_mainWindow->m_filterIndex;
-        lowFreq   = static_cast<float>(m_mainWindow->m_lowBandFreq);
-        highFreq  = static_cast<float>(m_mainWindow->m_highBandFreq);
-    }
-
-    // Set up the chosen filter once. If you want dynamic changes,
-    // you can call updateFilter(...) from the UI
-    switch (filterIdx) {
-    case 1: // Low Pass
-        m_biquadFilter.setupLowPass(lowFreq, m_inputFormat.sampleRate());
-        break;
-    case 2: // High Pass
-        m_biquadFilter.setupHighPass(highFreq, m_inputFormat.sampleRate());
-        break;
-    case 3: // Band Pass
-        m_biquadFilter.setupBandPass((lowFreq + highFreq) * 0.5f,
-                                     (highFreq - lowFreq),
-                                     m_inputFormat.sampleRate());
-        break;
-    case 4: // Notch
-        m_biquadFilter.setupNotch((lowFreq + highFreq) * 0.5f,
-                                  (highFreq - lowFreq),
-                                  m_inputFormat.sampleRate());
-        break;
-    default:
-        // No filter
-        break;
-    }
+    // The chain is configured from the current parameters before the first
+    // block; setFormat() already reset the filter and gate state
 }
 
 // ----------------------------------------------------------
-// 5. Audio Processing Functions
+// 4. Audio Processing Functions
 // ----------------------------------------------------------
 
 // Always produce float data:
@@ -741,152 +871,8 @@ QByteArray AudioThread::int16ToFloat(const QByteArray &input, int channels)
     return out;
 }
 
-void AudioThread::applyPitchShifting(float* inputSamples, int numSamples, QByteArray& outputBuffer)
-{
-    if (!inputSamples || numSamples <= 0) {
-        qCWarning(audioCategory) << "Invalid input for pitch shifting";
-        return;
-    }
-
-    float pitchFactor;
-    {
-        QMutexLocker lock(&m_parametersMutex);
-        pitchFactor = m_mainWindow->m_pitchFactor;
-    }
-
-    // Crossfade parameters
-    const int minCrossfade = 50;
-    const int maxCrossfade = 256;
-    int crossfadeSamples = static_cast<int>(minCrossfade * std::abs(pitchFactor));
-    crossfadeSamples = std::clamp(crossfadeSamples, minCrossfade, maxCrossfade);
-
-    // Estimate output size
-    int estimatedOutputSize = static_cast<int>(numSamples * pitchFactor) + crossfadeSamples;
-    std::vector<SAMPLETYPE> outputSamples;
-    outputSamples.reserve(std::max(estimatedOutputSize, 0));
-
-    if (m_soundTouch.numUnprocessedSamples() > 8192) {
-        qCWarning(audioCategory) << "SoundTouch buffer risk: clearing old samples.";
-        m_soundTouch.clear();
-    }
-
-    try {
-        m_soundTouch.putSamples(inputSamples, numSamples);
-
-        const int chunkSize = 1024;
-        std::vector<SAMPLETYPE> tempBuffer(chunkSize);
-
-        while (m_soundTouch.numSamples() > 0) {
-            int received = m_soundTouch.receiveSamples(tempBuffer.data(), chunkSize);
-            if (received <= 0) break;
-            outputSamples.insert(outputSamples.end(),
-                                 tempBuffer.begin(),
-                                 tempBuffer.begin() + received);
-        }
-    } catch (const std::exception& e) {
-        qCCritical(audioCategory) << "SoundTouch processing failed:" << e.what();
-        return;
-    }
-
-    // Crossfade with previous pitch output
-    if (!m_previousPitchOutput.isEmpty() && !outputSamples.empty()) {
-        const SAMPLETYPE* prevSamples = reinterpret_cast<const SAMPLETYPE*>(m_previousPitchOutput.constData());
-        int prevSampleCount = m_previousPitchOutput.size() / sizeof(SAMPLETYPE);
-
-        int fadeLength = std::min({crossfadeSamples,
-                                   prevSampleCount,
-                                   static_cast<int>(outputSamples.size())});
-
-        for (int i = 0; i < fadeLength; ++i) {
-            float fadeIn  = 0.5f * (1.0f - std::cos(M_PI * i / fadeLength));
-            float fadeOut = 1.0f - fadeIn;
-            int prevIndex = prevSampleCount - fadeLength + i;
-            outputSamples[i] = static_cast<SAMPLETYPE>(
-                prevSamples[prevIndex] * fadeOut +
-                outputSamples[i]      * fadeIn
-                );
-        }
-    }
-
-    // Save overlap region for next crossfade
-    if (!outputSamples.empty()) {
-        int storeSize = std::min(static_cast<int>(outputSamples.size()), crossfadeSamples);
-        m_previousPitchOutput = QByteArray(
-            reinterpret_cast<const char*>(outputSamples.data() + (outputSamples.size() - storeSize)),
-            storeSize * sizeof(SAMPLETYPE)
-            );
-    }
-
-    // Write output to QByteArray
-    outputBuffer = QByteArray(
-        reinterpret_cast<const char*>(outputSamples.data()),
-        outputSamples.size() * sizeof(SAMPLETYPE)
-        );
-}
-
-void AudioThread::applyDistortion(float* samples, int numSamples, float gain)
-{
-    // Process float in [-1, +1]
-    for (int i = 0; i < numSamples; ++i) {
-        float x = samples[i] * gain;      // apply gain
-        float y = std::tanh(x);           // soft-clip using tanh
-        samples[i] = y;                   // store back
-    }
-}
-
-void AudioThread::applyBandFilterFloat(float* samples, int numSamples,
-                                       int filterIndex, float lowFreq,
-                                       float highFreq, int sampleRate)
-{
-    // Put samples into a std::vector for Biquad
-    std::vector<float> floatBuf(numSamples);
-    for (int i = 0; i < numSamples; ++i) {
-        floatBuf[i] = samples[i];
-    }
-
-    switch (filterIndex) {
-    case 1:
-        m_biquadFilter.applyLowPass(floatBuf, lowFreq, sampleRate);
-        break;
-    case 2:
-        m_biquadFilter.applyHighPass(floatBuf, highFreq, sampleRate);
-        break;
-    case 3:
-        m_biquadFilter.applyBandPass(floatBuf, lowFreq, highFreq, sampleRate);
-        break;
-    case 4:
-        m_biquadFilter.applyBandStop(floatBuf, lowFreq, highFreq, sampleRate);
-        break;
-    default:
-        // No filter
-        break;
-    }
-
-    // Copy back into raw pointer
-    for (int i = 0; i < numSamples; ++i) {
-        samples[i] = floatBuf[i];
-    }
-}
-
-float AudioThread::computeLevel(const QByteArray &buffer)
-{
-    const float* samples = reinterpret_cast<const float*>(buffer.constData());
-    int numSamples = buffer.size() / sizeof(float);
-    if (numSamples == 0) return 0.f;
-
-    float maxVal = 0.f;
-    for (int i = 0; i < numSamples; ++i) {
-        float val = std::fabs(samples[i]);
-        if (val > maxVal) {
-            maxVal = val;
-        }
-    }
-    // For float audio in [-1, +1], maxVal is in [0,1].
-    return maxVal;
-}
-
 // ----------------------------------------------------------
-// 6. State Change Handlers
+// 5. State Change Handlers
 // ----------------------------------------------------------
 
 void AudioThread::handleAudioSourceStateChanged(QAudio::State state)
@@ -908,33 +894,3 @@ void AudioThread::handleAudioSinkStateChanged(QAudio::State state)
         }
     }
 }
-
-// ----------------------------------------------------------
-// 7. Filter Update Function
-// ----------------------------------------------------------
-
-void AudioThread::updateFilter(int filterIdx, float lowFreq, float highFreq, int sampleRate)
-{
-    QMutexLocker lock(&m_parametersMutex);
-    switch (filterIdx) {
-    case 1:
-        m_biquadFilter.setupLowPass(lowFreq, sampleRate);
-        break;
-    case 2:
-        m_biquadFilter.setupHighPass(highFreq, sampleRate);
-        break;
-    case 3:
-        m_biquadFilter.setupBandPass((lowFreq + highFreq) / 2.0f,
-                                     (highFreq - lowFreq),
-                                     sampleRate);
-        break;
-    case 4:
-        m_biquadFilter.setupNotch((lowFreq + highFreq) / 2.0f,
-                                  (highFreq - lowFreq),
-                                  sampleRate);
-        break;
-    default:
-        // No filter
-        break;
-    }
-}
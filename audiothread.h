@@ -2,50 +2,37 @@
 #ifndef AUDIOTHREAD_H
 #define AUDIOTHREAD_H
 
-#include "mainwindow.h"
-
 #include <QThread>
 #include <QAudioSource>
 #include <QAudioSink>
 #include <QAudioFormat>
 #include <QMutex>
+#include <QWaitCondition>
 #include <QByteArray>
 #include <QLoggingCategory>
+#include <atomic>
 #include <vector>
-#include <SoundTouch.h>
 #include <samplerate.h>
 
-// Declare logging category for audio debugging
-Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+#include "dspchain.h"
+#include "capturering.h"
+#include "diskrecorder.h"
+#include "filesource.h"
+#include "netstream.h"
+#include "sharedoutput.h"
+#include "driftcompensator.h"
+#include "audiometer.h"
+#include "voiceactivity.h"
 
-// ----------------------------------------------------------
-// 1. Biquad Filter Class Declaration
-// ----------------------------------------------------------
+class MainWindow;
+class SpectrumAnalyzer;
+class BeatTracker;
 
-class Biquad
-{
-public:
-    Biquad();
-    void setupLowPass(float cutoff, float sampleRate, float Q = 0.7071f);
-    void setupHighPass(float cutoff, float sampleRate, float Q = 0.7071f);
-    void setupBandPass(float centerFreq, float bandwidth, float sampleRate, float Q = 0.7071f);
-    void setupNotch(float centerFreq, float bandwidth, float sampleRate, float Q = 0.7071f);
-
-    float process(float in);
-
-    void applyLowPass(std::vector<float>& buffer, float cutoffHz, int sampleRate);
-    void applyHighPass(std::vector<float>& buffer, float cutoffHz, int sampleRate);
-    void applyBandPass(std::vector<float>& buffer, float centerFreq, float bandwidth, int sampleRate);
-    void applyBandStop(std::vector<float>& buffer, float centerFreq, float bandwidth, int sampleRate);
-    void setNoiseGateDB(int value);
-    int getNoiseGateDB();
-private:
-    float b0, b1, b2, a0, a1, a2;
-    float z1, z2;
-};
+// Declare logging category for audio debugging
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
 
 // ----------------------------------------------------------
-// 2. AudioThread Class Declaration
+// AudioThread Class Declaration
 // ----------------------------------------------------------
 
 class AudioThread : public QThread
@@ -61,12 +48,155 @@ public:
     void resume();
 
     void setVolume(int value);
+
+    /**
+     * @brief Noise gate slider position in dB (any thread): negative values
+     * enable the gate, 0 turns it off. The audio thread reads it every block.
+     */
+    void setNoiseGate(int dB) { m_noiseGate.store(dB, std::memory_order_relaxed); }
+
+    /// Rate the effect chain runs at (the processing rate once the devices are open).
     int getSampleRate() const;
 
-    void updateFilter(int filterIdx, float lowFreq, float highFreq, int sampleRate);
+    /**
+     * @brief Runs the effect chain at a reduced rate, e.g. 16000 or 24000 Hz for
+     * speech. The input is resampled once to this rate and the result once to
+     * the sink rate. 0 (default) or a rate at or above the sink rate processes
+     * at the sink rate. Must be called before start().
+     */
+    void setProcessingRate(int sampleRate) { m_requestedProcessingRate = sampleRate; }
+
+    /**
+     * @brief Drains meter readings published by the audio thread since the
+     * last call. Lock-free; call from the UI thread only.
+     */
+    bool readMeter(MeterReading& reading) { return m_meter.read(reading); }
+
+    /**
+     * @brief Sets the analyzer that receives a copy of every processed block.
+     * Must be called before start().
+     */
+    void setSpectrumAnalyzer(SpectrumAnalyzer* analyzer) { m_spectrumAnalyzer = analyzer; }
+
+    /**
+     * @brief Sets the tempo tracker that receives a copy of every processed block.
+     * Must be called before start().
+     */
+    void setBeatTracker(BeatTracker* tracker) { m_beatTracker = tracker; }
+
+    /**
+     * @brief Queues a parametric EQ band change (UI thread only).
+     * Coefficients are recomputed on the audio thread before the next block.
+     */
+    bool setEqBand(int index, const EqBand& band) { return m_dsp.setEqBand(index, band); }
+
+    /**
+     * @brief Loads a WAV impulse response into the convolution stage (UI thread).
+     * The IR is resampled and partitioned here; the audio thread picks it up lock-free.
+     */
+    bool loadImpulseResponse(const QString& path, QString* error = nullptr);
+    void clearImpulseResponse() { m_dsp.clearImpulseResponse(); }
+    void setConvolutionMix(float wet) { m_dsp.setConvolutionMix(wet); }
+
+    /**
+     * @brief Configures a harmonizer voice (any thread). While at least one voice
+     * has a non-zero gain the harmonizer replaces the single pitch shifter.
+     */
+    void setHarmonyVoice(int index, float semitones, float gain, float pan)
+    {
+        m_dsp.setHarmonyVoice(index, semitones, gain, pan);
+    }
+    void clearHarmonyVoices() { m_dsp.clearHarmonyVoices(); }
+    void setHarmonyDryGain(float gain) { m_dsp.setHarmonyDryGain(gain); }
+
+    /**
+     * @brief Selects the pitch-shift engine (UI thread). The engine is built
+     * here and picked up by the audio thread before its next block.
+     */
+    void setPitchEngine(PitchEngineType type) { m_dsp.setPitchEngine(type); }
+
+    /**
+     * @brief Records the dry input (16-bit, as captured) to @p dryPath and the
+     * processed output (float, as sent to the sink) to @p wetPath while the
+     * audio runs (UI thread). Either path may be empty. The audio thread only
+     * copies into the recorders' rings; their writer threads do the file I/O.
+     */
+    bool startRecording(const QString& dryPath, const QString& wetPath, QString* error = nullptr);
+    void stopRecording();
+    bool isRecording() const { return m_dryRecorder.isRecording() || m_wetRecorder.isRecording(); }
 
-signals:
-    void levelChanged(float level);
+    /**
+     * @brief Plays a WAV/RF64 file (memory-mapped, see FileSource) through the
+     * chain instead of the microphone. Call before start(); if the file cannot
+     * be opened the microphone is used.
+     */
+    void setInputFile(const QString& path, bool loop = true)
+    {
+        m_inputFilePath = path;
+        m_fileSource.setLooping(loop);
+    }
+
+    /// Play position of the input file in [0, 1], or -1 while the microphone is the input. Any thread.
+    double inputFileProgress() const;
+
+    /// Jumps to @p fraction [0, 1] of the input file. Any thread.
+    void seekInputFile(double fraction);
+
+    /**
+     * @brief Keeps the last @p minutes of input and output in memory (see
+     * CaptureRing); call before start(). The input is held as 16-bit, the
+     * output as 16-bit or, with @p floatOutput, as float.
+     */
+    void setCapture(int minutes, bool floatOutput)
+    {
+        m_captureMinutes = minutes;
+        m_captureFloat = floatOutput;
+    }
+
+    /// True once the capture rings are allocated. Any thread.
+    bool hasCapture() const { return m_captureReady.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Writes the captured window to @p dryPath (input) and @p wetPath
+     * (output) on background threads (UI thread).
+     */
+    bool saveCapture(const QString& dryPath, const QString& wetPath, QString* error = nullptr);
+    bool isSavingCapture() const
+    {
+        return hasCapture() && (m_inputCapture.isSaving() || m_outputCapture.isSaving());
+    }
+
+    /// Result of the last saveCapture() once it has finished (UI thread).
+    bool captureSaveResult(QString* error = nullptr);
+
+    /**
+     * @brief Also publishes the output in the shared-memory ring @p name (see
+     * SharedOutput) for other local processes; call before start().
+     */
+    void setSharedOutput(const QString& name) { m_sharedOutputName = name; }
+
+    /**
+     * @brief Also streams the output over UDP to a NetReceiver at @p host:@p port
+     * (see NetSender); call before start().
+     */
+    void setNetworkOutput(const QString& host, int port)
+    {
+        m_netOutputHost = host;
+        m_netOutputPort = port;
+    }
+
+    /**
+     * @brief Plays the NetSender stream arriving on UDP @p port through the
+     * chain instead of the microphone (see NetReceiver); call before start().
+     * If the port cannot be bound the microphone is used.
+     */
+    void setNetworkInput(int port) { m_netInputPort = port; }
+
+    /// Jitter buffer and end-to-end latency of the network input. Any thread.
+    NetReceiverStats networkInputStats() const { return m_netReceiver.stats(); }
+
+    /// Pitch engine trouble counted on the audio thread. Any thread.
+    PitchEngineEvents pitchEngineEvents() const { return m_dsp.pitchEngineEvents(); }
 
 protected:
     void run() override;
@@ -75,26 +205,21 @@ private:
     void initializeAudioDevices();
     void initializeAudioEffects();
     void initializeFilters();
+
     void cleanup();
+    void waitWhilePaused();
 
     void performSampleRateConversionToFloat(const QByteArray& input, QByteArray& output,
                                             int inSampleRate, int outSampleRate, int inChannels);
     QByteArray int16ToFloat(const QByteArray& input, int channels);
 
-    void applyNoiseGate(QByteArray &inBuffer, int sampleRate);
-    void applyPitchShifting(float* inputSamples, int numSamples, QByteArray& outputBuffer);
-    void applyDistortion(float* samples, int numSamples, float gain);
-    void applyBandFilterFloat(float* samples, int numSamples,
-                              int filterIndex, float lowFreq, float highFreq, int sampleRate);
-    float computeLevel(const QByteArray &buffer);
-
     void handleAudioSourceStateChanged(QAudio::State state);
     void handleAudioSinkStateChanged(QAudio::State state);
 
 private:
     MainWindow* m_mainWindow;
-    bool m_running;
-    bool m_paused;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_paused;
 
     QAudioSource* m_audioSource;
     QAudioSink* m_audioSink;
@@ -106,19 +231,61 @@ private:
     int m_inChannels;
     int m_outChannels;
     int m_chunkSize;
+    int m_requestedProcessingRate;
+    std::atomic<int> m_processingRate;    ///< Rate of the whole effect chain (read by the UI)
 
-    soundtouch::SoundTouch m_soundTouch;
     SRC_STATE* m_sampleRateConverter;
 
-    Biquad m_biquadFilter;
+    DspChain m_dsp;                       ///< The effect chain, shared with headless hosts
+
+    AudioMeter m_meter;                   ///< Peak/RMS/true-peak, polled by the UI
+    SpectrumAnalyzer* m_spectrumAnalyzer; ///< Optional FFT worker, fed lock-free
+    BeatTracker* m_beatTracker;           ///< Optional BPM/beat worker, fed lock-free
+
+    DriftCompensator m_driftCompensator;  ///< Keeps sink fill constant across clock domains
+    std::vector<float> m_driftOutput;
+
+    // File input instead of the microphone; paced by the sink
+    QString m_inputFilePath;
+    FileSource m_fileSource;
+    std::atomic<bool> m_fileInput;        ///< m_fileSource is open and feeds the loop
+
+    // Retrospective capture of the last minutes, allocated with the formats
+    int m_captureMinutes;
+    bool m_captureFloat;
+    CaptureRing m_inputCapture;
+    CaptureRing m_outputCapture;
+    std::atomic<bool> m_captureReady;     ///< Rings allocated; hands them to the UI thread
+
+    // Output for local consumers, besides the sink
+    QString m_sharedOutputName;
+    SharedOutput m_sharedOutput;
+
+    // UDP streaming to and from another machine
+    QString m_netOutputHost;
+    int m_netOutputPort;
+    NetSender m_netSender;
+    int m_netInputPort;
+    NetReceiver m_netReceiver;
+    std::atomic<bool> m_netInput;         ///< m_netReceiver is open and feeds the loop instead of the microphone
+
+    DiskRecorder m_dryRecorder;           ///< Captured input, before any processing
+    DiskRecorder m_wetRecorder;           ///< What the sink plays
+
+    // Silence fast path: the chain is skipped once the input has been quiet
+    // for longer than its tail
+    VoiceActivityDetector m_voiceActivity;
+    std::vector<float> m_blockBuffer;     ///< Current block at the processing rate
+    qint64 m_idleFrameRemainder;          ///< Rate-conversion remainder while idle
+    bool m_chainRunning;
 
-    QByteArray m_previousPitchOutput;
+    // Pause blocks the loop on m_pauseCondition instead of polling
+    QMutex m_pauseMutex;
+    QWaitCondition m_pauseCondition;
 
     QMutex m_parametersMutex;
 
-    bool m_isGateClosed;
-    int m_holdCounter;
-    float m_gain;
+    std::atomic<int> m_noiseGate;         ///< Gate slider in dB, published by the UI
     int noiseGateDB;
 };
 
@@ -0,0 +1,110 @@
+#include "beattracker.h"
+#include "realtime.h"
+
+#include <BPMDetect.h>
+
+#include <QLoggingCategory>
+#include <algorithm>
+
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+
+namespace {
+// Beats fetched from the detector per update; a 500 ms update holds at most two.
+const int kMaxBeatsPerUpdate = 64;
+}
+
+BeatTracker::BeatTracker(QObject* parent)
+    : QThread(parent)
+    , m_running(false)
+    , m_sampleRate(48000)
+    , m_detectorRate(0)
+    , m_framesAnalyzed(0)
+    , m_framesSinceUpdate(0)
+    , m_bpm(0.0f)
+    , m_lastBeat(-1.0)
+    , m_analyzed(0.0)
+{
+}
+
+BeatTracker::~BeatTracker()
+{
+    stop();
+    wait();
+}
+
+void BeatTracker::stop()
+{
+    m_running = false;
+}
+
+void BeatTracker::pushSamples(const float* interleaved, int frames, int channels)
+{
+    while (frames > 0) {
+        AudioBlock* block = m_ring.beginWrite();
+        if (!block)
+            return; // worker is behind; the tempo estimate tolerates a gap
+        int used = block->assign(interleaved, frames, channels);
+        m_ring.commitWrite();
+        interleaved += static_cast<size_t>(used) * std::max(channels, 1);
+        frames -= used;
+    }
+}
+
+void BeatTracker::run()
+{
+    m_running = true;
+    Realtime::flushDenormals();
+    qCDebug(audioCategory) << "BeatTracker started";
+
+    while (m_running) {
+        const int sampleRate = m_sampleRate.load();
+        if (sampleRate != m_detectorRate)
+            restart(sampleRate);
+
+        const AudioBlock* block = m_ring.beginRead();
+        if (!block) {
+            QThread::msleep(10);
+            continue;
+        }
+
+        m_detector->inputSamples(block->samples, block->frames);
+        m_framesAnalyzed += block->frames;
+        m_framesSinceUpdate += block->frames;
+        m_ring.commitRead();
+
+        if (m_framesSinceUpdate * 1000 >= static_cast<qint64>(kUpdateMs) * m_detectorRate) {
+            m_framesSinceUpdate = 0;
+            update();
+        }
+    }
+
+    m_detector.reset();
+    qCDebug(audioCategory) << "BeatTracker stopped";
+}
+
+void BeatTracker::restart(int sampleRate)
+{
+    // BPMDetect keeps its whole history internally, so a new rate needs a new instance
+    m_detector.reset(new soundtouch::BPMDetect(1, sampleRate));
+    m_detectorRate = sampleRate;
+    m_framesAnalyzed = 0;
+    m_framesSinceUpdate = 0;
+    m_bpm.store(0.0f, std::memory_order_relaxed);
+    m_lastBeat.store(-1.0, std::memory_order_relaxed);
+    m_analyzed.store(0.0, std::memory_order_relaxed);
+}
+
+void BeatTracker::update()
+{
+    m_bpm.store(m_detector->getBpm(), std::memory_order_relaxed);
+
+    float positions[kMaxBeatsPerUpdate];
+    float strengths[kMaxBeatsPerUpdate];
+    int count;
+    while ((count = m_detector->takeBeats(positions, strengths, kMaxBeatsPerUpdate)) > 0) {
+        m_lastBeat.store(positions[count - 1], std::memory_order_relaxed);
+    }
+
+    m_analyzed.store(static_cast<double>(m_framesAnalyzed) / m_detectorRate,
+                     std::memory_order_relaxed);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QThread>
+#include <atomic>
+#include <memory>
+
+#include "audioblock.h"
+#include "spscring.h"
+
+namespace soundtouch { class BPMDetect; }
+
+/**
+ * @brief Background tempo (BPM) and beat tracker.
+ *
+ * The AudioThread copies each processed block into a lock-free ring
+ * (pushSamples()). This low-priority thread feeds SoundTouch's BPMDetect,
+ * re-estimates the tempo every kUpdateMs and consumes detected beats as
+ * they appear. Results are published through atomics, so the UI and
+ * tempo-synced effects can read them from any thread without locking.
+ */
+class BeatTracker : public QThread
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kUpdateMs = 500;
+
+    explicit BeatTracker(QObject* parent = nullptr);
+    ~BeatTracker();
+
+    void stop();
+
+    /// Sample rate of the pushed stream; the detector restarts when it changes.
+    void setSampleRate(int sampleRate) { m_sampleRate.store(sampleRate); }
+
+    /**
+     * @brief Audio thread: queues interleaved samples (downmixed to mono).
+     * Never blocks; drops data if the worker falls behind.
+     */
+    void pushSamples(const float* interleaved, int frames, int channels);
+
+    /// Current tempo estimate, 0 while unknown. Safe from any thread.
+    float bpm() const { return m_bpm.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Stream position of the most recent beat in seconds, counted from
+     * the start of the analyzed stream; negative if no beat was found yet.
+     * Compare with analyzedSeconds() to get the beat phase. Safe from any thread.
+     */
+    double lastBeatSeconds() const { return m_lastBeat.load(std::memory_order_relaxed); }
+
+    /// Seconds of audio analyzed so far. Safe from any thread.
+    double analyzedSeconds() const { return m_analyzed.load(std::memory_order_relaxed); }
+
+protected:
+    void run() override;
+
+private:
+    void restart(int sampleRate);
+    void update();
+
+    std::atomic<bool> m_running;
+    std::atomic<int> m_sampleRate;
+
+    SpscRing<AudioBlock, 64> m_ring;
+
+    // Worker-thread state
+    std::unique_ptr<soundtouch::BPMDetect> m_detector;
+    int m_detectorRate;
+    qint64 m_framesAnalyzed;
+    qint64 m_framesSinceUpdate;
+
+    // Published results
+    std::atomic<float> m_bpm;
+    std::atomic<double> m_lastBeat;
+    std::atomic<double> m_analyzed;
+};
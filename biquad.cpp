@@ -0,0 +1,242 @@
+// biquad.cpp
+
+#include "biquad.h"
+
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ----------------------------------------------------------
+// Biquad Filter Class Implementation
+// ----------------------------------------------------------
+
+Biquad::Biquad()
+    : b0(1.0f), b1(0.0f), b2(0.0f),
+    a0(1.0f), a1(0.0f), a2(0.0f),
+    z1(0.0f), z2(0.0f)
+{
+}
+
+void Biquad::setupLowPass(float cutoff, float sampleRate, float Q)
+{
+    float omega = 2.0f * M_PI * cutoff / sampleRate;
+    float alpha = sinf(omega) / (2.0f * Q);
+
+    float cos_omega = cosf(omega);
+    float a0_inv = 1.0f / (1.0f + alpha);
+
+    b0 = (1.0f - cos_omega) / 2.0f;
+    b1 = 1.0f - cos_omega;
+    b2 = (1.0f - cos_omega) / 2.0f;
+    a0 = 1.0f + alpha;
+    a1 = -2.0f * cos_omega;
+    a2 = 1.0f - alpha;
+
+    b0 *= a0_inv;
+    b1 *= a0_inv;
+    b2 *= a0_inv;
+    a1 *= a0_inv;
+    a2 *= a0_inv;
+}
+
+void Biquad::setupHighPass(float cutoff, float sampleRate, float Q)
+{
+    float omega = 2.0f * M_PI * cutoff / sampleRate;
+    float alpha = sinf(omega) / (2.0f * Q);
+
+    float cos_omega = cosf(omega);
+    float a0_inv = 1.0f / (1.0f + alpha);
+
+    b0 = (1.0f + cos_omega) / 2.0f;
+    b1 = -(1.0f + cos_omega);
+    b2 = (1.0f + cos_omega) / 2.0f;
+    a0 = 1.0f + alpha;
+    a1 = -2.0f * cos_omega;
+    a2 = 1.0f - alpha;
+
+    b0 *= a0_inv;
+    b1 *= a0_inv;
+    b2 *= a0_inv;
+    a1 *= a0_inv;
+    a2 *= a0_inv;
+}
+
+void Biquad::setupBandPass(float centerFreq, float bandwidth, float sampleRate, float Q)
+{
+    float omega = 2.0f * M_PI * centerFreq / sampleRate;
+    float alpha = sinf(omega) * sinhf(logf(2.0f) / 2.0f * bandwidth * omega / sinf(omega));
+
+    float cos_omega = cosf(omega);
+    float a0_inv = 1.0f / (1.0f + alpha);
+
+    b0 = alpha;
+    b1 = 0.0f;
+    b2 = -alpha;
+    a0 = 1.0f + alpha;
+    a1 = -2.0f * cos_omega;
+    a2 = 1.0f - alpha;
+
+    b0 *= a0_inv;
+    b1 *= a0_inv;
+    b2 *= a0_inv;
+    a1 *= a0_inv;
+    a2 *= a0_inv;
+}
+
+void Biquad::setupNotch(float centerFreq, float bandwidth, float sampleRate, float Q)
+{
+    float omega = 2.0f * M_PI * centerFreq / sampleRate;
+    float alpha = sinf(omega) * sinhf(logf(2.0f) / 2.0f * bandwidth * omega / sinf(omega));
+
+    float cos_omega = cosf(omega);
+    float a0_inv = 1.0f / (1.0f + alpha);
+
+    b0 = 1.0f;
+    b1 = -2.0f * cos_omega;
+    b2 = 1.0f;
+    a0 = 1.0f + alpha;
+    a1 = -2.0f * cos_omega;
+    a2 = 1.0f - alpha;
+
+    b0 *= a0_inv;
+    b1 *= a0_inv;
+    b2 *= a0_inv;
+    a1 *= a0_inv;
+    a2 *= a0_inv;
+}
+
+void Biquad::setupPeaking(float centerFreq, float sampleRate, float Q, float gainDb)
+{
+    float A = powf(10.0f, gainDb / 40.0f);
+    float omega = 2.0f * M_PI * centerFreq / sampleRate;
+    float alpha = sinf(omega) / (2.0f * Q);
+
+    float cos_omega = cosf(omega);
+    float a0_inv = 1.0f / (1.0f + alpha / A);
+
+    b0 = 1.0f + alpha * A;
+    b1 = -2.0f * cos_omega;
+    b2 = 1.0f - alpha * A;
+    a0 = 1.0f + alpha / A;
+    a1 = -2.0f * cos_omega;
+    a2 = 1.0f - alpha / A;
+
+    b0 *= a0_inv;
+    b1 *= a0_inv;
+    b2 *= a0_inv;
+    a1 *= a0_inv;
+    a2 *= a0_inv;
+}
+
+void Biquad::setupLowShelf(float cutoff, float sampleRate, float slope, float gainDb)
+{
+    float A = powf(10.0f, gainDb / 40.0f);
+    float omega = 2.0f * M_PI * cutoff / sampleRate;
+    float alpha = sinf(omega) / 2.0f * sqrtf((A + 1.0f / A) * (1.0f / slope - 1.0f) + 2.0f);
+
+    float cos_omega = cosf(omega);
+    float sqrtA2alpha = 2.0f * sqrtf(A) * alpha;
+    float a0_inv = 1.0f / ((A + 1.0f) + (A - 1.0f) * cos_omega + sqrtA2alpha);
+
+    b0 = A * ((A + 1.0f) - (A - 1.0f) * cos_omega + sqrtA2alpha);
+    b1 = 2.0f * A * ((A - 1.0f) - (A + 1.0f) * cos_omega);
+    b2 = A * ((A + 1.0f) - (A - 1.0f) * cos_omega - sqrtA2alpha);
+    a0 = (A + 1.0f) + (A - 1.0f) * cos_omega + sqrtA2alpha;
+    a1 = -2.0f * ((A - 1.0f) + (A + 1.0f) * cos_omega);
+    a2 = (A + 1.0f) + (A - 1.0f) * cos_omega - sqrtA2alpha;
+
+    b0 *= a0_inv;
+    b1 *= a0_inv;
+    b2 *= a0_inv;
+    a1 *= a0_inv;
+    a2 *= a0_inv;
+}
+
+void Biquad::setupHighShelf(float cutoff, float sampleRate, float slope, float gainDb)
+{
+    float A = powf(10.0f, gainDb / 40.0f);
+    float omega = 2.0f * M_PI * cutoff / sampleRate;
+    float alpha = sinf(omega) / 2.0f * sqrtf((A + 1.0f / A) * (1.0f / slope - 1.0f) + 2.0f);
+
+    float cos_omega = cosf(omega);
+    float sqrtA2alpha = 2.0f * sqrtf(A) * alpha;
+    float a0_inv = 1.0f / ((A + 1.0f) - (A - 1.0f) * cos_omega + sqrtA2alpha);
+
+    b0 = A * ((A + 1.0f) + (A - 1.0f) * cos_omega + sqrtA2alpha);
+    b1 = -2.0f * A * ((A - 1.0f) + (A + 1.0f) * cos_omega);
+    b2 = A * ((A + 1.0f) + (A - 1.0f) * cos_omega - sqrtA2alpha);
+    a0 = (A + 1.0f) - (A - 1.0f) * cos_omega + sqrtA2alpha;
+    a1 = 2.0f * ((A - 1.0f) - (A + 1.0f) * cos_omega);
+    a2 = (A + 1.0f) - (A - 1.0f) * cos_omega - sqrtA2alpha;
+
+    b0 *= a0_inv;
+    b1 *= a0_inv;
+    b2 *= a0_inv;
+    a1 *= a0_inv;
+    a2 *= a0_inv;
+}
+
+void Biquad::getCoefficients(float& outB0, float& outB1, float& outB2,
+                             float& outA1, float& outA2) const
+{
+    outB0 = b0;
+    outB1 = b1;
+    outB2 = b2;
+    outA1 = a1;
+    outA2 = a2;
+}
+
+float Biquad::process(float in)
+{
+    float out = b0 * in + b1 * z1 + b2 * z2
+                - a1 * z1 - a2 * z2;
+    z2 = z1;
+    z1 = out;
+    return out;
+}
+
+void Biquad::applyLowPass(std::vector<float> &buffer, float cutoffHz, int sampleRate)
+{
+    if (cutoffHz <= 0.f || cutoffHz >= sampleRate * 0.5f) {
+        return; // Invalid or trivial
+    }
+    setupLowPass(cutoffHz, sampleRate);
+    for (auto &sample : buffer) {
+        sample = process(sample);
+    }
+}
+
+void Biquad::applyHighPass(std::vector<float> &buffer, float cutoffHz, int sampleRate)
+{
+    if (cutoffHz <= 0.f || cutoffHz >= sampleRate * 0.5f) {
+        return;
+    }
+    setupHighPass(cutoffHz, sampleRate);
+    for (auto &sample : buffer) {
+        sample = process(sample);
+    }
+}
+
+void Biquad::applyBandPass(std::vector<float> &buffer, float centerFreq, float bandwidth, int sampleRate)
+{
+    if (centerFreq <= 0.f || centerFreq >= sampleRate * 0.5f) {
+        return;
+    }
+    setupBandPass(centerFreq, bandwidth, sampleRate);
+    for (auto &sample : buffer) {
+        sample = process(sample);
+    }
+}
+
+void Biquad::applyBandStop(std::vector<float> &buffer, float centerFreq, float bandwidth, int sampleRate)
+{
+    if (centerFreq <= 0.f || centerFreq >= sampleRate * 0.5f) {
+        return;
+    }
+    setupNotch(centerFreq, bandwidth, sampleRate);
+    for (auto &sample : buffer) {
+        sample = process(sample);
+    }
+}
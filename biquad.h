@@ -0,0 +1,43 @@
+// biquad.h
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+#include <vector>
+
+// ----------------------------------------------------------
+// Biquad Filter Class Declaration
+// ----------------------------------------------------------
+
+class Biquad
+{
+public:
+    Biquad();
+    void setupLowPass(float cutoff, float sampleRate, float Q = 0.7071f);
+    void setupHighPass(float cutoff, float sampleRate, float Q = 0.7071f);
+    void setupBandPass(float centerFreq, float bandwidth, float sampleRate, float Q = 0.7071f);
+    void setupNotch(float centerFreq, float bandwidth, float sampleRate, float Q = 0.7071f);
+    void setupPeaking(float centerFreq, float sampleRate, float Q, float gainDb);
+    void setupLowShelf(float cutoff, float sampleRate, float slope, float gainDb);
+    void setupHighShelf(float cutoff, float sampleRate, float slope, float gainDb);
+
+    /**
+     * @brief Returns the normalized (a0 == 1) coefficients, so that
+     * vectorized cascades such as ParametricEq can reuse the designs above.
+     */
+    void getCoefficients(float& outB0, float& outB1, float& outB2,
+                         float& outA1, float& outA2) const;
+
+    float process(float in);
+
+    void applyLowPass(std::vector<float>& buffer, float cutoffHz, int sampleRate);
+    void applyHighPass(std::vector<float>& buffer, float cutoffHz, int sampleRate);
+    void applyBandPass(std::vector<float>& buffer, float centerFreq, float bandwidth, int sampleRate);
+    void applyBandStop(std::vector<float>& buffer, float centerFreq, float bandwidth, int sampleRate);
+    void setNoiseGateDB(int value);
+    int getNoiseGateDB();
+private:
+    float b0, b1, b2, a0, a1, a2;
+    float z1, z2;
+};
+
+#endif // BIQUAD_H
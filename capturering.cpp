@@ -0,0 +1,304 @@
+// capturering.cpp
+
+#include "capturering.h"
+
+#include <QFile>
+#include <QLoggingCategory>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+
+namespace {
+// Extra ring beyond the window: how far the audio may run on during a save
+const int kSaveHeadroomSeconds = 30;
+
+// Bytes per write while saving
+const qint64 kSaveChunkBytes = 1 << 20;
+
+// Most frames write() copies before publishing them; a save treats this
+// many frames past the published total as possibly being overwritten
+const int kWriteChunkFrames = 4096;
+}
+
+// ----------------------------------------------------------
+// 1. Save thread
+// ----------------------------------------------------------
+
+class CaptureSaver : public QThread
+{
+public:
+    explicit CaptureSaver(CaptureRing* owner) : m_owner(owner) {}
+
+protected:
+    void run() override
+    {
+        m_owner->saveRange(m_owner->m_saveFirst, m_owner->m_saveEnd);
+        m_owner->m_saving.store(false, std::memory_order_release);
+    }
+
+private:
+    CaptureRing* m_owner;
+};
+
+// ----------------------------------------------------------
+// 2. Setup
+// ----------------------------------------------------------
+
+CaptureRing::CaptureRing()
+    : m_ring(nullptr)
+    , m_ringBytes(0)
+    , m_capacity(0)
+    , m_windowFrames(0)
+    , m_channels(0)
+    , m_sampleRate(0)
+    , m_bytesPerFrame(0)
+    , m_storage(RecordFormat::Int16)
+    , m_written(0)
+    , m_saving(false)
+    , m_saveFirst(0)
+    , m_saveEnd(0)
+{
+}
+
+CaptureRing::~CaptureRing()
+{
+    release();
+}
+
+bool CaptureRing::allocate(int channels, int sampleRate, int seconds, RecordFormat storage, qint64 maxBytes)
+{
+    release();
+    if (channels <= 0 || sampleRate <= 0 || seconds <= 0)
+        return false;
+
+    m_channels = channels;
+    m_sampleRate = sampleRate;
+    m_storage = storage;
+    m_bytesPerFrame = channels * (storage == RecordFormat::Int16 ? 2 : 4);
+
+    // Window plus save headroom, cut to the budget (the headroom shrinks with it)
+    qint64 window = static_cast<qint64>(seconds) * sampleRate;
+    qint64 capacity = window + static_cast<qint64>(std::min(seconds, kSaveHeadroomSeconds)) * sampleRate;
+    const qint64 maxFrames = maxBytes / m_bytesPerFrame;
+    if (capacity > maxFrames) {
+        window = window * maxFrames / capacity;
+        capacity = maxFrames;
+        qCWarning(audioCategory) << "Capture window cut to" << window / sampleRate
+                                 << "s to stay within" << maxBytes / (1024 * 1024) << "MiB";
+    }
+    if (window <= 0)
+        return false;
+
+    const qint64 bytes = capacity * m_bytesPerFrame;
+#if defined(__linux__)
+    // Populated right away: the memory is committed and no page is first
+    // touched by the audio thread
+    void* ring = mmap(nullptr, static_cast<size_t>(bytes), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    m_ring = ring != MAP_FAILED ? static_cast<char*>(ring) : nullptr;
+#else
+    m_ring = static_cast<char*>(qMallocAligned(static_cast<size_t>(bytes), 4096));
+    if (m_ring)
+        std::memset(m_ring, 0, static_cast<size_t>(bytes));
+#endif
+    if (!m_ring) {
+        qCWarning(audioCategory) << "Cannot map a" << bytes / (1024 * 1024) << "MiB capture ring";
+        return false;
+    }
+
+    m_ringBytes = bytes;
+    m_capacity = capacity;
+    m_windowFrames = window;
+    m_written.store(0, std::memory_order_relaxed);
+
+    qCDebug(audioCategory) << "Capture ring:" << window / sampleRate << "s," << channels << "ch,"
+                           << sampleRate << "Hz," << (storage == RecordFormat::Int16 ? "16-bit" : "float")
+                           << "|" << bytes / (1024 * 1024) << "MiB";
+    return true;
+}
+
+void CaptureRing::release()
+{
+    if (m_saver) {
+        m_saver->wait();
+        m_saver.reset();
+    }
+    if (!m_ring)
+        return;
+#if defined(__linux__)
+    munmap(m_ring, static_cast<size_t>(m_ringBytes));
+#else
+    qFreeAligned(m_ring);
+#endif
+    m_ring = nullptr;
+    m_ringBytes = 0;
+    m_capacity = 0;
+    m_windowFrames = 0;
+}
+
+qint64 CaptureRing::availableFrames() const
+{
+    return std::min(m_written.load(std::memory_order_acquire), m_windowFrames);
+}
+
+// ----------------------------------------------------------
+// 3. Audio thread side
+// ----------------------------------------------------------
+
+void CaptureRing::write(const qint16* samples, int frames)
+{
+    if (!m_ring || !samples || frames <= 0)
+        return;
+
+    const qint64 written = m_written.load(std::memory_order_relaxed);
+    const int channels = m_channels;
+    int done = 0;
+    while (done < frames) {
+        const qint64 slot = (written + done) % m_capacity;
+        const int count = static_cast<int>(std::min<qint64>({frames - done, m_capacity - slot, kWriteChunkFrames}));
+        const qint16* src = samples + static_cast<size_t>(done) * channels;
+        if (m_storage == RecordFormat::Int16) {
+            std::memcpy(m_ring + slot * m_bytesPerFrame, src, static_cast<size_t>(count) * m_bytesPerFrame);
+        } else {
+            float* dst = reinterpret_cast<float*>(m_ring + slot * m_bytesPerFrame);
+            const float scale = 1.0f / 32768.0f;
+            for (int i = 0; i < count * channels; ++i)
+                dst[i] = src[i] * scale;
+        }
+        done += count;
+        m_written.store(written + done, std::memory_order_release);
+    }
+}
+
+void CaptureRing::write(const float* samples, int frames)
+{
+    if (!m_ring || !samples || frames <= 0)
+        return;
+
+    const qint64 written = m_written.load(std::memory_order_relaxed);
+    const int channels = m_channels;
+    int done = 0;
+    while (done < frames) {
+        const qint64 slot = (written + done) % m_capacity;
+        const int count = static_cast<int>(std::min<qint64>({frames - done, m_capacity - slot, kWriteChunkFrames}));
+        const float* src = samples + static_cast<size_t>(done) * channels;
+        if (m_storage == RecordFormat::Float32) {
+            std::memcpy(m_ring + slot * m_bytesPerFrame, src, static_cast<size_t>(count) * m_bytesPerFrame);
+        } else {
+            qint16* dst = reinterpret_cast<qint16*>(m_ring + slot * m_bytesPerFrame);
+            for (int i = 0; i < count * channels; ++i) {
+                const float v = std::clamp(src[i] * 32768.0f, -32768.0f, 32767.0f);
+                dst[i] = static_cast<qint16>(std::lrint(v));
+            }
+        }
+        done += count;
+        m_written.store(written + done, std::memory_order_release);
+    }
+}
+
+// ----------------------------------------------------------
+// 4. Saving
+// ----------------------------------------------------------
+
+bool CaptureRing::save(const QString& path, int seconds, QString* error)
+{
+    if (!m_ring || isSaving()) {
+        if (error)
+            *error = m_ring ? QStringLiteral("A save is still running")
+                            : QStringLiteral("Capture is off");
+        return false;
+    }
+    if (m_saver) {
+        m_saver->wait();
+        m_saver.reset();
+    }
+
+    // Snapshot the window; the audio thread carries on behind it
+    const qint64 end = m_written.load(std::memory_order_acquire);
+    qint64 frames = std::min(end, m_windowFrames);
+    if (seconds > 0)
+        frames = std::min(frames, static_cast<qint64>(seconds) * m_sampleRate);
+    if (frames <= 0) {
+        if (error)
+            *error = QStringLiteral("Nothing captured yet");
+        return false;
+    }
+
+    m_savePath = path;
+    m_saveError.clear();
+    m_saveFirst = end - frames;
+    m_saveEnd = end;
+    m_saving.store(true, std::memory_order_relaxed);
+    m_saver.reset(new CaptureSaver(this));
+    m_saver->start(QThread::LowPriority);
+    return true;
+}
+
+bool CaptureRing::lastSaveResult(QString* error)
+{
+    if (isSaving())
+        return true;
+    if (m_saver) {
+        m_saver->wait();
+        m_saver.reset();
+    }
+    if (error)
+        *error = m_saveError;
+    return m_saveError.isEmpty();
+}
+
+void CaptureRing::saveRange(qint64 first, qint64 end)
+{
+    QFile file(m_savePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_saveError = file.errorString();
+        return;
+    }
+
+    char header[kWavHeaderBytes];
+    qint64 dataBytes = (end - first) * m_bytesPerFrame;
+    buildWavHeader(header, m_storage, m_channels, m_sampleRate, dataBytes);
+    if (file.write(header, kWavHeaderBytes) != kWavHeaderBytes) {
+        m_saveError = file.errorString();
+        return;
+    }
+
+    // Straight from the ring, wrapping once at most
+    const qint64 chunkFrames = std::max<qint64>(kSaveChunkBytes / m_bytesPerFrame, 1);
+    qint64 frame = first;
+    while (frame < end) {
+        const qint64 slot = frame % m_capacity;
+        const qint64 count = std::min({end - frame, m_capacity - slot, chunkFrames});
+        if (file.write(m_ring + slot * m_bytesPerFrame, count * m_bytesPerFrame) != count * m_bytesPerFrame) {
+            m_saveError = file.errorString();
+            break;
+        }
+        // Has the audio thread come round to these frames while they were
+        // written? It may be copying up to one chunk past what it published.
+        if (m_written.load(std::memory_order_acquire) + kWriteChunkFrames - m_capacity > frame) {
+            m_saveError = QStringLiteral("The capture ring overtook the save; the file is cut short");
+            break;
+        }
+        frame += count;
+    }
+
+    // The data actually saved, if that ended early
+    if (frame < end) {
+        dataBytes = (frame - first) * m_bytesPerFrame;
+        buildWavHeader(header, m_storage, m_channels, m_sampleRate, dataBytes);
+        file.seek(0);
+        file.write(header, kWavHeaderBytes);
+        file.resize(kWavHeaderBytes + dataBytes);
+    }
+    file.close();
+
+    qCDebug(audioCategory) << "Capture saved:" << m_savePath << (frame - first) << "frames"
+                           << (m_saveError.isEmpty() ? "" : "(incomplete)");
+}
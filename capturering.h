@@ -0,0 +1,109 @@
+// capturering.h
+#ifndef CAPTURERING_H
+#define CAPTURERING_H
+
+#include "diskrecorder.h"
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+
+class CaptureSaver;
+
+// ----------------------------------------------------------
+// CaptureRing Class Declaration
+// ----------------------------------------------------------
+
+/**
+ * @brief Always-on memory of the last few minutes of a stream, for saving
+ * something after it happened.
+ *
+ * allocate() maps one anonymous, prefaulted ring for the whole window up
+ * front (so the audio thread never faults a page in and the memory use is
+ * fixed from the start), capped to a byte budget. With RecordFormat::Int16
+ * storage an hour of 48 kHz mono takes about 330 MiB; float doubles that.
+ *
+ * write() copies (and if needed converts) a block into the ring, publishing
+ * the new total every few thousand frames; it never blocks. save() snapshots the window
+ * and writes it to a WAV file from a background thread straight out of the
+ * ring. The ring is a little longer than the window, so the audio thread
+ * can keep writing during the save without reaching the frames still being
+ * saved; should the disk be slower than that, the file is cut where the
+ * ring overtook it and the save reports an error.
+ *
+ * write() belongs to the audio thread, save() and lastSaveResult() to one
+ * control thread. allocate() and release() must not overlap any of them:
+ * if allocate() runs on the audio thread, publish its completion to the
+ * control thread (e.g. with a release/acquire flag) before the first
+ * save(), and release() only after the audio thread has stopped.
+ */
+class CaptureRing
+{
+public:
+    CaptureRing();
+    ~CaptureRing();
+
+    CaptureRing(const CaptureRing&) = delete;
+    CaptureRing& operator=(const CaptureRing&) = delete;
+
+    /**
+     * @brief Not real-time safe. Maps and prefaults the ring.
+     * @param seconds Window to keep; shortened to fit @p maxBytes.
+     * @return false if nothing could be mapped.
+     */
+    bool allocate(int channels, int sampleRate, int seconds, RecordFormat storage, qint64 maxBytes);
+    void release();
+    bool isAllocated() const { return m_ring != nullptr; }
+
+    /// Seconds of audio the window holds (after the budget cap).
+    int windowSeconds() const { return m_sampleRate > 0 ? static_cast<int>(m_windowFrames / m_sampleRate) : 0; }
+
+    /// Frames currently available to save().
+    qint64 availableFrames() const;
+
+    /// Audio thread. Converts to the storage format if needed.
+    void write(const qint16* samples, int frames);
+    void write(const float* samples, int frames);
+
+    /**
+     * @brief Starts writing the last @p seconds (all that is held for <= 0) to @p path.
+     * @return false if a save is still running or nothing has been captured.
+     */
+    bool save(const QString& path, int seconds = 0, QString* error = nullptr);
+
+    /// True while a save is in progress.
+    bool isSaving() const { return m_saving.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Collects the result of the last save once it has finished.
+     * @return false if it failed; @p error then holds the reason.
+     */
+    bool lastSaveResult(QString* error = nullptr);
+
+private:
+    friend class CaptureSaver;
+
+    void saveRange(qint64 first, qint64 end);
+
+    char* m_ring;
+    qint64 m_ringBytes;                     ///< Mapped size
+    qint64 m_capacity;                      ///< Frames in the ring
+    qint64 m_windowFrames;                  ///< Frames a save may cover (capacity minus headroom)
+    int m_channels;
+    int m_sampleRate;
+    int m_bytesPerFrame;
+    RecordFormat m_storage;
+
+    std::atomic<qint64> m_written;          ///< Total frames ever written
+
+    // Background save
+    std::unique_ptr<CaptureSaver> m_saver;
+    std::atomic<bool> m_saving;
+    QString m_savePath;
+    QString m_saveError;
+    qint64 m_saveFirst;
+    qint64 m_saveEnd;
+};
+
+#endif // CAPTURERING_H
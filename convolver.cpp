@@ -0,0 +1,439 @@
+// convolver.cpp
+
+#include "convolver.h"
+#include "fft.h"
+
+#include <FIRFilter.h>
+#include <samplerate.h>
+
+#include <QLoggingCategory>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CONVOLVER_SSE 1
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+
+namespace {
+const double kPi = 3.14159265358979323846;
+
+const int kBlock     = Convolver::kPartitionSize;
+const int kFftSize   = 2 * kBlock;
+const int kBins      = kBlock + 1;
+const int kBinStride = (kBins + 3) & ~3;    ///< Bins padded to a multiple of 4 for SSE
+
+// Trailing IR samples below this level (-120 dB) are dropped
+const float kSilence = 1e-6f;
+
+/// acc += x * h over split complex arrays
+void multiplyAccumulate(float* accRe, float* accIm,
+                        const float* xRe, const float* xIm,
+                        const float* hRe, const float* hIm, int count)
+{
+    int i = 0;
+#ifdef CONVOLVER_SSE
+    for (; i + 4 <= count; i += 4) {
+        __m128 xr = _mm_loadu_ps(xRe + i);
+        __m128 xi = _mm_loadu_ps(xIm + i);
+        __m128 hr = _mm_loadu_ps(hRe + i);
+        __m128 hi = _mm_loadu_ps(hIm + i);
+        __m128 re = _mm_sub_ps(_mm_mul_ps(xr, hr), _mm_mul_ps(xi, hi));
+        __m128 im = _mm_add_ps(_mm_mul_ps(xr, hi), _mm_mul_ps(xi, hr));
+        _mm_storeu_ps(accRe + i, _mm_add_ps(_mm_loadu_ps(accRe + i), re));
+        _mm_storeu_ps(accIm + i, _mm_add_ps(_mm_loadu_ps(accIm + i), im));
+    }
+#endif
+    for (; i < count; ++i) {
+        accRe[i] += xRe[i] * hRe[i] - xIm[i] * hIm[i];
+        accIm[i] += xRe[i] * hIm[i] + xIm[i] * hRe[i];
+    }
+}
+}
+
+// ----------------------------------------------------------
+// 1. Kernel: IR spectra plus all per-stream filter state
+// ----------------------------------------------------------
+
+struct Convolver::Kernel
+{
+    Kernel(int numChannels, int numIrChannels, int numHeadTaps, int numPartitions)
+        : channels(numChannels)
+        , irChannels(numIrChannels)
+        , headLength(numHeadTaps)
+        , partitions(numPartitions)
+        , historyStride(numHeadTaps - 1 + kBlock + 2)
+        , history(static_cast<size_t>(numChannels) * historyStride, 0.0f)
+        , headOut(kBlock + 2, 0.0f)
+        , fft(kFftSize)
+        , irRe(static_cast<size_t>(numIrChannels) * numPartitions * kBinStride, 0.0f)
+        , irIm(irRe.size(), 0.0f)
+        , fdlRe(static_cast<size_t>(numChannels) * numPartitions * kBinStride, 0.0f)
+        , fdlIm(fdlRe.size(), 0.0f)
+        , window(static_cast<size_t>(numChannels) * kFftSize, 0.0f)
+        , tail(static_cast<size_t>(numChannels) * kBlock, 0.0f)
+        , accRe(kBinStride, 0.0f)
+        , accIm(kBinStride, 0.0f)
+        , time(kFftSize, 0.0f)
+        , fdlPos(0)
+        , blockPos(0)
+    {
+        std::fill(std::begin(heads), std::end(heads), nullptr);
+    }
+
+    ~Kernel()
+    {
+        for (soundtouch::FIRFilter* filter : heads)
+            delete filter;
+    }
+
+    bool isEmpty() const { return headLength == 0; }
+
+    void process(float* samples, int frames, float wet);
+    void convolveTail();
+
+    int channels;
+    int irChannels;     ///< 1 (shared by all channels) or == channels
+    int headLength;     ///< Direct-form taps, multiple of 8, <= kPartitionSize
+    int partitions;     ///< FFT partitions after the head
+
+    soundtouch::FIRFilter* heads[kMaxChannels];   ///< One per IR channel, reversed taps
+
+    int historyStride;
+    std::vector<float> history;     ///< Per channel: headLength - 1 past samples, block, 2 padding
+    std::vector<float> headOut;
+
+    RealFft fft;
+    std::vector<float> irRe, irIm;      ///< [irChannel][partition][bin]
+    std::vector<float> fdlRe, fdlIm;    ///< [channel][slot][bin], frequency-domain delay line
+    std::vector<float> window;          ///< [channel][2 * kPartitionSize] overlap-save input
+    std::vector<float> tail;            ///< [channel][kPartitionSize] FFT output for the current block
+    std::vector<float> accRe, accIm, time;
+    int fdlPos;
+    int blockPos;
+};
+
+void Convolver::Kernel::process(float* samples, int frames, float wet)
+{
+    const float dry = 1.0f - wet;
+
+    while (frames > 0) {
+        // Never cross a partition boundary inside one chunk
+        const int n = std::min(frames, kBlock - blockPos);
+        const int evalFrames = headLength + n;  // evaluate() yields evalFrames - headLength outputs
+
+        for (int ch = 0; ch < channels; ++ch) {
+            float* hist  = &history[static_cast<size_t>(ch) * historyStride];
+            float* block = hist + headLength - 1;
+            for (int i = 0; i < n; ++i)
+                block[i] = samples[static_cast<size_t>(i) * channels + ch];
+            block[n] = block[n + 1] = 0.0f;
+
+            std::memcpy(&window[static_cast<size_t>(ch) * kFftSize + kBlock + blockPos],
+                        block, n * sizeof(float));
+
+            // Head: taps 0..headLength-1 in direct form, no latency
+            heads[irChannels == 1 ? 0 : ch]->evaluate(headOut.data(), hist, evalFrames, 1);
+
+            // Tail: taps from kPartitionSize on, computed one block ahead
+            const float* t = &tail[static_cast<size_t>(ch) * kBlock + blockPos];
+            for (int i = 0; i < n; ++i) {
+                float& s = samples[static_cast<size_t>(i) * channels + ch];
+                s = dry * s + wet * (headOut[i] + t[i]);
+            }
+
+            std::memmove(hist, hist + n, (headLength - 1) * sizeof(float));
+        }
+
+        samples += static_cast<size_t>(n) * channels;
+        frames -= n;
+        blockPos += n;
+        if (blockPos == kBlock) {
+            convolveTail();
+            blockPos = 0;
+        }
+    }
+}
+
+void Convolver::Kernel::convolveTail()
+{
+    if (partitions == 0)
+        return;
+
+    // Uniformly partitioned overlap-save: Y = sum_p X[k - p] * H[p]. Partition
+    // p starts at tap kPartitionSize * (p + 1), so the result belongs to the
+    // next block and the FFT round trip adds no latency.
+    for (int ch = 0; ch < channels; ++ch) {
+        float* win = &window[static_cast<size_t>(ch) * kFftSize];
+        const size_t fdlBase = static_cast<size_t>(ch) * partitions * kBinStride;
+        const size_t irBase  = static_cast<size_t>(irChannels == 1 ? 0 : ch) * partitions * kBinStride;
+
+        fft.forward(win, &fdlRe[fdlBase + fdlPos * kBinStride], &fdlIm[fdlBase + fdlPos * kBinStride]);
+
+        std::fill(accRe.begin(), accRe.end(), 0.0f);
+        std::fill(accIm.begin(), accIm.end(), 0.0f);
+        for (int p = 0; p < partitions; ++p) {
+            int slot = fdlPos - p;
+            if (slot < 0)
+                slot += partitions;
+            multiplyAccumulate(accRe.data(), accIm.data(),
+                               &fdlRe[fdlBase + slot * kBinStride], &fdlIm[fdlBase + slot * kBinStride],
+                               &irRe[irBase + p * kBinStride], &irIm[irBase + p * kBinStride],
+                               kBinStride);
+        }
+
+        fft.inverse(accRe.data(), accIm.data(), time.data());
+        std::memcpy(&tail[static_cast<size_t>(ch) * kBlock], time.data() + kBlock, kBlock * sizeof(float));
+
+        // Slide: the current block becomes the previous half of the next window
+        std::memcpy(win, win + kBlock, kBlock * sizeof(float));
+    }
+
+    fdlPos = (fdlPos + 1) % partitions;
+}
+
+// ----------------------------------------------------------
+// 2. Setup (non-real-time)
+// ----------------------------------------------------------
+
+Convolver::Convolver()
+    : m_active(nullptr)
+    , m_pending(nullptr)
+    , m_mix(1.0f)
+    , m_irChannels(0)
+    , m_irSampleRate(0)
+    , m_normalize(true)
+    , m_channels(0)
+    , m_sampleRate(0)
+{
+}
+
+Convolver::~Convolver()
+{
+    delete m_active;
+    delete m_pending.exchange(nullptr);
+    collectRetired();
+}
+
+void Convolver::setFormat(int channels, int sampleRate)
+{
+    QMutexLocker lock(&m_setupMutex);
+    channels = std::clamp(channels, 1, kMaxChannels);
+    if (channels == m_channels && sampleRate == m_sampleRate)
+        return;
+    m_channels = channels;
+    m_sampleRate = sampleRate;
+    if (!m_ir.empty())
+        postKernel(buildKernel());
+}
+
+bool Convolver::setImpulseResponse(const std::vector<float>& interleaved, int irChannels,
+                                   int irSampleRate, bool normalize)
+{
+    if (irChannels <= 0 || irSampleRate <= 0 || interleaved.size() < static_cast<size_t>(irChannels))
+        return false;
+
+    QMutexLocker lock(&m_setupMutex);
+    m_ir = interleaved;
+    m_irChannels = irChannels;
+    m_irSampleRate = irSampleRate;
+    m_normalize = normalize;
+
+    if (m_channels == 0 || m_sampleRate <= 0)
+        return true;    // built once the stream format is known
+
+    Kernel* kernel = buildKernel();
+    if (!kernel)
+        return false;
+    postKernel(kernel);
+    return true;
+}
+
+void Convolver::clearImpulseResponse()
+{
+    QMutexLocker lock(&m_setupMutex);
+    m_ir.clear();
+    m_irChannels = 0;
+    postKernel(new Kernel(1, 1, 0, 0));
+}
+
+void Convolver::postKernel(Kernel* kernel)
+{
+    collectRetired();
+    if (!kernel)
+        return;
+    // A kernel the audio thread never picked up can be freed right here
+    delete m_pending.exchange(kernel, std::memory_order_acq_rel);
+}
+
+void Convolver::collectRetired()
+{
+    Kernel* kernel;
+    while (m_retired.pop(kernel))
+        delete kernel;
+}
+
+Convolver::Kernel* Convolver::buildKernel() const
+{
+    const int channels = m_channels;
+    const int sampleRate = m_sampleRate;
+
+    // A mono IR is shared; any other mismatch is folded down to mono
+    int irChannels = m_irChannels;
+    std::vector<float> ir;
+    if (irChannels == 1 || irChannels == channels) {
+        ir = m_ir;
+    } else {
+        const size_t frames = m_ir.size() / irChannels;
+        ir.assign(frames, 0.0f);
+        for (size_t i = 0; i < frames; ++i) {
+            float sum = 0.0f;
+            for (int c = 0; c < irChannels; ++c)
+                sum += m_ir[i * irChannels + c];
+            ir[i] = sum / irChannels;
+        }
+        irChannels = 1;
+    }
+
+    // Resample to the stream rate
+    if (m_irSampleRate != sampleRate) {
+        const long inFrames = static_cast<long>(ir.size() / irChannels);
+        const double ratio = static_cast<double>(sampleRate) / m_irSampleRate;
+        std::vector<float> resampled(static_cast<size_t>(std::ceil(inFrames * ratio) + 16) * irChannels);
+
+        SRC_DATA data;
+        std::memset(&data, 0, sizeof(data));
+        data.data_in = ir.data();
+        data.input_frames = inFrames;
+        data.data_out = resampled.data();
+        data.output_frames = static_cast<long>(resampled.size() / irChannels);
+        data.src_ratio = ratio;
+        int error = src_simple(&data, SRC_SINC_MEDIUM_QUALITY, irChannels);
+        if (error != 0) {
+            qCWarning(audioCategory) << "Convolver: IR resampling failed:" << src_strerror(error);
+            return nullptr;
+        }
+        resampled.resize(static_cast<size_t>(data.output_frames_gen) * irChannels);
+        ir.swap(resampled);
+    }
+
+    // Truncate, then drop the silent tail so it costs no partitions
+    int length = static_cast<int>(std::min<size_t>(ir.size() / irChannels,
+                                                   static_cast<size_t>(kMaxIrSeconds) * sampleRate));
+    while (length > 0) {
+        bool silent = true;
+        for (int c = 0; c < irChannels && silent; ++c)
+            silent = std::fabs(ir[static_cast<size_t>(length - 1) * irChannels + c]) < kSilence;
+        if (!silent)
+            break;
+        --length;
+    }
+    if (length == 0) {
+        qCWarning(audioCategory) << "Convolver: impulse response is silent";
+        return nullptr;
+    }
+
+    if (m_normalize) {
+        double maxEnergy = 0.0;
+        for (int c = 0; c < irChannels; ++c) {
+            double energy = 0.0;
+            for (int i = 0; i < length; ++i) {
+                double v = ir[static_cast<size_t>(i) * irChannels + c];
+                energy += v * v;
+            }
+            maxEnergy = std::max(maxEnergy, energy);
+        }
+        const float scale = static_cast<float>(1.0 / std::sqrt(maxEnergy));
+        for (float& v : ir)
+            v *= scale;
+    }
+
+    const int headLength = std::min((length + 7) & ~7, kBlock);
+    const int partitions = (length > kBlock) ? (length - kBlock + kBlock - 1) / kBlock : 0;
+    Kernel* kernel = new Kernel(channels, irChannels, headLength, partitions);
+
+    std::vector<float> taps(headLength);
+    std::vector<float> segment(kFftSize);
+    for (int c = 0; c < irChannels; ++c) {
+        auto tap = [&](int i) { return i < length ? ir[static_cast<size_t>(i) * irChannels + c] : 0.0f; };
+
+        // FIRFilter correlates, so the head taps go in reversed
+        for (int i = 0; i < headLength; ++i)
+            taps[i] = tap(headLength - 1 - i);
+        kernel->heads[c] = soundtouch::FIRFilter::newInstance();
+        kernel->heads[c]->setCoefficients(taps.data(), headLength, 0);
+
+        for (int p = 0; p < partitions; ++p) {
+            for (int i = 0; i < kBlock; ++i)
+                segment[i] = tap(kBlock * (p + 1) + i);
+            std::fill(segment.begin() + kBlock, segment.end(), 0.0f);
+            const size_t offset = (static_cast<size_t>(c) * partitions + p) * kBinStride;
+            kernel->fft.forward(segment.data(), &kernel->irRe[offset], &kernel->irIm[offset]);
+        }
+    }
+
+    qCDebug(audioCategory) << "Convolver: IR of" << length << "frames," << irChannels << "channel(s),"
+                           << partitions << "FFT partitions";
+    return kernel;
+}
+
+std::vector<float> Convolver::designLinearPhase(const std::vector<float>& magnitude)
+{
+    const int n = 2 * (static_cast<int>(magnitude.size()) - 1);
+    if (n < 4 || (n & (n - 1)) != 0)
+        return {};
+
+    // Zero-phase impulse from the magnitude, centred at n / 2 and Hann-windowed
+    RealFft fft(n);
+    std::vector<float> re(magnitude);
+    std::vector<float> im(magnitude.size(), 0.0f);
+    std::vector<float> zeroPhase(n);
+    fft.inverse(re.data(), im.data(), zeroPhase.data());
+
+    std::vector<float> taps(n - 1);
+    for (int i = 0; i < n - 1; ++i) {
+        int k = (i + 1 - n / 2 + n) % n;
+        float w = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * (i + 1) / n));
+        taps[i] = zeroPhase[k] * w;
+    }
+    return taps;
+}
+
+// ----------------------------------------------------------
+// 3. Processing
+// ----------------------------------------------------------
+
+void Convolver::process(float* samples, int frames)
+{
+    if (Kernel* next = m_pending.exchange(nullptr, std::memory_order_acq_rel)) {
+        // Freeing is left to the setup side; if the ring is somehow full the
+        // old kernel is leaked rather than freed on the audio thread
+        if (m_active)
+            m_retired.push(m_active);
+        m_active = next;
+    }
+
+    Kernel* kernel = m_active;
+    if (!kernel || kernel->isEmpty() || !samples || frames <= 0)
+        return;
+
+    const float wet = std::clamp(m_mix.load(std::memory_order_relaxed), 0.0f, 1.0f);
+    kernel->process(samples, frames, wet);
+}
+
+bool Convolver::isActive() const
+{
+    return (m_active && !m_active->isEmpty())
+        || m_pending.load(std::memory_order_acquire) != nullptr;
+}
+
+int Convolver::tailFrames() const
+{
+    if (!m_active || m_active->isEmpty())
+        return 0;
+    // Head taps, the partitioned tail and one block of FFT latency
+    return m_active->headLength + (m_active->partitions + 1) * kBlock;
+}
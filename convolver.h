@@ -0,0 +1,99 @@
+// convolver.h
+#ifndef CONVOLVER_H
+#define CONVOLVER_H
+
+#include "spscring.h"
+
+#include <QMutex>
+#include <atomic>
+#include <vector>
+
+// ----------------------------------------------------------
+// Convolver Class Declaration
+// ----------------------------------------------------------
+
+/**
+ * @brief Zero-latency convolution with long impulse responses
+ * (cabinet/room simulation, linear-phase EQ).
+ *
+ * The first kPartitionSize taps run in direct form through SoundTouch's
+ * FIRFilter, so the dry path has no added latency. The rest of the IR is
+ * split into uniform partitions of kPartitionSize taps and convolved with
+ * overlap-save FFTs and a frequency-domain delay line; the FFT work for a
+ * partition is exactly hidden behind the direct-form head.
+ *
+ * Kernels (IR spectra plus all filter state) are built off the audio thread
+ * and handed over through an atomic mailbox (newest kernel wins); process()
+ * never locks or allocates. Kernels the audio thread is done with come back
+ * through a lock-free ring and are freed on the next setup call.
+ */
+class Convolver
+{
+public:
+    static constexpr int kPartitionSize = 256;
+    static constexpr int kMaxChannels   = 8;
+    static constexpr int kMaxIrSeconds  = 10;
+
+    Convolver();
+    ~Convolver();
+
+    Convolver(const Convolver&) = delete;
+    Convolver& operator=(const Convolver&) = delete;
+
+    /// Not real-time safe. Sets the stream layout and rebuilds the kernel if an IR is loaded.
+    void setFormat(int channels, int sampleRate);
+
+    /**
+     * @brief Loads an impulse response. Not real-time safe.
+     * @param interleaved IR samples, @p irChannels interleaved. A mono IR is
+     *        applied to every channel; otherwise the channel counts must match.
+     * @param irSampleRate Rate of the IR; it is resampled to the stream rate.
+     * @param normalize Scale the IR to unit energy so the wet level matches the dry level.
+     */
+    bool setImpulseResponse(const std::vector<float>& interleaved, int irChannels,
+                            int irSampleRate, bool normalize = true);
+    void clearImpulseResponse();
+
+    /// Wet/dry balance, 0 = dry, 1 = fully wet. Safe from any thread.
+    void setMix(float wet) { m_mix.store(wet, std::memory_order_relaxed); }
+
+    /**
+     * @brief Designs a symmetric (linear-phase) FIR from a magnitude response.
+     * @param magnitude Linear gain at bins k * sampleRate / N, k = 0..N/2, N a power of two.
+     * @return N - 1 taps, latency (N - 2) / 2 samples.
+     */
+    static std::vector<float> designLinearPhase(const std::vector<float>& magnitude);
+
+    /// Audio thread: picks up new kernels and filters interleaved samples in place.
+    void process(float* samples, int frames);
+
+    /// Audio thread: true if process() has an IR to apply or a new kernel to pick up.
+    bool isActive() const;
+
+    /// Audio thread: frames the current IR keeps ringing after the input stops.
+    int tailFrames() const;
+
+private:
+    struct Kernel;
+
+    Kernel* buildKernel() const;
+    void postKernel(Kernel* kernel);
+    void collectRetired();
+
+    // Audio-thread side
+    Kernel* m_active;
+    std::atomic<Kernel*> m_pending;     ///< Setup -> audio thread, newest wins
+    SpscRing<Kernel*, 16> m_retired;    ///< Audio thread -> setup, freed outside the audio thread
+    std::atomic<float> m_mix;
+
+    // Setup side, guarded by m_setupMutex (never taken by process())
+    QMutex m_setupMutex;
+    std::vector<float> m_ir;
+    int m_irChannels;
+    int m_irSampleRate;
+    bool m_normalize;
+    int m_channels;
+    int m_sampleRate;
+};
+
+#endif // CONVOLVER_H
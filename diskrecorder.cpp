@@ -0,0 +1,349 @@
+// diskrecorder.cpp
+
+#include "diskrecorder.h"
+
+#include <QLoggingCategory>
+#include <QThread>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+
+namespace {
+// Samples start one page into the file, so every chunk write is page aligned
+const qint64 kHeaderBytes = kWavHeaderBytes;
+
+// One write; the ring is a multiple of it, so a chunk never wraps
+const std::size_t kWriteChunk = 1 << 20;
+
+// Ring depth: whatever is larger
+const int kRingSeconds = 8;
+const std::size_t kMinRingBytes = 4 * kWriteChunk;
+
+// File space reserved ahead of the write position
+const qint64 kPreallocateBytes = 64 * 1024 * 1024;
+
+const int kHeaderIntervalMs = 2000;
+const int kPollMs = 20;
+
+const int kFormatPcm   = 0x0001;
+const int kFormatFloat = 0x0003;
+
+void writeLe16(char* p, quint16 v)
+{
+    p[0] = static_cast<char>(v & 0xFF);
+    p[1] = static_cast<char>(v >> 8);
+}
+void writeLe32(char* p, quint32 v)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+void writeLe64(char* p, quint64 v)
+{
+    for (int i = 0; i < 8; ++i)
+        p[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+}
+
+// ----------------------------------------------------------
+// 1. WAV header
+// ----------------------------------------------------------
+
+void buildWavHeader(char* header, RecordFormat format, int channels, int sampleRate, qint64 dataBytes)
+{
+    std::memset(header, 0, kHeaderBytes);
+    const int bytesPerFrame = channels * (format == RecordFormat::Int16 ? 2 : 4);
+
+    const quint64 riffSize = static_cast<quint64>(kHeaderBytes - 8 + dataBytes);
+    const bool rf64 = riffSize >= 0xFFFFFFFFull;
+
+    // RIFF/RF64 header; the 28-byte JUNK chunk becomes ds64 once the sizes
+    // outgrow 32 bits (EBU Tech 3306)
+    std::memcpy(header, rf64 ? "RF64" : "RIFF", 4);
+    writeLe32(header + 4, rf64 ? 0xFFFFFFFFu : static_cast<quint32>(riffSize));
+    std::memcpy(header + 8, "WAVE", 4);
+    std::memcpy(header + 12, rf64 ? "ds64" : "JUNK", 4);
+    writeLe32(header + 16, 28);
+    if (rf64) {
+        writeLe64(header + 20, riffSize);
+        writeLe64(header + 28, static_cast<quint64>(dataBytes));
+        writeLe64(header + 36, static_cast<quint64>(dataBytes / bytesPerFrame));
+    }
+
+    // fmt
+    const int bitsPerSample = format == RecordFormat::Int16 ? 16 : 32;
+    std::memcpy(header + 48, "fmt ", 4);
+    writeLe32(header + 52, 16);
+    writeLe16(header + 56, format == RecordFormat::Int16 ? kFormatPcm : kFormatFloat);
+    writeLe16(header + 58, static_cast<quint16>(channels));
+    writeLe32(header + 60, static_cast<quint32>(sampleRate));
+    writeLe32(header + 64, static_cast<quint32>(sampleRate * bytesPerFrame));
+    writeLe16(header + 68, static_cast<quint16>(bytesPerFrame));
+    writeLe16(header + 70, static_cast<quint16>(bitsPerSample));
+
+    // Padding up to the data chunk header in the last 8 bytes of the page
+    std::memcpy(header + 72, "JUNK", 4);
+    writeLe32(header + 76, static_cast<quint32>(kHeaderBytes - 8 - 80));
+
+    std::memcpy(header + kHeaderBytes - 8, "data", 4);
+    writeLe32(header + kHeaderBytes - 4, rf64 ? 0xFFFFFFFFu : static_cast<quint32>(dataBytes));
+}
+
+// ----------------------------------------------------------
+// 2. Writer thread
+// ----------------------------------------------------------
+
+class RecorderWriter : public QThread
+{
+public:
+    explicit RecorderWriter(DiskRecorder* owner) : m_owner(owner) {}
+
+protected:
+    void run() override { m_owner->writerLoop(); }
+
+private:
+    DiskRecorder* m_owner;
+};
+
+// ----------------------------------------------------------
+// 3. Control
+// ----------------------------------------------------------
+
+DiskRecorder::DiskRecorder()
+    : m_ring(nullptr)
+    , m_ringSize(0)
+    , m_head(0)
+    , m_tail(0)
+    , m_active(false)
+    , m_busy(false)
+    , m_format(RecordFormat::Float32)
+    , m_channels(0)
+    , m_sampleRate(0)
+    , m_bytesPerFrame(0)
+    , m_dataBytes(0)
+    , m_preallocated(0)
+    , m_failed(false)
+    , m_writing(false)
+    , m_framesWritten(0)
+    , m_droppedFrames(0)
+{
+}
+
+DiskRecorder::~DiskRecorder()
+{
+    stop();
+}
+
+bool DiskRecorder::start(const QString& path, RecordFormat format, int channels, int sampleRate,
+                         QString* error)
+{
+    stop();
+    if (channels <= 0 || sampleRate <= 0) {
+        if (error)
+            *error = QStringLiteral("Invalid channel count or sample rate");
+        return false;
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        if (error)
+            *error = m_file.errorString();
+        return false;
+    }
+
+    m_format = format;
+    m_channels = channels;
+    m_sampleRate = sampleRate;
+    m_bytesPerFrame = channels * (format == RecordFormat::Int16 ? 2 : 4);
+
+    const std::size_t wanted = std::max(kMinRingBytes,
+        static_cast<std::size_t>(sampleRate) * m_bytesPerFrame * kRingSeconds);
+    m_ringSize = kMinRingBytes;
+    while (m_ringSize < wanted)
+        m_ringSize <<= 1;
+    m_ring = static_cast<char*>(qMallocAligned(m_ringSize, kHeaderBytes));
+    if (!m_ring) {
+        m_file.close();
+        if (error)
+            *error = QStringLiteral("Out of memory for the recording buffer");
+        return false;
+    }
+    // Touch every page now, so the audio thread never faults one in
+    std::memset(m_ring, 0, m_ringSize);
+
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+    m_dataBytes = 0;
+    m_preallocated = 0;
+    m_failed = false;
+    m_framesWritten.store(0, std::memory_order_relaxed);
+    m_droppedFrames.store(0, std::memory_order_relaxed);
+
+    if (!writeHeader()) {
+        m_file.close();
+        qFreeAligned(m_ring);
+        m_ring = nullptr;
+        if (error)
+            *error = m_file.errorString();
+        return false;
+    }
+    preallocate();
+
+    m_writing.store(true, std::memory_order_relaxed);
+    m_writer.reset(new RecorderWriter(this));
+    m_writer->start();
+    m_active.store(true, std::memory_order_release);
+
+    qCDebug(audioCategory) << "Recording" << path << channels << "ch," << sampleRate << "Hz,"
+                           << (format == RecordFormat::Int16 ? "16-bit PCM" : "float")
+                           << "| ring" << m_ringSize / 1024 << "KiB";
+    return true;
+}
+
+void DiskRecorder::stop()
+{
+    if (!m_writer)
+        return;
+
+    // Dekker-style handshake: once m_busy reads false after m_active was
+    // cleared, the audio thread is out of write() and will not come back
+    m_active.store(false);
+    while (m_busy.load())
+        QThread::yieldCurrentThread();
+
+    m_writing.store(false, std::memory_order_relaxed);
+    m_writer->wait();
+    m_writer.reset();
+
+    m_file.close();
+    qFreeAligned(m_ring);
+    m_ring = nullptr;
+    m_ringSize = 0;
+
+    qCDebug(audioCategory) << "Recording stopped:" << m_file.fileName()
+                           << framesWritten() << "frames," << droppedFrames() << "dropped"
+                           << (m_failed ? "(write error)" : "");
+}
+
+// ----------------------------------------------------------
+// 4. Audio thread side
+// ----------------------------------------------------------
+
+void DiskRecorder::write(const qint16* samples, int frames)
+{
+    push(samples, frames, RecordFormat::Int16);
+}
+
+void DiskRecorder::write(const float* samples, int frames)
+{
+    push(samples, frames, RecordFormat::Float32);
+}
+
+void DiskRecorder::push(const void* data, int frames, RecordFormat format)
+{
+    if (!data || frames <= 0)
+        return;
+
+    m_busy.store(true);
+    if (m_active.load() && format == m_format) {
+        const std::size_t bytes = static_cast<std::size_t>(frames) * m_bytesPerFrame;
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        const std::size_t used = head - m_tail.load(std::memory_order_acquire);
+        if (m_ringSize - used < bytes) {
+            // The writer is seconds behind; lose this block, never wait
+            m_droppedFrames.fetch_add(frames, std::memory_order_relaxed);
+        } else {
+            const std::size_t offset = head & (m_ringSize - 1);
+            const std::size_t first = std::min(bytes, m_ringSize - offset);
+            const char* src = static_cast<const char*>(data);
+            std::memcpy(m_ring + offset, src, first);
+            std::memcpy(m_ring, src + first, bytes - first);
+            m_head.store(head + bytes, std::memory_order_release);
+        }
+    }
+    m_busy.store(false, std::memory_order_release);
+}
+
+// ----------------------------------------------------------
+// 5. Writer side
+// ----------------------------------------------------------
+
+void DiskRecorder::writerLoop()
+{
+    m_headerClock.start();
+    while (m_writing.load(std::memory_order_relaxed)) {
+        if (!drain(false))
+            break;
+        QThread::msleep(kPollMs);
+    }
+    if (!m_failed)
+        drain(true);
+    writeHeader();
+
+    // Give back the preallocated space past the end
+    m_file.resize(kHeaderBytes + m_dataBytes);
+}
+
+bool DiskRecorder::drain(bool final)
+{
+    std::size_t available = m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_relaxed);
+    while (available >= kWriteChunk || (final && available > 0)) {
+        // Tails advance in whole chunks until the final drain, so a chunk
+        // never wraps and goes to disk straight from the ring
+        const std::size_t count = std::min(available, kWriteChunk);
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        const char* chunk = m_ring + (tail & (m_ringSize - 1));
+
+        preallocate();
+        if (m_file.write(chunk, static_cast<qint64>(count)) != static_cast<qint64>(count)) {
+            qCWarning(audioCategory) << "Recording write failed:" << m_file.errorString();
+            m_failed = true;
+            return false;
+        }
+        m_tail.store(tail + count, std::memory_order_release);
+        m_dataBytes += static_cast<qint64>(count);
+        m_framesWritten.store(m_dataBytes / m_bytesPerFrame, std::memory_order_relaxed);
+        available -= count;
+    }
+
+    if (m_headerClock.elapsed() >= kHeaderIntervalMs) {
+        writeHeader();
+        m_headerClock.restart();
+    }
+    return true;
+}
+
+void DiskRecorder::preallocate()
+{
+#if defined(__linux__)
+    // Reserve extents ahead of time (without changing the file size), so
+    // writes never wait for block allocation and the file stays contiguous
+    const qint64 end = kHeaderBytes + m_dataBytes + static_cast<qint64>(kWriteChunk);
+    if (end <= m_preallocated)
+        return;
+    if (fallocate(m_file.handle(), FALLOC_FL_KEEP_SIZE, m_preallocated, kPreallocateBytes) != 0) {
+        qCDebug(audioCategory) << "Recording: no preallocation on this file system";
+        m_preallocated = std::numeric_limits<qint64>::max();
+        return;
+    }
+    m_preallocated += kPreallocateBytes;
+#endif
+}
+
+bool DiskRecorder::writeHeader()
+{
+    char header[kHeaderBytes];
+    buildWavHeader(header, m_format, m_channels, m_sampleRate, m_dataBytes);
+
+    const bool ok = m_file.seek(0) && m_file.write(header, kHeaderBytes) == kHeaderBytes
+                 && m_file.seek(kHeaderBytes + m_dataBytes);
+    if (!ok)
+        qCWarning(audioCategory) << "Recording header update failed:" << m_file.errorString();
+    return ok;
+}
@@ -0,0 +1,115 @@
+// diskrecorder.h
+#ifndef DISKRECORDER_H
+#define DISKRECORDER_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+class RecorderWriter;
+
+// ----------------------------------------------------------
+// DiskRecorder Class Declaration
+// ----------------------------------------------------------
+
+enum class RecordFormat
+{
+    Int16,          ///< 16-bit PCM, e.g. the dry microphone input as read
+    Float32         ///< IEEE float, e.g. the processed output as written to the sink
+};
+
+/// Size of the header built by buildWavHeader(); the samples start one page into the file.
+constexpr int kWavHeaderBytes = 4096;
+
+/**
+ * @brief Fills @p header (kWavHeaderBytes) with a WAV header for @p dataBytes
+ * of samples. Past 4 GiB the reserved JUNK chunk becomes ds64 and the file RF64.
+ */
+void buildWavHeader(char* header, RecordFormat format, int channels, int sampleRate, qint64 dataBytes);
+
+/**
+ * @brief Streams an audio stream to a WAV file without putting any disk I/O
+ * on the audio thread.
+ *
+ * write() only copies the block into a preallocated lock-free byte ring
+ * (several seconds deep) and never blocks; if the writer falls that far
+ * behind, the block is dropped and counted. A writer thread drains the ring
+ * in 1 MiB writes at 4 KiB-aligned file offsets (the header is padded to
+ * one page), preallocates the file in large extents ahead of the write
+ * position and rewrites the header every few seconds, so an interrupted
+ * recording stays playable. Past 4 GiB the file becomes RF64 (the reserved
+ * JUNK chunk turns into ds64), so multi-hour captures work.
+ *
+ * start() and stop() belong to one control thread; write() to the audio thread.
+ */
+class DiskRecorder
+{
+public:
+    DiskRecorder();
+    ~DiskRecorder();
+
+    DiskRecorder(const DiskRecorder&) = delete;
+    DiskRecorder& operator=(const DiskRecorder&) = delete;
+
+    /// Not real-time safe. Creates @p path, allocates the ring and starts the writer.
+    bool start(const QString& path, RecordFormat format, int channels, int sampleRate,
+               QString* error = nullptr);
+
+    /// Not real-time safe. Waits for the audio thread to leave write(), flushes and finalizes the file.
+    void stop();
+
+    bool isRecording() const { return m_active.load(std::memory_order_acquire); }
+
+    /// Audio thread. Ignored unless recording in the matching format.
+    void write(const qint16* samples, int frames);
+    void write(const float* samples, int frames);
+
+    /// Frames that reached the file so far.
+    qint64 framesWritten() const { return m_framesWritten.load(std::memory_order_relaxed); }
+
+    /// Frames dropped because the ring was full.
+    qint64 droppedFrames() const { return m_droppedFrames.load(std::memory_order_relaxed); }
+
+private:
+    friend class RecorderWriter;
+
+    void push(const void* data, int frames, RecordFormat format);
+    void writerLoop();
+    bool drain(bool final);
+    bool writeHeader();
+    void preallocate();
+
+    // Ring, written by the audio thread and written out by the writer
+    // straight from its page-aligned memory
+    char* m_ring;
+    std::size_t m_ringSize;                 ///< Bytes, power of two
+    std::atomic<std::size_t> m_head;        ///< Total bytes pushed
+    std::atomic<std::size_t> m_tail;        ///< Total bytes written out
+
+    // Handshake with the audio thread (see stop())
+    std::atomic<bool> m_active;
+    std::atomic<bool> m_busy;
+
+    RecordFormat m_format;
+    int m_channels;
+    int m_sampleRate;
+    int m_bytesPerFrame;
+
+    // Writer side
+    QFile m_file;
+    qint64 m_dataBytes;                     ///< Sample bytes in the file
+    qint64 m_preallocated;                  ///< File bytes reserved so far
+    QElapsedTimer m_headerClock;            ///< Time since the last header update
+    bool m_failed;
+    std::unique_ptr<RecorderWriter> m_writer;
+    std::atomic<bool> m_writing;
+
+    std::atomic<qint64> m_framesWritten;
+    std::atomic<qint64> m_droppedFrames;
+};
+
+#endif // DISKRECORDER_H
@@ -0,0 +1,152 @@
+#include "driftcompensator.h"
+
+#include <algorithm>
+#include <cmath>
+
+// ----------------------------------------------------------
+// Controller tuning
+// ----------------------------------------------------------
+
+namespace {
+// Proportional and integral gains on the fill error in seconds.
+// 10 ms of excess fill gives an immediate 100 ppm correction.
+const double kProportionalGain = 0.01;
+const double kIntegralGain     = 0.0005;
+
+// Real device clocks differ by well under 1000 ppm; anything larger is a
+// transient (xrun, device hiccup) that we should not chase.
+const double kMaxCorrection    = 0.002;
+
+// One-pole smoothing of the measured fill, which jumps by a whole device
+// period every time the sink pulls data.
+const double kFillSmoothing    = 0.02;
+
+// Blocks to observe before latching the target fill (~0.5 s at 256 frames / 48 kHz).
+const int kSettleBlocks        = 100;
+}
+
+DriftCompensator::DriftCompensator()
+    : m_state(nullptr)
+    , m_channels(0)
+    , m_inputRate(0)
+    , m_sampleRate(0)
+    , m_maxOutputFrames(0)
+    , m_baseRatio(1.0)
+    , m_ratio(1.0)
+    , m_integral(0.0)
+    , m_filteredFill(0.0)
+    , m_targetFill(0)
+    , m_settleBlocks(kSettleBlocks)
+{
+}
+
+DriftCompensator::~DriftCompensator()
+{
+    if (m_state) {
+        src_delete(m_state);
+        m_state = nullptr;
+    }
+}
+
+bool DriftCompensator::init(int channels, int inputRate, int outputRate, int maxBlockFrames,
+                            int converterType)
+{
+    if (m_state) {
+        src_delete(m_state);
+        m_state = nullptr;
+    }
+    m_maxOutputFrames = 0;
+    if (channels <= 0 || inputRate <= 0 || outputRate <= 0 || maxBlockFrames <= 0)
+        return false;
+
+    int error = 0;
+    m_state = src_new(converterType, channels, &error);
+    if (!m_state)
+        return false;
+
+    m_channels   = channels;
+    m_inputRate  = inputRate;
+    m_sampleRate = outputRate;
+    m_baseRatio  = static_cast<double>(outputRate) / inputRate;
+    m_maxOutputFrames = static_cast<int>(std::ceil(maxBlockFrames * m_baseRatio * (1.0 + kMaxCorrection))) + 16;
+    reset();
+    return true;
+}
+
+void DriftCompensator::reset()
+{
+    if (m_state) {
+        src_reset(m_state);
+        src_set_ratio(m_state, m_baseRatio);
+    }
+    m_ratio        = 1.0;
+    m_integral     = 0.0;
+    m_filteredFill = 0.0;
+    m_targetFill   = 0;
+    m_settleBlocks = kSettleBlocks;
+}
+
+void DriftCompensator::setTargetFill(int frames)
+{
+    m_targetFill   = std::max(frames, 0);
+    m_settleBlocks = (m_targetFill > 0) ? 0 : kSettleBlocks;
+}
+
+double DriftCompensator::update(int queuedFrames, int blockFrames)
+{
+    if (!m_state || blockFrames <= 0)
+        return m_ratio;
+
+    if (m_filteredFill == 0.0)
+        m_filteredFill = queuedFrames;
+    else
+        m_filteredFill += kFillSmoothing * (queuedFrames - m_filteredFill);
+
+    if (m_settleBlocks > 0) {
+        // Still latching the target; leave the ratio untouched.
+        if (--m_settleBlocks == 0 && m_targetFill == 0)
+            m_targetFill = static_cast<int>(m_filteredFill + 0.5);
+        return m_ratio;
+    }
+
+    const double dt    = static_cast<double>(blockFrames) / m_inputRate;
+    const double error = (m_filteredFill - m_targetFill) / m_sampleRate;
+
+    // Anti-windup: bound the integral to what the output clamp can express.
+    const double limit = kMaxCorrection / kIntegralGain;
+    m_integral = std::clamp(m_integral + error * dt, -limit, limit);
+
+    double correction = kProportionalGain * error + kIntegralGain * m_integral;
+    correction = std::clamp(correction, -kMaxCorrection, kMaxCorrection);
+
+    // A fuller sink means we produce faster than it plays: shrink the output.
+    m_ratio = 1.0 - correction;
+    return m_ratio;
+}
+
+int DriftCompensator::process(const float* in, int inFrames, std::vector<float>& out)
+{
+    if (!m_state || !in || inFrames <= 0)
+        return 0;
+
+    // Bounded by what the caller sized up front; a block larger than the
+    // one given to init() is cut short rather than growing the buffer here
+    const int maxOutFrames = static_cast<int>(out.size() / m_channels);
+    if (maxOutFrames <= 0)
+        return 0;
+
+    SRC_DATA data;
+    data.data_in       = in;
+    data.data_out      = out.data();
+    data.input_frames  = inFrames;
+    data.output_frames = maxOutFrames;
+    data.src_ratio     = m_baseRatio * m_ratio;   // libsamplerate ramps smoothly from the previous ratio
+    data.end_of_input  = 0;
+    data.input_frames_used = 0;
+    data.output_frames_gen = 0;
+
+    if (src_process(m_state, &data) != 0)
+        return 0;
+
+    return static_cast<int>(data.output_frames_gen);
+}
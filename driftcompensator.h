@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <samplerate.h>
+
+/**
+ * @brief Keeps the output buffer fill level constant when the input and
+ * output devices run from independent clocks.
+ *
+ * Every processed block is passed through a variable-ratio libsamplerate
+ * converter. A PI controller compares the number of frames queued in the
+ * sink against a target fill level and nudges the conversion ratio by a few
+ * hundred ppm, so the sink neither slowly fills up nor drains.
+ *
+ * When the chain runs at a reduced processing rate, the same converter also
+ * does the upsampling to the sink rate, so the stream is resampled only once
+ * on its way out.
+ */
+class DriftCompensator
+{
+public:
+    DriftCompensator();
+    ~DriftCompensator();
+
+    DriftCompensator(const DriftCompensator&) = delete;
+    DriftCompensator& operator=(const DriftCompensator&) = delete;
+
+    /**
+     * @brief Allocates the converter. Returns false if libsamplerate fails.
+     * @param channels Number of interleaved channels in each block.
+     * @param inputRate Rate of the processed blocks.
+     * @param outputRate Rate of the sink; the fill level is measured in frames at this rate.
+     * @param maxBlockFrames Largest block process() will be given, in input frames.
+     */
+    bool init(int channels, int inputRate, int outputRate, int maxBlockFrames,
+              int converterType = SRC_SINC_FASTEST);
+
+    /**
+     * @brief Resets controller and converter state (e.g. after a pause).
+     * The target fill is re-latched from the next measurements.
+     */
+    void reset();
+
+    /**
+     * @brief Sets the desired sink fill level in frames.
+     * A value <= 0 latches the average fill seen during the first blocks.
+     */
+    void setTargetFill(int frames);
+    int targetFill() const { return m_targetFill; }
+
+    /**
+     * @brief Feeds the current sink fill level into the PI controller.
+     * @param queuedFrames Frames written to the sink but not yet played.
+     * @param blockFrames Size of the block about to be written (input frames), used as the controller time step.
+     * @return The drift correction that will be applied to the next block (1.0 = none).
+     */
+    double update(int queuedFrames, int blockFrames);
+
+    /**
+     * @brief Resamples one block with the current ratio.
+     * @p out is never resized (this runs on the audio thread); size it to
+     * maxOutputFrames() frames once after init().
+     * @return Number of frames written to @p out.
+     */
+    int process(const float* in, int inFrames, std::vector<float>& out);
+
+    /// Output frames a block of maxBlockFrames can produce at the largest correction.
+    int maxOutputFrames() const { return m_maxOutputFrames; }
+    double ratio() const { return m_ratio; }
+    bool isValid() const { return m_state != nullptr; }
+
+private:
+    SRC_STATE* m_state;
+    int m_channels;
+    int m_inputRate;
+    int m_sampleRate;        ///< Output (sink) rate
+
+    int m_maxOutputFrames;   ///< Output capacity for the largest block
+
+    double m_baseRatio;      ///< outputRate / inputRate
+    double m_ratio;          ///< Correction applied to the next block (1.0 = none).
+    double m_integral;       ///< Integrated fill error in seconds * seconds.
+    double m_filteredFill;   ///< Low-passed fill level in frames.
+    int m_targetFill;        ///< Desired fill level in frames, 0 until latched.
+    int m_settleBlocks;      ///< Blocks left before the target is latched.
+};
@@ -0,0 +1,338 @@
+// dspchain.cpp
+
+#include "dspchain.h"
+#include "biquad.h"
+
+#include <QLoggingCategory>
+#include <algorithm>
+#include <cmath>
+
+// Shared by every DSP module and the application
+Q_LOGGING_CATEGORY(audioCategory, "audio")
+
+namespace {
+// Stages count as bypassed within this distance of their neutral setting
+const float kNeutralTolerance = 0.0001f;
+
+// Tail of the gate release and biquad decay, on top of the pitch and
+// convolution tails
+const int kBaseTailMs = 100;
+
+// Noise gate ramps
+const int kGateAttackMs  = 10;
+const int kGateReleaseMs = 50;
+}
+
+// ----------------------------------------------------------
+// 1. Stage design
+// ----------------------------------------------------------
+
+DspStages designChainState(const DspParameters& p, int sampleRate, ChainState& state)
+{
+    DspStages stages;
+
+    // Noise gate: ramps towards the reduction floor below the threshold
+    const int attackSamples  = std::max(sampleRate * kGateAttackMs / 1000, 1);
+    const int releaseSamples = std::max(sampleRate * kGateReleaseMs / 1000, 1);
+    const float threshold = std::pow(10.0f, p.gateThresholdDb / 20.0f);
+    const float floor = std::clamp(1.0f - threshold, 0.0f, 0.9f);
+    stages.gate = p.gateEnabled;
+    state.gateThreshold = stages.gate ? threshold : 0.0f;
+    state.gateFloor     = floor;
+    state.gateAttack    = (1.0f - floor) / attackSamples;
+    state.gateRelease   = (1.0f - floor) / releaseSamples;
+
+    stages.distortion = std::fabs(p.distortionGain - 1.0f) > kNeutralTolerance;
+    state.drive = stages.distortion ? p.distortionGain : 0.0f;
+
+    // Band filter, designed once per change. The band modes take the
+    // geometric centre and the width in octaves.
+    Biquad designer;
+    const float nyquist = sampleRate * 0.5f;
+    const float low = p.lowFreq;
+    const float high = p.highFreq;
+    switch (p.filter) {
+    case DspFilter::LowPass:
+        if (low > 0.0f && low < nyquist) {
+            designer.setupLowPass(low, sampleRate);
+            stages.filter = true;
+        }
+        break;
+    case DspFilter::HighPass:
+        if (high > 0.0f && high < nyquist) {
+            designer.setupHighPass(high, sampleRate);
+            stages.filter = true;
+        }
+        break;
+    case DspFilter::BandPass:
+    case DspFilter::Notch:
+        if (low > 0.0f && high > low && high < nyquist) {
+            const float centre = std::sqrt(low * high);
+            const float octaves = std::log2(high / low);
+            if (p.filter == DspFilter::BandPass)
+                designer.setupBandPass(centre, octaves, sampleRate);
+            else
+                designer.setupNotch(centre, octaves, sampleRate);
+            stages.filter = true;
+        }
+        break;
+    case DspFilter::None:
+    default:
+        break;
+    }
+    if (stages.filter) {
+        designer.getCoefficients(state.b0, state.b1, state.b2, state.a1, state.a2);
+    } else {
+        state.b0 = 1.0f;
+        state.b1 = state.b2 = state.a1 = state.a2 = 0.0f;
+    }
+    return stages;
+}
+
+// ----------------------------------------------------------
+// 2. Setup
+// ----------------------------------------------------------
+
+DspChain::DspChain()
+    : m_channels(1)
+    , m_sampleRate(48000)
+    , m_configured(false)
+    , m_gated(false)
+    , m_distorted(false)
+    , m_filtered(false)
+    , m_kernelsPitched(false)
+    , m_preChainKernel(nullptr)
+    , m_postChainKernel(nullptr)
+    , m_pitchEngine(nullptr)
+    , m_pendingPitchEngine(nullptr)
+    , m_pitchEngaged(false)
+    , m_pitchInvalidBlocks(0)
+    , m_pitchBacklogResets(0)
+    , m_pitchFailedBlocks(0)
+    , m_pitchEngineType(PitchEngineType::SoundTouch)
+    , m_pitchEngineChannels(0)
+    , m_pitchEngineSampleRate(0)
+{
+}
+
+DspChain::~DspChain()
+{
+    delete m_pitchEngine;
+    delete m_pendingPitchEngine.exchange(nullptr);
+    collectRetiredPitchEngines();
+}
+
+void DspChain::setFormat(int channels, int sampleRate)
+{
+    m_channels = std::clamp(channels, 1, kMaxChannels);
+    m_sampleRate = sampleRate;
+
+    // Processing has not started, so the engine can be installed directly
+    {
+        QMutexLocker lock(&m_pitchEngineMutex);
+        m_pitchEngineChannels = m_channels;
+        m_pitchEngineSampleRate = sampleRate;
+        delete m_pendingPitchEngine.exchange(nullptr);
+        retirePitchEvents(m_pitchEngine);
+        delete m_pitchEngine;
+        m_pitchEngine = PitchEngine::create(m_pitchEngineType).release();
+        m_pitchEngine->setFormat(m_pitchEngineChannels, m_pitchEngineSampleRate);
+        m_pitchEngaged = false;
+    }
+
+    m_parametricEq.setChannels(m_channels);
+    m_parametricEq.setSampleRate(sampleRate);
+    m_convolver.setFormat(m_channels, sampleRate);
+    m_harmonizer.setFormat(m_channels, sampleRate);
+
+    // Fresh filter and gate state; the kernels follow on the next setParameters()
+    for (ChainState& state : m_chainStates)
+        state = ChainState();
+    m_configured = false;
+    configure();
+}
+
+void DspChain::setParameters(const DspParameters& parameters)
+{
+    if (m_configured && parameters == m_parameters)
+        return;
+    m_parameters = parameters;
+    configure();
+}
+
+void DspChain::configure()
+{
+    DspStages stages;
+    for (int ch = 0; ch < m_channels; ++ch)
+        stages = designChainState(m_parameters, m_sampleRate, m_chainStates[ch]);
+    m_gated = stages.gate;
+    m_distorted = stages.distortion;
+    m_filtered = stages.filter;
+
+    selectKernels(m_parameters.pitchSemitones != 0.0f || m_harmonizer.isActive());
+    m_configured = true;
+    qCDebug(audioCategory) << "Effect chain: gate" << m_gated << "distortion" << m_distorted
+                           << "filter" << (m_filtered ? static_cast<int>(m_parameters.filter) : 0)
+                           << "pitch" << m_parameters.pitchSemitones;
+}
+
+void DspChain::selectKernels(bool pitched)
+{
+    // The gate sits in front of the pitch stage; when nothing is pitched
+    // all three stages fuse into one pass
+    if (pitched) {
+        m_preChainKernel  = selectChainKernel(m_gated, false, false);
+        m_postChainKernel = selectChainKernel(false, m_distorted, m_filtered);
+    } else {
+        m_preChainKernel  = selectChainKernel(m_gated, m_distorted, m_filtered);
+        m_postChainKernel = nullptr;
+    }
+    m_kernelsPitched = pitched;
+}
+
+bool DspChain::isActive() const
+{
+    return m_gated || m_distorted || m_filtered
+        || m_parameters.pitchSemitones != 0.0f || m_harmonizer.isActive()
+        || m_parametricEq.isActive() || m_convolver.isActive();
+}
+
+int DspChain::latencyFrames() const
+{
+    if (m_harmonizer.isActive())
+        return m_harmonizer.latencyFrames();
+    if (m_parameters.pitchSemitones != 0.0f && m_pitchEngine)
+        return m_pitchEngine->latencyFrames();
+    return 0;
+}
+
+int DspChain::tailFrames() const
+{
+    return m_sampleRate * kBaseTailMs / 1000 + latencyFrames() + m_convolver.tailFrames();
+}
+
+// ----------------------------------------------------------
+// 3. Processing
+// ----------------------------------------------------------
+
+void DspChain::process(const float* in, float* out, int frames)
+{
+    if (!in || !out || frames <= 0)
+        return;
+
+    const int numSamples = frames * m_channels;
+    if (in != out)
+        std::copy(in, in + numSamples, out);
+
+    // Voices can be switched on from the setup thread at any time
+    const bool harmonized = m_harmonizer.isActive();
+    const bool pitched = harmonized || m_parameters.pitchSemitones != 0.0f;
+    if (pitched != m_kernelsPitched)
+        selectKernels(pitched);
+
+    // Gate (+ distortion and band filter when not pitched), one fused pass per channel
+    if (m_preChainKernel) {
+        for (int ch = 0; ch < m_channels; ++ch)
+            m_preChainKernel(m_chainStates[ch], out + ch, frames, m_channels);
+    }
+
+    // Pitch: harmonizer voices replace the single shifter while enabled
+    if (harmonized) {
+        m_harmonizer.process(out, frames);
+        m_pitchEngaged = false;
+    } else if (pitched) {
+        applyPitchShifting(out, frames);
+    } else {
+        m_pitchEngaged = false;
+    }
+
+    // Distortion + band filter after the pitch stage, one fused pass
+    if (m_postChainKernel) {
+        for (int ch = 0; ch < m_channels; ++ch)
+            m_postChainKernel(m_chainStates[ch], out + ch, frames, m_channels);
+    }
+
+    // Both bypass themselves when no band / no IR is set
+    m_parametricEq.process(out, frames);
+    m_convolver.process(out, frames);
+}
+
+// ----------------------------------------------------------
+// 4. Pitch engine hand-over
+// ----------------------------------------------------------
+
+void DspChain::setPitchEngine(PitchEngineType type)
+{
+    QMutexLocker lock(&m_pitchEngineMutex);
+    collectRetiredPitchEngines();
+    m_pitchEngineType = type;
+    if (m_pitchEngineChannels <= 0)
+        return; // installed by setFormat()
+
+    PitchEngine* engine = PitchEngine::create(type).release();
+    engine->setFormat(m_pitchEngineChannels, m_pitchEngineSampleRate);
+    // An engine the processing thread never picked up can be freed right here
+    delete m_pendingPitchEngine.exchange(engine, std::memory_order_acq_rel);
+    qCDebug(audioCategory) << "Pitch engine:" << engine->name()
+                           << "latency" << engine->latencyFrames() << "frames";
+}
+
+void DspChain::collectRetiredPitchEngines()
+{
+    PitchEngine* engine;
+    while (m_retiredPitchEngines.pop(engine))
+        delete engine;
+}
+
+void DspChain::applyPitchShifting(float* samples, int frames)
+{
+    if (PitchEngine* next = m_pendingPitchEngine.exchange(nullptr, std::memory_order_acq_rel)) {
+        // Freeing is left to the setup side; if the ring is somehow full the
+        // old engine is leaked rather than freed on the processing thread
+        if (m_pitchEngine) {
+            retirePitchEvents(m_pitchEngine);
+            m_retiredPitchEngines.push(m_pitchEngine);
+        }
+        m_pitchEngine = next;
+        m_pitchEngaged = false;
+    }
+    if (!m_pitchEngine)
+        return;
+
+    // Whatever was buffered before a bypass is stale by now
+    if (!m_pitchEngaged) {
+        m_pitchEngine->reset();
+        m_pitchEngaged = true;
+    }
+
+    m_pitchEngine->setPitchSemiTones(m_parameters.pitchSemitones);
+    m_pitchEngine->process(samples, frames);
+    publishPitchEvents();
+}
+
+void DspChain::retirePitchEvents(const PitchEngine* engine)
+{
+    if (!engine)
+        return;
+    const PitchEngineEvents events = engine->events();
+    m_retiredPitchEvents.invalidBlocks += events.invalidBlocks;
+    m_retiredPitchEvents.backlogResets += events.backlogResets;
+    m_retiredPitchEvents.failedBlocks  += events.failedBlocks;
+}
+
+void DspChain::publishPitchEvents()
+{
+    const PitchEngineEvents events = m_pitchEngine->events();
+    m_pitchInvalidBlocks.store(m_retiredPitchEvents.invalidBlocks + events.invalidBlocks, std::memory_order_relaxed);
+    m_pitchBacklogResets.store(m_retiredPitchEvents.backlogResets + events.backlogResets, std::memory_order_relaxed);
+    m_pitchFailedBlocks.store(m_retiredPitchEvents.failedBlocks + events.failedBlocks, std::memory_order_relaxed);
+}
+
+PitchEngineEvents DspChain::pitchEngineEvents() const
+{
+    PitchEngineEvents events;
+    events.invalidBlocks = m_pitchInvalidBlocks.load(std::memory_order_relaxed);
+    events.backlogResets = m_pitchBacklogResets.load(std::memory_order_relaxed);
+    events.failedBlocks  = m_pitchFailedBlocks.load(std::memory_order_relaxed);
+    return events;
+}
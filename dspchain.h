@@ -0,0 +1,200 @@
+// dspchain.h
+#ifndef DSPCHAIN_H
+#define DSPCHAIN_H
+
+#include "convolver.h"
+#include "effectchain.h"
+#include "harmonizer.h"
+#include "parametriceq.h"
+#include "pitchengine.h"
+#include "spscring.h"
+
+#include <QMutex>
+#include <atomic>
+#include <vector>
+
+// ----------------------------------------------------------
+// DspChain Class Declaration
+// ----------------------------------------------------------
+
+/// Band filter modes; the values match the filter combo box index.
+enum class DspFilter
+{
+    None = 0,
+    LowPass,        ///< Cutoff at lowFreq
+    HighPass,       ///< Cutoff at highFreq
+    BandPass,       ///< lowFreq .. highFreq
+    Notch           ///< lowFreq .. highFreq
+};
+
+/// Plain parameter set of the chain. Copy it in with DspChain::setParameters().
+struct DspParameters
+{
+    bool gateEnabled      = false;
+    float gateThresholdDb = -20.0f;
+    float pitchSemitones  = 0.0f;   ///< 0 bypasses the pitch stage
+    float distortionGain  = 1.0f;   ///< tanh drive; 1 bypasses the stage
+    DspFilter filter      = DspFilter::None;
+    float lowFreq         = 500.0f;
+    float highFreq        = 5000.0f;
+
+    bool operator==(const DspParameters& other) const
+    {
+        return gateEnabled == other.gateEnabled && gateThresholdDb == other.gateThresholdDb
+            && pitchSemitones == other.pitchSemitones && distortionGain == other.distortionGain
+            && filter == other.filter && lowFreq == other.lowFreq && highFreq == other.highFreq;
+    }
+    bool operator!=(const DspParameters& other) const { return !(*this == other); }
+};
+
+/// Stages a parameter set switches on.
+struct DspStages
+{
+    bool gate       = false;
+    bool distortion = false;
+    bool filter     = false;
+};
+
+/**
+ * @brief Writes the gate, drive and band filter settings for @p parameters
+ * into @p state, leaving its running state (gate gain, filter history) alone.
+ * Disabled stages get neutral settings (threshold 0, drive 0, identity
+ * filter), so lane-batched kernels can run streams with different stage
+ * sets side by side.
+ */
+DspStages designChainState(const DspParameters& parameters, int sampleRate, ChainState& state);
+
+/**
+ * @brief The complete effect chain, free of widgets, devices and QByteArray:
+ * gate -> pitch (or harmonizer) -> distortion -> band filter -> parametric
+ * EQ -> convolution, on caller-owned interleaved float buffers.
+ *
+ * AudioThread drives one of these; servers embed it directly or through the
+ * C API in audiomodifier_dsp.h. process(), setParameters() and the query
+ * functions belong to the processing thread. The stage setup functions
+ * (EQ bands, impulse response, harmony voices, pitch engine) may be called
+ * from one other thread and reach the processing thread lock-free.
+ */
+class DspChain
+{
+public:
+    /// Channels every stage supports (see ParametricEq, Convolver, Harmonizer).
+    static constexpr int kMaxChannels = 8;
+
+    DspChain();
+    ~DspChain();
+
+    DspChain(const DspChain&) = delete;
+    DspChain& operator=(const DspChain&) = delete;
+
+    /**
+     * @brief Not real-time safe. Sets the stream layout of every stage and
+     * resets their state. @p channels is clamped to 1..kMaxChannels, as in
+     * the stages; callers with more must not pass their buffers through.
+     */
+    void setFormat(int channels, int sampleRate);
+    int channels() const { return m_channels; }
+    int sampleRate() const { return m_sampleRate; }
+
+    /**
+     * @brief Processing thread, between blocks. Comparing is all it costs when
+     * nothing changed; a change redesigns the filter and re-selects the fused kernels.
+     */
+    void setParameters(const DspParameters& parameters);
+    const DspParameters& parameters() const { return m_parameters; }
+
+    /// Processes @p frames interleaved frames; @p in and @p out may be the same buffer. Real-time safe.
+    void process(const float* in, float* out, int frames);
+
+    /// True if any stage would change the signal.
+    bool isActive() const;
+
+    /// Frames the active stages keep ringing after the input stops.
+    int tailFrames() const;
+
+    /// Gain the noise gate settles at below its threshold; 1 while the gate is off.
+    float gateFloor() const { return m_gated ? m_chainStates[0].gateFloor : 1.0f; }
+
+    /// Delay of the pitch stage in frames (0 when it is bypassed).
+    int latencyFrames() const;
+
+    /**
+     * @brief Tells the chain that the caller skipped process() for a block
+     * (silence or pass-through), so the pitch stage restarts from clean buffers.
+     */
+    void bypass() { m_pitchEngaged = false; }
+
+    /// The pitch engine of the last block if it was pitch shifting, else null.
+    const PitchEngine* activePitchEngine() const { return m_pitchEngaged ? m_pitchEngine : nullptr; }
+
+    /// Events of every pitch engine this chain has run, as of its last block. Any thread.
+    PitchEngineEvents pitchEngineEvents() const;
+
+    // Stage setup (setup thread)
+    bool setEqBand(int index, const EqBand& band) { return m_parametricEq.setBand(index, band); }
+    bool setImpulseResponse(const std::vector<float>& interleaved, int irChannels, int irSampleRate)
+    {
+        return m_convolver.setImpulseResponse(interleaved, irChannels, irSampleRate);
+    }
+    void clearImpulseResponse() { m_convolver.clearImpulseResponse(); }
+    void setConvolutionMix(float wet) { m_convolver.setMix(wet); }
+
+    void setHarmonyVoice(int index, float semitones, float gain, float pan)
+    {
+        m_harmonizer.setVoice(index, semitones, gain, pan);
+    }
+    void clearHarmonyVoices() { m_harmonizer.clearVoices(); }
+    void setHarmonyDryGain(float gain) { m_harmonizer.setDryGain(gain); }
+
+    /// Builds the engine here and hands it to the processing thread before its next block.
+    void setPitchEngine(PitchEngineType type);
+
+private:
+    void configure();
+    void selectKernels(bool pitched);
+    void applyPitchShifting(float* samples, int frames);
+    void collectRetiredPitchEngines();
+    void retirePitchEvents(const PitchEngine* engine);
+    void publishPitchEvents();
+
+    int m_channels;
+    int m_sampleRate;
+    DspParameters m_parameters;
+    bool m_configured;
+
+    // Fused gate/distortion/filter stages, one gate envelope and filter history per channel
+    ChainState m_chainStates[kMaxChannels];
+    bool m_gated;
+    bool m_distorted;
+    bool m_filtered;
+    bool m_kernelsPitched;              ///< Pitch stage the current kernels were selected around
+    ChainKernelFn m_preChainKernel;     ///< Stages before the pitch stage
+    ChainKernelFn m_postChainKernel;    ///< Stages after it
+
+    ParametricEq m_parametricEq;
+    Convolver m_convolver;              ///< IR convolution (cabinet/room, linear-phase EQ)
+    Harmonizer m_harmonizer;            ///< Parallel pitched voices, replaces the pitch engine while active
+
+    // Pitch shifting: the active engine belongs to the processing thread; new
+    // engines arrive through an atomic mailbox and old ones go back through
+    // a lock-free ring to be freed on the setup side
+    PitchEngine* m_pitchEngine;
+    std::atomic<PitchEngine*> m_pendingPitchEngine;
+    SpscRing<PitchEngine*, 8> m_retiredPitchEngines;
+    bool m_pitchEngaged;                ///< Engine was used for the previous block
+
+    // Pitch engine events: totals of the engines already swapped out (processing
+    // thread), plus those of the active one as published after every block
+    PitchEngineEvents m_retiredPitchEvents;
+    std::atomic<qint64> m_pitchInvalidBlocks;
+    std::atomic<qint64> m_pitchBacklogResets;
+    std::atomic<qint64> m_pitchFailedBlocks;
+
+    // Engine setup, guarded by m_pitchEngineMutex (never taken by process())
+    QMutex m_pitchEngineMutex;
+    PitchEngineType m_pitchEngineType;
+    int m_pitchEngineChannels;          ///< 0 until setFormat()
+    int m_pitchEngineSampleRate;
+};
+
+#endif // DSPCHAIN_H
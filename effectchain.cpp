@@ -0,0 +1,34 @@
+// effectchain.cpp
+
+#include "effectchain.h"
+
+ChainKernelFn selectChainKernel(bool gate, bool distortion, bool filter)
+{
+    // Indexed by gate * 4 + distortion * 2 + filter, stages in chain order
+    static const ChainKernelFn kernels[8] = {
+        nullptr,
+        &ChainKernel<BiquadStage>::process,
+        &ChainKernel<DistortionStage>::process,
+        &ChainKernel<DistortionStage, BiquadStage>::process,
+        &ChainKernel<GateStage>::process,
+        &ChainKernel<GateStage, BiquadStage>::process,
+        &ChainKernel<GateStage, DistortionStage>::process,
+        &ChainKernel<GateStage, DistortionStage, BiquadStage>::process,
+    };
+    return kernels[(gate ? 4 : 0) + (distortion ? 2 : 0) + (filter ? 1 : 0)];
+}
+
+BatchKernelFn selectBatchKernel(bool gate, bool distortion, bool filter)
+{
+    static const BatchKernelFn kernels[8] = {
+        nullptr,
+        &BatchKernel<BiquadLanes>::process,
+        &BatchKernel<DistortionLanes>::process,
+        &BatchKernel<DistortionLanes, BiquadLanes>::process,
+        &BatchKernel<GateLanes>::process,
+        &BatchKernel<GateLanes, BiquadLanes>::process,
+        &BatchKernel<GateLanes, DistortionLanes>::process,
+        &BatchKernel<GateLanes, DistortionLanes, BiquadLanes>::process,
+    };
+    return kernels[(gate ? 4 : 0) + (distortion ? 2 : 0) + (filter ? 1 : 0)];
+}
@@ -0,0 +1,260 @@
+// effectchain.h
+#ifndef EFFECTCHAIN_H
+#define EFFECTCHAIN_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <tuple>
+
+// ----------------------------------------------------------
+// Fused per-sample stages
+// ----------------------------------------------------------
+
+/**
+ * @brief Parameters and state of the per-sample stages (noise gate,
+ * distortion, band filter). Owned by the audio thread; the kernels load it
+ * into registers at the start of a block and store it back at the end.
+ * Disabled stages may hold neutral settings (threshold 0, drive 0, identity
+ * filter), which the lane kernels below rely on.
+ */
+struct ChainState
+{
+    // Noise gate
+    float gateThreshold = 0.0f;     ///< Linear level below which the gate closes
+    float gateFloor     = 1.0f;     ///< Gain the closed gate settles at
+    float gateAttack    = 0.0f;     ///< Gain step per sample while opening
+    float gateRelease   = 0.0f;     ///< Gain step per sample while closing
+    float gateGain      = 1.0f;
+
+    // Distortion (tanh soft clipper)
+    float drive = 1.0f;
+
+    // Band filter: normalised Biquad coefficients and output history
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+    float z1 = 0.0f, z2 = 0.0f;
+};
+
+/**
+ * @brief Stage policies for ChainKernel. Each copies what it needs from
+ * ChainState on construction, processes one sample per tick() and writes
+ * its state back in store().
+ */
+struct GateStage
+{
+    explicit GateStage(const ChainState& s)
+        : threshold(s.gateThreshold), floor(s.gateFloor)
+        , attack(s.gateAttack), release(s.gateRelease), gain(s.gateGain) {}
+
+    float tick(float x)
+    {
+        gain = std::fabs(x) < threshold ? std::max(gain - release, floor)
+                                        : std::min(gain + attack, 1.0f);
+        return x * gain;
+    }
+    void store(ChainState& s) const { s.gateGain = gain; }
+
+    float threshold, floor, attack, release, gain;
+};
+
+struct DistortionStage
+{
+    explicit DistortionStage(const ChainState& s) : drive(s.drive) {}
+
+    float tick(float x) const { return std::tanh(x * drive); }
+    void store(ChainState&) const {}
+
+    float drive;
+};
+
+/// Same recurrence and evaluation order as Biquad::process().
+struct BiquadStage
+{
+    explicit BiquadStage(const ChainState& s)
+        : b0(s.b0), b1(s.b1), b2(s.b2), a1(s.a1), a2(s.a2), z1(s.z1), z2(s.z2) {}
+
+    float tick(float x)
+    {
+        const float y = b0 * x + b1 * z1 + b2 * z2 - a1 * z1 - a2 * z2;
+        z2 = z1;
+        z1 = y;
+        return y;
+    }
+    void store(ChainState& s) const { s.z1 = z1; s.z2 = z2; }
+
+    float b0, b1, b2, a1, a2, z1, z2;
+};
+
+/**
+ * @brief One loop over the block running every stage on each sample in turn.
+ *
+ * Each combination of stages is its own instantiation, so the loop body has
+ * no configuration branches and the compiler keeps all stage state in
+ * registers. The audio thread picks the instantiation once per configuration
+ * change through selectChainKernel(). One call runs one channel: @p count
+ * samples, @p stride apart (the channel count of an interleaved buffer).
+ */
+template <typename... Stages>
+struct ChainKernel
+{
+    static void process(ChainState& state, float* samples, int count, int stride)
+    {
+        std::tuple<Stages...> stages{Stages(state)...};
+        std::apply([&](Stages&... stage) {
+            for (int i = 0; i < count; ++i) {
+                float x = samples[static_cast<std::ptrdiff_t>(i) * stride];
+                ((x = stage.tick(x)), ...);
+                samples[static_cast<std::ptrdiff_t>(i) * stride] = x;
+            }
+            (stage.store(state), ...);
+        }, stages);
+    }
+};
+
+using ChainKernelFn = void (*)(ChainState& state, float* samples, int count, int stride);
+
+/// Returns the fused kernel for the given stages, or nullptr if none is enabled.
+ChainKernelFn selectChainKernel(bool gate, bool distortion, bool filter);
+
+// ----------------------------------------------------------
+// Lane-batched stages (many mono streams at once)
+// ----------------------------------------------------------
+
+/// Streams processed side by side by a BatchKernel: one AVX register, two SSE registers.
+constexpr int kChainLanes = 8;
+
+/**
+ * @brief tanh through its [7/6] Pade approximant, within 1e-4 of std::tanh.
+ * Unlike std::tanh it vectorises, which the lane kernels need.
+ */
+inline float fastTanh(float x)
+{
+    x = std::clamp(x, -5.0f, 5.0f);
+    const float x2 = x * x;
+    const float num = x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2)));
+    const float den = 135135.0f + x2 * (62370.0f + x2 * (3150.0f + 28.0f * x2));
+    return std::clamp(num / den, -1.0f, 1.0f);
+}
+
+/**
+ * @brief Lane versions of the stage policies. Each lane belongs to another
+ * stream with its own ChainState; tick() advances all lanes by one sample,
+ * so the per-lane loops compile to straight SIMD code. A lane whose stream
+ * has a stage disabled runs it with neutral settings instead of branching.
+ */
+struct GateLanes
+{
+    explicit GateLanes(ChainState* const* s)
+    {
+        for (int l = 0; l < kChainLanes; ++l) {
+            threshold[l] = s[l]->gateThreshold;
+            floor[l]     = s[l]->gateFloor;
+            attack[l]    = s[l]->gateAttack;
+            release[l]   = s[l]->gateRelease;
+            gain[l]      = s[l]->gateGain;
+        }
+    }
+
+    void tick(float* x)
+    {
+        for (int l = 0; l < kChainLanes; ++l) {
+            const float closing = std::max(gain[l] - release[l], floor[l]);
+            const float opening = std::min(gain[l] + attack[l], 1.0f);
+            gain[l] = std::fabs(x[l]) < threshold[l] ? closing : opening;
+            x[l] *= gain[l];
+        }
+    }
+    void store(ChainState* const* s) const
+    {
+        for (int l = 0; l < kChainLanes; ++l)
+            s[l]->gateGain = gain[l];
+    }
+
+    alignas(32) float threshold[kChainLanes];
+    alignas(32) float floor[kChainLanes];
+    alignas(32) float attack[kChainLanes];
+    alignas(32) float release[kChainLanes];
+    alignas(32) float gain[kChainLanes];
+};
+
+/// Drive 0 passes the lane through.
+struct DistortionLanes
+{
+    explicit DistortionLanes(ChainState* const* s)
+    {
+        for (int l = 0; l < kChainLanes; ++l)
+            drive[l] = s[l]->drive;
+    }
+
+    void tick(float* x) const
+    {
+        for (int l = 0; l < kChainLanes; ++l) {
+            const float shaped = fastTanh(x[l] * drive[l]);
+            x[l] = drive[l] > 0.0f ? shaped : x[l];
+        }
+    }
+    void store(ChainState* const*) const {}
+
+    alignas(32) float drive[kChainLanes];
+};
+
+struct BiquadLanes
+{
+    explicit BiquadLanes(ChainState* const* s)
+    {
+        for (int l = 0; l < kChainLanes; ++l) {
+            b0[l] = s[l]->b0; b1[l] = s[l]->b1; b2[l] = s[l]->b2;
+            a1[l] = s[l]->a1; a2[l] = s[l]->a2;
+            z1[l] = s[l]->z1; z2[l] = s[l]->z2;
+        }
+    }
+
+    void tick(float* x)
+    {
+        for (int l = 0; l < kChainLanes; ++l) {
+            const float y = b0[l] * x[l] + b1[l] * z1[l] + b2[l] * z2[l] - a1[l] * z1[l] - a2[l] * z2[l];
+            z2[l] = z1[l];
+            z1[l] = y;
+            x[l] = y;
+        }
+    }
+    void store(ChainState* const* s) const
+    {
+        for (int l = 0; l < kChainLanes; ++l) {
+            s[l]->z1 = z1[l];
+            s[l]->z2 = z2[l];
+        }
+    }
+
+    alignas(32) float b0[kChainLanes], b1[kChainLanes], b2[kChainLanes];
+    alignas(32) float a1[kChainLanes], a2[kChainLanes];
+    alignas(32) float z1[kChainLanes], z2[kChainLanes];
+};
+
+/**
+ * @brief ChainKernel over kChainLanes streams. @p lanes holds the block
+ * lane-interleaved (frame-major: frame i of lane l at i * kChainLanes + l);
+ * @p states has one entry per lane, unused lanes point at a neutral state.
+ */
+template <typename... Stages>
+struct BatchKernel
+{
+    static void process(ChainState* const* states, float* lanes, int frames)
+    {
+        std::tuple<Stages...> stages{Stages(states)...};
+        std::apply([&](Stages&... stage) {
+            for (int i = 0; i < frames; ++i) {
+                float* x = lanes + i * kChainLanes;
+                (stage.tick(x), ...);
+            }
+            (stage.store(states), ...);
+        }, stages);
+    }
+};
+
+using BatchKernelFn = void (*)(ChainState* const* states, float* lanes, int frames);
+
+/// Returns the lane kernel for the given stages, or nullptr if none is enabled in any lane.
+BatchKernelFn selectBatchKernel(bool gate, bool distortion, bool filter);
+
+#endif // EFFECTCHAIN_H
@@ -0,0 +1,183 @@
+#include "fft.h"
+
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FFT_SSE 1
+#endif
+
+namespace {
+const double kPi = 3.14159265358979323846;
+}
+
+// ----------------------------------------------------------
+// 1. Complex FFT
+// ----------------------------------------------------------
+
+Fft::Fft(int size)
+    : m_size(size)
+{
+    assert(size >= 2 && (size & (size - 1)) == 0);
+
+    int bits = 0;
+    while ((1 << bits) < size) ++bits;
+
+    for (int i = 0; i < size; ++i) {
+        int j = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) j |= 1 << (bits - 1 - b);
+        }
+        if (i < j) {
+            m_swapPairs.push_back(i);
+            m_swapPairs.push_back(j);
+        }
+    }
+
+    // Stage with half-span h uses twiddles e^{-i*pi*j/h}, j < h,
+    // stored contiguously at offset h - 1 so SSE can load four at once
+    m_twRe.resize(size);
+    m_twIm.resize(size);
+    for (int half = 1; half < size; half <<= 1) {
+        for (int j = 0; j < half; ++j) {
+            double angle = -kPi * j / half;
+            m_twRe[half - 1 + j] = static_cast<float>(std::cos(angle));
+            m_twIm[half - 1 + j] = static_cast<float>(std::sin(angle));
+        }
+    }
+}
+
+void Fft::forward(float* re, float* im) const
+{
+    for (size_t p = 0; p < m_swapPairs.size(); p += 2) {
+        const int i = m_swapPairs[p];
+        const int j = m_swapPairs[p + 1];
+        std::swap(re[i], re[j]);
+        std::swap(im[i], im[j]);
+    }
+    butterflies(re, im);
+}
+
+void Fft::butterflies(float* re, float* im) const
+{
+    for (int half = 1; half < m_size; half <<= 1) {
+        const float* wr = &m_twRe[half - 1];
+        const float* wi = &m_twIm[half - 1];
+
+        for (int start = 0; start < m_size; start += 2 * half) {
+            float* ar = re + start;
+            float* ai = im + start;
+            float* br = ar + half;
+            float* bi = ai + half;
+
+            int j = 0;
+#ifdef FFT_SSE
+            for (; j + 4 <= half; j += 4) {
+                __m128 vwr = _mm_loadu_ps(wr + j);
+                __m128 vwi = _mm_loadu_ps(wi + j);
+                __m128 vbr = _mm_loadu_ps(br + j);
+                __m128 vbi = _mm_loadu_ps(bi + j);
+                __m128 tr  = _mm_sub_ps(_mm_mul_ps(vwr, vbr), _mm_mul_ps(vwi, vbi));
+                __m128 ti  = _mm_add_ps(_mm_mul_ps(vwr, vbi), _mm_mul_ps(vwi, vbr));
+                __m128 var = _mm_loadu_ps(ar + j);
+                __m128 vai = _mm_loadu_ps(ai + j);
+                _mm_storeu_ps(br + j, _mm_sub_ps(var, tr));
+                _mm_storeu_ps(bi + j, _mm_sub_ps(vai, ti));
+                _mm_storeu_ps(ar + j, _mm_add_ps(var, tr));
+                _mm_storeu_ps(ai + j, _mm_add_ps(vai, ti));
+            }
+#endif
+            for (; j < half; ++j) {
+                float tr = wr[j] * br[j] - wi[j] * bi[j];
+                float ti = wr[j] * bi[j] + wi[j] * br[j];
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------
+// 2. Real FFT (N-point real via N/2-point complex)
+// ----------------------------------------------------------
+
+RealFft::RealFft(int size)
+    : m_size(size)
+    , m_half(size / 2)
+    , m_cosTable(size / 2 + 1)
+    , m_sinTable(size / 2 + 1)
+    , m_zRe(size / 2)
+    , m_zIm(size / 2)
+{
+    assert(size >= 4);
+    for (int k = 0; k <= size / 2; ++k) {
+        double angle = 2.0 * kPi * k / size;
+        m_cosTable[k] = static_cast<float>(std::cos(angle));
+        m_sinTable[k] = static_cast<float>(std::sin(angle));
+    }
+}
+
+void RealFft::forward(const float* in, float* re, float* im)
+{
+    const int half = m_size / 2;
+
+    // Pack even samples as real part, odd samples as imaginary part
+    for (int n = 0; n < half; ++n) {
+        m_zRe[n] = in[2 * n];
+        m_zIm[n] = in[2 * n + 1];
+    }
+    m_half.forward(m_zRe.data(), m_zIm.data());
+
+    // Split into the spectra of the even and odd samples and recombine:
+    // X[k] = E[k] + W^k O[k], W = e^{-2 pi i / N}
+    for (int k = 0; k <= half; ++k) {
+        const int a = (k == half) ? 0 : k;
+        const int b = (k == 0) ? 0 : half - k;
+        const float zr = m_zRe[a], zi = m_zIm[a];
+        const float cr = m_zRe[b], ci = -m_zIm[b];   // conj(Z[M-k])
+
+        const float er = 0.5f * (zr + cr);
+        const float ei = 0.5f * (zi + ci);
+        const float orr = 0.5f * (zi - ci);           // (Z - Zc) / 2i
+        const float oi  = -0.5f * (zr - cr);
+
+        const float wr = m_cosTable[k], wi = -m_sinTable[k];
+        re[k] = er + wr * orr - wi * oi;
+        im[k] = ei + wr * oi + wi * orr;
+    }
+}
+
+void RealFft::inverse(const float* re, const float* im, float* out)
+{
+    const int half = m_size / 2;
+
+    // Z[k] = E[k] + i O[k] with E = (X[k] + conj(X[M-k])) / 2,
+    // O = (X[k] - conj(X[M-k])) W^{-k} / 2
+    for (int k = 0; k < half; ++k) {
+        const float xr = re[k], xi = im[k];
+        const float cr = re[half - k], ci = -im[half - k];
+
+        const float er = 0.5f * (xr + cr);
+        const float ei = 0.5f * (xi + ci);
+        const float dr = 0.5f * (xr - cr);
+        const float di = 0.5f * (xi - ci);
+
+        const float wr = m_cosTable[k], wi = m_sinTable[k];   // W^{-k}
+        const float orr = dr * wr - di * wi;
+        const float oi  = dr * wi + di * wr;
+
+        m_zRe[k] = er - oi;
+        m_zIm[k] = ei + orr;
+    }
+    m_half.inverse(m_zRe.data(), m_zIm.data());
+
+    const float scale = 1.0f / half;
+    for (int n = 0; n < half; ++n) {
+        out[2 * n]     = m_zRe[n] * scale;
+        out[2 * n + 1] = m_zIm[n] * scale;
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * @brief In-place radix-2 complex FFT on split (separate real/imaginary)
+ * arrays, which lets the butterflies run four at a time with SSE.
+ *
+ * Twiddles and the bit-reversal table are computed once in the
+ * constructor; forward()/inverse() never allocate and are safe to call
+ * from the audio thread.
+ */
+class Fft
+{
+public:
+    /// @param size Transform length, must be a power of two >= 2.
+    explicit Fft(int size);
+
+    int size() const { return m_size; }
+
+    /// Forward transform (e^{-i...}), unscaled.
+    void forward(float* re, float* im) const;
+
+    /// Inverse transform (e^{+i...}), unscaled: inverse(forward(x)) == size() * x.
+    void inverse(float* re, float* im) const { forward(im, re); }
+
+private:
+    void butterflies(float* re, float* im) const;
+
+    int m_size;
+    std::vector<int> m_swapPairs;   ///< Flattened (i, j) pairs for bit reversal
+    std::vector<float> m_twRe;      ///< Per-stage twiddles, stage s at offset (1 << s) - 1
+    std::vector<float> m_twIm;
+};
+
+/**
+ * @brief Real-input FFT of length N computed with one complex FFT of N/2.
+ *
+ * Spectra are N/2 + 1 bins in split format. inverse() is scaled so that
+ * inverse(forward(x)) == x. Holds scratch buffers, so one instance must
+ * not be shared between threads.
+ */
+class RealFft
+{
+public:
+    /// @param size Transform length, must be a power of two >= 4.
+    explicit RealFft(int size);
+
+    int size() const { return m_size; }
+    int bins() const { return m_size / 2 + 1; }
+
+    void forward(const float* in, float* re, float* im);
+    void inverse(const float* re, const float* im, float* out);
+
+private:
+    int m_size;
+    Fft m_half;
+    std::vector<float> m_cosTable;  ///< cos(2*pi*k/N), k = 0..N/2
+    std::vector<float> m_sinTable;
+    std::vector<float> m_zRe;
+    std::vector<float> m_zIm;
+};
@@ -0,0 +1,184 @@
+// filesource.cpp
+
+#include "filesource.h"
+
+#include <QLoggingCategory>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+
+namespace {
+// Read-ahead: about this much audio, but never less than a few pages
+const int kPrefetchMs = 1000;
+const qint64 kMinPrefetchBytes = 256 * 1024;
+
+// Frames converted per pass for formats that are not 16-bit PCM
+const int kScratchFrames = 1024;
+}
+
+// ----------------------------------------------------------
+// 1. Opening and closing
+// ----------------------------------------------------------
+
+FileSource::FileSource()
+    : m_map(nullptr)
+    , m_mapSize(0)
+    , m_length(0)
+    , m_prefetchFrames(0)
+    , m_prefetchedUntil(0)
+    , m_position(0)
+    , m_seekRequest(-1)
+    , m_looping(true)
+{
+}
+
+FileSource::~FileSource()
+{
+    close();
+}
+
+bool FileSource::open(const QString& path, QString* error)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = m_file.errorString();
+        return false;
+    }
+    m_mapSize = m_file.size();
+    m_map = m_mapSize > 0 ? m_file.map(0, m_mapSize) : nullptr;
+    if (!m_map) {
+        if (error)
+            *error = m_mapSize > 0 ? m_file.errorString() : QStringLiteral("File is empty");
+        m_file.close();
+        return false;
+    }
+
+    m_format = WavFormat();
+    if (!parseWavHeader(m_map, m_mapSize, m_format, error)) {
+        close();
+        return false;
+    }
+    m_length = m_format.frames();
+
+#if defined(__linux__)
+    // Aggressive read-ahead on the data; pages behind the play position
+    // may be dropped early
+    madvise(m_map, static_cast<size_t>(m_mapSize), MADV_SEQUENTIAL);
+#endif
+    const qint64 bytesPerSecond = static_cast<qint64>(m_format.sampleRate) * m_format.bytesPerFrame();
+    m_prefetchFrames = std::max(bytesPerSecond * kPrefetchMs / 1000, kMinPrefetchBytes)
+                     / m_format.bytesPerFrame();
+
+    m_scratch.clear();
+    if (m_format.isFloat || m_format.bitsPerSample != 16 || Q_BYTE_ORDER != Q_LITTLE_ENDIAN)
+        m_scratch.assign(static_cast<size_t>(kScratchFrames) * m_format.channels, 0.0f);
+
+    m_position.store(0, std::memory_order_relaxed);
+    m_seekRequest.store(-1, std::memory_order_relaxed);
+    m_prefetchedUntil = 0;
+    prefetch(0);
+
+    qCDebug(audioCategory) << "Input file" << path << m_format.channels << "ch,"
+                           << m_format.sampleRate << "Hz," << m_format.bitsPerSample << "bit,"
+                           << m_length << "frames (mapped)";
+    return true;
+}
+
+void FileSource::close()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    if (m_file.isOpen())
+        m_file.close();
+    m_mapSize = 0;
+    m_length = 0;
+}
+
+// ----------------------------------------------------------
+// 2. Reading (audio thread)
+// ----------------------------------------------------------
+
+void FileSource::prefetch(qint64 frame)
+{
+#if defined(__linux__)
+    // Ask for the next window once the position is half-way through the
+    // previous one; madvise only queues the I/O and returns
+    if (frame + m_prefetchFrames / 2 < m_prefetchedUntil)
+        return;
+    static const qint64 pageSize = sysconf(_SC_PAGESIZE);
+    const qint64 begin = std::max(frame, m_prefetchedUntil);
+    const qint64 end = std::min(frame + m_prefetchFrames, m_length);
+    if (end > begin) {
+        qint64 offset = m_format.dataOffset + begin * m_format.bytesPerFrame();
+        const qint64 stop = m_format.dataOffset + end * m_format.bytesPerFrame();
+        offset -= offset % pageSize;
+        madvise(m_map + offset, static_cast<size_t>(stop - offset), MADV_WILLNEED);
+    }
+    m_prefetchedUntil = end;
+#else
+    Q_UNUSED(frame);
+#endif
+}
+
+int FileSource::read(qint16* dst, int frames)
+{
+    if (!m_map || !dst || frames <= 0 || m_length <= 0)
+        return 0;
+
+    qint64 position = m_position.load(std::memory_order_relaxed);
+    const qint64 seekTo = m_seekRequest.exchange(-1, std::memory_order_relaxed);
+    if (seekTo >= 0) {
+        position = std::min(seekTo, m_length);
+        m_prefetchedUntil = position;
+    }
+
+    const int channels = m_format.channels;
+    const int bytesPerFrame = m_format.bytesPerFrame();
+    const bool looping = m_looping.load(std::memory_order_relaxed);
+    int produced = 0;
+    while (produced < frames) {
+        if (position >= m_length) {
+            if (!looping)
+                break;
+            position = 0;
+            m_prefetchedUntil = 0;
+        }
+        prefetch(position);
+
+        const int count = static_cast<int>(std::min<qint64>(frames - produced, m_length - position));
+        const uchar* src = m_map + m_format.dataOffset + position * bytesPerFrame;
+        qint16* out = dst + static_cast<size_t>(produced) * channels;
+
+        if (m_scratch.empty()) {
+            // 16-bit PCM on a little-endian host: the file is the block
+            std::memcpy(out, src, static_cast<size_t>(count) * bytesPerFrame);
+            produced += count;
+            position += count;
+            continue;
+        }
+
+        const int pass = std::min(count, kScratchFrames);
+        convertWavSamples(src, m_format, pass, m_scratch.data());
+        for (int i = 0; i < pass * channels; ++i) {
+            const float v = std::round(m_scratch[i] * 32768.0f);
+            out[i] = static_cast<qint16>(std::clamp(v, -32768.0f, 32767.0f));
+        }
+        produced += pass;
+        position += pass;
+    }
+
+    m_position.store(position, std::memory_order_relaxed);
+    return produced;
+}
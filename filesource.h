@@ -0,0 +1,82 @@
+// filesource.h
+#ifndef FILESOURCE_H
+#define FILESOURCE_H
+
+#include "wavfile.h"
+
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+
+// ----------------------------------------------------------
+// FileSource Class Declaration
+// ----------------------------------------------------------
+
+/**
+ * @brief Memory-mapped WAV/RF64 file as an input for the audio loop.
+ *
+ * open() maps the whole file and parses the header in place; read() then
+ * converts straight out of the mapping (a plain copy for 16-bit PCM), so
+ * there is no decode thread, no read() syscall per block and no copy of
+ * the file in memory besides the page cache. The kernel is told that the
+ * data is read sequentially, and read() asks for the next second or so
+ * ahead of the play position (madvise WILLNEED) so the pages are resident
+ * before the audio thread touches them.
+ *
+ * open() and close() are not real-time safe and must not overlap read().
+ * seek() and setLooping() may be called from any thread; they take effect
+ * with the next read(), which belongs to the audio thread.
+ */
+class FileSource
+{
+public:
+    FileSource();
+    ~FileSource();
+
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+
+    bool open(const QString& path, QString* error = nullptr);
+    void close();
+    bool isOpen() const { return m_map != nullptr; }
+
+    const WavFormat& format() const { return m_format; }
+    qint64 lengthFrames() const { return m_length; }
+
+    /// Frame that the next read() starts at.
+    qint64 positionFrames() const { return m_position.load(std::memory_order_relaxed); }
+
+    /// Restart at the beginning instead of stopping at the end.
+    void setLooping(bool looping) { m_looping.store(looping, std::memory_order_relaxed); }
+    bool isLooping() const { return m_looping.load(std::memory_order_relaxed); }
+
+    /// Any thread. Clamped to the file.
+    void seek(qint64 frame) { m_seekRequest.store(std::max<qint64>(frame, 0), std::memory_order_relaxed); }
+
+    /**
+     * @brief Audio thread. Converts up to @p frames interleaved frames to 16-bit.
+     * @return Frames written to @p dst; fewer than requested only at the end
+     *         of a file that does not loop.
+     */
+    int read(qint16* dst, int frames);
+
+private:
+    void prefetch(qint64 frame);
+
+    QFile m_file;
+    uchar* m_map;
+    qint64 m_mapSize;
+    WavFormat m_format;
+    qint64 m_length;                        ///< Frames in the data chunk
+    qint64 m_prefetchFrames;                ///< Read-ahead window
+    qint64 m_prefetchedUntil;               ///< End of the last read-ahead request (frame)
+    std::vector<float> m_scratch;           ///< Conversion buffer for non-16-bit files
+
+    std::atomic<qint64> m_position;
+    std::atomic<qint64> m_seekRequest;      ///< -1 = none
+    std::atomic<bool> m_looping;
+};
+
+#endif // FILESOURCE_H
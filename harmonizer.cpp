@@ -0,0 +1,301 @@
+// harmonizer.cpp
+
+#include "harmonizer.h"
+#include "realtime.h"
+#include "rtsanitizer.h"
+
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QSemaphore>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HARMONIZER_SSE 1
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+
+namespace {
+// Busy-wait iterations before the joining audio thread starts yielding its core
+const int kSpinsBeforeYield = 4096;
+
+inline void cpuRelax()
+{
+#ifdef HARMONIZER_SSE
+    _mm_pause();
+#endif
+}
+}
+
+// ----------------------------------------------------------
+// 1. Worker threads
+// ----------------------------------------------------------
+
+/**
+ * @brief Pool thread that runs one executor's share of the voices per block.
+ * Sleeps on a semaphore between blocks.
+ */
+class HarmonizerWorker : public QThread
+{
+public:
+    HarmonizerWorker(Harmonizer* owner, int executor)
+        : m_owner(owner)
+        , m_executor(executor)
+        , m_running(true)
+    {
+    }
+
+    void wake() { m_start.release(); }
+
+    void stop()
+    {
+        m_running = false;
+        m_start.release();
+    }
+
+protected:
+    void run() override
+    {
+        // The audio thread spins on these workers; they need its priority
+        Realtime::promoteCurrentThread("Harmonizer");
+        while (true) {
+            m_start.acquire();
+            if (!m_running)
+                break;
+            RtSanitizer::Section rtSection;
+            m_owner->runVoices(m_executor);
+            m_owner->m_pending.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+private:
+    Harmonizer* m_owner;
+    int m_executor;
+    std::atomic<bool> m_running;
+    QSemaphore m_start;
+};
+
+// ----------------------------------------------------------
+// 2. Setup
+// ----------------------------------------------------------
+
+Harmonizer::Harmonizer()
+    : m_channels(1)
+    , m_sampleRate(48000)
+    , m_dryGain(1.0f)
+    , m_frames(0)
+    , m_workersStarted(false)
+    , m_workerCount(0)
+    , m_executors(1)
+    , m_pending(0)
+{
+}
+
+Harmonizer::~Harmonizer()
+{
+    stopWorkers();
+}
+
+void Harmonizer::startWorkers()
+{
+    QMutexLocker locker(&m_workerMutex);
+    if (m_workersStarted)
+        return;
+    m_workersStarted = true;
+
+    // One executor per voice at most, and leave a core for everything else.
+    // The workers share the audio thread's --rt-cpus set, so count only
+    // that set: spinning on a worker queued behind us on our own core
+    // would stall the block, and no workers means the voices run inline.
+    const std::vector<int>& pinned = Realtime::config().cpus;
+    const int cores = pinned.empty() ? QThread::idealThreadCount() : static_cast<int>(pinned.size());
+    const int workers = std::clamp(cores - 1, 0, kMaxVoices - 1);
+    for (int i = 0; i < workers; ++i) {
+        m_workers.emplace_back(new HarmonizerWorker(this, i + 1));
+        m_workers.back()->start(QThread::TimeCriticalPriority);
+    }
+    // process() only looks at the pool once this is published
+    m_workerCount.store(workers, std::memory_order_release);
+    qCDebug(audioCategory) << "Harmonizer:" << workers << "worker threads";
+}
+
+void Harmonizer::stopWorkers()
+{
+    QMutexLocker locker(&m_workerMutex);
+    m_workerCount.store(0, std::memory_order_relaxed);
+    for (auto& worker : m_workers) {
+        worker->stop();
+        worker->wait();
+    }
+    m_workers.clear();
+    m_workersStarted = false;
+}
+
+void Harmonizer::setFormat(int channels, int sampleRate)
+{
+    stopWorkers();
+
+    m_channels = std::clamp(channels, 1, kMaxChannels);
+    m_sampleRate = sampleRate;
+
+    for (Voice& voice : m_voices) {
+        voice.engine.setFormat(1, sampleRate);
+        voice.output.assign(AudioBlock::kMaxFrames, 0.0f);
+        voice.enabled = false;
+    }
+
+    // Chains that never switch a voice on never start the pool
+    if (isActive())
+        startWorkers();
+}
+
+void Harmonizer::setVoice(int index, float semitones, float gain, float pan)
+{
+    if (index < 0 || index >= kMaxVoices)
+        return;
+    Voice& voice = m_voices[index];
+    voice.semitones.store(semitones, std::memory_order_relaxed);
+    voice.pan.store(std::clamp(pan, -1.0f, 1.0f), std::memory_order_relaxed);
+    voice.gain.store(std::max(gain, 0.0f), std::memory_order_relaxed);
+    if (gain > 0.0f)
+        startWorkers();
+}
+
+void Harmonizer::clearVoices()
+{
+    for (int i = 0; i < kMaxVoices; ++i)
+        setVoice(i, 0.0f, 0.0f, 0.0f);
+}
+
+bool Harmonizer::isActive() const
+{
+    for (const Voice& voice : m_voices) {
+        if (voice.gain.load(std::memory_order_relaxed) > 0.0f)
+            return true;
+    }
+    return false;
+}
+
+// ----------------------------------------------------------
+// 3. Voice processing (audio thread and workers)
+// ----------------------------------------------------------
+
+void Harmonizer::runVoices(int executor)
+{
+    const int executors = m_executors;
+    for (int v = executor; v < kMaxVoices; v += executors)
+        runVoice(m_voices[v]);
+}
+
+void Harmonizer::runVoice(Voice& voice)
+{
+    if (!voice.active) {
+        voice.enabled = false;
+        return;
+    }
+
+    if (!voice.enabled) {
+        // Switched on again: drop whatever was left from the last time
+        voice.engine.reset();
+        voice.enabled = true;
+    }
+    voice.engine.setPitchSemiTones(voice.targetSemitones);
+
+    std::copy(m_input.samples, m_input.samples + m_frames, voice.output.begin());
+    voice.engine.process(voice.output.data(), m_frames);
+}
+
+// ----------------------------------------------------------
+// 4. Fork / join and mixing
+// ----------------------------------------------------------
+
+void Harmonizer::process(float* samples, int frames)
+{
+    if (!samples || frames <= 0)
+        return;
+
+    const int channels = m_channels;
+    const int executors = m_workerCount.load(std::memory_order_acquire) + 1;
+    m_executors = executors;
+
+    while (frames > 0) {
+        const int used = m_input.assign(samples, frames, channels);
+        m_frames = used;
+
+        // Snapshot the voice parameters for this block
+        float voiceGains[kMaxVoices][3];    // left, right, other channels
+        bool executorBusy[kMaxVoices] = {};
+        for (int v = 0; v < kMaxVoices; ++v) {
+            Voice& voice = m_voices[v];
+            const float gain = voice.gain.load(std::memory_order_relaxed);
+            const float pan = voice.pan.load(std::memory_order_relaxed);
+            voice.active = gain > 0.0f;
+            voice.targetSemitones = voice.semitones.load(std::memory_order_relaxed);
+            // Balance law: the centre keeps unity gain on both sides
+            voiceGains[v][0] = gain * std::min(1.0f, 1.0f - pan);
+            voiceGains[v][1] = gain * std::min(1.0f, 1.0f + pan);
+            voiceGains[v][2] = gain;
+            // A voice that was just switched off passes through its executor
+            // once more to release its state ('enabled' is stable after the join)
+            if (voice.active || voice.enabled)
+                executorBusy[v % executors] = true;
+        }
+
+        // Fork: the semaphore release publishes the block and the snapshot
+        int woken = 0;
+        for (int e = 1; e < executors; ++e) {
+            if (executorBusy[e])
+                ++woken;
+        }
+        m_pending.store(woken, std::memory_order_relaxed);
+        for (int e = 1; e < executors; ++e) {
+            if (executorBusy[e])
+                m_workers[e - 1]->wake();
+        }
+
+        runVoices(0);
+
+        // Join: workers finish within the block, so spin rather than sleep
+        int spins = 0;
+        while (m_pending.load(std::memory_order_acquire) > 0) {
+            if (++spins < kSpinsBeforeYield)
+                cpuRelax();
+            else
+                QThread::yieldCurrentThread();
+        }
+
+        // Mix dry signal and voices
+        const float dry = m_dryGain.load(std::memory_order_relaxed);
+        for (int i = 0; i < used * channels; ++i)
+            samples[i] *= dry;
+
+        for (int v = 0; v < kMaxVoices; ++v) {
+            const Voice& voice = m_voices[v];
+            if (!voice.active)
+                continue;
+            const float* out = voice.output.data();
+            if (channels == 1) {
+                const float g = voiceGains[v][2];
+                for (int i = 0; i < used; ++i)
+                    samples[i] += g * out[i];
+            } else {
+                const float gl = voiceGains[v][0];
+                const float gr = voiceGains[v][1];
+                const float gc = voiceGains[v][2];
+                for (int i = 0; i < used; ++i) {
+                    float* frame = samples + i * channels;
+                    frame[0] += gl * out[i];
+                    frame[1] += gr * out[i];
+                    for (int ch = 2; ch < channels; ++ch)
+                        frame[ch] += gc * out[i];
+                }
+            }
+        }
+
+        samples += static_cast<size_t>(used) * channels;
+        frames -= used;
+    }
+}
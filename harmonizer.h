@@ -0,0 +1,110 @@
+// harmonizer.h
+#ifndef HARMONIZER_H
+#define HARMONIZER_H
+
+#include "audioblock.h"
+#include "pitchengine.h"
+
+#include <QMutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class HarmonizerWorker;
+
+// ----------------------------------------------------------
+// Harmonizer Class Declaration
+// ----------------------------------------------------------
+
+/**
+ * @brief Up to kMaxVoices independently pitched voices mixed with the dry signal.
+ *
+ * Every voice owns a mono SoundTouchPitchEngine fed with a downmix of the
+ * block. Voices are spread over a small pool of time-critical worker threads
+ * (started when the first voice is switched on) plus the calling audio
+ * thread: process() wakes the workers (fork), runs its own share and spins
+ * until the workers are done (join), then mixes the voices with their gain
+ * and pan. Voice parameters are atomics, so the UI
+ * can change them at any time; process() never locks or allocates.
+ */
+class Harmonizer
+{
+public:
+    static constexpr int kMaxVoices   = 4;
+    static constexpr int kMaxChannels = 8;
+
+    Harmonizer();
+    ~Harmonizer();
+
+    Harmonizer(const Harmonizer&) = delete;
+    Harmonizer& operator=(const Harmonizer&) = delete;
+
+    /// Not real-time safe. Sets the stream layout, resets the voices and restarts the worker pool if it runs.
+    void setFormat(int channels, int sampleRate);
+
+    /**
+     * @brief Configures a voice. Safe from any thread but the audio thread:
+     * switching the first voice on starts the worker pool.
+     * @param semitones Pitch offset against the dry signal.
+     * @param gain Linear voice level; 0 switches the voice off.
+     * @param pan -1 (left) .. +1 (right); ignored for mono streams.
+     */
+    void setVoice(int index, float semitones, float gain, float pan);
+    void clearVoices();
+
+    /// Linear level of the unprocessed signal. Safe from any thread.
+    void setDryGain(float gain) { m_dryGain.store(gain, std::memory_order_relaxed); }
+
+    /// True if at least one voice is switched on. Safe from any thread.
+    bool isActive() const;
+
+    /// Delay of the pitched voices in frames.
+    int latencyFrames() const { return m_voices[0].engine.latencyFrames(); }
+
+    /// Audio thread: pitches, mixes and writes interleaved samples in place.
+    void process(float* samples, int frames);
+
+private:
+    friend class HarmonizerWorker;
+
+    struct Voice
+    {
+        // Written by setVoice(), snapshotted by process() once per block
+        std::atomic<float> semitones{0.0f};
+        std::atomic<float> gain{0.0f};
+        std::atomic<float> pan{0.0f};
+
+        // Owned by whichever thread runs the voice this block
+        SoundTouchPitchEngine engine;
+        std::vector<float> output;
+        bool enabled = false;
+
+        // Block snapshot, set by process() before the fork
+        bool active = false;
+        float targetSemitones = 0.0f;
+    };
+
+    void runVoices(int executor);
+    void runVoice(Voice& voice);
+    void startWorkers();
+    void stopWorkers();
+
+    int m_channels;
+    int m_sampleRate;
+    Voice m_voices[kMaxVoices];
+    std::atomic<float> m_dryGain;
+
+    // Current block, shared with the workers
+    AudioBlock m_input;               ///< Mono downmix of the block
+    int m_frames;
+
+    // Worker pool; voice v runs on executor v % (workers + 1), executor 0 is the caller
+    QMutex m_workerMutex;             ///< Serializes starting and stopping the pool
+    bool m_workersStarted;
+    std::vector<std::unique_ptr<HarmonizerWorker>> m_workers;
+    std::atomic<int> m_workerCount;   ///< Workers process() may wake; set once they run
+    int m_executors;                  ///< Workers + 1 for the current block
+    std::atomic<int> m_pending;       ///< Workers still busy with the current block
+};
+
+#endif // HARMONIZER_H
@@ -0,0 +1,525 @@
+// kernelbench.cpp
+//
+// Single-thread cost of the DSP kernels, measured on synthetic audio and
+// reported as the share of one core they take in real time. Each kernel
+// runs flat out on the calling thread, so pin it (taskset) for stable
+// numbers.
+
+#include "parametriceq.h"
+#include "pitchengine.h"
+
+#include <FIFOSampleBuffer.h>
+#include <FIRFilter.h>
+#include <RateTransposer.h>
+#include <TDStretch.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using soundtouch::FIFOSampleBuffer;
+using soundtouch::FIRFilter;
+using soundtouch::TransposerBase;
+
+const double kPi = 3.14159265358979323846;
+
+struct BenchConfig
+{
+    int sampleRate = 48000;
+    int blockFrames = 256;
+    double seconds = 20.0;
+};
+
+double elapsedSeconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Elapsed time as a share of the audio duration, in percent of one core
+void report(const char* name, double elapsed, qint64 frames, int sampleRate)
+{
+    std::printf("%-32s %8.3f %% of one core  (%.1f ns/frame)\n", name,
+                100.0 * elapsed * sampleRate / static_cast<double>(frames), 1e9 * elapsed / static_cast<double>(frames));
+}
+
+std::vector<float> noise(int frames, int channels)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+    std::vector<float> samples(static_cast<size_t>(frames) * channels);
+    for (float& s : samples)
+        s = dist(rng);
+    return samples;
+}
+
+// A few partials of equal level (in cycles per frame), all below a quarter
+// of the rate; every channel slightly detuned
+std::vector<float> multitone(int frames, int channels)
+{
+    const double partials[] = {0.0047, 0.0191, 0.0533, 0.1102, 0.1759, 0.2311};
+    std::vector<float> samples(static_cast<size_t>(frames) * channels);
+    for (int ch = 0; ch < channels; ++ch) {
+        for (int i = 0; i < frames; ++i) {
+            double s = 0.0;
+            for (double f : partials)
+                s += std::sin(2.0 * kPi * f * (1.0 + 0.01 * ch) * i + ch);
+            samples[static_cast<size_t>(i) * channels + ch] = static_cast<float>(s / 8.0);
+        }
+    }
+    return samples;
+}
+
+double snrDb(const std::vector<float>& reference, const std::vector<float>& test)
+{
+    const size_t n = std::min(reference.size(), test.size());
+    double signal = 0.0;
+    double error = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        signal += static_cast<double>(reference[i]) * reference[i];
+        error += (static_cast<double>(reference[i]) - test[i]) * (static_cast<double>(reference[i]) - test[i]);
+    }
+    return error > 0.0 ? 10.0 * std::log10(signal / error) : 999.0;
+}
+
+// ----------------------------------------------------------
+// Parametric EQ
+// ----------------------------------------------------------
+
+// All 16 bands in use, one biquad section each
+void benchEq(const BenchConfig& config)
+{
+    for (int channels : {1, 2}) {
+        ParametricEq eq;
+        eq.setSampleRate(config.sampleRate);
+        eq.setChannels(channels);
+        for (int b = 0; b < ParametricEq::kMaxBands; ++b) {
+            EqBand band;
+            band.type = b == 0 ? EqBandType::LowShelf
+                      : b == ParametricEq::kMaxBands - 1 ? EqBandType::HighShelf : EqBandType::Peaking;
+            band.frequency = 31.25f * std::pow(2.0f, b * 9.0f / (ParametricEq::kMaxBands - 1));
+            band.gainDb = b % 2 ? -3.0f : 4.0f;
+            band.q = band.type == EqBandType::Peaking ? 1.4f : 0.7f;
+            eq.setBand(b, band);
+        }
+
+        std::vector<float> block = noise(config.blockFrames, channels);
+        eq.process(block.data(), config.blockFrames);   // applies the queued bands
+        const int blocks = static_cast<int>(config.seconds * config.sampleRate / config.blockFrames);
+        const Clock::time_point start = Clock::now();
+        for (int i = 0; i < blocks; ++i)
+            eq.process(block.data(), config.blockFrames);
+        report(channels == 1 ? "eq 16 bands, mono" : "eq 16 bands, stereo", elapsedSeconds(start),
+               static_cast<qint64>(blocks) * config.blockFrames, config.sampleRate);
+    }
+}
+
+// ----------------------------------------------------------
+// SoundTouch interpolation
+// ----------------------------------------------------------
+
+/**
+ * @brief SoundTouch's Shannon interpolator as it was before the table-driven
+ * kernel: eight sin() evaluations per output frame in double precision.
+ * Kept as the accuracy reference and the "before" timing.
+ */
+struct ReferenceShannon
+{
+    int channels = 1;
+    double rate = 1.0;
+    double fract = 0.0;
+
+    // Same contract as TransposerBase::transpose()
+    int transpose(FIFOSampleBuffer& dest, FIFOSampleBuffer& src)
+    {
+        // Kaiser window with beta = 2, scaled down by 5 %
+        static const double kaiser8[8] = {0.41778693317814, 0.64888025049173, 0.83508562409944, 0.93887857733412,
+                                          0.93887857733412, 0.83508562409944, 0.64888025049173, 0.41778693317814};
+        const int srcFrames = static_cast<int>(src.numSamples());
+        const float* in = src.ptrBegin();
+        float* out = dest.ptrEnd(static_cast<int>(srcFrames / rate) + 8);
+        int produced = 0;
+        int consumed = 0;
+        while (consumed < srcFrames - 8) {
+            double w[8];
+            for (int t = 0; t < 8; ++t) {
+                const double x = kPi * (t - 3 - fract);
+                w[t] = (t == 3 && fract < 1e-6 ? 1.0 : std::sin(x) / x) * kaiser8[t];
+            }
+            for (int ch = 0; ch < channels; ++ch) {
+                double sum = 0.0;
+                for (int t = 0; t < 8; ++t)
+                    sum += in[t * channels + ch] * w[t];
+                out[produced * channels + ch] = static_cast<float>(sum);
+            }
+            ++produced;
+            fract += rate;
+            const int whole = static_cast<int>(fract);
+            fract -= whole;
+            in += whole * channels;
+            consumed += whole;
+        }
+        dest.putSamples(produced);
+        src.receiveSamples(consumed);
+        return produced;
+    }
+};
+
+std::unique_ptr<TransposerBase> newTransposer(SoundTouchInterpolation interpolation, int channels, double rate)
+{
+    SoundTouchPitchEngine::setInterpolation(interpolation);
+    std::unique_ptr<TransposerBase> transposer(TransposerBase::newInstance());
+    transposer->setChannels(channels);
+    transposer->setRate(rate);
+    return transposer;
+}
+
+// Feeds @p input through @p transposer in blocks and collects the output
+template <typename Transposer>
+std::vector<float> transposeAll(Transposer& transposer, const std::vector<float>& input, int channels,
+                                int blockFrames, double* elapsed)
+{
+    FIFOSampleBuffer src(channels);
+    FIFOSampleBuffer dest(channels);
+    const int frames = static_cast<int>(input.size() / channels);
+    std::vector<float> output;
+    output.reserve(input.size() * 2 + 64);
+    const Clock::time_point start = Clock::now();
+    for (int pos = 0; pos < frames; pos += blockFrames) {
+        src.putSamples(input.data() + static_cast<size_t>(pos) * channels, std::min(blockFrames, frames - pos));
+        transposer.transpose(dest, src);
+        // Drain per block as the pitch engine does; the FIFO grows linearly
+        output.insert(output.end(), dest.ptrBegin(), dest.ptrBegin() + static_cast<size_t>(dest.numSamples()) * channels);
+        dest.clear();
+    }
+    if (elapsed)
+        *elapsed = elapsedSeconds(start);
+    return output;
+}
+
+// Cost of the table-driven Shannon kernel against the sin() reference and
+// cubic at a semitone up, then its accuracy over the usable rate range
+void benchInterpolation(const BenchConfig& config)
+{
+    const double semitoneUp = 1.0595;
+    const int frames = static_cast<int>(config.seconds * config.sampleRate);
+    for (int channels : {1, 2}) {
+        const std::vector<float> input = multitone(frames, channels);
+        const char* layout = channels == 1 ? "mono" : "stereo";
+        char name[64];
+        double elapsed = 0.0;
+
+        ReferenceShannon reference;
+        reference.channels = channels;
+        reference.rate = semitoneUp;
+        transposeAll(reference, input, channels, config.blockFrames, &elapsed);
+        std::snprintf(name, sizeof(name), "interp sin() shannon, %s", layout);
+        report(name, elapsed, frames, config.sampleRate);
+
+        const std::unique_ptr<TransposerBase> shannon = newTransposer(SoundTouchInterpolation::Shannon, channels, semitoneUp);
+        transposeAll(*shannon, input, channels, config.blockFrames, &elapsed);
+        std::snprintf(name, sizeof(name), "interp table shannon, %s", layout);
+        report(name, elapsed, frames, config.sampleRate);
+
+        const std::unique_ptr<TransposerBase> cubic = newTransposer(SoundTouchInterpolation::Cubic, channels, semitoneUp);
+        transposeAll(*cubic, input, channels, config.blockFrames, &elapsed);
+        std::snprintf(name, sizeof(name), "interp cubic, %s", layout);
+        report(name, elapsed, frames, config.sampleRate);
+    }
+
+    // Table against sin() reference at rates 0.5 .. 1.9, one second each
+    const int checkFrames = config.sampleRate;
+    double worstMono = 999.0;
+    double worstStereo = 999.0;
+    double worstMulti = 999.0;
+    for (double rate : {0.5, 0.71, 0.944, 1.0595, 1.33, 1.9}) {
+        for (int channels : {1, 2}) {
+            const std::vector<float> input = multitone(checkFrames, channels);
+            ReferenceShannon reference;
+            reference.channels = channels;
+            reference.rate = rate;
+            const std::vector<float> expected = transposeAll(reference, input, channels, config.blockFrames, nullptr);
+            const std::unique_ptr<TransposerBase> shannon = newTransposer(SoundTouchInterpolation::Shannon, channels, rate);
+            const double snr = snrDb(expected, transposeAll(*shannon, input, channels, config.blockFrames, nullptr));
+            double& worst = channels == 1 ? worstMono : worstStereo;
+            worst = std::min(worst, snr);
+        }
+
+        // Four channels against each channel transposed on its own
+        const int channels = 4;
+        const std::vector<float> input = multitone(checkFrames, channels);
+        const std::unique_ptr<TransposerBase> multi = newTransposer(SoundTouchInterpolation::Shannon, channels, rate);
+        const std::vector<float> together = transposeAll(*multi, input, channels, config.blockFrames, nullptr);
+        for (int ch = 0; ch < channels; ++ch) {
+            std::vector<float> single(checkFrames);
+            for (int i = 0; i < checkFrames; ++i)
+                single[i] = input[static_cast<size_t>(i) * channels + ch];
+            const std::unique_ptr<TransposerBase> mono = newTransposer(SoundTouchInterpolation::Shannon, 1, rate);
+            const std::vector<float> alone = transposeAll(*mono, single, 1, config.blockFrames, nullptr);
+            std::vector<float> picked(together.size() / channels);
+            for (size_t i = 0; i < picked.size(); ++i)
+                picked[i] = together[i * channels + ch];
+            worstMulti = std::min(worstMulti, snrDb(alone, picked));
+        }
+    }
+    std::printf("interp table vs sin() shannon: worst SNR %.1f dB mono, %.1f dB stereo; "
+                "4ch vs per-channel mono %.1f dB\n", worstMono, worstStereo, worstMulti);
+    SoundTouchPitchEngine::setInterpolation(SoundTouchInterpolation::Cubic);
+}
+
+// ----------------------------------------------------------
+// SoundTouch FIR filter
+// ----------------------------------------------------------
+
+// Plain C FIRFilter against FIRFilter::newInstance() (the SSE kernels on
+// x86), in ns per output sample, plus the SSE error against double precision
+void benchFir(const BenchConfig& config)
+{
+    const int frames = config.blockFrames;
+    const int blocks = std::max(static_cast<int>(config.seconds * config.sampleRate / frames), 1);
+    for (int taps : {64, 256}) {
+        // Windowed-sinc low-pass at a quarter of the rate
+        std::vector<float> coeffs(taps);
+        for (int i = 0; i < taps; ++i) {
+            const double x = i - (taps - 1) / 2.0;
+            const double window = 0.54 - 0.46 * std::cos(2.0 * kPi * i / (taps - 1));
+            coeffs[i] = static_cast<float>(0.5 * (x == 0.0 ? 1.0 : std::sin(0.5 * kPi * x) / (0.5 * kPi * x)) * window);
+        }
+
+        for (int channels : {1, 2, 4}) {
+            FIRFilter scalar;       // On the stack: operator new is reserved for newInstance()
+            scalar.setCoefficients(coeffs.data(), taps, 0);
+            const std::unique_ptr<FIRFilter> simd(FIRFilter::newInstance());
+            simd->setCoefficients(coeffs.data(), taps, 0);
+
+            const std::vector<float> input = noise(frames + taps, channels);
+            std::vector<float> output(static_cast<size_t>(frames) * channels);
+            double ns[2];
+            FIRFilter* filters[2] = {&scalar, simd.get()};
+            for (int f = 0; f < 2; ++f) {
+                const Clock::time_point start = Clock::now();
+                for (int b = 0; b < blocks; ++b)
+                    filters[f]->evaluate(output.data(), input.data(), frames + taps, channels);
+                ns[f] = 1e9 * elapsedSeconds(start) / (static_cast<double>(blocks) * frames * channels);
+            }
+
+            double maxError = 0.0;
+            for (int j = 0; j < frames; ++j) {
+                for (int ch = 0; ch < channels; ++ch) {
+                    double sum = 0.0;
+                    for (int i = 0; i < taps; ++i)
+                        sum += static_cast<double>(input[static_cast<size_t>(j + i) * channels + ch]) * coeffs[i];
+                    maxError = std::max(maxError, std::abs(sum - output[static_cast<size_t>(j) * channels + ch]));
+                }
+            }
+            std::printf("fir %3d taps, %dch: %7.1f ns/sample scalar, %7.1f ns/sample newInstance(), max error %.1e\n",
+                        taps, channels, ns[0], ns[1], maxError);
+        }
+    }
+}
+
+// ----------------------------------------------------------
+// TDStretch overlap seek
+// ----------------------------------------------------------
+
+#ifdef SOUNDTOUCH_ALLOW_SSE
+using SeekProbeBase = soundtouch::TDStretchSSE;
+#else
+using SeekProbeBase = soundtouch::TDStretch;
+#endif
+
+/**
+ * @brief TDStretch that runs every overlap seek three ways on the same
+ * data: the full search, and the coarse-to-fine search with 1 and 2
+ * candidates. Times each one and scores the coarse-to-fine picks against
+ * the full search; the full search's pick is what gets spliced.
+ */
+class SeekProbe : public SeekProbeBase
+{
+public:
+    static constexpr int kModes = 3;            ///< Full, then 1 and 2 candidates
+
+    double seconds[kModes] = {};
+    int agreed[kModes] = {};                    ///< Picked the full search's offset
+    double quality[kModes] = {};                ///< Sum of weighted correlation / full search's
+    int seeks = 0;
+
+protected:
+    int seekBestOverlapPosition(const float* refPos) override
+    {
+        int offsets[kModes];
+        for (int mode = 0; mode < kModes; ++mode) {
+            setSeekCandidates(mode);
+            const Clock::time_point start = Clock::now();
+            offsets[mode] = mode == 0 ? seekBestOverlapPositionFull(refPos) : seekBestOverlapPositionHierarchical(refPos);
+            seconds[mode] += elapsedSeconds(start);
+        }
+        setSeekCandidates(0);
+
+        const double best = weightedCorrelation(refPos, offsets[0]);
+        for (int mode = 0; mode < kModes; ++mode) {
+            if (offsets[mode] == offsets[0])
+                ++agreed[mode];
+            quality[mode] += best > 0.0 ? weightedCorrelation(refPos, offsets[mode]) / best : 1.0;
+        }
+        ++seeks;
+        return offsets[0];
+    }
+
+private:
+    // The score both searches maximize
+    double weightedCorrelation(const float* refPos, int offset)
+    {
+        double norm = 0.0;
+        const double corr = calcCrossCorr(refPos + channels * offset, pMidBuffer, norm);
+        clearCrossCorrState();
+        const double tmp = static_cast<double>(2 * offset - seekLength) / seekLength;
+        return (corr + 0.1) * (1.0 - 0.25 * tmp * tmp);
+    }
+};
+
+enum class SeekSignal { Vowel, Chord, TwoVoices, SpeechLike, WhiteNoise };
+
+// Harmonic tone at @p f0 Hz shaped by three vowel formants
+double vowel(double t, double f0, int sampleRate)
+{
+    const double formants[3][2] = {{700.0, 130.0}, {1220.0, 70.0}, {2600.0, 160.0}};
+    double s = 0.0;
+    for (int h = 1; h * f0 < 0.45 * sampleRate; ++h) {
+        const double f = h * f0;
+        double gain = 0.0;
+        for (const auto& formant : formants)
+            gain += 1.0 / (1.0 + std::pow((f - formant[0]) / formant[1], 2.0));
+        s += gain * std::sin(2.0 * kPi * f * t + h);
+    }
+    return s;
+}
+
+std::vector<float> seekSignal(SeekSignal kind, int frames, int channels, int sampleRate)
+{
+    std::mt19937 rng(99);
+    std::normal_distribution<double> gauss(0.0, 1.0);
+    std::vector<float> samples(static_cast<size_t>(frames) * channels);
+    double peak = 1e-9;
+    for (int i = 0; i < frames; ++i) {
+        const double t = static_cast<double>(i) / sampleRate;
+        const double vibrato = 1.0 + 0.01 * std::sin(2.0 * kPi * 5.0 * t);
+        double s = 0.0;
+        switch (kind) {
+        case SeekSignal::Vowel:
+            s = vowel(t, 140.0 * vibrato, sampleRate);
+            break;
+        case SeekSignal::Chord:
+            for (double f : {261.6, 329.6, 392.0})
+                for (int h = 1; h <= 6; ++h)
+                    s += std::sin(2.0 * kPi * h * f * t) / h;
+            break;
+        case SeekSignal::TwoVoices:
+            s = vowel(t, 110.0 * vibrato, sampleRate) + vowel(t, 175.0 / vibrato, sampleRate);
+            break;
+        case SeekSignal::SpeechLike: {
+            // Syllables at 4 Hz: voiced harmonics with a gliding pitch and noise bursts
+            const double envelope = std::pow(std::max(std::sin(2.0 * kPi * 4.0 * t), 0.0), 2.0);
+            const double f0 = 120.0 + 30.0 * std::sin(2.0 * kPi * 0.7 * t);
+            s = envelope * (vowel(t, f0, sampleRate) + 0.5 * gauss(rng)) + 0.02 * gauss(rng);
+            break;
+        }
+        case SeekSignal::WhiteNoise:
+            s = gauss(rng);
+            break;
+        }
+        for (int ch = 0; ch < channels; ++ch)
+            samples[static_cast<size_t>(i) * channels + ch] = static_cast<float>(ch == 0 ? s : 0.8 * s);
+        peak = std::max(peak, std::abs(s));
+    }
+    for (float& s : samples)
+        s = static_cast<float>(s * 0.5 / peak);
+    return samples;
+}
+
+// Per-seek cost and agreement of the coarse-to-fine seek with the full
+// search, at the pitch engine's 40/15/8 ms settings and +-4 semitones
+void benchSeek(const BenchConfig& config)
+{
+    const struct { SeekSignal kind; const char* name; } corpus[] = {
+        {SeekSignal::Vowel, "vowel"}, {SeekSignal::Chord, "chord"}, {SeekSignal::TwoVoices, "two voices"},
+        {SeekSignal::SpeechLike, "speech-like"}, {SeekSignal::WhiteNoise, "white noise"}};
+    const int frames = static_cast<int>(std::min(config.seconds, 5.0) * config.sampleRate);
+
+    std::printf("seek %-12s ch  full us   K=1 us   K=2 us   K=1 agree/quality   K=2 agree/quality\n", "");
+    for (const auto& entry : corpus) {
+        for (int channels : {1, 2}) {
+            const std::vector<float> input = seekSignal(entry.kind, frames, channels, config.sampleRate);
+            SeekProbe total;
+            for (double semitones : {4.0, -4.0}) {
+                SeekProbe probe;        // On the stack: operator new is reserved for newInstance()
+                probe.setChannels(channels);
+                probe.setParameters(config.sampleRate, 40, 15, 8);
+                probe.setTempo(std::pow(2.0, -semitones / 12.0));
+                for (int pos = 0; pos < frames; pos += config.blockFrames) {
+                    probe.putSamples(input.data() + static_cast<size_t>(pos) * channels,
+                                     std::min(config.blockFrames, frames - pos));
+                    probe.getOutput()->clear();
+                }
+                for (int mode = 0; mode < SeekProbe::kModes; ++mode) {
+                    total.seconds[mode] += probe.seconds[mode];
+                    total.agreed[mode] += probe.agreed[mode];
+                    total.quality[mode] += probe.quality[mode];
+                }
+                total.seeks += probe.seeks;
+            }
+            const double n = std::max(total.seeks, 1);
+            std::printf("seek %-12s %d  %7.2f  %7.2f  %7.2f   %5.1f %%  %.4f      %5.1f %%  %.4f\n", entry.name,
+                        channels, 1e6 * total.seconds[0] / n, 1e6 * total.seconds[1] / n, 1e6 * total.seconds[2] / n,
+                        100.0 * total.agreed[1] / n, total.quality[1] / n,
+                        100.0 * total.agreed[2] / n, total.quality[2] / n);
+        }
+    }
+}
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption kernelsOption("kernels", "Comma-separated kernels to run: eq, interp, fir, seek.",
+                                     "names", "eq,interp,fir,seek");
+    QCommandLineOption rateOption("rate", "Sample rate.", "Hz", "48000");
+    QCommandLineOption blockOption("block", "Frames per block.", "frames", "256");
+    QCommandLineOption secondsOption("seconds", "Seconds of audio per measurement.", "seconds", "20");
+    parser.addOption(kernelsOption);
+    parser.addOption(rateOption);
+    parser.addOption(blockOption);
+    parser.addOption(secondsOption);
+    parser.process(app);
+
+    BenchConfig config;
+    config.sampleRate = std::max(parser.value(rateOption).toInt(), 8000);
+    config.blockFrames = std::max(parser.value(blockOption).toInt(), 16);
+    config.seconds = std::max(parser.value(secondsOption).toDouble(), 1.0);
+
+    for (const QString& kernel : parser.value(kernelsOption).split(',', Qt::SkipEmptyParts)) {
+        if (kernel == "eq") {
+            benchEq(config);
+        } else if (kernel == "interp") {
+            benchInterpolation(config);
+        } else if (kernel == "fir") {
+            benchFir(config);
+        } else if (kernel == "seek") {
+            benchSeek(config);
+        } else {
+            std::fprintf(stderr, "Unknown kernel %s\n", kernel.toLocal8Bit().constData());
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -1,36 +1,106 @@
 #include "levelmeter.h"
 #include <QPainter>
 #include <QColor>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Release: 20 dB per second, the usual PPM-style fall-back.
+const float kReleaseDbPerSecond = 20.0f;
+// How long the peak-hold marker stays put before it starts falling.
+const float kPeakHoldSeconds    = 1.5f;
+}
 
 LevelMeter::LevelMeter(QWidget *parent)
     : QWidget(parent)
     , m_level(0.0f)
+    , m_rms(0.0f)
+    , m_hold(0.0f)
+    , m_holdTime(0.0f)
     , m_numSteps(5)
+    , m_paintedLevelSteps(-1)
+    , m_paintedRmsSteps(-1)
+    , m_paintedHoldStep(-1)
 {}
 
 void LevelMeter::setLevel(float level)
+{
+    level = qBound(0.0f, level, 1.0f);
+    m_level    = level;
+    m_rms      = level;
+    m_hold     = level;
+    m_holdTime = 0.0f;
+    advance(0.0f);
+}
+
+void LevelMeter::feedLevels(float rms, float peak, float truePeak)
 {
     // Clamp to [0..1]
-    if (level < 0.0f) level = 0.0f;
-    if (level > 1.0f) level = 1.0f;
-    m_level = level;
-    // Trigger a repaint
-    update();
+    rms      = qBound(0.0f, rms, 1.0f);
+    peak     = qBound(0.0f, peak, 1.0f);
+    truePeak = qBound(0.0f, truePeak, 1.0f);
+
+    m_rms   = std::max(m_rms, rms);
+    m_level = std::max(m_level, peak);
+    if (truePeak >= m_hold) {
+        m_hold     = truePeak;
+        m_holdTime = kPeakHoldSeconds;
+    }
+}
+
+void LevelMeter::advance(float seconds)
+{
+    if (seconds > 0.0f) {
+        const float release = std::pow(10.0f, -kReleaseDbPerSecond * seconds / 20.0f);
+        m_level *= release;
+        m_rms   *= release;
+
+        if (m_holdTime > 0.0f)
+            m_holdTime -= seconds;
+        else
+            m_hold *= release;
+    }
+
+    // Only repaint when something visible changed
+    const int levelSteps = litSteps(m_level);
+    const int rmsSteps   = litSteps(m_rms);
+    const int holdStep   = litSteps(m_hold);
+    if (levelSteps != m_paintedLevelSteps
+        || rmsSteps != m_paintedRmsSteps
+        || holdStep != m_paintedHoldStep) {
+        m_paintedLevelSteps = levelSteps;
+        m_paintedRmsSteps   = rmsSteps;
+        m_paintedHoldStep   = holdStep;
+        update();
+    }
+}
+
+int LevelMeter::litSteps(float level) const
+{
+    if (level < 0.01f)
+        return 0;
+    // Step i is lit when level >= (i+1) / m_numSteps
+    return std::min(static_cast<int>(level * m_numSteps + 1e-4f), m_numSteps);
 }
 
 void LevelMeter::paintEvent(QPaintEvent * /*event*/)
 {
     QPainter painter(this);
 
-    if (m_level < 0.01f) {
+    const int levelSteps = litSteps(m_level);
+    const int rmsSteps   = litSteps(m_rms);
+    const int holdStep   = litSteps(m_hold);
+
+    if (levelSteps == 0 && holdStep == 0) {
         painter.fillRect(rect(), Qt::darkGreen);
         return;
     }
 
     // For a vertical "stairs" meter:
     //   - We'll divide the widget's height into m_numSteps segments.
-    //   - Each step i corresponds to a threshold: i+1 / m_numSteps
-    //   - If m_level >= threshold, that step is green; else gray.
+    //   - Steps up to the RMS level are solid green, steps up to the
+    //     peak level are light green, the rest dark green.
+    //   - The step holding the recent true peak is drawn in yellow.
 
     int w = width();
     int h = height();
@@ -40,18 +110,18 @@ void LevelMeter::paintEvent(QPaintEvent * /*event*/)
 
     // Draw from bottom to top
     for (int i = 0; i < m_numSteps; ++i) {
-        // threshold for this step
-        float stepThreshold = (i + 1) / static_cast<float>(m_numSteps);
-
         // Compute the rectangle for this step
         int stepTop    = h - static_cast<int>((i+1) * stepHeight);
         int stepBottom = h - static_cast<int>(i * stepHeight);
 
         QRect stepRect(0, stepTop, w, stepBottom - stepTop);
 
-        // If current level is high enough to “fill” this step
-        if (m_level >= stepThreshold) {
+        if (i < rmsSteps) {
             painter.fillRect(stepRect, Qt::green);
+        } else if (i < levelSteps) {
+            painter.fillRect(stepRect, QColor(150, 230, 150));
+        } else if (i == holdStep - 1) {
+            painter.fillRect(stepRect, Qt::yellow);
         } else {
             // Draw a darker color to show the step
             painter.fillRect(stepRect, Qt::darkGreen);
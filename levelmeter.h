@@ -9,14 +9,36 @@ public:
     explicit LevelMeter(QWidget *parent = nullptr);
     void setNumSteps(int steps) { m_numSteps = steps; }
 
+    /**
+     * @brief Feeds a new measurement through the peak-hold ballistics.
+     * Levels above the displayed ones are shown immediately (instant
+     * attack); lower ones are reached through the release in advance().
+     */
+    void feedLevels(float rms, float peak, float truePeak);
+
+    /**
+     * @brief Advances the ballistics by @p seconds and repaints only if the
+     * number of lit steps or the peak-hold marker changed.
+     */
+    void advance(float seconds);
+
 public slots:
+    /// Shows @p level (0..1) as is, bypassing the ballistics; also resets the peak hold.
     void setLevel(float level);
 
 protected:
     void paintEvent(QPaintEvent *event) override;
 
 private:
-    float m_level;      // 0.0 .. 1.0
+    int litSteps(float level) const;
+
+    float m_level;      // 0.0 .. 1.0, displayed peak
+    float m_rms;        // 0.0 .. 1.0, displayed RMS
+    float m_hold;       // 0.0 .. 1.0, peak-hold marker (true peak)
+    float m_holdTime;   // seconds left before the hold marker starts falling
     int   m_numSteps;   // how many “stairs” steps
-};
 
+    int   m_paintedLevelSteps;
+    int   m_paintedRmsSteps;
+    int   m_paintedHoldStep;
+};
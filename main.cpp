@@ -1,11 +1,181 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
 #include "mainwindow.h"
+#include "parametriceq.h"
+#include "pitchengine.h"
+#include "realtime.h"
+#include "rtkit.h"
+
+// One --eq band: type@Hz[:value[:Q]], value being the gain in dB for
+// peak and shelves and the slope in dB/octave for lowpass and highpass
+static bool parseEqBand(const QString& text, EqBand* band)
+{
+    const QStringList typeAndRest = text.trimmed().split('@');
+    if (typeAndRest.size() != 2)
+        return false;
+    const QString type = typeAndRest[0].toLower();
+    if (type == "peak")
+        band->type = EqBandType::Peaking;
+    else if (type == "lowshelf")
+        band->type = EqBandType::LowShelf;
+    else if (type == "highshelf")
+        band->type = EqBandType::HighShelf;
+    else if (type == "lowpass")
+        band->type = EqBandType::LowPass;
+    else if (type == "highpass")
+        band->type = EqBandType::HighPass;
+    else
+        return false;
+
+    const QStringList fields = typeAndRest[1].split(':');
+    bool ok = false;
+    band->frequency = fields[0].toFloat(&ok);
+    if (!ok || band->frequency <= 0.0f)
+        return false;
+    const bool passFilter = band->type == EqBandType::LowPass || band->type == EqBandType::HighPass;
+    if (fields.size() > 1) {
+        const float value = fields[1].toFloat(&ok);
+        if (!ok)
+            return false;
+        if (passFilter)
+            band->slope = static_cast<int>(value);
+        else
+            band->gainDb = value;
+    }
+    if (fields.size() > 2) {
+        band->q = fields[2].toFloat(&ok);
+        if (!ok || band->q <= 0.0f)
+            return false;
+    }
+    return fields.size() <= 3;
+}
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
 
-    MainWindow w;
+    // Band-limited 8-tap interpolation for pitch shifting; the table-driven
+    // Shannon transposer costs about the same as the default cubic one.
+    // Must be set before any SoundTouch instance is created.
+    SoundTouchPitchEngine::setInterpolation(SoundTouchInterpolation::Shannon);
+
+    // Speech needs no more than 16-24 kHz; a reduced processing rate cuts the
+    // cost of every effect stage, with one resampling pass on each side
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption processingRateOption(
+        QStringList() << "r" << "processing-rate",
+        "Run the effect chain at <Hz> (e.g. 16000 or 24000) instead of the output rate.",
+        "Hz", "0");
+    parser.addOption(processingRateOption);
+
+    // Tone shaping ahead of the rest of the chain
+    QCommandLineOption eqOption(
+        "eq",
+        "Parametric EQ <bands>, comma-separated type@Hz[:gain dB or slope dB/oct[:Q]] with type one of "
+        "peak, lowshelf, highshelf, lowpass, highpass; e.g. highpass@80:24,peak@2500:-4:1.4,highshelf@8000:3.",
+        "bands");
+    parser.addOption(eqOption);
+
+    // Audition a file through the effects instead of the microphone
+    QCommandLineOption inputFileOption(
+        QStringList() << "i" << "input-file",
+        "Play the WAV/RF64 <file> through the effect chain instead of the microphone.",
+        "file");
+    QCommandLineOption playOnceOption(
+        "play-once",
+        "Stop at the end of the input file instead of looping.");
+    parser.addOption(inputFileOption);
+    parser.addOption(playOnceOption);
+
+    // Keep the last minutes in memory, to save something after it happened
+    QCommandLineOption captureOption(
+        "capture-minutes",
+        "Keep the last <minutes> of input and output in memory for \"Save last\" (max. 60).",
+        "minutes", "0");
+    QCommandLineOption captureFloatOption(
+        "capture-float",
+        "Keep the captured output as float instead of 16-bit (twice the memory).");
+    parser.addOption(captureOption);
+    parser.addOption(captureFloatOption);
+
+    // Zero-copy output for local tools (see shmtap.cpp for a consumer)
+    QCommandLineOption sharedOutputOption(
+        "shm-output",
+        "Also publish the output in the shared-memory ring /dev/shm/<name> (Linux).",
+        "name");
+    parser.addOption(sharedOutputOption);
+
+    // UDP streaming between machines (see netloop.cpp for a loopback test)
+    QCommandLineOption netSendOption(
+        "net-send",
+        "Also stream the output over UDP to <host:port>, where another instance runs --net-receive (Linux).",
+        "host:port");
+    QCommandLineOption netReceiveOption(
+        "net-receive",
+        "Process the stream arriving on UDP <port> instead of the microphone (Linux).",
+        "port", "0");
+    parser.addOption(netSendOption);
+    parser.addOption(netReceiveOption);
+
+    // Real-time guarantees for the audio threads (Linux)
+    QCommandLineOption rtPriorityOption(
+        "rt-priority",
+        "Run the audio threads with SCHED_FIFO <priority> (1-99), via rtkit if needed.",
+        "priority", "0");
+    QCommandLineOption rtCpusOption(
+        "rt-cpus",
+        "Pin the audio threads to the comma-separated <cpus>, e.g. an isolated core.",
+        "cpus");
+    QCommandLineOption lockMemoryOption(
+        "lock-memory",
+        "Prefault and lock all process memory (mlockall) so the audio path never page-faults.");
+    parser.addOption(rtPriorityOption);
+    parser.addOption(rtCpusOption);
+    parser.addOption(lockMemoryOption);
+    parser.process(app);
+
+    RealtimeConfig realtime;
+    realtime.fifoPriority = parser.value(rtPriorityOption).toInt();
+    realtime.lockMemory = parser.isSet(lockMemoryOption);
+    for (const QString& cpu : parser.value(rtCpusOption).split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const int index = cpu.trimmed().toInt(&ok);
+        if (ok)
+            realtime.cpus.push_back(index);
+    }
+    realtime.priorityFallback = &Realtime::requestRtkitPriority;
+    Realtime::configure(realtime);
+    if (realtime.lockMemory)
+        Realtime::lockMemory(realtime.prefaultHeapBytes);
+
+    AudioOptions options;
+    options.processingRate = parser.value(processingRateOption).toInt();
+    options.inputFile      = parser.value(inputFileOption);
+    options.loopInput      = !parser.isSet(playOnceOption);
+    options.captureMinutes = qBound(0, parser.value(captureOption).toInt(), 60);
+    options.captureFloat   = parser.isSet(captureFloatOption);
+    options.sharedOutput   = parser.value(sharedOutputOption);
+    options.netReceivePort = parser.value(netReceiveOption).toInt();
+    const QString netSend = parser.value(netSendOption);
+    if (!netSend.isEmpty()) {
+        const int colon = netSend.lastIndexOf(':');
+        options.netSendHost = netSend.left(colon);
+        options.netSendPort = colon > 0 ? netSend.mid(colon + 1).toInt() : 0;
+        if (options.netSendPort <= 0)
+            qWarning() << "--net-send expects host:port, got" << netSend;
+    }
+
+    MainWindow w(nullptr, options);
+    int eqIndex = 0;
+    for (const QString& text : parser.value(eqOption).split(',', Qt::SkipEmptyParts)) {
+        EqBand band;
+        if (!parseEqBand(text, &band))
+            qWarning() << "Ignoring EQ band" << text << "- expected type@Hz[:value[:Q]]";
+        else if (!w.setEqBand(eqIndex++, band))
+            qWarning() << "Ignoring EQ band" << text << "- at most" << ParametricEq::kMaxBands << "bands";
+    }
     w.show();
 
     return app.exec();
@@ -2,6 +2,10 @@
 #include "ui_mainwindow.h"
 #include "audiothread.h"
 #include "levelmeter.h"
+#include "spectrumanalyzer.h"
+#include "spectrumwidget.h"
+#include "beattracker.h"
+#include "pitchengine.h"
 
 #include <QCloseEvent>
 #include <QDebug>
@@ -9,11 +13,37 @@
 #include <QDoubleValidator>
 #include <QTimer>
 #include <QMessageBox>
+#include <QScreen>
+#include <QPushButton>
+#include <QFileDialog>
+#include <QLabel>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QSlider>
+
+namespace {
+// Resolution of the input file position slider
+const int kInputPositionSteps = 1000;
+}
 
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(QWidget *parent, const AudioOptions& options)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , m_audioThread(nullptr)
+    , m_meterTimer(nullptr)
+    , m_spectrumAnalyzer(nullptr)
+    , m_spectrumWidget(nullptr)
+    , m_loadIrButton(nullptr)
+    , m_clearIrButton(nullptr)
+    , m_beatTracker(nullptr)
+    , m_bpmLabel(nullptr)
+    , m_shownBpm(-1.0f)
+    , m_harmonyCheckBox(nullptr)
+    , m_pitchEngineComboBox(nullptr)
+    , m_recordButton(nullptr)
+    , m_inputPositionSlider(nullptr)
+    , m_saveCaptureButton(nullptr)
+    , m_captureSaving(false)
     , m_distortionGain(1.0f)
     , m_pitchFactor(1.0f)
     , m_lowBandFreq(500)
@@ -126,17 +156,144 @@ MainWindow::MainWindow(QWidget *parent)
     else
         m_levelMeter->hide();
 
+    // -----------------------------
+    // Spectrum analyzer (FFT on a low-priority worker)
+    // -----------------------------
+    m_spectrumAnalyzer = new SpectrumAnalyzer(this);
+    m_spectrumWidget = new SpectrumWidget(this);
+    m_spectrumWidget->setGeometry(240, 400, 540, 140);
+    m_spectrumWidget->setAnalyzer(m_spectrumAnalyzer);
+    m_spectrumWidget->setBandMarkers(m_filterIndex, m_lowBandFreq, m_highBandFreq, 0);
+    connect(this, &MainWindow::filterParametersChanged,
+            this, &MainWindow::updateBandMarkers);
+    m_spectrumAnalyzer->start(QThread::LowPriority);
+
+    // -----------------------------
+    // Impulse response (convolution) buttons
+    // -----------------------------
+    m_loadIrButton = new QPushButton("Load IR...", this);
+    m_loadIrButton->setGeometry(10, 35, 100, 26);
+    m_loadIrButton->setToolTip("Load a WAV impulse response (cabinet, room or linear-phase EQ)");
+    connect(m_loadIrButton, &QPushButton::clicked,
+            this, &MainWindow::loadImpulseResponse);
+    m_clearIrButton = new QPushButton("No IR", this);
+    m_clearIrButton->setGeometry(115, 35, 60, 26);
+    m_clearIrButton->setEnabled(false);
+    connect(m_clearIrButton, &QPushButton::clicked,
+            this, &MainWindow::clearImpulseResponse);
+
+    // -----------------------------
+    // Harmonizer (parallel pitched voices)
+    // -----------------------------
+    m_harmonyCheckBox = new QCheckBox("Harmony", this);
+    m_harmonyCheckBox->setGeometry(290, 35, 90, 26);
+    m_harmonyCheckBox->setToolTip("Add a third and a fifth above the voice");
+    connect(m_harmonyCheckBox, &QCheckBox::toggled,
+            this, &MainWindow::setHarmonyEnabled);
+
+    // -----------------------------
+    // Pitch-shift engine
+    // -----------------------------
+    m_pitchEngineComboBox = new QComboBox(this);
+    m_pitchEngineComboBox->setGeometry(385, 35, 130, 26);
+    m_pitchEngineComboBox->addItem("Granular");
+    m_pitchEngineComboBox->addItem("SoundTouch");
+    m_pitchEngineComboBox->addItem("Phase vocoder");
+    m_pitchEngineComboBox->setCurrentIndex(static_cast<int>(PitchEngineType::SoundTouch));
+    m_pitchEngineComboBox->setToolTip("Pitch-shift engine:\n"
+                                      "- Granular: lowest CPU, some flanging.\n"
+                                      "- SoundTouch: balanced (default).\n"
+                                      "- Phase vocoder: highest CPU, keeps formants.");
+
+    // -----------------------------
+    // Recording of the dry input and the processed output
+    // -----------------------------
+    m_recordButton = new QPushButton("Record...", this);
+    m_recordButton->setGeometry(520, 35, 90, 26);
+    m_recordButton->setCheckable(true);
+    m_recordButton->setToolTip("Record the processed output to a WAV file\n"
+                               "(and the unprocessed input next to it as <name>-dry.wav)");
+    connect(m_recordButton, &QPushButton::clicked,
+            this, &MainWindow::setRecording);
+
+    // -----------------------------
+    // Position in the input file (only shown when a file replaces the microphone)
+    // -----------------------------
+    m_inputPositionSlider = new QSlider(Qt::Horizontal, this);
+    m_inputPositionSlider->setGeometry(240, 70, 370, 22);
+    m_inputPositionSlider->setRange(0, kInputPositionSteps);
+    m_inputPositionSlider->setToolTip("Position in the input file");
+    m_inputPositionSlider->hide();
+    connect(m_inputPositionSlider, &QSlider::sliderMoved,
+            this, &MainWindow::seekInputFile);
+
+    // -----------------------------
+    // Retrospective capture ("save what just happened")
+    // -----------------------------
+    m_saveCaptureButton = new QPushButton("Save last...", this);
+    m_saveCaptureButton->setGeometry(615, 35, 100, 26);
+    m_saveCaptureButton->setToolTip(QString("Save the last %1 min of output (and input as <name>-dry.wav)")
+                                        .arg(options.captureMinutes));
+    m_saveCaptureButton->setVisible(options.captureMinutes > 0);
+    connect(m_saveCaptureButton, &QPushButton::clicked,
+            this, &MainWindow::saveCapture);
+
+    // -----------------------------
+    // Tempo (BPM) tracking on a low-priority worker
+    // -----------------------------
+    m_beatTracker = new BeatTracker(this);
+    m_bpmLabel = new QLabel(this);
+    m_bpmLabel->setGeometry(185, 35, 100, 26);
+    m_beatTracker->start(QThread::LowPriority);
+
     // -----------------------------
     // Start the audio thread
     // -----------------------------
     m_audioThread = new AudioThread(this);
-    connect(this, &MainWindow::filterParametersChanged,
-            m_audioThread, &AudioThread::updateFilter);
-    connect(m_audioThread, &AudioThread::levelChanged,
-            this, &MainWindow::handleLevelChanged);
+    m_audioThread->setSpectrumAnalyzer(m_spectrumAnalyzer);
+    m_audioThread->setBeatTracker(m_beatTracker);
+    m_audioThread->setNoiseGate(ui->noiseGateSlider->value());
+    m_audioThread->setProcessingRate(options.processingRate);
+    if (!options.inputFile.isEmpty())
+        m_audioThread->setInputFile(options.inputFile, options.loopInput);
+    m_audioThread->setCapture(options.captureMinutes, options.captureFloat);
+    m_audioThread->setSharedOutput(options.sharedOutput);
+    if (options.netSendPort > 0)
+        m_audioThread->setNetworkOutput(options.netSendHost, options.netSendPort);
+    if (options.netReceivePort > 0)
+        m_audioThread->setNetworkInput(options.netReceivePort);
+    connect(m_pitchEngineComboBox,
+            QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::setPitchEngine);
 
     // Launch the audio thread
     m_audioThread->start();
+
+    // -----------------------------
+    // Level-meter polling at display refresh rate
+    //   (the audio thread only publishes into a lock-free ring)
+    // -----------------------------
+    qreal refreshRate = screen() ? screen()->refreshRate() : 60.0;
+    if (refreshRate <= 0.0)
+        refreshRate = 60.0;
+    m_meterTimer = new QTimer(this);
+    m_meterTimer->setTimerType(Qt::PreciseTimer);
+    m_meterTimer->setInterval(qBound(8, qRound(1000.0 / refreshRate), 50));
+    connect(m_meterTimer, &QTimer::timeout,
+            this, &MainWindow::pollLevelMeter);
+    connect(m_meterTimer, &QTimer::timeout,
+            m_spectrumWidget, &SpectrumWidget::poll);
+    connect(m_meterTimer, &QTimer::timeout,
+            this, &MainWindow::pollBeatTracker);
+    connect(m_meterTimer, &QTimer::timeout,
+            this, &MainWindow::pollInputPosition);
+    connect(m_meterTimer, &QTimer::timeout,
+            this, &MainWindow::pollCaptureSave);
+    connect(m_meterTimer, &QTimer::timeout,
+            this, &MainWindow::pollPitchEngine);
+    m_meterClock.start();
+    if (ui->playback_CheckBox->isChecked())
+        m_meterTimer->start();
 }
 
 MainWindow::~MainWindow()
@@ -147,6 +304,14 @@ MainWindow::~MainWindow()
         delete m_audioThread;
         m_audioThread = nullptr;
     }
+    if (m_spectrumAnalyzer) {
+        m_spectrumAnalyzer->stop();
+        m_spectrumAnalyzer->wait();
+    }
+    if (m_beatTracker) {
+        m_beatTracker->stop();
+        m_beatTracker->wait();
+    }
     delete ui;
 }
 
@@ -159,20 +324,18 @@ void MainWindow::on_noiseGateSlider_valueChanged(int value)
     setNoiseGate(value);
 }
 
-int MainWindow::getNoiseGate()
+bool MainWindow::setEqBand(int index, const EqBand& band)
 {
-    // The AudioThread calls this to read the noise gate threshold in dB.
-    return ui->noiseGateSlider->value();
+    return m_audioThread && m_audioThread->setEqBand(index, band);
 }
 
 void MainWindow::setNoiseGate(int value)
 {
-    // You can log or further handle the new noise gate threshold.
-    // For example, negative values => gate is active; 0 => disabled.
+    // Negative values => gate is active; 0 => disabled. The audio thread
+    // picks the value up lock-free before its next block.
     qCDebug(audioCategory) << "[UI] Noise Gate set to:" << value << "dB";
-    // If you want to force an immediate filter update or do something else,
-    // you can emit filterParametersChanged(...) here or do it only
-    // in AudioThread by calling getNoiseGate() inside the loop.
+    if (m_audioThread)
+        m_audioThread->setNoiseGate(value);
 }
 
 //------------------------------------------------------------
@@ -200,10 +363,7 @@ void MainWindow::on_pitchSlider_valueChanged(int value)
                 ui->pitchValueEditLine->text());
 
     // Trigger filter update (some DSP might read m_pitchFactor in AudioThread)
-    emit filterParametersChanged(m_filterIndex,
-                                 m_lowBandFreq,
-                                 m_highBandFreq,
-                                 m_audioThread->getSampleRate());
+    emit filterParametersChanged();
 }
 
 void MainWindow::on_pitchValueEditLine_editingFinished()
@@ -242,10 +402,7 @@ void MainWindow::on_distortionSlider_valueChanged(int value)
                 ui->distortionValueEditLine->text());
 
     // Emit the signal to update distortion in AudioThread
-    emit filterParametersChanged(m_filterIndex,
-                                 m_lowBandFreq,
-                                 m_highBandFreq,
-                                 m_audioThread->getSampleRate());
+    emit filterParametersChanged();
 }
 
 void MainWindow::on_distortionValueEditLine_editingFinished()
@@ -282,10 +439,7 @@ void MainWindow::on_lowBandSlider_valueChanged(int value)
                 QString::number(oldLowBandFreq) + " Hz",
                 QString::number(m_lowBandFreq)  + " Hz");
 
-    emit filterParametersChanged(m_filterIndex,
-                                 static_cast<float>(m_lowBandFreq),
-                                 static_cast<float>(m_highBandFreq),
-                                 m_audioThread->getSampleRate());
+    emit filterParametersChanged();
 }
 
 void MainWindow::on_highBandSlider_valueChanged(int value)
@@ -299,10 +453,7 @@ void MainWindow::on_highBandSlider_valueChanged(int value)
                 QString::number(oldHighBandFreq) + " Hz",
                 QString::number(m_highBandFreq)  + " Hz");
 
-    emit filterParametersChanged(m_filterIndex,
-                                 static_cast<float>(m_lowBandFreq),
-                                 static_cast<float>(m_highBandFreq),
-                                 m_audioThread->getSampleRate());
+    emit filterParametersChanged();
 }
 
 void MainWindow::on_lowBandValueEditLine_editingFinished()
@@ -353,10 +504,15 @@ void MainWindow::on_bandFilterComboBox_currentIndexChanged(int index)
                 QString::number(oldFilterIndex),
                 QString::number(index));
 
-    emit filterParametersChanged(m_filterIndex,
-                                 static_cast<float>(m_lowBandFreq),
-                                 static_cast<float>(m_highBandFreq),
-                                 m_audioThread->getSampleRate());
+    emit filterParametersChanged();
+}
+
+void MainWindow::updateBandMarkers()
+{
+    m_spectrumWidget->setBandMarkers(m_filterIndex,
+                                     static_cast<float>(m_lowBandFreq),
+                                     static_cast<float>(m_highBandFreq),
+                                     m_audioThread->getSampleRate());
 }
 
 //------------------------------------------------------------
@@ -368,10 +524,13 @@ void MainWindow::on_playback_CheckBox_toggled(bool checked)
         if (checked) {
             m_audioThread->resume();
             m_levelMeter->show();
+            m_meterClock.restart();
+            m_meterTimer->start();
             qCDebug(audioCategory) << "[UI] Playback Checkbox checked: Playback enabled.";
         } else {
             m_audioThread->pause();
             m_levelMeter->hide();
+            m_meterTimer->stop();
             qCDebug(audioCategory) << "[UI] Playback Checkbox unchecked: Playback paused.";
         }
     } else {
@@ -382,13 +541,218 @@ void MainWindow::on_playback_CheckBox_toggled(bool checked)
 //------------------------------------------------------------
 // 8. Level Meter
 //------------------------------------------------------------
-void MainWindow::handleLevelChanged(float level)
+void MainWindow::pollLevelMeter()
+{
+    if (!m_audioThread)
+        return;
+
+    MeterReading reading;
+    if (m_audioThread->readMeter(reading)) {
+        m_levelMeter->feedLevels(reading.maxRms(),
+                                 reading.maxPeak(),
+                                 reading.maxTruePeak());
+    }
+
+    float elapsed = m_meterClock.restart() / 1000.0f;
+    m_levelMeter->advance(elapsed);
+}
+
+void MainWindow::pollBeatTracker()
+{
+    if (!m_beatTracker)
+        return;
+
+    // Only touch the label when the displayed value changes
+    float bpm = qRound(m_beatTracker->bpm() * 10.0f) / 10.0f;
+    if (bpm == m_shownBpm)
+        return;
+    m_shownBpm = bpm;
+    m_bpmLabel->setText(bpm > 0.0f ? QString("BPM: %1").arg(bpm, 0, 'f', 1)
+                                   : QString("BPM: --"));
+}
+
+//------------------------------------------------------------
+// 9. Convolution
+//------------------------------------------------------------
+void MainWindow::loadImpulseResponse()
+{
+    if (!m_audioThread)
+        return;
+
+    QString path = QFileDialog::getOpenFileName(this, "Load impulse response",
+                                                QString(), "WAV files (*.wav)");
+    if (path.isEmpty())
+        return;
+
+    QString error;
+    if (!m_audioThread->loadImpulseResponse(path, &error)) {
+        QMessageBox::warning(this, "Impulse response",
+                             QString("Could not load %1:\n%2").arg(path, error));
+        return;
+    }
+    m_clearIrButton->setEnabled(true);
+    logUIChange("Impulse response", "", path);
+}
+
+void MainWindow::clearImpulseResponse()
+{
+    if (!m_audioThread)
+        return;
+    m_audioThread->clearImpulseResponse();
+    m_clearIrButton->setEnabled(false);
+    logUIChange("Impulse response", "loaded", "none");
+}
+
+//------------------------------------------------------------
+// 10. Harmonizer and pitch engine
+//------------------------------------------------------------
+void MainWindow::setHarmonyEnabled(bool enabled)
+{
+    if (!m_audioThread)
+        return;
+
+    if (enabled) {
+        // Major third left, fifth right, both a little under the dry voice
+        m_audioThread->setHarmonyDryGain(0.8f);
+        m_audioThread->setHarmonyVoice(0, 4.0f, 0.6f, -0.5f);
+        m_audioThread->setHarmonyVoice(1, 7.0f, 0.6f, 0.5f);
+    } else {
+        m_audioThread->clearHarmonyVoices();
+    }
+    logUIChange("Harmony", enabled ? "off" : "on", enabled ? "on" : "off");
+}
+
+void MainWindow::setPitchEngine(int index)
+{
+    if (!m_audioThread || index < 0)
+        return;
+    m_audioThread->setPitchEngine(static_cast<PitchEngineType>(index));
+    qCDebug(audioCategory) << "[UI] Pitch engine set to:" << m_pitchEngineComboBox->currentText();
+}
+
+//------------------------------------------------------------
+// 11. Recording
+//------------------------------------------------------------
+void MainWindow::setRecording(bool enabled)
+{
+    if (!m_audioThread)
+        return;
+
+    if (!enabled) {
+        m_audioThread->stopRecording();
+        m_recordButton->setText("Record...");
+        logUIChange("Recording", "on", "off");
+        return;
+    }
+
+    QString path = QFileDialog::getSaveFileName(this, "Record to",
+                                                "recording.wav", "WAV files (*.wav)");
+    if (path.isEmpty()) {
+        m_recordButton->setChecked(false);
+        return;
+    }
+    if (!path.endsWith(".wav", Qt::CaseInsensitive))
+        path += ".wav";
+    QString dryPath = path;
+    dryPath.chop(4);
+    dryPath += "-dry.wav";
+
+    QString error;
+    if (!m_audioThread->startRecording(dryPath, path, &error)) {
+        m_recordButton->setChecked(false);
+        QMessageBox::warning(this, "Recording",
+                             QString("Could not record to %1:\n%2").arg(path, error));
+        return;
+    }
+    m_recordButton->setText("Stop");
+    logUIChange("Recording", "off", path);
+}
+
+//------------------------------------------------------------
+// 12. Input file position
+//------------------------------------------------------------
+void MainWindow::pollInputPosition()
+{
+    if (!m_audioThread)
+        return;
+
+    const double progress = m_audioThread->inputFileProgress();
+    if (progress < 0.0)
+        return;
+    if (!m_inputPositionSlider->isVisible())
+        m_inputPositionSlider->show();
+    // Leave the handle alone while the user drags it
+    if (!m_inputPositionSlider->isSliderDown())
+        m_inputPositionSlider->setValue(qRound(progress * kInputPositionSteps));
+}
+
+void MainWindow::seekInputFile(int position)
+{
+    if (!m_audioThread)
+        return;
+    m_audioThread->seekInputFile(static_cast<double>(position) / kInputPositionSteps);
+}
+
+//------------------------------------------------------------
+// 13. Retrospective capture
+//------------------------------------------------------------
+void MainWindow::saveCapture()
+{
+    if (!m_audioThread || m_captureSaving)
+        return;
+
+    QString path = QFileDialog::getSaveFileName(this, "Save the last minutes",
+                                                "capture.wav", "WAV files (*.wav)");
+    if (path.isEmpty())
+        return;
+    if (!path.endsWith(".wav", Qt::CaseInsensitive))
+        path += ".wav";
+    QString dryPath = path;
+    dryPath.chop(4);
+    dryPath += "-dry.wav";
+
+    QString error;
+    if (!m_audioThread->saveCapture(dryPath, path, &error)) {
+        QMessageBox::warning(this, "Save last",
+                             QString("Could not save to %1:\n%2").arg(path, error));
+        return;
+    }
+    m_captureSaving = true;
+    m_saveCaptureButton->setEnabled(false);
+    m_saveCaptureButton->setText("Saving...");
+    logUIChange("Capture", "", path);
+}
+
+void MainWindow::pollCaptureSave()
+{
+    if (!m_captureSaving || m_audioThread->isSavingCapture())
+        return;
+
+    m_captureSaving = false;
+    m_saveCaptureButton->setEnabled(true);
+    m_saveCaptureButton->setText("Save last...");
+    QString error;
+    if (!m_audioThread->captureSaveResult(&error))
+        QMessageBox::warning(this, "Save last", error);
+}
+
+void MainWindow::pollPitchEngine()
 {
-    m_levelMeter->setLevel(level);
+    const PitchEngineEvents events = m_audioThread->pitchEngineEvents();
+    if (events.invalidBlocks > m_pitchEvents.invalidBlocks)
+        qCWarning(audioCategory) << "Pitch engine skipped"
+                                 << events.invalidBlocks - m_pitchEvents.invalidBlocks << "invalid blocks";
+    if (events.backlogResets > m_pitchEvents.backlogResets)
+        qCWarning(audioCategory) << "Pitch engine backlog overflowed"
+                                 << events.backlogResets - m_pitchEvents.backlogResets << "times; buffered audio dropped";
+    if (events.failedBlocks > m_pitchEvents.failedBlocks)
+        qCWarning(audioCategory) << "Pitch engine failed on"
+                                 << events.failedBlocks - m_pitchEvents.failedBlocks << "blocks";
+    m_pitchEvents = events;
 }
 
 //------------------------------------------------------------
-// 9. Utility / Logging
+// 14. Utility / Logging
 //------------------------------------------------------------
 void MainWindow::logUIChange(const QString &elementName,
                              const QString &oldValue,
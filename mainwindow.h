@@ -2,16 +2,46 @@
 
 #include <QMainWindow>
 #include <QLoggingCategory>
+#include <QElapsedTimer>
+
+#include "pitchengine.h"
 
 Q_DECLARE_LOGGING_CATEGORY(audioCategory)
 
 class AudioThread;
+struct EqBand;
 class LevelMeter;
+class SpectrumAnalyzer;
+class SpectrumWidget;
+class BeatTracker;
+class QTimer;
+class QPushButton;
+class QLabel;
+class QCheckBox;
+class QComboBox;
+class QSlider;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
+/**
+ * @brief Start-up settings of the audio thread, usually from the command
+ * line. Each field is handed to the AudioThread setter named beside it.
+ */
+struct AudioOptions
+{
+    int processingRate = 0;         ///< Effect-chain rate in Hz, 0 for the sink rate (setProcessingRate())
+    QString inputFile;              ///< WAV file to play instead of the microphone (setInputFile())
+    bool loopInput = true;
+    int captureMinutes = 0;         ///< Input/output kept for "Save last", 0 for off (setCapture())
+    bool captureFloat = false;
+    QString sharedOutput;           ///< Shared-memory name for the output, empty for none (setSharedOutput())
+    QString netSendHost;            ///< Receiver to stream the output to over UDP (setNetworkOutput())
+    int netSendPort = 0;            ///< 0 for none
+    int netReceivePort = 0;         ///< UDP port whose stream replaces the microphone, 0 for none (setNetworkInput())
+};
+
 /**
  * @brief The MainWindow class manages the user interface and interacts with the AudioThread.
  */
@@ -20,7 +50,7 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget *parent = nullptr);
+    explicit MainWindow(QWidget *parent = nullptr, const AudioOptions& options = AudioOptions());
 
     // Audio parameters
     float m_distortionGain;   ///< Current distortion gain.
@@ -29,22 +59,17 @@ public:
     int m_highBandFreq;       ///< Current high band frequency.
     int m_filterIndex;        ///< Current filter index.
 
-    /**
-     * @brief Returns the user-selected noise gate threshold in dB
-     */
-    int getNoiseGate();
+    /// Sets parametric EQ band @p index (see AudioThread::setEqBand()).
+    bool setEqBand(int index, const EqBand& band);
 
     ~MainWindow();
 
 signals:
     /**
-     * @brief Emitted when filter parameters change.
-     * @param filterIdx Index indicating the type of filter.
-     * @param lowFreq Lower frequency bound for band filters.
-     * @param highFreq Upper frequency bound for band filters.
-     * @param sampleRate Sample rate of the audio in Hz.
+     * @brief Emitted when the band filter type or its edges change. The audio
+     * thread picks the new values up on its own every block.
      */
-    void filterParametersChanged(int filterIdx, float lowFreq, float highFreq, int sampleRate);
+    void filterParametersChanged();
 
 private slots:
     void on_noiseGateSlider_valueChanged(int value);
@@ -61,10 +86,41 @@ private slots:
     void on_lowBandValueEditLine_editingFinished();
     void on_highBandValueEditLine_editingFinished();
 
+    /// Moves the spectrum's band markers to the current filter settings.
+    void updateBandMarkers();
+
     /**
-     * @brief Called whenever the AudioThread emits a new audio level.
+     * @brief Polls the AudioThread's meter ring at display refresh rate
+     * and advances the LevelMeter ballistics.
      */
-    void handleLevelChanged(float level);
+    void pollLevelMeter();
+
+    /// Shows the latest tempo estimate of the BeatTracker.
+    void pollBeatTracker();
+
+    /// Asks for a WAV impulse response and hands it to the convolution stage.
+    void loadImpulseResponse();
+    void clearImpulseResponse();
+
+    /// Switches the harmonizer between off and a three-part major chord.
+    void setHarmonyEnabled(bool enabled);
+
+    /// Hands the selected pitch-shift engine to the audio thread.
+    void setPitchEngine(int index);
+
+    /// Starts (asking for a file name) or stops recording the input and output.
+    void setRecording(bool enabled);
+
+    /// Follows the input file's play position on the slider / seeks from it.
+    void pollInputPosition();
+    void seekInputFile(int position);
+
+    /// Saves the capture window in the background; the poll re-arms the button when done.
+    void saveCapture();
+    void pollCaptureSave();
+
+    /// Logs the pitch engine events the audio thread counted since the last poll.
+    void pollPitchEngine();
 
 private:
     /**
@@ -87,5 +143,21 @@ private:
     Ui::MainWindow *ui;          ///< Pointer to the UI elements.
     AudioThread* m_audioThread;  ///< Pointer to the AudioThread.
     LevelMeter* m_levelMeter;    ///< Pointer to the LevelMeter widget.
+    QTimer* m_meterTimer;        ///< Drives pollLevelMeter() at display rate.
+    QElapsedTimer m_meterClock;  ///< Time since the previous meter poll.
+    SpectrumAnalyzer* m_spectrumAnalyzer; ///< Background FFT worker.
+    SpectrumWidget* m_spectrumWidget;     ///< Spectrum/spectrogram view.
+    QPushButton* m_loadIrButton;          ///< Opens an impulse response for the convolver.
+    QPushButton* m_clearIrButton;
+    BeatTracker* m_beatTracker;           ///< Background tempo/beat detection.
+    QLabel* m_bpmLabel;
+    float m_shownBpm;                     ///< Value currently on m_bpmLabel.
+    QCheckBox* m_harmonyCheckBox;         ///< Enables the harmonizer voices.
+    QComboBox* m_pitchEngineComboBox;     ///< Pitch-shift engine, in PitchEngineType order.
+    QPushButton* m_recordButton;          ///< Checked while recording.
+    QSlider* m_inputPositionSlider;       ///< Play position of the input file.
+    QPushButton* m_saveCaptureButton;     ///< Saves the last minutes of input and output.
+    bool m_captureSaving;                 ///< A capture save is running.
+    PitchEngineEvents m_pitchEvents;      ///< Pitch engine events already logged.
 };
 
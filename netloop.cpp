@@ -0,0 +1,114 @@
+// netloop.cpp
+//
+// Loopback test of the UDP streaming (--net-send / --net-receive): sends a
+// sine from a NetSender to a NetReceiver over localhost, with optional
+// packet loss, jitter and a clock offset between the two ends, reads it back
+// at real-time pace and prints the receiver statistics once per second.
+
+#include "netstream.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption portOption("port", "UDP port on localhost.", "port", "47000");
+    QCommandLineOption lossOption("loss", "Packets dropped at random, in percent.", "percent", "0");
+    QCommandLineOption jitterOption("jitter", "Random extra delay per packet, up to this many ms.", "ms", "0");
+    QCommandLineOption driftOption("drift-ppm", "Receiver clock running this much faster than the sender's.", "ppm", "0");
+    QCommandLineOption secondsOption("seconds", "Test length.", "seconds", "10");
+    QCommandLineOption packetOption("packet-ms", "Audio per packet.", "ms", "5");
+    QCommandLineOption rateOption("rate", "Sample rate at both ends.", "Hz", "48000");
+    QCommandLineOption channelsOption("channels", "Channels at both ends.", "count", "1");
+    parser.addOption(portOption);
+    parser.addOption(lossOption);
+    parser.addOption(jitterOption);
+    parser.addOption(driftOption);
+    parser.addOption(secondsOption);
+    parser.addOption(packetOption);
+    parser.addOption(rateOption);
+    parser.addOption(channelsOption);
+    parser.process(app);
+
+    const int port = parser.value(portOption).toInt();
+    const int rate = std::max(parser.value(rateOption).toInt(), 8000);
+    const int channels = std::clamp(parser.value(channelsOption).toInt(), 1, 8);
+    const double driftPpm = parser.value(driftOption).toDouble();
+    const int seconds = std::max(parser.value(secondsOption).toInt(), 1);
+
+    NetReceiver receiver;
+    NetSender sender;
+    QString error;
+    if (!receiver.open(port, channels, rate, &error)
+        || !sender.open(QStringLiteral("127.0.0.1"), port, channels, rate, parser.value(packetOption).toDouble(), &error)) {
+        std::fprintf(stderr, "%s\n", error.toLocal8Bit().constData());
+        return 1;
+    }
+    sender.setImpairment(parser.value(lossOption).toDouble(), parser.value(jitterOption).toDouble());
+
+    // Both ends move 10 ms blocks; the receiver's clock runs driftPpm fast
+    using Clock = std::chrono::steady_clock;
+    const int blockFrames = rate / 100;
+    const auto sendPeriod = std::chrono::nanoseconds(10000000);
+    const auto readPeriod = std::chrono::nanoseconds(static_cast<qint64>(10000000.0 / (1.0 + driftPpm * 1e-6)));
+    std::vector<float> block(static_cast<size_t>(blockFrames) * channels);
+    std::vector<float> played(static_cast<size_t>(blockFrames) * channels);
+
+    const auto start = Clock::now();
+    const auto end = start + std::chrono::seconds(seconds);
+    auto nextSend = start;
+    auto nextRead = start;
+    auto nextReport = start + std::chrono::seconds(1);
+    double phase = 0.0;
+    const double step = 2.0 * M_PI * 440.0 / rate;
+
+    std::printf("   s  received   lost  late  underruns  jitter ms  buffer ms  target ms  transit ms  end-to-end ms   drift ppm\n");
+    while (Clock::now() < end) {
+        const auto now = Clock::now();
+        if (now >= nextSend) {
+            for (int f = 0; f < blockFrames; ++f) {
+                const float sample = 0.5f * static_cast<float>(std::sin(phase));
+                phase += step;
+                for (int ch = 0; ch < channels; ++ch)
+                    block[static_cast<size_t>(f) * channels + ch] = sample;
+            }
+            phase = std::fmod(phase, 2.0 * M_PI);
+            sender.write(block.data(), blockFrames);
+            nextSend += sendPeriod;
+        }
+        if (now >= nextRead) {
+            receiver.read(played.data(), blockFrames);
+            nextRead += readPeriod;
+        }
+        if (now >= nextReport) {
+            const NetReceiverStats stats = receiver.stats();
+            std::printf("%4lld  %8lld  %5lld  %4lld  %9lld  %9.2f  %9.2f  %9.2f  %10.2f  %13.2f  %10.0f\n",
+                        static_cast<long long>(std::chrono::duration_cast<std::chrono::seconds>(now - start).count()),
+                        static_cast<long long>(stats.packetsReceived), static_cast<long long>(stats.packetsLost),
+                        static_cast<long long>(stats.packetsLate), static_cast<long long>(stats.underruns),
+                        stats.jitterMs, stats.bufferMs, stats.targetMs, stats.transitMs, stats.endToEndMs(),
+                        (stats.driftRatio - 1.0) * 1e6);
+            std::fflush(stdout);
+            nextReport += std::chrono::seconds(1);
+        }
+        std::this_thread::sleep_until(std::min(nextSend, nextRead));
+    }
+
+    const NetSenderStats sent = sender.stats();
+    const NetReceiverStats received = receiver.stats();
+    std::printf("sent %lld, impaired %lld, dropped %lld; concealed %lld frames (%.2f %%)\n",
+                static_cast<long long>(sent.packetsSent), static_cast<long long>(sent.packetsImpaired),
+                static_cast<long long>(sent.packetsDropped), static_cast<long long>(received.concealedFrames),
+                100.0 * received.concealedFrames / (static_cast<double>(rate) * seconds));
+    return 0;
+}
@@ -0,0 +1,926 @@
+// netstream.cpp
+
+#include "netstream.h"
+#include "realtime.h"
+
+#include <QLoggingCategory>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+
+namespace {
+// Datagrams per sendmmsg() / recvmmsg() call
+const int kBatch = 32;
+
+// Packets the sender may hold back for the jitter impairment
+const int kMaxHeld = 256;
+
+// Largest block read() produces in one pass; bigger requests are split
+const int kMaxReadFrames = 4096;
+
+// Concealment: packets until the repetition has faded to silence, and
+// the crossfade back into real audio after it
+const int kConcealPackets = 4;
+const int kCrossfadeFrames = 48;
+
+// Buffer target bounds in packets
+const int kMinTargetPackets = 2;
+const int kMaxTargetPackets = 48;
+
+// Transit minimum is tracked over two windows of this length
+const qint64 kTransitWindowNs = 2000000000LL;
+
+// Per-packet decay of the transit peak (~5 s at 200 packets/s)
+const double kPeakDecay = 1.0 / 1024.0;
+
+// Sequence numbers this far off in a row mean the sender restarted
+const int kStrayPacketsForRestart = 8;
+
+qint64 monotonicNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Wrap-safe distance a - b between sequence numbers
+inline qint32 seqDiff(quint32 a, quint32 b)
+{
+    return static_cast<qint32>(a - b);
+}
+
+void writeLe16(char* p, quint16 v)
+{
+    p[0] = static_cast<char>(v & 0xFF);
+    p[1] = static_cast<char>(v >> 8);
+}
+
+void writeLe32(char* p, quint32 v)
+{
+    writeLe16(p, static_cast<quint16>(v & 0xFFFF));
+    writeLe16(p + 2, static_cast<quint16>(v >> 16));
+}
+
+void writeLe64(char* p, quint64 v)
+{
+    writeLe32(p, static_cast<quint32>(v & 0xFFFFFFFFu));
+    writeLe32(p + 4, static_cast<quint32>(v >> 32));
+}
+
+quint16 readLe16(const uchar* p) { return static_cast<quint16>(p[0] | (p[1] << 8)); }
+quint32 readLe32(const uchar* p)
+{
+    return static_cast<quint32>(p[0]) | (static_cast<quint32>(p[1]) << 8)
+         | (static_cast<quint32>(p[2]) << 16) | (static_cast<quint32>(p[3]) << 24);
+}
+quint64 readLe64(const uchar* p)
+{
+    return static_cast<quint64>(readLe32(p)) | (static_cast<quint64>(readLe32(p + 4)) << 32);
+}
+
+void encodeHeader(char* p, const NetPacketHeader& header)
+{
+    writeLe16(p, header.magic);
+    p[2] = static_cast<char>(header.version);
+    p[3] = static_cast<char>(header.channels);
+    writeLe32(p + 4, header.seq);
+    writeLe32(p + 8, header.timestamp);
+    writeLe32(p + 12, header.sampleRate);
+    writeLe64(p + 16, static_cast<quint64>(header.sendNs));
+}
+
+bool decodeHeader(const uchar* p, int bytes, NetPacketHeader* header)
+{
+    if (bytes < NetPacketHeader::kBytes)
+        return false;
+    header->magic      = readLe16(p);
+    header->version    = p[2];
+    header->channels   = p[3];
+    header->seq        = readLe32(p + 4);
+    header->timestamp  = readLe32(p + 8);
+    header->sampleRate = readLe32(p + 12);
+    header->sendNs     = static_cast<qint64>(readLe64(p + 16));
+    return header->magic == NetPacketHeader::kMagic && header->version == NetPacketHeader::kVersion
+        && header->channels > 0 && header->sampleRate > 0;
+}
+
+inline qint16 toInt16(float sample)
+{
+    return static_cast<qint16>(std::lrint(std::clamp(sample, -1.0f, 1.0f) * 32767.0f));
+}
+
+bool fail(QString* error, const QString& message)
+{
+    if (error)
+        *error = message;
+    return false;
+}
+}
+
+// ----------------------------------------------------------
+// 1. Network threads
+// ----------------------------------------------------------
+
+/// Sends the packets queued by the audio thread.
+class NetSenderThread : public QThread
+{
+public:
+    explicit NetSenderThread(NetSender* owner) : m_owner(owner) {}
+
+protected:
+    void run() override { m_owner->senderLoop(); }
+
+private:
+    NetSender* m_owner;
+};
+
+/// Drains the socket into the jitter buffer.
+class NetReceiverThread : public QThread
+{
+public:
+    explicit NetReceiverThread(NetReceiver* owner) : m_owner(owner) {}
+
+protected:
+    void run() override { m_owner->receiverLoop(); }
+
+private:
+    NetReceiver* m_owner;
+};
+
+// ----------------------------------------------------------
+// 2. Sender
+// ----------------------------------------------------------
+
+NetSender::NetSender()
+    : m_fd(-1)
+    , m_channels(0)
+    , m_sampleRate(0)
+    , m_packetFrames(0)
+    , m_buildFrames(0)
+    , m_seq(0)
+    , m_timestamp(0)
+    , m_running(false)
+    , m_lossPpm(0)
+    , m_jitterUs(0)
+    , m_sent(0)
+    , m_dropped(0)
+    , m_impaired(0)
+{
+}
+
+NetSender::~NetSender()
+{
+    close();
+}
+
+bool NetSender::open(const QString& host, int port, int channels, int sampleRate, double packetMs,
+                     QString* error)
+{
+    close();
+    if (channels <= 0 || channels > 255 || sampleRate <= 0)
+        return fail(error, QStringLiteral("Invalid channel count or sample rate"));
+    if (port <= 0 || port > 65535)
+        return fail(error, QStringLiteral("Invalid port %1").arg(port));
+
+#if defined(__linux__)
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* address = nullptr;
+    const int resolved = getaddrinfo(host.toLocal8Bit().constData(),
+                                     QByteArray::number(port).constData(), &hints, &address);
+    if (resolved != 0 || !address)
+        return fail(error, QStringLiteral("Cannot resolve %1: %2").arg(host, QString::fromLocal8Bit(gai_strerror(resolved))));
+
+    const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+        const QString message = QString::fromLocal8Bit(strerror(errno));
+        freeaddrinfo(address);
+        if (fd >= 0)
+            ::close(fd);
+        return fail(error, QStringLiteral("Cannot open UDP socket to %1:%2: %3").arg(host).arg(port).arg(message));
+    }
+    freeaddrinfo(address);
+
+    // Expedited forwarding, for networks that honour DSCP; and room for a
+    // burst of packets if the sender thread is late
+    const int tos = IPTOS_DSCP_EF;
+    setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+    const int sendBuffer = 256 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+
+    m_fd           = fd;
+    m_channels     = channels;
+    m_sampleRate   = sampleRate;
+    m_packetFrames = std::clamp(static_cast<int>(std::lround(packetMs * sampleRate / 1000.0)),
+                                1, kNetMaxPacketSamples / channels);
+    m_buildFrames  = 0;
+    m_seq          = 0;
+    m_timestamp    = 0;
+    m_queue.reset(new SpscRing<Packet, 128>());
+
+    m_running = true;
+    m_thread.reset(new NetSenderThread(this));
+    m_thread->start(QThread::HighPriority);
+
+    qCDebug(audioCategory) << "Network output to" << host << "port" << port << "-"
+                           << m_packetFrames << "frames per packet";
+    return true;
+#else
+    Q_UNUSED(host);
+    Q_UNUSED(packetMs);
+    return fail(error, QStringLiteral("UDP streaming is only available on Linux"));
+#endif
+}
+
+void NetSender::close()
+{
+    if (m_thread) {
+        m_running = false;
+        m_wake.release();
+        m_thread->wait();
+        m_thread.reset();
+    }
+#if defined(__linux__)
+    if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+    m_fd = -1;
+    m_queue.reset();
+}
+
+void NetSender::setImpairment(double lossPercent, double jitterMs)
+{
+    m_lossPpm.store(static_cast<int>(std::clamp(lossPercent, 0.0, 100.0) * 10000.0), std::memory_order_relaxed);
+    m_jitterUs.store(static_cast<int>(std::clamp(jitterMs, 0.0, 1000.0) * 1000.0), std::memory_order_relaxed);
+}
+
+NetSenderStats NetSender::stats() const
+{
+    NetSenderStats stats;
+    stats.packetsSent     = m_sent.load(std::memory_order_relaxed);
+    stats.packetsDropped  = m_dropped.load(std::memory_order_relaxed);
+    stats.packetsImpaired = m_impaired.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void NetSender::write(const float* samples, int frames)
+{
+    if (m_fd < 0 || !samples)
+        return;
+
+    char* payload = m_building.data + NetPacketHeader::kBytes;
+    while (frames > 0) {
+        const int count = std::min(frames, m_packetFrames - m_buildFrames);
+        char* out = payload + static_cast<size_t>(m_buildFrames) * m_channels * 2;
+        for (int i = 0; i < count * m_channels; ++i)
+            writeLe16(out + 2 * i, static_cast<quint16>(toInt16(samples[i])));
+        samples += static_cast<size_t>(count) * m_channels;
+        frames -= count;
+        m_buildFrames += count;
+        if (m_buildFrames == m_packetFrames)
+            finishPacket();
+    }
+}
+
+void NetSender::finishPacket()
+{
+    NetPacketHeader header;
+    header.magic      = NetPacketHeader::kMagic;
+    header.version    = NetPacketHeader::kVersion;
+    header.channels   = static_cast<quint8>(m_channels);
+    header.seq        = m_seq++;
+    header.timestamp  = m_timestamp;
+    header.sampleRate = static_cast<quint32>(m_sampleRate);
+    header.sendNs     = monotonicNs();
+    encodeHeader(m_building.data, header);
+    m_building.bytes = NetPacketHeader::kBytes + m_packetFrames * m_channels * 2;
+
+    // A full queue costs this packet, not the audio thread's time; the
+    // receiver sees the gap in seq and conceals it
+    if (!m_queue->push(m_building))
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    m_timestamp += static_cast<quint32>(m_packetFrames);
+    m_buildFrames = 0;
+    m_wake.release();
+}
+
+void NetSender::senderLoop()
+{
+#if defined(__linux__)
+    Realtime::promoteServiceThread("NetSender");
+
+    std::vector<Packet> batch(kBatch);
+    std::vector<Packet> held;
+    held.reserve(kMaxHeld);
+    mmsghdr messages[kBatch];
+    iovec vectors[kBatch];
+    std::minstd_rand random(static_cast<unsigned>(monotonicNs()));
+
+    int count = 0;
+    auto flush = [&]() {
+        if (count == 0)
+            return;
+        std::memset(messages, 0, sizeof(mmsghdr) * count);
+        for (int i = 0; i < count; ++i) {
+            vectors[i].iov_base = batch[i].data;
+            vectors[i].iov_len  = static_cast<size_t>(batch[i].bytes);
+            messages[i].msg_hdr.msg_iov    = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        // Non-blocking: what the socket buffer cannot take is lost, not late
+        const int sent = sendmmsg(m_fd, messages, static_cast<unsigned>(count), 0);
+        const int ok = std::max(sent, 0);
+        m_sent.fetch_add(ok, std::memory_order_relaxed);
+        m_dropped.fetch_add(count - ok, std::memory_order_relaxed);
+        count = 0;
+    };
+
+    while (m_running.load(std::memory_order_acquire)) {
+        // Sleep until the audio thread finishes a packet, or a held one is due
+        m_wake.tryAcquire(1, held.empty() ? 20 : 1);
+        const int pending = m_wake.available();
+        if (pending > 0)
+            m_wake.tryAcquire(pending);
+
+        const int lossPpm = m_lossPpm.load(std::memory_order_relaxed);
+        const int jitterUs = m_jitterUs.load(std::memory_order_relaxed);
+        const qint64 now = monotonicNs();
+
+        while (const Packet* packet = m_queue->beginRead()) {
+            if (lossPpm > 0 && static_cast<int>(random() % 1000000) < lossPpm) {
+                m_impaired.fetch_add(1, std::memory_order_relaxed);
+            } else if (jitterUs > 0 && held.size() < static_cast<size_t>(kMaxHeld)) {
+                held.push_back(*packet);
+                held.back().dueNs = now + static_cast<qint64>(random() % static_cast<unsigned>(jitterUs)) * 1000;
+            } else {
+                batch[count++] = *packet;
+                if (count == kBatch)
+                    flush();
+            }
+            m_queue->commitRead();
+        }
+
+        for (size_t i = 0; i < held.size();) {
+            if (held[i].dueNs <= now) {
+                batch[count++] = held[i];
+                held[i] = held.back();
+                held.pop_back();
+                if (count == kBatch)
+                    flush();
+            } else {
+                ++i;
+            }
+        }
+        flush();
+    }
+#endif
+}
+
+// ----------------------------------------------------------
+// 3. Receiver: socket and jitter buffer
+// ----------------------------------------------------------
+
+NetReceiver::NetReceiver()
+    : m_fd(-1)
+    , m_channels(0)
+    , m_sampleRate(0)
+    , m_running(false)
+    , m_firstSeq(0)
+    , m_highestSeq(0)
+    , m_generation(0)
+    , m_targetPackets(kMinTargetPackets)
+    , m_packetNs(0)
+    , m_lastTransitNs(0)
+    , m_jitterNsAcc(0.0)
+    , m_minTransitNs{0, 0}
+    , m_windowStartNs(0)
+    , m_peakDelayNs(0.0)
+    , m_strayPackets(0)
+    , m_playing(false)
+    , m_playGeneration(0)
+    , m_remoteChannels(0)
+    , m_remoteRate(0)
+    , m_packetFrames(0)
+    , m_playSeq(0)
+    , m_playSeqValid(false)
+    , m_lossRun(0)
+    , m_concealGain(0.0f)
+    , m_fifoFrames(0)
+    , m_lastTarget(0)
+    , m_received(0)
+    , m_lost(0)
+    , m_late(0)
+    , m_invalid(0)
+    , m_underruns(0)
+    , m_concealedFrames(0)
+    , m_jitterNs(0)
+    , m_transitNs(0)
+    , m_bufferedUs(0)
+    , m_ratio(1.0)
+{
+}
+
+NetReceiver::~NetReceiver()
+{
+    close();
+}
+
+bool NetReceiver::open(int port, int channels, int sampleRate, QString* error)
+{
+    close();
+    if (channels <= 0 || sampleRate <= 0)
+        return fail(error, QStringLiteral("Invalid channel count or sample rate"));
+    if (port <= 0 || port > 65535)
+        return fail(error, QStringLiteral("Invalid port %1").arg(port));
+
+#if defined(__linux__)
+    const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return fail(error, QStringLiteral("Cannot create UDP socket: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+
+    const int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    // Kernel arrival times, so a batch from recvmmsg() keeps its spacing
+    setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+    const int receiveBuffer = 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    // Bounded waits, so close() is noticed
+    timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = 50000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port        = htons(static_cast<quint16>(port));
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const QString message = QString::fromLocal8Bit(strerror(errno));
+        ::close(fd);
+        return fail(error, QStringLiteral("Cannot bind UDP port %1: %2").arg(port).arg(message));
+    }
+
+    m_fd         = fd;
+    m_channels   = channels;
+    m_sampleRate = sampleRate;
+    m_slots.reset(new Slot[kSlots]);
+    m_scratch.assign(static_cast<size_t>(kMaxReadFrames) * channels, 0.0f);
+
+    m_generation    = 0;
+    m_packetNs      = 0;
+    m_targetPackets = kMinTargetPackets;
+    m_strayPackets  = 0;
+    m_playing       = false;
+    m_playGeneration = 0;
+    m_playSeqValid  = false;
+
+    m_running = true;
+    m_thread.reset(new NetReceiverThread(this));
+    m_thread->start(QThread::HighPriority);
+
+    qCDebug(audioCategory) << "Network input on UDP port" << port;
+    return true;
+#else
+    return fail(error, QStringLiteral("UDP streaming is only available on Linux"));
+#endif
+}
+
+void NetReceiver::close()
+{
+    if (m_thread) {
+        m_running = false;
+#if defined(__linux__)
+        shutdown(m_fd, SHUT_RDWR);
+#endif
+        m_thread->wait();
+        m_thread.reset();
+    }
+#if defined(__linux__)
+    if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+    m_fd = -1;
+    m_generation = 0;
+    m_packetNs = 0;
+    m_playGeneration = 0;
+    m_playing = false;
+    m_playSeqValid = false;
+    m_slots.reset();
+}
+
+void NetReceiver::receiverLoop()
+{
+#if defined(__linux__)
+    Realtime::promoteServiceThread("NetReceiver");
+
+    std::vector<char> buffers(static_cast<size_t>(kBatch) * kNetMaxDatagram);
+    std::vector<char> controls(static_cast<size_t>(kBatch) * CMSG_SPACE(sizeof(timespec)));
+    mmsghdr messages[kBatch];
+    iovec vectors[kBatch];
+
+    while (m_running.load(std::memory_order_acquire)) {
+        std::memset(messages, 0, sizeof(messages));
+        for (int i = 0; i < kBatch; ++i) {
+            vectors[i].iov_base = buffers.data() + static_cast<size_t>(i) * kNetMaxDatagram;
+            vectors[i].iov_len  = kNetMaxDatagram;
+            messages[i].msg_hdr.msg_iov        = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen     = 1;
+            messages[i].msg_hdr.msg_control    = controls.data() + static_cast<size_t>(i) * CMSG_SPACE(sizeof(timespec));
+            messages[i].msg_hdr.msg_controllen = CMSG_SPACE(sizeof(timespec));
+        }
+
+        // Blocks for the first datagram only, then takes whatever else is queued
+        const int received = recvmmsg(m_fd, messages, kBatch, MSG_WAITFORONE, nullptr);
+        if (received <= 0)
+            continue;
+
+        // Kernel timestamps are CLOCK_REALTIME; map them onto the monotonic clock
+        const qint64 now = monotonicNs();
+        timespec wall;
+        clock_gettime(CLOCK_REALTIME, &wall);
+        const qint64 wallOffset = static_cast<qint64>(wall.tv_sec) * 1000000000LL + wall.tv_nsec - now;
+
+        for (int i = 0; i < received; ++i) {
+            const msghdr& message = messages[i].msg_hdr;
+            qint64 arrivalNs = now;
+            for (cmsghdr* control = CMSG_FIRSTHDR(&message); control; control = CMSG_NXTHDR(const_cast<msghdr*>(&message), control)) {
+                if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMPNS) {
+                    timespec stamp;
+                    std::memcpy(&stamp, CMSG_DATA(control), sizeof(stamp));
+                    arrivalNs = std::min(now, static_cast<qint64>(stamp.tv_sec) * 1000000000LL + stamp.tv_nsec - wallOffset);
+                }
+            }
+
+            const uchar* data = reinterpret_cast<const uchar*>(vectors[i].iov_base);
+            const int bytes = static_cast<int>(messages[i].msg_len);
+            NetPacketHeader header;
+            if ((message.msg_flags & MSG_TRUNC) || !decodeHeader(data, bytes, &header)) {
+                m_invalid.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            store(header, data + NetPacketHeader::kBytes, bytes - NetPacketHeader::kBytes, arrivalNs);
+        }
+    }
+#endif
+}
+
+bool NetReceiver::latchFormat(const NetPacketHeader& header, int frames)
+{
+    // Everything the audio thread needs is allocated here, into m_stream,
+    // which it has handed back by now; the new generation publishes it
+    Stream& stream = m_stream;
+    if (!stream.drift)
+        stream.drift.reset(new DriftCompensator);
+    if (!stream.drift->init(header.channels, static_cast<int>(header.sampleRate), m_sampleRate, frames))
+        return false;
+
+    stream.channels     = header.channels;
+    stream.rate         = static_cast<int>(header.sampleRate);
+    stream.packetFrames = frames;
+
+    const size_t packetSamples = static_cast<size_t>(frames) * stream.channels;
+    const int maxResampled = stream.drift->maxOutputFrames();
+    stream.packet.assign(packetSamples, 0.0f);
+    stream.lastGood.assign(packetSamples, 0.0f);
+    stream.resampled.assign(static_cast<size_t>(maxResampled) * stream.channels, 0.0f);
+    stream.fifo.assign(static_cast<size_t>(kMaxReadFrames + 2 * maxResampled) * stream.channels, 0.0f);
+
+    m_firstSeq.store(header.seq, std::memory_order_relaxed);
+    m_highestSeq.store(header.seq, std::memory_order_release);
+    m_playSeqValid.store(false, std::memory_order_release);
+    m_packetNs.store(static_cast<qint64>(frames) * 1000000000LL / stream.rate, std::memory_order_relaxed);
+    m_generation.fetch_add(1, std::memory_order_release);
+    qCDebug(audioCategory) << "Network stream:" << stream.channels << "channels at" << stream.rate
+                           << "Hz," << frames << "frames per packet";
+    return true;
+}
+
+void NetReceiver::store(const NetPacketHeader& header, const uchar* payload, int bytes, qint64 arrivalNs)
+{
+    const int frames = bytes / (2 * header.channels);
+    if (frames <= 0 || frames * header.channels * 2 != bytes) {
+        m_invalid.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // A sender that restarts begins a new sequence, possibly in another
+    // format; follow it once it is clearly not noise
+    const int generation = m_generation.load(std::memory_order_relaxed);
+    bool restart = generation == 0;
+    if (!restart) {
+        const qint32 ahead = seqDiff(header.seq, m_highestSeq.load(std::memory_order_relaxed));
+        const bool sameFormat = header.channels == m_stream.channels
+                             && static_cast<int>(header.sampleRate) == m_stream.rate
+                             && frames == m_stream.packetFrames;
+        if (ahead > kSlots || ahead < -kSlots || !sameFormat) {
+            if (++m_strayPackets < kStrayPacketsForRestart) {
+                m_invalid.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            restart = true;
+        }
+    }
+    if (restart) {
+        // Until read() has taken the last stream's buffers, m_stream still
+        // holds the ones it plays from; retry with the next packet
+        if (m_playGeneration.load(std::memory_order_acquire) != generation
+            || !latchFormat(header, frames)) {
+            m_invalid.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        resetEstimates(arrivalNs);
+        if (generation > 0)
+            qCDebug(audioCategory) << "Network stream restarted at packet" << header.seq;
+    }
+    m_strayPackets = 0;
+    m_received.fetch_add(1, std::memory_order_relaxed);
+
+    // Interarrival jitter (RFC 3550, 6.4.1) on the media timestamps
+    const qint64 packetNs = static_cast<qint64>(m_stream.packetFrames) * 1000000000LL / m_stream.rate;
+    const qint64 transit = arrivalNs - static_cast<qint64>(header.timestamp) * 1000000000LL / m_stream.rate;
+    if (m_lastTransitNs != 0) {
+        const double deviation = std::fabs(static_cast<double>(transit - m_lastTransitNs));
+        m_jitterNsAcc += (deviation - m_jitterNsAcc) / 16.0;
+        m_jitterNs.store(static_cast<qint64>(m_jitterNsAcc), std::memory_order_relaxed);
+    }
+    m_lastTransitNs = transit;
+
+    const qint64 latency = arrivalNs - header.sendNs;
+    const qint64 smoothed = m_transitNs.load(std::memory_order_relaxed);
+    m_transitNs.store(smoothed == 0 ? latency : smoothed + (latency - smoothed) / 16, std::memory_order_relaxed);
+
+    // Buffer target: the recent peak of the transit over its minimum, which
+    // covers the delays seen so far, plus a packet for the playout granularity
+    if (arrivalNs - m_windowStartNs > kTransitWindowNs) {
+        m_minTransitNs[1] = m_minTransitNs[0];
+        m_minTransitNs[0] = transit;
+        m_windowStartNs = arrivalNs;
+    } else {
+        m_minTransitNs[0] = std::min(m_minTransitNs[0], transit);
+    }
+    const double delay = static_cast<double>(transit - std::min(m_minTransitNs[0], m_minTransitNs[1]));
+    if (delay > m_peakDelayNs)
+        m_peakDelayNs = delay;
+    else
+        m_peakDelayNs += (delay - m_peakDelayNs) * kPeakDecay;
+    const int target = static_cast<int>(std::ceil(m_peakDelayNs / packetNs)) + 2;
+    m_targetPackets.store(std::clamp(target, kMinTargetPackets, kMaxTargetPackets), std::memory_order_relaxed);
+
+    if (m_playSeqValid.load(std::memory_order_acquire)
+        && seqDiff(header.seq, m_playSeq.load(std::memory_order_acquire)) < 0) {
+        m_late.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Seqlock-style slot update: the tag is cleared while the samples change
+    Slot& slot = m_slots[header.seq % kSlots];
+    slot.tag.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    const int samples = frames * header.channels;
+    for (int i = 0; i < samples; ++i)
+        slot.samples[i] = static_cast<qint16>(readLe16(payload + 2 * i));
+    slot.frames = frames;
+    slot.tag.store(header.seq + 1, std::memory_order_release);
+
+    if (seqDiff(header.seq, m_highestSeq.load(std::memory_order_relaxed)) > 0)
+        m_highestSeq.store(header.seq, std::memory_order_release);
+}
+
+void NetReceiver::resetEstimates(qint64 arrivalNs)
+{
+    m_lastTransitNs = 0;
+    m_minTransitNs[0] = m_minTransitNs[1] = std::numeric_limits<qint64>::max();
+    m_windowStartNs = arrivalNs;
+    m_peakDelayNs = 0.0;
+}
+
+NetReceiverStats NetReceiver::stats() const
+{
+    NetReceiverStats stats;
+    stats.packetsReceived = m_received.load(std::memory_order_relaxed);
+    stats.packetsLost     = m_lost.load(std::memory_order_relaxed);
+    stats.packetsLate     = m_late.load(std::memory_order_relaxed);
+    stats.packetsInvalid  = m_invalid.load(std::memory_order_relaxed);
+    stats.underruns       = m_underruns.load(std::memory_order_relaxed);
+    stats.concealedFrames = m_concealedFrames.load(std::memory_order_relaxed);
+    stats.jitterMs        = m_jitterNs.load(std::memory_order_relaxed) / 1e6;
+    stats.transitMs       = m_transitNs.load(std::memory_order_relaxed) / 1e6;
+    stats.bufferMs        = m_bufferedUs.load(std::memory_order_relaxed) / 1e3;
+    stats.driftRatio      = m_ratio.load(std::memory_order_relaxed);
+    stats.packetMs        = m_packetNs.load(std::memory_order_relaxed) / 1e6;
+    stats.targetMs        = stats.packetMs * m_targetPackets.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// ----------------------------------------------------------
+// 4. Receiver: playout (audio thread)
+// ----------------------------------------------------------
+
+void NetReceiver::read(qint16* samples, int frames)
+{
+    while (frames > 0) {
+        const int count = std::min(frames, kMaxReadFrames);
+        read(m_scratch.data(), count);
+        const int total = count * m_channels;
+        for (int i = 0; i < total; ++i)
+            samples[i] = toInt16(m_scratch[i]);
+        samples += total;
+        frames -= count;
+    }
+}
+
+void NetReceiver::read(float* samples, int frames)
+{
+    const int generation = m_generation.load(std::memory_order_acquire);
+    if (generation == 0) {
+        std::fill(samples, samples + static_cast<size_t>(frames) * m_channels, 0.0f);
+        return;
+    }
+
+    if (generation != m_playGeneration.load(std::memory_order_relaxed)) {
+        // A new stream: swap in the buffers the receiver thread sized for
+        // it (no allocation here), hand ours back and start over once it
+        // has buffered up
+        m_remoteChannels = m_stream.channels;
+        m_remoteRate     = m_stream.rate;
+        m_packetFrames   = m_stream.packetFrames;
+        m_drift.swap(m_stream.drift);
+        m_packet.swap(m_stream.packet);
+        m_lastGood.swap(m_stream.lastGood);
+        m_resampled.swap(m_stream.resampled);
+        m_fifo.swap(m_stream.fifo);
+        m_fifoFrames = 0;
+        m_playing = false;
+        m_playSeqValid.store(false, std::memory_order_release);
+        m_playGeneration.store(generation, std::memory_order_release);
+    }
+
+    while (frames > 0) {
+        const int count = std::min(frames, kMaxReadFrames);
+        while (m_fifoFrames < count && nextPacket()) {
+        }
+        if (m_fifoFrames < count) {
+            // Still filling the buffer
+            std::fill(samples, samples + static_cast<size_t>(count) * m_channels, 0.0f);
+        } else {
+            deliver(samples, count);
+        }
+        samples += static_cast<size_t>(count) * m_channels;
+        frames -= count;
+    }
+
+    const int pending = m_playing ? std::max(seqDiff(m_highestSeq.load(std::memory_order_acquire),
+                                                     m_playSeq.load(std::memory_order_relaxed)) + 1, 0)
+                                  : 0;
+    m_bufferedUs.store(static_cast<qint64>(pending) * m_packetFrames * 1000000LL / m_remoteRate
+                       + static_cast<qint64>(m_fifoFrames) * 1000000LL / m_sampleRate,
+                       std::memory_order_relaxed);
+}
+
+bool NetReceiver::nextPacket()
+{
+    // The buffer is counted in packets at the sender's rate, the drift
+    // controller works in frames at ours
+    const auto outputFrames = [this](int packets) {
+        return static_cast<int>(static_cast<qint64>(packets) * m_packetFrames * m_sampleRate / m_remoteRate);
+    };
+
+    const quint32 highest = m_highestSeq.load(std::memory_order_acquire);
+    const int target = m_targetPackets.load(std::memory_order_relaxed);
+
+    if (!m_playing) {
+        const quint32 first = m_firstSeq.load(std::memory_order_relaxed);
+        if (seqDiff(highest, first) + 1 < target)
+            return false;
+        m_playSeq.store(highest + 1 - target, std::memory_order_relaxed);
+        m_playSeqValid.store(true, std::memory_order_release);
+        m_playing = true;
+        m_lossRun = 0;
+        m_concealGain = 0.0f;
+        std::fill(m_lastGood.begin(), m_lastGood.end(), 0.0f);
+        m_drift->reset();
+        m_drift->setTargetFill(outputFrames(target));
+        m_lastTarget = target;
+    }
+
+    quint32 playSeq = m_playSeq.load(std::memory_order_relaxed);
+    int buffered = seqDiff(highest, playSeq) + 1;
+
+    // Far more than the target (e.g. a burst after a stall): skip ahead
+    // rather than carry the extra delay until the drift correction has
+    // worked it off
+    if (buffered > 2 * target + kMinTargetPackets || buffered > kSlots - kMinTargetPackets) {
+        playSeq = highest + 1 - target;
+        buffered = target;
+        m_playSeq.store(playSeq, std::memory_order_release);
+    }
+    if (target != m_lastTarget) {
+        m_drift->setTargetFill(outputFrames(target));
+        m_lastTarget = target;
+    }
+
+    const int fill = std::max(buffered, 0);
+    if (buffered <= 0) {
+        // Nothing has arrived: conceal in place, which adds a packet of delay
+        m_underruns.fetch_add(1, std::memory_order_relaxed);
+        concealPacket();
+    } else {
+        const Slot& slot = m_slots[playSeq % kSlots];
+        const quint32 tag = slot.tag.load(std::memory_order_acquire);
+        bool valid = tag == playSeq + 1 && slot.frames == m_packetFrames;
+        if (valid) {
+            const int count = m_packetFrames * m_remoteChannels;
+            for (int i = 0; i < count; ++i)
+                m_packet[i] = slot.samples[i] / 32768.0f;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            valid = slot.tag.load(std::memory_order_relaxed) == tag;
+        }
+
+        if (valid) {
+            if (m_lossRun > 0) {
+                // Crossfade out of the concealment, which would have
+                // continued with the start of the repeated packet
+                const int fade = std::min(kCrossfadeFrames, m_packetFrames);
+                for (int f = 0; f < fade; ++f) {
+                    const float w = static_cast<float>(f + 1) / (fade + 1);
+                    for (int ch = 0; ch < m_remoteChannels; ++ch) {
+                        const int i = f * m_remoteChannels + ch;
+                        m_packet[i] = w * m_packet[i] + (1.0f - w) * m_concealGain * m_lastGood[i];
+                    }
+                }
+                m_lossRun = 0;
+            }
+            std::copy(m_packet.begin(), m_packet.end(), m_lastGood.begin());
+            m_concealGain = 1.0f;
+        } else {
+            m_lost.fetch_add(1, std::memory_order_relaxed);
+            concealPacket();
+        }
+        m_playSeq.store(playSeq + 1, std::memory_order_release);
+    }
+
+    // A fuller buffer than the target shrinks each packet, so read() pulls
+    // packets faster than the sender's clock delivers them, and vice versa
+    m_drift->update(outputFrames(fill), m_packetFrames);
+    m_ratio.store(m_drift->ratio(), std::memory_order_relaxed);
+    const int produced = m_drift->process(m_packet.data(), m_packetFrames, m_resampled);
+    const int capacity = static_cast<int>(m_fifo.size()) / m_remoteChannels;
+    const int count = std::min(produced, capacity - m_fifoFrames);
+    std::copy(m_resampled.begin(), m_resampled.begin() + static_cast<size_t>(count) * m_remoteChannels,
+              m_fifo.begin() + static_cast<size_t>(m_fifoFrames) * m_remoteChannels);
+    m_fifoFrames += count;
+    return true;
+}
+
+void NetReceiver::concealPacket()
+{
+    // Repeat the last good packet, fading a step further each time
+    const float from = m_concealGain;
+    const float to = std::max(0.0f, from - 1.0f / kConcealPackets);
+    for (int f = 0; f < m_packetFrames; ++f) {
+        const float gain = from + (to - from) * f / m_packetFrames;
+        for (int ch = 0; ch < m_remoteChannels; ++ch) {
+            const int i = f * m_remoteChannels + ch;
+            m_packet[i] = gain * m_lastGood[i];
+        }
+    }
+    m_concealGain = to;
+    ++m_lossRun;
+    m_concealedFrames.fetch_add(m_packetFrames, std::memory_order_relaxed);
+}
+
+void NetReceiver::deliver(float* samples, int frames)
+{
+    const int lastChannel = m_remoteChannels - 1;
+    for (int f = 0; f < frames; ++f) {
+        const float* in = m_fifo.data() + static_cast<size_t>(f) * m_remoteChannels;
+        float* out = samples + static_cast<size_t>(f) * m_channels;
+        for (int ch = 0; ch < m_channels; ++ch)
+            out[ch] = in[std::min(ch, lastChannel)];
+    }
+    const int remaining = m_fifoFrames - frames;
+    std::copy(m_fifo.begin() + static_cast<size_t>(frames) * m_remoteChannels,
+              m_fifo.begin() + static_cast<size_t>(m_fifoFrames) * m_remoteChannels,
+              m_fifo.begin());
+    m_fifoFrames = remaining;
+}
@@ -0,0 +1,315 @@
+// netstream.h
+#ifndef NETSTREAM_H
+#define NETSTREAM_H
+
+#include "driftcompensator.h"
+#include "spscring.h"
+
+#include <QSemaphore>
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class NetSenderThread;
+class NetReceiverThread;
+
+// ----------------------------------------------------------
+// Wire format
+// ----------------------------------------------------------
+
+/**
+ * @brief Header of every datagram; all fields little-endian, followed by
+ * frames * channels interleaved int16 samples (L16, also little-endian).
+ *
+ * Compact RTP-like framing: seq counts datagrams (loss and reordering),
+ * timestamp counts frames at sampleRate (jitter), sendNs is the sender's
+ * CLOCK_MONOTONIC time when the packet was complete (transit latency; only
+ * meaningful across hosts whose monotonic clocks are aligned, e.g. the
+ * same host or PTP-disciplined ones).
+ */
+struct NetPacketHeader
+{
+    static constexpr quint16 kMagic   = 0x4D41;     ///< "AM"
+    static constexpr quint8  kVersion = 1;
+    static constexpr int     kBytes   = 24;
+
+    quint16 magic;
+    quint8  version;
+    quint8  channels;
+    quint32 seq;
+    quint32 timestamp;
+    quint32 sampleRate;
+    qint64  sendNs;
+};
+
+/// Largest datagram we send: fits a 1500-byte Ethernet MTU after IPv4 and UDP headers.
+constexpr int kNetMaxDatagram = 1472;
+
+/// Samples (over all channels) that fit one datagram.
+constexpr int kNetMaxPacketSamples = (kNetMaxDatagram - NetPacketHeader::kBytes) / 2;
+
+// ----------------------------------------------------------
+// NetSender Class Declaration
+// ----------------------------------------------------------
+
+struct NetSenderStats
+{
+    qint64 packetsSent = 0;
+    qint64 packetsDropped = 0;      ///< Queue full or socket buffer full
+    qint64 packetsImpaired = 0;     ///< Dropped on purpose by setImpairment()
+};
+
+/**
+ * @brief Streams interleaved audio to a remote NetReceiver over UDP.
+ *
+ * write() (audio thread) converts the block to int16, cuts it into
+ * packets of a few milliseconds and pushes them into a lock-free queue;
+ * it never touches the socket. A sender thread, woken once per packet,
+ * sends whatever is queued with one sendmmsg() call. For testing, it can
+ * drop and delay packets on purpose (see setImpairment()).
+ *
+ * IPv4, Linux only; open() fails elsewhere.
+ */
+class NetSender
+{
+public:
+    NetSender();
+    ~NetSender();
+
+    NetSender(const NetSender&) = delete;
+    NetSender& operator=(const NetSender&) = delete;
+
+    /**
+     * @brief Not real-time safe. Resolves @p host and starts the sender thread.
+     * @param packetMs Audio per datagram; capped to what fits kNetMaxDatagram.
+     */
+    bool open(const QString& host, int port, int channels, int sampleRate, double packetMs = 5.0,
+              QString* error = nullptr);
+
+    /// Not real-time safe. Stops the sender thread; packets still queued are dropped.
+    void close();
+
+    bool isOpen() const { return m_fd >= 0; }
+
+    /// Frames per datagram, as chosen by open().
+    int packetFrames() const { return m_packetFrames; }
+
+    /// Audio thread. Interleaved frames with the channel count given to open().
+    void write(const float* samples, int frames);
+
+    /**
+     * @brief Test aid, any thread: drops @p lossPercent of the packets at
+     * random and holds each other one back by a random 0..@p jitterMs, which
+     * also reorders them.
+     */
+    void setImpairment(double lossPercent, double jitterMs);
+
+    NetSenderStats stats() const;
+
+private:
+    friend class NetSenderThread;
+
+    struct Packet
+    {
+        int bytes = 0;
+        qint64 dueNs = 0;           ///< Release time when impaired
+        char data[kNetMaxDatagram];
+    };
+
+    void finishPacket();
+    void senderLoop();
+
+    int m_fd;
+    int m_channels;
+    int m_sampleRate;
+    int m_packetFrames;
+
+    // Audio thread
+    Packet m_building;
+    int m_buildFrames;
+    quint32 m_seq;
+    quint32 m_timestamp;
+
+    // Hand-off to the sender thread
+    std::unique_ptr<SpscRing<Packet, 128>> m_queue;
+    QSemaphore m_wake;
+    std::unique_ptr<NetSenderThread> m_thread;
+    std::atomic<bool> m_running;
+
+    std::atomic<int> m_lossPpm;
+    std::atomic<int> m_jitterUs;
+
+    std::atomic<qint64> m_sent;
+    std::atomic<qint64> m_dropped;
+    std::atomic<qint64> m_impaired;
+};
+
+// ----------------------------------------------------------
+// NetReceiver Class Declaration
+// ----------------------------------------------------------
+
+struct NetReceiverStats
+{
+    qint64 packetsReceived = 0;
+    qint64 packetsLost = 0;         ///< Never arrived in time; concealed
+    qint64 packetsLate = 0;         ///< Arrived after their playout slot
+    qint64 packetsInvalid = 0;      ///< Wrong magic, version or format
+    qint64 underruns = 0;           ///< Buffer ran dry; concealed and stretched
+    qint64 concealedFrames = 0;
+    double jitterMs = 0.0;          ///< RFC 3550 interarrival jitter
+    double transitMs = 0.0;         ///< Sender hand-off to arrival, smoothed
+    double bufferMs = 0.0;          ///< Audio waiting for playout
+    double targetMs = 0.0;          ///< Adaptive buffer target
+    double packetMs = 0.0;
+    double driftRatio = 1.0;        ///< Current drift correction
+
+    /// Hand-off to NetSender::write() until NetReceiver::read() returns it.
+    double endToEndMs() const { return packetMs + transitMs + bufferMs; }
+};
+
+/**
+ * @brief Receives a NetSender stream and plays it out at the local clock.
+ *
+ * A receiver thread drains the socket with recvmmsg() and files every
+ * packet into a jitter buffer slot by sequence number (kernel receive
+ * timestamps keep batched arrivals apart). It also measures the transit
+ * delay of each packet and derives the buffer target from its recent peak
+ * over the minimum, so the buffer grows with the network jitter and
+ * shrinks again when it settles.
+ *
+ * read() (audio thread) plays the packets back in sequence order. A lost
+ * packet is concealed by repeating the previous one with a fade (silence
+ * after a few in a row); when the buffer runs dry the concealment is
+ * played without consuming a slot, which stretches the buffer. A
+ * DriftCompensator resamples from the sender's rate to @p sampleRate and
+ * steers the fill towards the target, so the two clocks may drift apart
+ * indefinitely. read() never blocks: before the first packets it returns
+ * silence. A sender that restarts, in the same format or another one, is
+ * followed after a few packets.
+ *
+ * IPv4, Linux only; open() fails elsewhere.
+ */
+class NetReceiver
+{
+public:
+    NetReceiver();
+    ~NetReceiver();
+
+    NetReceiver(const NetReceiver&) = delete;
+    NetReceiver& operator=(const NetReceiver&) = delete;
+
+    /**
+     * @brief Not real-time safe. Binds UDP @p port on all interfaces and
+     * starts the receiver thread. read() delivers @p channels channels at
+     * @p sampleRate whatever the sender uses (extra channels are dropped,
+     * missing ones repeat the last).
+     */
+    bool open(int port, int channels, int sampleRate, QString* error = nullptr);
+
+    /// Not real-time safe. Stops the receiver thread and forgets the stream.
+    void close();
+
+    bool isOpen() const { return m_fd >= 0; }
+
+    /// Audio thread. Always fills @p frames frames.
+    void read(qint16* samples, int frames);
+    void read(float* samples, int frames);
+
+    NetReceiverStats stats() const;
+
+private:
+    friend class NetReceiverThread;
+
+    static constexpr int kSlots = 128;              ///< Jitter buffer depth in packets
+
+    struct Slot
+    {
+        std::atomic<quint32> tag{0};                ///< seq + 1 once complete, 0 while empty or written
+        int frames = 0;
+        qint16 samples[kNetMaxPacketSamples];
+    };
+
+    /**
+     * Format of the latest sender stream and the playout state sized for it.
+     * The receiver thread sets it up and bumps m_generation; read() swaps the
+     * buffers with its own and acknowledges through m_playGeneration, after
+     * which the receiver may reuse (and free) what it got back.
+     */
+    struct Stream
+    {
+        int channels = 0;
+        int rate = 0;
+        int packetFrames = 0;
+        std::unique_ptr<DriftCompensator> drift;
+        std::vector<float> packet;
+        std::vector<float> lastGood;
+        std::vector<float> resampled;
+        std::vector<float> fifo;
+    };
+
+    void receiverLoop();
+    void store(const NetPacketHeader& header, const uchar* payload, int bytes, qint64 arrivalNs);
+    void resetEstimates(qint64 arrivalNs);
+    bool latchFormat(const NetPacketHeader& header, int frames);
+
+    bool nextPacket();
+    void concealPacket();
+    void deliver(float* samples, int frames);
+
+    int m_fd;
+    int m_channels;
+    int m_sampleRate;
+    std::unique_ptr<NetReceiverThread> m_thread;
+    std::atomic<bool> m_running;
+
+    // Jitter buffer, filled by the receiver thread
+    std::unique_ptr<Slot[]> m_slots;
+    Stream m_stream;                                ///< Handed over through m_generation
+    std::atomic<quint32> m_firstSeq;                ///< First packet of the current stream
+    std::atomic<quint32> m_highestSeq;
+    std::atomic<int> m_generation;                  ///< Bumped per stream; 0 until the first packet
+    std::atomic<int> m_targetPackets;
+    std::atomic<qint64> m_packetNs;                 ///< Of the current stream, for stats()
+
+    // Receiver thread statistics
+    qint64 m_lastTransitNs;                         ///< RFC 3550 bookkeeping
+    double m_jitterNsAcc;
+    qint64 m_minTransitNs[2];                       ///< Minimum transit, current and last window
+    qint64 m_windowStartNs;
+    double m_peakDelayNs;                           ///< Recent peak transit over the minimum
+    int m_strayPackets;                             ///< Consecutive far-off sequence numbers
+
+    // Playout, owned by the audio thread
+    bool m_playing;
+    std::atomic<int> m_playGeneration;              ///< Stream the buffers below belong to
+    int m_remoteChannels;
+    int m_remoteRate;
+    int m_packetFrames;
+    std::atomic<quint32> m_playSeq;                 ///< Next packet to play; older ones are late
+    std::atomic<bool> m_playSeqValid;
+    int m_lossRun;                                  ///< Packets concealed in a row
+    float m_concealGain;                            ///< Level the last concealment ended at
+    std::vector<float> m_packet;                    ///< Current packet as float
+    std::vector<float> m_lastGood;
+    std::unique_ptr<DriftCompensator> m_drift;
+    std::vector<float> m_resampled;
+    std::vector<float> m_fifo;                      ///< Resampled frames not yet read, remote layout
+    int m_fifoFrames;
+    std::vector<float> m_scratch;                   ///< Float block for the int16 read()
+    int m_lastTarget;
+
+    std::atomic<qint64> m_received;
+    std::atomic<qint64> m_lost;
+    std::atomic<qint64> m_late;
+    std::atomic<qint64> m_invalid;
+    std::atomic<qint64> m_underruns;
+    std::atomic<qint64> m_concealedFrames;
+    std::atomic<qint64> m_jitterNs;
+    std::atomic<qint64> m_transitNs;
+    std::atomic<qint64> m_bufferedUs;
+    std::atomic<double> m_ratio;
+};
+
+#endif // NETSTREAM_H
@@ -0,0 +1,316 @@
+// parametriceq.cpp
+
+#include "parametriceq.h"
+#include "biquad.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARAMETRICEQ_SSE 1
+#endif
+
+namespace {
+const double kPi = 3.14159265358979323846;
+
+enum { B0, B1, B2, A1, A2 };
+enum { S1, S2 };
+}
+
+// ----------------------------------------------------------
+// 1. Setup and parameter changes
+// ----------------------------------------------------------
+
+ParametricEq::ParametricEq()
+    : m_sampleRate(48000)
+    , m_channels(1)
+    , m_numSections(0)
+    , m_numGroups(0)
+{
+    for (int i = 0; i < kMaxBands; ++i) {
+        m_bandDirty[i] = false;
+        m_bandSections[i] = 0;
+    }
+    std::memset(m_bandCoeffs, 0, sizeof(m_bandCoeffs));
+    std::memset(m_coeffs, 0, sizeof(m_coeffs));
+    std::memset(m_groupCoeffs, 0, sizeof(m_groupCoeffs));
+    reset();
+}
+
+void ParametricEq::setSampleRate(int sampleRate)
+{
+    if (sampleRate <= 0)
+        return;
+    m_sampleRate = sampleRate;
+    for (int i = 0; i < kMaxBands; ++i)
+        m_bandDirty[i] = true;
+    applyPendingChanges();
+    reset();
+}
+
+void ParametricEq::setChannels(int channels)
+{
+    m_channels = std::clamp(channels, 1, kMaxChannels);
+    reset();
+}
+
+void ParametricEq::reset()
+{
+    std::memset(m_groupState, 0, sizeof(m_groupState));
+    std::memset(m_state, 0, sizeof(m_state));
+}
+
+bool ParametricEq::setBand(int index, const EqBand& band)
+{
+    if (index < 0 || index >= kMaxBands)
+        return false;
+    return m_updates.push(BandUpdate{index, band});
+}
+
+void ParametricEq::applyPendingChanges()
+{
+    BandUpdate update;
+    while (m_updates.pop(update)) {
+        m_bands[update.index] = update.band;
+        m_bandDirty[update.index] = true;
+    }
+
+    bool layoutChanged = false;
+    bool coeffsChanged = false;
+    for (int i = 0; i < kMaxBands; ++i) {
+        if (!m_bandDirty[i])
+            continue;
+        int oldSections = m_bandSections[i];
+        m_bandSections[i] = designBand(i);
+        m_bandDirty[i] = false;
+        coeffsChanged = true;
+        layoutChanged |= (oldSections != m_bandSections[i]);
+    }
+
+    if (coeffsChanged)
+        packSections();
+    if (layoutChanged)
+        reset();    // sections moved between slots; old state no longer matches
+}
+
+int ParametricEq::designBand(int index)
+{
+    const EqBand& band = m_bands[index];
+    const float nyquist = m_sampleRate * 0.5f;
+    const float freq = std::clamp(band.frequency, 10.0f, nyquist * 0.98f);
+    const float q = std::max(band.q, 0.05f);
+    float (*out)[5] = m_bandCoeffs[index];
+
+    Biquad designer;
+    int sections = 0;
+
+    switch (band.type) {
+    case EqBandType::Peaking:
+        if (std::fabs(band.gainDb) < 0.01f)
+            return 0;   // flat band costs nothing
+        designer.setupPeaking(freq, m_sampleRate, q, band.gainDb);
+        designer.getCoefficients(out[0][B0], out[0][B1], out[0][B2], out[0][A1], out[0][A2]);
+        return 1;
+
+    case EqBandType::LowShelf:
+    case EqBandType::HighShelf:
+        if (std::fabs(band.gainDb) < 0.01f)
+            return 0;
+        if (band.type == EqBandType::LowShelf)
+            designer.setupLowShelf(freq, m_sampleRate, std::min(q, 1.0f), band.gainDb);
+        else
+            designer.setupHighShelf(freq, m_sampleRate, std::min(q, 1.0f), band.gainDb);
+        designer.getCoefficients(out[0][B0], out[0][B1], out[0][B2], out[0][A1], out[0][A2]);
+        return 1;
+
+    case EqBandType::LowPass:
+    case EqBandType::HighPass:
+        // Butterworth cascade of n second-order sections (12 dB/oct each);
+        // the user Q scales the resonance of the sharpest section
+        sections = std::clamp(band.slope / 12, 1, kMaxSectionsPerBand);
+        for (int k = 0; k < sections; ++k) {
+            float sectionQ = (sections == 1)
+                ? q
+                : static_cast<float>(1.0 / (2.0 * std::cos((2 * k + 1) * kPi / (4.0 * sections))));
+            if (sections > 1 && k == sections - 1)
+                sectionQ *= q / 0.7071f;
+            if (band.type == EqBandType::LowPass)
+                designer.setupLowPass(freq, m_sampleRate, sectionQ);
+            else
+                designer.setupHighPass(freq, m_sampleRate, sectionQ);
+            designer.getCoefficients(out[k][B0], out[k][B1], out[k][B2], out[k][A1], out[k][A2]);
+        }
+        return sections;
+
+    case EqBandType::Off:
+    default:
+        return 0;
+    }
+}
+
+void ParametricEq::packSections()
+{
+    m_numSections = 0;
+    for (int i = 0; i < kMaxBands; ++i) {
+        for (int k = 0; k < m_bandSections[i]; ++k) {
+            std::memcpy(m_coeffs[m_numSections++], m_bandCoeffs[i][k], sizeof(m_coeffs[0]));
+        }
+    }
+
+    // Wavefront groups; unused lanes are identity sections (b0 = 1)
+    m_numGroups = (m_numSections + 3) / 4;
+    for (int g = 0; g < m_numGroups; ++g) {
+        for (int lane = 0; lane < 4; ++lane) {
+            int s = g * 4 + lane;
+            for (int c = 0; c < 5; ++c) {
+                m_groupCoeffs[g][c][lane] = (s < m_numSections) ? m_coeffs[s][c]
+                                                                : (c == B0 ? 1.0f : 0.0f);
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------
+// 2. Processing
+// ----------------------------------------------------------
+
+void ParametricEq::process(float* samples, int frames)
+{
+    if (m_updates.size() != 0)
+        applyPendingChanges();
+    if (m_numSections == 0 || !samples || frames <= 0)
+        return;
+
+#ifdef PARAMETRICEQ_SSE
+    if (m_channels == 1)
+        processMono(samples, frames);
+    else if (m_channels <= 4)
+        processLanes(samples, frames);
+    else
+        processScalar(samples, frames);
+#else
+    processScalar(samples, frames);
+#endif
+}
+
+#ifdef PARAMETRICEQ_SSE
+
+void ParametricEq::processMono(float* x, int frames)
+{
+    // Lane j of a group runs section 4g+j on sample t-j at step t, taking its
+    // input from lane j-1's output of the previous step. Lanes whose sample
+    // index is outside the block (pipeline fill/drain) keep their state.
+    for (int g = 0; g < m_numGroups; ++g) {
+        const __m128 b0 = _mm_load_ps(m_groupCoeffs[g][B0]);
+        const __m128 b1 = _mm_load_ps(m_groupCoeffs[g][B1]);
+        const __m128 b2 = _mm_load_ps(m_groupCoeffs[g][B2]);
+        const __m128 a1 = _mm_load_ps(m_groupCoeffs[g][A1]);
+        const __m128 a2 = _mm_load_ps(m_groupCoeffs[g][A2]);
+        __m128 s1  = _mm_load_ps(m_groupState[g][S1]);
+        __m128 s2  = _mm_load_ps(m_groupState[g][S2]);
+        __m128 out = _mm_setzero_ps();
+
+        const int steps = frames + 3;
+        for (int t = 0; t < steps; ++t) {
+            const float in = (t < frames) ? x[t] : 0.0f;
+            __m128 u = _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(out), 4));
+            u = _mm_move_ss(u, _mm_set_ss(in));
+
+            __m128 y  = _mm_add_ps(_mm_mul_ps(b0, u), s1);
+            __m128 n1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, u), _mm_mul_ps(a1, y)), s2);
+            __m128 n2 = _mm_sub_ps(_mm_mul_ps(b2, u), _mm_mul_ps(a2, y));
+
+            if (t >= 3 && t < frames) {
+                s1 = n1;
+                s2 = n2;
+            } else {
+                // Lane j is valid when 0 <= t - j < frames
+                __m128 valid = _mm_castsi128_ps(_mm_set_epi32(
+                    (t - 3 >= 0 && t - 3 < frames) ? -1 : 0,
+                    (t - 2 >= 0 && t - 2 < frames) ? -1 : 0,
+                    (t - 1 >= 0 && t - 1 < frames) ? -1 : 0,
+                    (t < frames) ? -1 : 0));
+                s1 = _mm_or_ps(_mm_and_ps(valid, n1), _mm_andnot_ps(valid, s1));
+                s2 = _mm_or_ps(_mm_and_ps(valid, n2), _mm_andnot_ps(valid, s2));
+            }
+            out = y;
+
+            if (t >= 3) {
+                // Lane 3 has now run all four sections on sample t-3
+                x[t - 3] = _mm_cvtss_f32(_mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 3, 3, 3)));
+            }
+        }
+
+        _mm_store_ps(m_groupState[g][S1], s1);
+        _mm_store_ps(m_groupState[g][S2], s2);
+    }
+}
+
+void ParametricEq::processLanes(float* samples, int frames)
+{
+    // One channel per lane, sections in series
+    alignas(16) float frame[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    __m128 s1[kMaxSections];
+    __m128 s2[kMaxSections];
+    for (int s = 0; s < m_numSections; ++s) {
+        s1[s] = _mm_load_ps(&m_state[s][S1][0]);
+        s2[s] = _mm_load_ps(&m_state[s][S2][0]);
+    }
+
+    for (int i = 0; i < frames; ++i) {
+        float* p = samples + static_cast<size_t>(i) * m_channels;
+        for (int ch = 0; ch < m_channels; ++ch)
+            frame[ch] = p[ch];
+        __m128 v = _mm_load_ps(frame);
+
+        for (int s = 0; s < m_numSections; ++s) {
+            const float* c = m_coeffs[s];
+            __m128 y = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(c[B0]), v), s1[s]);
+            s1[s] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(c[B1]), v),
+                                          _mm_mul_ps(_mm_set1_ps(c[A1]), y)), s2[s]);
+            s2[s] = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(c[B2]), v),
+                               _mm_mul_ps(_mm_set1_ps(c[A2]), y));
+            v = y;
+        }
+
+        _mm_store_ps(frame, v);
+        for (int ch = 0; ch < m_channels; ++ch)
+            p[ch] = frame[ch];
+    }
+
+    for (int s = 0; s < m_numSections; ++s) {
+        _mm_store_ps(&m_state[s][S1][0], s1[s]);
+        _mm_store_ps(&m_state[s][S2][0], s2[s]);
+    }
+}
+
+#else
+
+void ParametricEq::processMono(float* samples, int frames) { processScalar(samples, frames); }
+void ParametricEq::processLanes(float* samples, int frames) { processScalar(samples, frames); }
+
+#endif
+
+void ParametricEq::processScalar(float* samples, int frames)
+{
+    // Section by section over the whole block keeps coefficients in registers
+    for (int ch = 0; ch < m_channels; ++ch) {
+        for (int s = 0; s < m_numSections; ++s) {
+            const float* c = m_coeffs[s];
+            float s1 = m_state[s][S1][ch];
+            float s2 = m_state[s][S2][ch];
+            float* p = samples + ch;
+            for (int i = 0; i < frames; ++i, p += m_channels) {
+                float in = *p;
+                float y = c[B0] * in + s1;
+                s1 = c[B1] * in - c[A1] * y + s2;
+                s2 = c[B2] * in - c[A2] * y;
+                *p = y;
+            }
+            m_state[s][S1][ch] = s1;
+            m_state[s][S2][ch] = s2;
+        }
+    }
+}
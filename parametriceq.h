@@ -0,0 +1,109 @@
+// parametriceq.h
+#ifndef PARAMETRICEQ_H
+#define PARAMETRICEQ_H
+
+#include "spscring.h"
+
+// ----------------------------------------------------------
+// EQ band description
+// ----------------------------------------------------------
+
+enum class EqBandType
+{
+    Off,
+    Peaking,
+    LowShelf,
+    HighShelf,
+    LowPass,
+    HighPass
+};
+
+struct EqBand
+{
+    EqBandType type = EqBandType::Off;
+    float frequency = 1000.0f;  ///< Center / corner frequency in Hz
+    float gainDb    = 0.0f;     ///< Peaking and shelves only
+    float q         = 0.7071f;  ///< Peaking bandwidth, HP/LP resonance, shelf slope S (0..1]
+    int   slope     = 12;       ///< HP/LP only: 12, 24, 36 or 48 dB/octave
+};
+
+// ----------------------------------------------------------
+// ParametricEq Class Declaration
+// ----------------------------------------------------------
+
+/**
+ * @brief N-band parametric EQ evaluated as one cascade of biquad sections.
+ *
+ * Band designs come from Biquad; coefficients are only recomputed for bands
+ * that changed. Mono audio runs four consecutive sections in the four SSE
+ * lanes with a one-sample skew (a wavefront pipeline), 2-4 channels run one
+ * channel per lane. Band changes are posted through a lock-free ring, so
+ * process() never locks or allocates.
+ */
+class ParametricEq
+{
+public:
+    static constexpr int kMaxBands           = 16;
+    static constexpr int kMaxSectionsPerBand = 4;
+    static constexpr int kMaxSections        = kMaxBands * kMaxSectionsPerBand;
+    static constexpr int kMaxChannels        = 8;
+
+    ParametricEq();
+
+    /// Not real-time safe. Call before processing starts; clears filter state.
+    void setSampleRate(int sampleRate);
+    void setChannels(int channels);
+
+    /**
+     * @brief Queues a band change for the audio thread (single producer).
+     * @return false if the index is out of range or the queue is full.
+     */
+    bool setBand(int index, const EqBand& band);
+
+    /// Audio thread: applies queued changes and filters interleaved samples in place.
+    void process(float* samples, int frames);
+
+    /// Audio thread: true if at least one band is active or changes are queued.
+    bool isActive() const { return m_numSections > 0 || m_updates.size() != 0; }
+
+    void reset();
+
+private:
+    struct BandUpdate
+    {
+        int index;
+        EqBand band;
+    };
+
+    void applyPendingChanges();
+    int designBand(int index);
+    void packSections();
+
+    void processMono(float* samples, int frames);
+    void processLanes(float* samples, int frames);
+    void processScalar(float* samples, int frames);
+
+    int m_sampleRate;
+    int m_channels;
+
+    EqBand m_bands[kMaxBands];
+    bool m_bandDirty[kMaxBands];
+    int m_bandSections[kMaxBands];                           ///< Sections used by each band
+    float m_bandCoeffs[kMaxBands][kMaxSectionsPerBand][5];   ///< b0 b1 b2 a1 a2
+
+    // Packed cascade of active sections
+    int m_numSections;
+    float m_coeffs[kMaxSections][5];
+
+    // Mono wavefront layout: group g holds sections 4g..4g+3, one per lane
+    int m_numGroups;
+    alignas(16) float m_groupCoeffs[kMaxSections / 4][5][4];
+    alignas(16) float m_groupState[kMaxSections / 4][2][4];  ///< s1, s2 per lane
+
+    // Per-channel TDF-II state for the lane and scalar paths
+    alignas(16) float m_state[kMaxSections][2][kMaxChannels];
+
+    SpscRing<BandUpdate, 64> m_updates;
+};
+
+#endif // PARAMETRICEQ_H
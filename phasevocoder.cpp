@@ -0,0 +1,229 @@
+// phasevocoder.cpp
+
+#include "phasevocoder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const double kPi = 3.14159265358979323846;
+const float kTwoPi = static_cast<float>(2.0 * kPi);
+
+// Width of one envelope smoothing pass; two passes give a triangular kernel
+// wide enough to bridge the harmonics of a speaking or singing voice
+const float kEnvelopeHz = 300.0f;
+
+// Sum of the squared periodic Hann window over kOverlap = 4 hops
+const float kOverlapAddGain = 1.5f;
+
+inline float wrapPhase(float phase)
+{
+    return phase - kTwoPi * std::floor(phase / kTwoPi + 0.5f);
+}
+}
+
+// ----------------------------------------------------------
+// 1. Setup
+// ----------------------------------------------------------
+
+PhaseVocoderPitchEngine::PhaseVocoderPitchEngine()
+    : m_fft(kFftSize)
+    , m_window(kFftSize)
+    , m_rover(kFftSize - kHop)
+    , m_ratio(1.0f)
+    , m_preserveFormants(true)
+    , m_envelopeRadius(1)
+    , m_frame(kFftSize)
+    , m_re(kBins)
+    , m_im(kBins)
+    , m_magnitude(kBins)
+    , m_envelope(kBins, 1.0f)
+    , m_synRe(kBins)
+    , m_synIm(kBins)
+    , m_rotation(kBins)
+    , m_peaks(kBins)
+    , m_prefix(kBins + 1)
+{
+    for (int i = 0; i < kFftSize; ++i)
+        m_window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * i / kFftSize));
+}
+
+void PhaseVocoderPitchEngine::setFormat(int channels, int sampleRate)
+{
+    m_channels = std::max(channels, 1);
+    m_sampleRate = sampleRate;
+
+    const float binHz = static_cast<float>(sampleRate) / kFftSize;
+    m_envelopeRadius = std::max(1, static_cast<int>(kEnvelopeHz / binHz / 2.0f + 0.5f));
+
+    m_channelState.resize(m_channels);
+    for (Channel& channel : m_channelState) {
+        channel.input.assign(kFftSize, 0.0f);
+        channel.output.assign(kHop, 0.0f);
+        channel.accumulator.assign(kFftSize, 0.0f);
+        channel.prevRe.assign(kBins, 0.0f);
+        channel.prevIm.assign(kBins, 0.0f);
+        channel.rotation.assign(kBins, 0.0f);
+    }
+    reset();
+}
+
+void PhaseVocoderPitchEngine::setPitchSemiTones(float semitones)
+{
+    m_ratio = static_cast<float>(std::pow(2.0, semitones / 12.0));
+}
+
+void PhaseVocoderPitchEngine::reset()
+{
+    for (Channel& channel : m_channelState) {
+        std::fill(channel.input.begin(), channel.input.end(), 0.0f);
+        std::fill(channel.output.begin(), channel.output.end(), 0.0f);
+        std::fill(channel.accumulator.begin(), channel.accumulator.end(), 0.0f);
+        std::fill(channel.prevRe.begin(), channel.prevRe.end(), 0.0f);
+        std::fill(channel.prevIm.begin(), channel.prevIm.end(), 0.0f);
+        std::fill(channel.rotation.begin(), channel.rotation.end(), 0.0f);
+    }
+    m_rover = kFftSize - kHop;
+}
+
+// ----------------------------------------------------------
+// 2. Streaming
+// ----------------------------------------------------------
+
+void PhaseVocoderPitchEngine::processBlock(float* samples, int frames)
+{
+    if (m_channelState.empty())
+        return;
+
+    const int channels = m_channels;
+    const int fifoStart = kFftSize - kHop;      // Input fill when the next frame is due in one hop
+
+    for (int i = 0; i < frames; ++i) {
+        float* frame = samples + i * channels;
+        for (int ch = 0; ch < channels; ++ch) {
+            Channel& channel = m_channelState[ch];
+            channel.input[m_rover] = frame[ch];
+            frame[ch] = channel.output[m_rover - fifoStart];
+        }
+
+        if (++m_rover >= kFftSize) {
+            m_rover = fifoStart;
+            for (Channel& channel : m_channelState)
+                processFrame(channel);
+        }
+    }
+}
+
+// ----------------------------------------------------------
+// 3. Analysis, bin shifting and resynthesis
+// ----------------------------------------------------------
+
+void PhaseVocoderPitchEngine::processFrame(Channel& channel)
+{
+    const float expected = kTwoPi * kHop / kFftSize;   // phase advance of bin 1 per hop
+
+    for (int i = 0; i < kFftSize; ++i)
+        m_frame[i] = channel.input[i] * m_window[i];
+    m_fft.forward(m_frame.data(), m_re.data(), m_im.data());
+
+    for (int k = 0; k < kBins; ++k)
+        m_magnitude[k] = std::sqrt(m_re[k] * m_re[k] + m_im[k] * m_im[k]);
+    if (m_preserveFormants)
+        estimateEnvelope(m_magnitude.data(), m_envelope.data());
+
+    // Local maxima over +-2 bins
+    int numPeaks = 0;
+    for (int k = 2; k < kBins - 2; ++k) {
+        const float m = m_magnitude[k];
+        if (m > 1e-9f && m > m_magnitude[k - 1] && m >= m_magnitude[k + 1]
+            && m > m_magnitude[k - 2] && m >= m_magnitude[k + 2])
+            m_peaks[numPeaks++] = k;
+    }
+
+    std::fill(m_synRe.begin(), m_synRe.end(), 0.0f);
+    std::fill(m_synIm.begin(), m_synIm.end(), 0.0f);
+
+    int regionStart = 0;
+    for (int i = 0; i < numPeaks; ++i) {
+        const int peak = m_peaks[i];
+
+        // The region ends at the weakest bin before the next peak
+        int regionEnd = kBins - 1;
+        if (i + 1 < numPeaks) {
+            regionEnd = peak;
+            for (int k = peak + 1; k < m_peaks[i + 1]; ++k) {
+                if (m_magnitude[k] < m_magnitude[regionEnd])
+                    regionEnd = k;
+            }
+        }
+
+        // True frequency of the peak (in bins) from its phase advance
+        const float re = m_re[peak];
+        const float im = m_im[peak];
+        const float advance = std::atan2(im * channel.prevRe[peak] - re * channel.prevIm[peak],
+                                         re * channel.prevRe[peak] + im * channel.prevIm[peak]);
+        const float frequency = peak + wrapPhase(advance - peak * expected) * kOverlap / kTwoPi;
+
+        // Move the region by whole bins and rotate it so the peak advances
+        // like a partial at frequency * ratio
+        const float shift = frequency * (m_ratio - 1.0f);
+        const int binShift = static_cast<int>(std::floor(shift + 0.5f));
+        const float rotation = wrapPhase(channel.rotation[peak] + shift * kTwoPi / kOverlap);
+        const float c = std::cos(rotation);
+        const float s = std::sin(rotation);
+
+        const int lo = std::max(regionStart, -binShift);
+        const int hi = std::min(regionEnd, kBins - 1 - binShift);
+        for (int k = lo; k <= hi; ++k) {
+            const int target = k + binShift;
+            const float gain = m_preserveFormants ? m_envelope[target] / m_envelope[k] : 1.0f;
+            m_synRe[target] += gain * (m_re[k] * c - m_im[k] * s);
+            m_synIm[target] += gain * (m_re[k] * s + m_im[k] * c);
+        }
+        for (int k = regionStart; k <= regionEnd; ++k)
+            m_rotation[k] = rotation;
+
+        regionStart = regionEnd + 1;
+    }
+    if (numPeaks == 0)
+        std::fill(m_rotation.begin(), m_rotation.end(), 0.0f);
+
+    std::copy(m_re.begin(), m_re.end(), channel.prevRe.begin());
+    std::copy(m_im.begin(), m_im.end(), channel.prevIm.begin());
+    channel.rotation.swap(m_rotation);
+
+    m_fft.inverse(m_synRe.data(), m_synIm.data(), m_frame.data());
+
+    // Windowed overlap-add; the first hop is complete after this frame
+    const float scale = 1.0f / kOverlapAddGain;
+    for (int i = 0; i < kFftSize; ++i)
+        channel.accumulator[i] += m_window[i] * m_frame[i] * scale;
+    std::copy(channel.accumulator.begin(), channel.accumulator.begin() + kHop, channel.output.begin());
+    std::copy(channel.accumulator.begin() + kHop, channel.accumulator.end(), channel.accumulator.begin());
+    std::fill(channel.accumulator.end() - kHop, channel.accumulator.end(), 0.0f);
+
+    // Keep the overlapping part of the input for the next frame
+    std::copy(channel.input.begin() + kHop, channel.input.end(), channel.input.begin());
+}
+
+void PhaseVocoderPitchEngine::estimateEnvelope(const float* magnitude, float* envelope)
+{
+    // Two box-filter passes over the log magnitude, clamped at the edges
+    for (int k = 0; k < kBins; ++k)
+        envelope[k] = std::log(magnitude[k] + 1e-9f);
+
+    const int radius = m_envelopeRadius;
+    for (int pass = 0; pass < 2; ++pass) {
+        m_prefix[0] = 0.0;
+        for (int k = 0; k < kBins; ++k)
+            m_prefix[k + 1] = m_prefix[k] + envelope[k];
+        for (int k = 0; k < kBins; ++k) {
+            const int lo = std::max(k - radius, 0);
+            const int hi = std::min(k + radius, kBins - 1);
+            envelope[k] = static_cast<float>((m_prefix[hi + 1] - m_prefix[lo]) / (hi - lo + 1));
+        }
+    }
+
+    for (int k = 0; k < kBins; ++k)
+        envelope[k] = std::exp(envelope[k]);
+}
@@ -0,0 +1,89 @@
+// phasevocoder.h
+#ifndef PHASEVOCODER_H
+#define PHASEVOCODER_H
+
+#include "pitchengine.h"
+#include "fft.h"
+
+#include <vector>
+
+// ----------------------------------------------------------
+// PhaseVocoderPitchEngine
+// ----------------------------------------------------------
+
+/**
+ * @brief Phase-locked STFT pitch shifter with formant preservation.
+ *
+ * Each analysis frame is split into regions around its spectral peaks. A
+ * region is moved as a whole by the integer number of bins closest to its
+ * peak's shift and rotated so that the peak keeps a continuous phase at
+ * its new frequency (Laroche/Dolson); the bins around a peak keep their
+ * phase relation to it, so the shifted partials stay clean and at level.
+ * With formant preservation every moved bin is rescaled by the ratio of the
+ * spectral envelope (a log-domain smoothing of the magnitudes) at its new
+ * and old frequency, so voices keep their timbre.
+ *
+ * A sample comes out kFftSize frames after it went in (about 42.7 ms at
+ * 48 kHz): it waits for the rest of its analysis frame, then for the
+ * overlap-add to complete its hop.
+ */
+class PhaseVocoderPitchEngine : public PitchEngine
+{
+public:
+    static constexpr int kFftSize = 2048;
+    static constexpr int kOverlap = 4;
+    static constexpr int kHop     = kFftSize / kOverlap;
+    static constexpr int kBins    = kFftSize / 2 + 1;
+
+    PhaseVocoderPitchEngine();
+
+    PitchEngineType type() const override { return PitchEngineType::PhaseVocoder; }
+    const char* name() const override { return "Phase vocoder"; }
+
+    void setFormat(int channels, int sampleRate) override;
+    void setPitchSemiTones(float semitones) override;
+    void reset() override;
+    int latencyFrames() const override { return kFftSize; }
+
+    /// Audio thread. On by default.
+    void setFormantPreservation(bool enabled) { m_preserveFormants = enabled; }
+
+protected:
+    void processBlock(float* samples, int frames) override;
+
+private:
+    struct Channel
+    {
+        std::vector<float> input;       ///< Last kFftSize input samples
+        std::vector<float> output;      ///< Finished samples of the current hop
+        std::vector<float> accumulator; ///< Overlap-add buffer
+        std::vector<float> prevRe;      ///< Previous analysis spectrum
+        std::vector<float> prevIm;
+        std::vector<float> rotation;    ///< Phase rotation of the region each bin belonged to
+    };
+
+    void processFrame(Channel& channel);
+    void estimateEnvelope(const float* magnitude, float* envelope);
+
+    RealFft m_fft;
+    std::vector<float> m_window;
+    std::vector<Channel> m_channelState;
+    int m_rover;                        ///< Write position in Channel::input
+    float m_ratio;
+    bool m_preserveFormants;
+    int m_envelopeRadius;               ///< Half-width of the envelope smoothing in bins
+
+    // Per-frame scratch, shared by all channels
+    std::vector<float> m_frame;
+    std::vector<float> m_re;
+    std::vector<float> m_im;
+    std::vector<float> m_magnitude;
+    std::vector<float> m_envelope;
+    std::vector<float> m_synRe;
+    std::vector<float> m_synIm;
+    std::vector<float> m_rotation;
+    std::vector<int> m_peaks;
+    std::vector<double> m_prefix;
+};
+
+#endif // PHASEVOCODER_H
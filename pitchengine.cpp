@@ -0,0 +1,262 @@
+// pitchengine.cpp
+
+#include "pitchengine.h"
+#include "phasevocoder.h"
+
+#include <RateTransposer.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+using namespace soundtouch;
+
+namespace {
+const double kPi = 3.14159265358979323846;
+
+// Weight of the newest block in the running cost average
+const float kCostSmoothing = 0.01f;
+}
+
+// ----------------------------------------------------------
+// 1. PitchEngine
+// ----------------------------------------------------------
+
+std::unique_ptr<PitchEngine> PitchEngine::create(PitchEngineType type)
+{
+    switch (type) {
+    case PitchEngineType::Granular:
+        return std::unique_ptr<PitchEngine>(new GranularPitchEngine);
+    case PitchEngineType::PhaseVocoder:
+        return std::unique_ptr<PitchEngine>(new PhaseVocoderPitchEngine);
+    case PitchEngineType::SoundTouch:
+    default:
+        return std::unique_ptr<PitchEngine>(new SoundTouchPitchEngine);
+    }
+}
+
+void PitchEngine::process(float* samples, int frames)
+{
+    if (!samples || frames <= 0) {
+        m_invalidBlocks.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    processBlock(samples, frames);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    const float ns = static_cast<float>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())
+                   / (static_cast<float>(frames) * m_channels);
+    const float average = m_nsPerSample.load(std::memory_order_relaxed);
+    m_nsPerSample.store(average > 0.0f ? average + kCostSmoothing * (ns - average) : ns,
+                        std::memory_order_relaxed);
+}
+
+PitchEngineEvents PitchEngine::events() const
+{
+    PitchEngineEvents events;
+    events.invalidBlocks = m_invalidBlocks.load(std::memory_order_relaxed);
+    events.backlogResets = m_backlogResets.load(std::memory_order_relaxed);
+    events.failedBlocks  = m_failedBlocks.load(std::memory_order_relaxed);
+    return events;
+}
+
+// ----------------------------------------------------------
+// 2. SoundTouchPitchEngine
+// ----------------------------------------------------------
+
+SoundTouchPitchEngine::SoundTouchPitchEngine()
+    : m_semitones(0.0f)
+    , m_primed(false)
+{
+}
+
+void SoundTouchPitchEngine::setInterpolation(SoundTouchInterpolation interpolation)
+{
+    switch (interpolation) {
+    case SoundTouchInterpolation::Linear:
+        TransposerBase::setAlgorithm(TransposerBase::LINEAR);
+        break;
+    case SoundTouchInterpolation::Cubic:
+        TransposerBase::setAlgorithm(TransposerBase::CUBIC);
+        break;
+    case SoundTouchInterpolation::Shannon:
+        TransposerBase::setAlgorithm(TransposerBase::SHANNON);
+        break;
+    }
+}
+
+void SoundTouchPitchEngine::setFormat(int channels, int sampleRate)
+{
+    m_channels = std::max(channels, 1);
+    m_sampleRate = sampleRate;
+
+    m_soundTouch.setSampleRate(sampleRate);
+    m_soundTouch.setChannels(m_channels);
+    m_soundTouch.setPitchSemiTones(m_semitones);
+    m_soundTouch.setTempo(1.0f);
+    m_soundTouch.setRate(1.0f);
+    m_soundTouch.setSetting(SETTING_USE_AA_FILTER, 1);
+    m_soundTouch.setSetting(SETTING_SEQUENCE_MS,   40);
+    m_soundTouch.setSetting(SETTING_SEEKWINDOW_MS, 15);
+    m_soundTouch.setSetting(SETTING_OVERLAP_MS,    8);
+    // Coarse-to-fine overlap seek: matches the full search on voice at a
+    // fraction of its cost
+    m_soundTouch.setSetting(SETTING_SEEK_CANDIDATES, 2);
+    reset();
+}
+
+void SoundTouchPitchEngine::setPitchSemiTones(float semitones)
+{
+    if (semitones == m_semitones)
+        return;
+    m_semitones = semitones;
+    m_soundTouch.setPitchSemiTones(semitones);
+}
+
+void SoundTouchPitchEngine::reset()
+{
+    m_soundTouch.clear();
+    m_primed = false;
+}
+
+int SoundTouchPitchEngine::latencyFrames() const
+{
+    return m_soundTouch.getSetting(SETTING_INITIAL_LATENCY)
+         + m_soundTouch.getSetting(SETTING_NOMINAL_OUTPUT_SEQUENCE);
+}
+
+void SoundTouchPitchEngine::processBlock(float* samples, int numFrames)
+{
+    const uint frames = static_cast<uint>(numFrames);
+
+    if (m_soundTouch.numUnprocessedSamples() > 8192) {
+        // Input is piling up faster than TDStretch consumes it: start over
+        m_backlogResets.fetch_add(1, std::memory_order_relaxed);
+        reset();
+    }
+
+    try {
+        m_soundTouch.putSamples(samples, frames);
+    } catch (const std::exception&) {
+        m_failedBlocks.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Hold back one output sequence of headroom before starting
+    const uint sequence = static_cast<uint>(m_soundTouch.getSetting(SETTING_NOMINAL_OUTPUT_SEQUENCE));
+    if (!m_primed && m_soundTouch.numSamples() >= frames + sequence)
+        m_primed = true;
+
+    uint received = 0;
+    if (m_primed) {
+        // Pull straight into the caller's block; whatever is left stays
+        // queued in SoundTouch for the next call
+        received = m_soundTouch.receiveSamples(samples, frames);
+        if (received < frames)
+            m_primed = false;
+
+        // Bound the latency if the output backlog ever grows
+        const uint keep = frames + sequence;
+        const uint backlog = m_soundTouch.numSamples();
+        if (backlog > keep + 8192)
+            m_soundTouch.receiveSamples(backlog - keep);
+    }
+
+    // Silence while (re)priming
+    std::fill(samples + received * m_channels, samples + frames * m_channels, 0.0f);
+}
+
+// ----------------------------------------------------------
+// 3. GranularPitchEngine
+// ----------------------------------------------------------
+
+GranularPitchEngine::GranularPitchEngine()
+    : m_delayFrames(0)
+    , m_writePos(0)
+    , m_grain(0)
+    , m_phase(0.0)
+    , m_phaseStep(0.0)
+{
+    // Hann window; the second tap sits half a grain later and uses 1 - w
+    for (int i = 0; i <= kWindowSize; ++i) {
+        const double s = std::sin(kPi * i / kWindowSize);
+        m_window[i] = static_cast<float>(s * s);
+    }
+}
+
+void GranularPitchEngine::setFormat(int channels, int sampleRate)
+{
+    m_channels = std::max(channels, 1);
+    m_sampleRate = sampleRate;
+    m_grain = std::max(sampleRate * kGrainMs / 1000, 16);
+
+    // Room for a full grain of delay plus the interpolation neighbour
+    m_delayFrames = 1;
+    while (m_delayFrames < m_grain + 2)
+        m_delayFrames <<= 1;
+    m_delay.assign(static_cast<size_t>(m_delayFrames) * m_channels, 0.0f);
+    reset();
+}
+
+void GranularPitchEngine::setPitchSemiTones(float semitones)
+{
+    const double ratio = std::pow(2.0, semitones / 12.0);
+    // The delay shrinks by (ratio - 1) frames per frame, sweeping the
+    // read taps at 'ratio' times the write speed
+    m_phaseStep = m_grain > 0 ? (1.0 - ratio) / m_grain : 0.0;
+}
+
+void GranularPitchEngine::reset()
+{
+    std::fill(m_delay.begin(), m_delay.end(), 0.0f);
+    m_writePos = 0;
+    m_phase = 0.0;
+}
+
+void GranularPitchEngine::processBlock(float* samples, int frames)
+{
+    if (m_delay.empty())
+        return;
+
+    const int channels = m_channels;
+    const int mask = m_delayFrames - 1;
+    const double grain = m_grain;
+
+    for (int i = 0; i < frames; ++i) {
+        float* frame = samples + i * channels;
+        float* write = &m_delay[static_cast<size_t>(m_writePos) * channels];
+        for (int ch = 0; ch < channels; ++ch)
+            write[ch] = frame[ch];
+
+        // Tap A at delay phase * grain, tap B half a grain further on
+        const double phaseB = m_phase < 0.5 ? m_phase + 0.5 : m_phase - 0.5;
+        const float gainA = m_window[static_cast<int>(m_phase * kWindowSize)];
+        const float gainB = 1.0f - gainA;
+
+        const double posA = m_writePos - m_phase * grain;
+        const double posB = m_writePos - phaseB * grain;
+        const double floorA = std::floor(posA);
+        const double floorB = std::floor(posB);
+        const float fracA = static_cast<float>(posA - floorA);
+        const float fracB = static_cast<float>(posB - floorB);
+        const float* a0 = &m_delay[static_cast<size_t>(static_cast<int>(floorA) & mask) * channels];
+        const float* a1 = &m_delay[static_cast<size_t>((static_cast<int>(floorA) + 1) & mask) * channels];
+        const float* b0 = &m_delay[static_cast<size_t>(static_cast<int>(floorB) & mask) * channels];
+        const float* b1 = &m_delay[static_cast<size_t>((static_cast<int>(floorB) + 1) & mask) * channels];
+
+        for (int ch = 0; ch < channels; ++ch) {
+            const float a = a0[ch] + fracA * (a1[ch] - a0[ch]);
+            const float b = b0[ch] + fracB * (b1[ch] - b0[ch]);
+            frame[ch] = gainA * a + gainB * b;
+        }
+
+        m_writePos = (m_writePos + 1) & mask;
+        m_phase += m_phaseStep;
+        if (m_phase >= 1.0)
+            m_phase -= 1.0;
+        else if (m_phase < 0.0)
+            m_phase += 1.0;
+    }
+}
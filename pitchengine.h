@@ -0,0 +1,181 @@
+// pitchengine.h
+#ifndef PITCHENGINE_H
+#define PITCHENGINE_H
+
+#include <QtGlobal>
+#include <SoundTouch.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// ----------------------------------------------------------
+// PitchEngine Interface
+// ----------------------------------------------------------
+
+enum class PitchEngineType
+{
+    Granular,       ///< Two-tap delay-line shifter, lowest CPU, some flanging
+    SoundTouch,     ///< WSOLA time stretch plus resampling
+    PhaseVocoder    ///< STFT bin shifting with formant preservation, highest CPU
+};
+
+/**
+ * @brief Trouble an engine ran into on the audio thread. Counted rather than
+ * logged there; the UI side polls the counts and logs what changed.
+ */
+struct PitchEngineEvents
+{
+    qint64 invalidBlocks = 0;       ///< Null or empty blocks, skipped
+    qint64 backlogResets = 0;       ///< Queued input grew too long; buffered audio dropped
+    qint64 failedBlocks = 0;        ///< The engine threw; the block was left unshifted
+};
+
+/**
+ * @brief Pitch shifter working in place on interleaved float blocks.
+ *
+ * Engines trade CPU for quality; each reports its added latency and keeps a
+ * running average of its own cost, so a deployment can pick the best engine
+ * its CPU budget allows. setFormat() is not real-time safe; everything else
+ * is called from the audio thread and never locks or allocates.
+ */
+class PitchEngine
+{
+public:
+    virtual ~PitchEngine() = default;
+
+    static std::unique_ptr<PitchEngine> create(PitchEngineType type);
+
+    virtual PitchEngineType type() const = 0;
+    virtual const char* name() const = 0;
+
+    /// Not real-time safe. Allocates buffers for the stream layout and resets the state.
+    virtual void setFormat(int channels, int sampleRate) = 0;
+
+    virtual void setPitchSemiTones(float semitones) = 0;
+
+    /// Drops all buffered audio, e.g. after the engine was bypassed for a while.
+    virtual void reset() = 0;
+
+    /// Delay between input and output in frames.
+    virtual int latencyFrames() const = 0;
+
+    /// Pitch-shifts @p frames interleaved frames in place and updates the cost average.
+    void process(float* samples, int frames);
+
+    /// Running average of the processing cost in ns per sample (frames x channels). Any thread.
+    float nsPerSample() const { return m_nsPerSample.load(std::memory_order_relaxed); }
+
+    /// Events counted since the engine was created. Any thread.
+    PitchEngineEvents events() const;
+
+protected:
+    PitchEngine()
+        : m_channels(1), m_sampleRate(48000)
+        , m_invalidBlocks(0), m_backlogResets(0), m_failedBlocks(0), m_nsPerSample(0.0f) {}
+
+    virtual void processBlock(float* samples, int frames) = 0;
+
+    int m_channels;
+    int m_sampleRate;
+
+    // Event counters, bumped on the audio thread
+    std::atomic<qint64> m_invalidBlocks;
+    std::atomic<qint64> m_backlogResets;
+    std::atomic<qint64> m_failedBlocks;
+
+private:
+    std::atomic<float> m_nsPerSample;
+};
+
+// ----------------------------------------------------------
+// SoundTouchPitchEngine
+// ----------------------------------------------------------
+
+/// Resampling kernel of SoundTouch's rate transposer.
+enum class SoundTouchInterpolation
+{
+    Linear,
+    Cubic,      ///< SoundTouch's default
+    Shannon     ///< Band-limited 8-tap windowed sinc
+};
+
+/**
+ * @brief SoundTouch's TDStretch + RateTransposer path.
+ *
+ * TDStretch emits whole sequences (tens of ms) while the audio thread
+ * consumes one short block per call, so output starts once one sequence of
+ * headroom is buffered; afterwards every block is served in full.
+ */
+class SoundTouchPitchEngine : public PitchEngine
+{
+public:
+    SoundTouchPitchEngine();
+
+    /**
+     * @brief Not real-time safe. Selects the interpolation of every
+     * SoundTouch instance created afterwards (process-wide, including the
+     * harmonizer voices); call before any engine is created.
+     */
+    static void setInterpolation(SoundTouchInterpolation interpolation);
+
+    PitchEngineType type() const override { return PitchEngineType::SoundTouch; }
+    const char* name() const override { return "SoundTouch"; }
+
+    void setFormat(int channels, int sampleRate) override;
+    void setPitchSemiTones(float semitones) override;
+    void reset() override;
+    int latencyFrames() const override;
+
+protected:
+    void processBlock(float* samples, int frames) override;
+
+private:
+    soundtouch::SoundTouch m_soundTouch;
+    float m_semitones;
+    bool m_primed;                  ///< Output headroom reached, pitched blocks are served
+};
+
+// ----------------------------------------------------------
+// GranularPitchEngine
+// ----------------------------------------------------------
+
+/**
+ * @brief Classic delay-line pitch shifter.
+ *
+ * Two read taps sweep through a short delay line at the pitch ratio, half a
+ * grain apart, and are crossfaded with complementary Hann windows. Costs a
+ * few operations per sample; the price is audible comb filtering on
+ * sustained tones.
+ */
+class GranularPitchEngine : public PitchEngine
+{
+public:
+    static constexpr int kGrainMs = 40;
+
+    GranularPitchEngine();
+
+    PitchEngineType type() const override { return PitchEngineType::Granular; }
+    const char* name() const override { return "Granular"; }
+
+    void setFormat(int channels, int sampleRate) override;
+    void setPitchSemiTones(float semitones) override;
+    void reset() override;
+    int latencyFrames() const override { return m_grain / 2; }
+
+protected:
+    void processBlock(float* samples, int frames) override;
+
+private:
+    static constexpr int kWindowSize = 1024;
+
+    std::vector<float> m_delay;     ///< Interleaved delay line, m_delayFrames frames
+    int m_delayFrames;              ///< Power of two
+    int m_writePos;
+    int m_grain;                    ///< Grain length in frames
+    double m_phase;                 ///< Position within the grain, 0..1
+    double m_phaseStep;             ///< (1 - ratio) / grain
+    float m_window[kWindowSize + 1];
+};
+
+#endif // PITCHENGINE_H
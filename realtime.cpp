@@ -0,0 +1,214 @@
+// realtime.cpp
+
+#include "realtime.h"
+
+#include <QLoggingCategory>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define REALTIME_SSE 1
+#endif
+
+#if defined(__linux__)
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+
+namespace {
+// Stack touched per promoted thread so its first deep call never faults
+const std::size_t kStackPrefaultBytes = 256 * 1024;
+
+// SCHED_FIFO levels service threads stay below the audio threads
+const int kServicePriorityDrop = 10;
+
+RealtimeConfig g_config;
+bool g_memoryLocked = false;
+
+#if defined(__linux__)
+void prefaultStack()
+{
+    char stack[kStackPrefaultBytes];
+    volatile char* touch = stack;
+    const long page = sysconf(_SC_PAGESIZE);
+    for (std::size_t i = 0; i < kStackPrefaultBytes; i += static_cast<std::size_t>(page))
+        touch[i] = 0;
+}
+
+bool pinCurrentThread(const std::vector<int>& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+    if (CPU_COUNT(&set) == 0)
+        return false;
+    const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (error != 0) {
+        qCWarning(audioCategory) << "CPU affinity refused:" << std::strerror(error);
+        return false;
+    }
+    return true;
+}
+
+void setFifoPriority(const char* role, int priority, RealtimeStatus* status)
+{
+    priority = std::clamp(priority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+    struct sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error == 0) {
+        status->fifoPriority = priority;
+    } else {
+        if (g_config.priorityFallback) {
+            status->fifoPriority = g_config.priorityFallback(priority);
+            status->viaRtkit = status->fifoPriority > 0;
+        }
+        if (status->fifoPriority == 0)
+            qCWarning(audioCategory) << role << "thread: SCHED_FIFO refused:" << std::strerror(error);
+    }
+}
+#endif
+
+void logStatus(const char* role, const RealtimeStatus& status)
+{
+    qCDebug(audioCategory) << role << "thread real-time status:"
+                           << "SCHED_FIFO" << status.fifoPriority << (status.viaRtkit ? "(rtkit)" : "")
+                           << "| pinned" << status.pinned
+                           << "| memory locked" << status.memoryLocked
+                           << "| FTZ/DAZ" << status.denormalsFlushed;
+}
+}
+
+namespace Realtime {
+
+void configure(const RealtimeConfig& config)
+{
+    g_config = config;
+}
+
+const RealtimeConfig& config()
+{
+    return g_config;
+}
+
+bool isMemoryLocked()
+{
+    return g_memoryLocked;
+}
+
+bool lockMemory(std::size_t heapBytes)
+{
+#if defined(__linux__)
+    // Keep freed heap mapped (no trimming, no per-allocation mmap), so memory
+    // prefaulted here is what later allocations reuse
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    // MCL_FUTURE makes every later mapping count against the limit, so only
+    // ask for it when the limit cannot make allocations fail
+    struct rlimit limit;
+    int flags = MCL_CURRENT;
+    if (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur == RLIM_INFINITY)
+        flags |= MCL_FUTURE;
+
+    if (char* heap = static_cast<char*>(std::malloc(heapBytes))) {
+        const long page = sysconf(_SC_PAGESIZE);
+        for (std::size_t i = 0; i < heapBytes; i += static_cast<std::size_t>(page))
+            heap[i] = 0;
+        std::free(heap);
+    }
+    prefaultStack();
+
+    if (mlockall(flags) != 0) {
+        qCWarning(audioCategory) << "mlockall failed:" << std::strerror(errno)
+                                 << "(raise the memlock limit); audio memory may be paged out";
+        return false;
+    }
+    g_memoryLocked = true;
+    qCDebug(audioCategory) << "Memory locked," << heapBytes / (1024 * 1024) << "MB heap prefaulted"
+                           << ((flags & MCL_FUTURE) ? "(current and future pages)" : "(current pages only)");
+    return true;
+#else
+    Q_UNUSED(heapBytes);
+    qCWarning(audioCategory) << "Memory locking is not supported on this platform";
+    return false;
+#endif
+}
+
+bool flushDenormals()
+{
+#if defined(REALTIME_SSE)
+    // FTZ (bit 15) and DAZ (bit 6)
+    _mm_setcsr(_mm_getcsr() | 0x8040);
+    return true;
+#elif defined(__aarch64__)
+    // FPCR.FZ (bit 24) covers both inputs and results
+    unsigned long fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | (1ul << 24)));
+    return true;
+#else
+    return false;
+#endif
+}
+
+RealtimeStatus promoteCurrentThread(const char* role, int cpu)
+{
+    RealtimeStatus status;
+    status.denormalsFlushed = flushDenormals();
+    status.memoryLocked = g_memoryLocked;
+
+#if defined(__linux__)
+    if (g_memoryLocked)
+        prefaultStack();
+
+    if (cpu >= 0)
+        status.pinned = pinCurrentThread(std::vector<int>(1, cpu));
+    else if (!g_config.cpus.empty())
+        status.pinned = pinCurrentThread(g_config.cpus);
+
+    if (g_config.fifoPriority > 0)
+        setFifoPriority(role, g_config.fifoPriority, &status);
+#endif
+
+#if !defined(__linux__)
+    Q_UNUSED(cpu);
+#endif
+    logStatus(role, status);
+    return status;
+}
+
+RealtimeStatus promoteServiceThread(const char* role)
+{
+    RealtimeStatus status;
+    status.denormalsFlushed = flushDenormals();
+    status.memoryLocked = g_memoryLocked;
+
+#if defined(__linux__)
+    if (g_memoryLocked)
+        prefaultStack();
+    // Above ordinary threads, below every audio thread; a priority of 1
+    // would still preempt the UI, so nothing is requested when the audio
+    // threads themselves sit that low
+    if (g_config.fifoPriority > kServicePriorityDrop)
+        setFifoPriority(role, g_config.fifoPriority - kServicePriorityDrop, &status);
+#endif
+
+    logStatus(role, status);
+    return status;
+}
+
+} // namespace Realtime
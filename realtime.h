@@ -0,0 +1,85 @@
+// realtime.h
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <cstddef>
+#include <vector>
+
+// ----------------------------------------------------------
+// Real-time thread setup
+// ----------------------------------------------------------
+
+/**
+ * @brief Process-wide real-time settings, set once from the command line
+ * before any audio thread starts.
+ */
+struct RealtimeConfig
+{
+    int fifoPriority = 0;               ///< SCHED_FIFO priority 1..99; 0 keeps the normal scheduler
+    std::vector<int> cpus;              ///< Cores the audio threads are pinned to; empty = no pinning
+    bool lockMemory = false;            ///< Prefault and mlockall() the process
+    std::size_t prefaultHeapBytes = 16 * 1024 * 1024;
+
+    /// Asked for SCHED_FIFO when setting it directly is refused; returns the priority granted, 0 if none
+    int (*priorityFallback)(int priority) = nullptr;
+};
+
+/// What promoteCurrentThread() actually obtained.
+struct RealtimeStatus
+{
+    bool denormalsFlushed = false;      ///< FTZ/DAZ set for this thread
+    bool pinned = false;                ///< Affinity mask applied
+    int fifoPriority = 0;               ///< Priority obtained, 0 if none
+    bool viaRtkit = false;              ///< Priority was granted by the fallback (rtkit) rather than set directly
+    bool memoryLocked = false;          ///< Process memory is locked
+};
+
+/**
+ * @brief Linux real-time setup for the audio threads.
+ *
+ * Denormal flushing works everywhere SSE or AArch64 is available; priority,
+ * affinity and memory locking are Linux only. SCHED_FIFO is requested
+ * directly first (needs CAP_SYS_NICE or an rtprio limit) and through
+ * RealtimeConfig::priorityFallback if that is refused; the application
+ * installs the rtkit client from rtkit.h there, so the DSP library itself
+ * never links D-Bus. Every call logs what it got, so a deployment can see
+ * which guarantees are missing.
+ */
+namespace Realtime {
+
+/// Stores the process-wide settings. Call before any audio thread starts.
+void configure(const RealtimeConfig& config);
+const RealtimeConfig& config();
+
+/**
+ * @brief Prefaults @p heapBytes of heap and the calling thread's stack, keeps
+ * freed heap from being returned to the OS and locks all current and future
+ * pages. Call once from the main thread if RealtimeConfig::lockMemory is set.
+ */
+bool lockMemory(std::size_t heapBytes);
+bool isMemoryLocked();
+
+/// Sets FTZ/DAZ for the calling thread, so decaying filter and overlap state never goes denormal.
+bool flushDenormals();
+
+/**
+ * @brief Applies the configured guarantees to the calling thread: denormal
+ * flushing, CPU affinity and SCHED_FIFO. Threads that the audio thread waits
+ * on (e.g. harmonizer workers) must use the same priority to avoid inversion.
+ * @param role Thread name for the log.
+ * @param cpu Pins the thread to this core alone instead of RealtimeConfig::cpus; -1 keeps the configured set.
+ */
+RealtimeStatus promoteCurrentThread(const char* role, int cpu = -1);
+
+/**
+ * @brief For threads that feed or drain the audio threads but are never
+ * waited on by them (e.g. network I/O): denormal flushing and SCHED_FIFO a
+ * few levels below the configured priority, never pinned to
+ * RealtimeConfig::cpus, so they cannot preempt audio or crowd its cores.
+ * @param role Thread name for the log.
+ */
+RealtimeStatus promoteServiceThread(const char* role);
+
+} // namespace Realtime
+
+#endif // REALTIME_H
@@ -0,0 +1,57 @@
+// rtkit.cpp
+
+#include "rtkit.h"
+
+#include <QLoggingCategory>
+#include <QtGlobal>
+
+#if defined(__linux__) && defined(AUDIOMODIFIER_RTKIT)
+#include <QDBusConnection>
+#include <QDBusInterface>
+#include <QDBusReply>
+#include <QVariant>
+#include <algorithm>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+
+namespace Realtime {
+
+int requestRtkitPriority(int priority)
+{
+#if defined(__linux__) && defined(AUDIOMODIFIER_RTKIT)
+    QDBusInterface rtkit("org.freedesktop.RealtimeKit1", "/org/freedesktop/RealtimeKit1",
+                         "org.freedesktop.RealtimeKit1", QDBusConnection::systemBus());
+    if (!rtkit.isValid())
+        return 0;
+
+    const int maxPriority = rtkit.property("MaxRealtimePriority").toInt();
+    const qlonglong maxRtTime = rtkit.property("RTTimeUSecMax").toLongLong();
+    if (maxPriority <= 0 || maxRtTime <= 0)
+        return 0;
+
+    // rtkit only grants SCHED_FIFO to threads whose RLIMIT_RTTIME is bounded
+    struct rlimit limit;
+    limit.rlim_cur = limit.rlim_max = static_cast<rlim_t>(maxRtTime);
+    if (setrlimit(RLIMIT_RTTIME, &limit) != 0)
+        return 0;
+
+    const int granted = std::min(priority, maxPriority);
+    const quint64 tid = static_cast<quint64>(syscall(SYS_gettid));
+    QDBusReply<void> reply = rtkit.call("MakeThreadRealtime", QVariant::fromValue(tid),
+                                        QVariant::fromValue(static_cast<quint32>(granted)));
+    if (!reply.isValid()) {
+        qCWarning(audioCategory) << "rtkit refused SCHED_FIFO:" << reply.error().message();
+        return 0;
+    }
+    return granted;
+#else
+    Q_UNUSED(priority);
+    return 0;
+#endif
+}
+
+} // namespace Realtime
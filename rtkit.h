@@ -0,0 +1,17 @@
+// rtkit.h
+#ifndef RTKIT_H
+#define RTKIT_H
+
+namespace Realtime {
+
+/**
+ * @brief Asks rtkit over D-Bus for SCHED_FIFO at @p priority (capped to what
+ * it allows) for the calling thread. Returns the priority granted, 0 if
+ * refused or if the build has no Qt DBus. Meant for
+ * RealtimeConfig::priorityFallback.
+ */
+int requestRtkitPriority(int priority);
+
+} // namespace Realtime
+
+#endif // RTKIT_H
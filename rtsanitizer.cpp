@@ -0,0 +1,318 @@
+// rtsanitizer.cpp
+//
+// Only built with -DAUDIOMODIFIER_RT_SANITIZER=ON. Linux/glibc: the real
+// allocator is reached through glibc's __libc_* entry points, everything
+// else through dlsym(RTLD_NEXT) resolved at load time.
+
+#include "rtsanitizer.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+namespace {
+const int kMaxFrames    = 32;
+const int kCallSiteSlots = 1024;   ///< Power of two
+
+thread_local int t_sectionDepth = 0;
+thread_local int t_suppressed   = 0;   ///< Allow scopes plus our own reporting
+
+std::atomic<long> g_violations{0};
+std::atomic<std::uintptr_t> g_callSites[kCallSiteSlots];
+bool g_halt = false;
+
+using MutexLockFn = int (*)(pthread_mutex_t*);
+using ReadFn      = ssize_t (*)(int, void*, size_t);
+using WriteFn     = ssize_t (*)(int, const void*, size_t);
+using OpenFn      = int (*)(const char*, int, ...);
+using OpenAtFn    = int (*)(int, const char*, int, ...);
+using NanosleepFn = int (*)(const struct timespec*, struct timespec*);
+using ClockSleepFn = int (*)(clockid_t, int, const struct timespec*, struct timespec*);
+using UsleepFn    = int (*)(useconds_t);
+using PollFn      = int (*)(struct pollfd*, nfds_t, int);
+using SyscallFn   = long (*)(long, ...);
+
+MutexLockFn  real_pthread_mutex_lock = nullptr;
+ReadFn       real_read = nullptr;
+WriteFn      real_write = nullptr;
+OpenFn       real_open = nullptr;
+OpenAtFn     real_openat = nullptr;
+NanosleepFn  real_nanosleep = nullptr;
+ClockSleepFn real_clock_nanosleep = nullptr;
+UsleepFn     real_usleep = nullptr;
+PollFn       real_poll = nullptr;
+SyscallFn    real_syscall = nullptr;
+
+template <typename Fn>
+void resolve(Fn& fn, const char* name)
+{
+    fn = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+}
+
+// Resolve everything up front: dlsym and the first backtrace() allocate
+__attribute__((constructor)) void initialize()
+{
+    ++t_suppressed;
+    resolve(real_pthread_mutex_lock, "pthread_mutex_lock");
+    resolve(real_read, "read");
+    resolve(real_write, "write");
+    resolve(real_open, "open");
+    resolve(real_openat, "openat");
+    resolve(real_nanosleep, "nanosleep");
+    resolve(real_clock_nanosleep, "clock_nanosleep");
+    resolve(real_usleep, "usleep");
+    resolve(real_poll, "poll");
+    resolve(real_syscall, "syscall");
+
+    void* frames[kMaxFrames];
+    backtrace(frames, kMaxFrames);
+
+    const char* halt = getenv("AUDIOMODIFIER_RTSAN_HALT");
+    g_halt = halt && halt[0] == '1';
+    --t_suppressed;
+}
+
+inline bool checking()
+{
+    return t_sectionDepth > 0 && t_suppressed == 0;
+}
+
+// True the first time a call site is seen; the table is lock-free and never allocates
+bool firstReport(std::uintptr_t site)
+{
+    std::uintptr_t slot = (site >> 4) & (kCallSiteSlots - 1);
+    for (int probe = 0; probe < kCallSiteSlots; ++probe) {
+        std::atomic<std::uintptr_t>& entry = g_callSites[(slot + probe) & (kCallSiteSlots - 1)];
+        std::uintptr_t current = entry.load(std::memory_order_relaxed);
+        if (current == site)
+            return false;
+        if (current == 0 && entry.compare_exchange_strong(current, site))
+            return true;
+        if (current == site)
+            return false;
+    }
+    return false;   // table full: stay quiet rather than flood
+}
+
+void writeString(const char* text)
+{
+    if (real_write)
+        real_write(STDERR_FILENO, text, std::strlen(text));
+}
+
+void report(const char* what)
+{
+    ++t_suppressed;
+    g_violations.fetch_add(1, std::memory_order_relaxed);
+
+    void* frames[kMaxFrames];
+    const int depth = backtrace(frames, kMaxFrames);
+    // frames[0] is report(), frames[1] the hook. Key the call site on a few
+    // callers, so allocations through operator new or QByteArray are told apart.
+    std::uintptr_t site = 1;
+    for (int i = 2; i < depth && i < 6; ++i)
+        site = (site * 31) ^ reinterpret_cast<std::uintptr_t>(frames[i]);
+    if (firstReport(site)) {
+        char header[160];
+        std::snprintf(header, sizeof(header),
+                      "==rtsan== real-time violation: %s called from a real-time section\n", what);
+        writeString(header);
+        backtrace_symbols_fd(frames + 1, depth - 1, STDERR_FILENO);
+        writeString("==rtsan== end of report\n");
+        if (g_halt)
+            abort();
+    }
+    --t_suppressed;
+}
+}
+
+// ----------------------------------------------------------
+// 1. Public API
+// ----------------------------------------------------------
+
+namespace RtSanitizer {
+
+Section::Section()  { ++t_sectionDepth; }
+Section::~Section() { --t_sectionDepth; }
+
+Allow::Allow()  { ++t_suppressed; }
+Allow::~Allow() { --t_suppressed; }
+
+void blocking(const char* function)
+{
+    if (checking())
+        report(function);
+}
+
+long violationCount()
+{
+    return g_violations.load(std::memory_order_relaxed);
+}
+
+} // namespace RtSanitizer
+
+// ----------------------------------------------------------
+// 2. Interposed functions
+// ----------------------------------------------------------
+
+extern "C" {
+
+void* malloc(size_t size)
+{
+    if (checking())
+        report("malloc");
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    if (checking())
+        report("calloc");
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    if (checking())
+        report("realloc");
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    if (ptr && checking())
+        report("free");
+    __libc_free(ptr);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    if (checking())
+        report("memalign");
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    if (checking())
+        report("aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size)
+{
+    if (checking())
+        report("posix_memalign");
+    void* ptr = __libc_memalign(alignment, size);
+    if (!ptr)
+        return ENOMEM;
+    *result = ptr;
+    return 0;
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    if (checking())
+        report("pthread_mutex_lock");
+    return real_pthread_mutex_lock(mutex);
+}
+
+ssize_t read(int fd, void* buffer, size_t count)
+{
+    if (checking())
+        report("read");
+    return real_read(fd, buffer, count);
+}
+
+ssize_t write(int fd, const void* buffer, size_t count)
+{
+    if (checking())
+        report("write");
+    return real_write(fd, buffer, count);
+}
+
+int open(const char* path, int flags, ...)
+{
+    if (checking())
+        report("open");
+    va_list args;
+    va_start(args, flags);
+    const mode_t mode = (flags & (O_CREAT | O_TMPFILE)) ? va_arg(args, mode_t) : 0;
+    va_end(args);
+    return real_open(path, flags, mode);
+}
+
+int openat(int dirfd, const char* path, int flags, ...)
+{
+    if (checking())
+        report("openat");
+    va_list args;
+    va_start(args, flags);
+    const mode_t mode = (flags & (O_CREAT | O_TMPFILE)) ? va_arg(args, mode_t) : 0;
+    va_end(args);
+    return real_openat(dirfd, path, flags, mode);
+}
+
+int nanosleep(const struct timespec* request, struct timespec* remaining)
+{
+    if (checking())
+        report("nanosleep");
+    return real_nanosleep(request, remaining);
+}
+
+int clock_nanosleep(clockid_t clock, int flags, const struct timespec* request, struct timespec* remaining)
+{
+    if (checking())
+        report("clock_nanosleep");
+    return real_clock_nanosleep(clock, flags, request, remaining);
+}
+
+int usleep(useconds_t usec)
+{
+    if (checking())
+        report("usleep");
+    return real_usleep(usec);
+}
+
+int poll(struct pollfd* fds, nfds_t count, int timeout)
+{
+    if (checking())
+        report("poll");
+    return real_poll(fds, count, timeout);
+}
+
+long syscall(long number, ...)
+{
+    // Contended QMutex/QWaitCondition waits arrive here as futex calls
+    if (checking())
+        report("syscall");
+    va_list args;
+    va_start(args, number);
+    long a[6];
+    for (long& arg : a)
+        arg = va_arg(args, long);
+    va_end(args);
+    return real_syscall(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+} // extern "C"
@@ -0,0 +1,62 @@
+// rtsanitizer.h
+#ifndef RTSANITIZER_H
+#define RTSANITIZER_H
+
+// ----------------------------------------------------------
+// Real-time safety sanitizer
+// ----------------------------------------------------------
+
+/**
+ * @brief Debug-build checker for real-time violations.
+ *
+ * Configure with -DAUDIOMODIFIER_RT_SANITIZER=ON. rtsanitizer.cpp then
+ * interposes malloc/free and friends, pthread_mutex_lock and the blocking
+ * syscalls (read/write/open, sleeps, poll, syscall() - which is how a
+ * contended QMutex waits). Any such call made by a thread inside a Section
+ * is reported once per call site with a stack trace on stderr. Set
+ * AUDIOMODIFIER_RTSAN_HALT=1 to abort on the first report instead.
+ *
+ * Without the option everything here compiles to nothing.
+ */
+namespace RtSanitizer {
+
+#ifdef AUDIOMODIFIER_RT_SANITIZER
+
+/// Marks the calling thread as real-time for the lifetime of the object. Nests.
+class Section
+{
+public:
+    Section();
+    ~Section();
+    Section(const Section&) = delete;
+    Section& operator=(const Section&) = delete;
+};
+
+/// Suspends checking on the calling thread, for known and accepted exceptions.
+class Allow
+{
+public:
+    Allow();
+    ~Allow();
+    Allow(const Allow&) = delete;
+    Allow& operator=(const Allow&) = delete;
+};
+
+/// Reports @p function if called inside a Section (for calls no hook can see, e.g. widget reads).
+void blocking(const char* function);
+
+/// Number of violations seen so far (including repeats of already reported call sites).
+long violationCount();
+
+#else
+
+class Section { public: Section() {} };
+class Allow { public: Allow() {} };
+inline void blocking(const char*) {}
+inline long violationCount() { return 0; }
+
+#endif
+
+} // namespace RtSanitizer
+
+#endif // RTSANITIZER_H
@@ -0,0 +1,331 @@
+// sharedoutput.cpp
+
+#include "sharedoutput.h"
+#include "rtsanitizer.h"
+
+#include <QLoggingCategory>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+
+namespace {
+const char kMagic[8] = {'A', 'M', 'S', 'H', 'M', 'O', 'U', 'T'};
+
+// Samples start one page into the object
+const std::size_t kHeaderBytes = 4096;
+static_assert(sizeof(SharedOutputHeader) <= kHeaderBytes, "header must fit its page");
+
+// shm_open() wants a single leading slash
+QByteArray objectName(const QString& name)
+{
+    QByteArray bytes = name.toLocal8Bit();
+    while (bytes.startsWith('/'))
+        bytes.remove(0, 1);
+    return '/' + bytes;
+}
+
+bool fail(QString* error, const QString& message)
+{
+    if (error)
+        *error = message;
+    return false;
+}
+
+#if defined(__linux__)
+long futex(std::atomic<quint32>* word, int op, quint32 value, const timespec* timeout)
+{
+    return syscall(SYS_futex, reinterpret_cast<quint32*>(word), op, value, timeout, nullptr, 0);
+}
+#endif
+}
+
+// ----------------------------------------------------------
+// 1. Writer
+// ----------------------------------------------------------
+
+SharedOutput::SharedOutput()
+    : m_inode(0)
+    , m_map(nullptr)
+    , m_mapSize(0)
+    , m_header(nullptr)
+    , m_samples(nullptr)
+    , m_channels(0)
+    , m_mask(0)
+{
+}
+
+SharedOutput::~SharedOutput()
+{
+    close();
+}
+
+bool SharedOutput::open(const QString& name, int channels, int sampleRate, double seconds, QString* error)
+{
+    close();
+    if (channels <= 0 || sampleRate <= 0)
+        return fail(error, QStringLiteral("Invalid channel count or sample rate"));
+
+#if defined(__linux__)
+    quint32 capacity = 1024;
+    while (capacity < seconds * sampleRate && capacity < (1u << 24))
+        capacity <<= 1;
+
+    // Never truncate an object that readers may still have mapped: unlink
+    // it (they keep their pages) and create a fresh one
+    const QByteArray path = objectName(name);
+    shm_unlink(path.constData());
+    const int fd = shm_open(path.constData(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+        return fail(error, QString::fromLocal8Bit(std::strerror(errno)));
+
+    const std::size_t size = kHeaderBytes + static_cast<std::size_t>(capacity) * channels * sizeof(float);
+    void* map = MAP_FAILED;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        // Populated now: the audio thread never faults a page of the ring in
+        map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    }
+    const int mapError = errno;
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        shm_unlink(path.constData());
+        return fail(error, QString::fromLocal8Bit(std::strerror(mapError)));
+    }
+
+    m_name = name;
+    m_inode = static_cast<quint64>(info.st_ino);
+    m_map = map;
+    m_mapSize = size;
+    m_header = new (map) SharedOutputHeader;
+    m_samples = reinterpret_cast<float*>(static_cast<char*>(map) + kHeaderBytes);
+    m_channels = channels;
+    m_mask = capacity - 1;
+
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    m_header->version = SharedOutputHeader::kVersion;
+    m_header->headerBytes = kHeaderBytes;
+    m_header->sampleRate = static_cast<quint32>(sampleRate);
+    m_header->channels = static_cast<quint32>(channels);
+    m_header->sampleFormat = SharedOutputHeader::kFormatFloat32;
+    m_header->capacityFrames = capacity;
+    m_header->writeFrame.store(0, std::memory_order_relaxed);
+    m_header->wakeSequence.store(0, std::memory_order_relaxed);
+    m_header->waiters.store(0, std::memory_order_relaxed);
+    m_header->createdNs = static_cast<qint64>(now.tv_sec) * 1000000000 + now.tv_nsec;
+    std::memcpy(m_header->magic, kMagic, sizeof(kMagic));
+    m_header->state.store(SharedOutputHeader::kStateLive, std::memory_order_release);
+
+    qCDebug(audioCategory) << "Shared output" << path.constData() << channels << "ch," << sampleRate
+                           << "Hz, ring of" << capacity << "frames";
+    return true;
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(seconds);
+    return fail(error, QStringLiteral("Shared-memory output is only available on Linux"));
+#endif
+}
+
+void SharedOutput::close()
+{
+#if defined(__linux__)
+    if (!m_map)
+        return;
+    // Readers that still hold the mapping learn that nothing more will come
+    m_header->state.store(SharedOutputHeader::kStateClosed, std::memory_order_release);
+    m_header->wakeSequence.fetch_add(1, std::memory_order_seq_cst);
+    futex(&m_header->wakeSequence, FUTEX_WAKE, INT_MAX, nullptr);
+    munmap(m_map, m_mapSize);
+
+    // Only remove the name if it is still ours, not a later writer's
+    const QByteArray path = objectName(m_name);
+    const int fd = shm_open(path.constData(), O_RDONLY, 0);
+    if (fd >= 0) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && static_cast<quint64>(info.st_ino) == m_inode)
+            shm_unlink(path.constData());
+        ::close(fd);
+    }
+#endif
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_header = nullptr;
+    m_samples = nullptr;
+}
+
+void SharedOutput::write(const float* samples, int frames)
+{
+    if (!m_header || !samples || frames <= 0)
+        return;
+
+    // A block larger than the ring only keeps its end
+    const quint64 capacity = static_cast<quint64>(m_mask) + 1;
+    quint64 position = m_header->writeFrame.load(std::memory_order_relaxed);
+    if (static_cast<quint64>(frames) > capacity) {
+        samples += (frames - capacity) * m_channels;
+        position += frames - capacity;
+        frames = static_cast<int>(capacity);
+    }
+
+    const quint32 slot = static_cast<quint32>(position) & m_mask;
+    const int first = std::min<int>(frames, static_cast<int>(capacity - slot));
+    std::memcpy(m_samples + static_cast<std::size_t>(slot) * m_channels, samples,
+                static_cast<std::size_t>(first) * m_channels * sizeof(float));
+    std::memcpy(m_samples, samples + static_cast<std::size_t>(first) * m_channels,
+                static_cast<std::size_t>(frames - first) * m_channels * sizeof(float));
+    m_header->writeFrame.store(position + frames, std::memory_order_release);
+
+    // Readers register before they sleep, so the wake syscall is skipped
+    // while everybody is busy or polling
+    m_header->wakeSequence.fetch_add(1, std::memory_order_seq_cst);
+#if defined(__linux__)
+    if (m_header->waiters.load(std::memory_order_seq_cst) > 0) {
+        // FUTEX_WAKE never blocks
+        RtSanitizer::Allow wake;
+        futex(&m_header->wakeSequence, FUTEX_WAKE, INT_MAX, nullptr);
+    }
+#endif
+}
+
+// ----------------------------------------------------------
+// 2. Reader
+// ----------------------------------------------------------
+
+SharedOutputReader::SharedOutputReader()
+    : m_map(nullptr)
+    , m_mapSize(0)
+    , m_header(nullptr)
+    , m_samples(nullptr)
+{
+}
+
+SharedOutputReader::~SharedOutputReader()
+{
+    close();
+}
+
+bool SharedOutputReader::open(const QString& name, QString* error)
+{
+    close();
+#if defined(__linux__)
+    const QByteArray path = objectName(name);
+    const int fd = shm_open(path.constData(), O_RDWR, 0);
+    if (fd < 0)
+        return fail(error, QString::fromLocal8Bit(std::strerror(errno)));
+
+    struct stat info;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) > kHeaderBytes)
+        map = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return fail(error, QStringLiteral("Cannot map %1").arg(QString::fromLocal8Bit(path.constData())));
+
+    auto* header = static_cast<SharedOutputHeader*>(map);
+    const std::size_t size = static_cast<std::size_t>(info.st_size);
+    // state is published last; the other fields are only read after it
+    const bool valid = header->state.load(std::memory_order_acquire) != SharedOutputHeader::kStateStarting
+                    && std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0
+                    && header->version == SharedOutputHeader::kVersion
+                    && header->sampleFormat == SharedOutputHeader::kFormatFloat32
+                    && header->headerBytes + static_cast<std::size_t>(header->capacityFrames)
+                           * header->channels * sizeof(float) <= size;
+    if (!valid) {
+        munmap(map, size);
+        return fail(error, QStringLiteral("Not an AudioModifier output (or not ready yet)"));
+    }
+
+    m_map = map;
+    m_mapSize = size;
+    m_header = header;
+    m_samples = reinterpret_cast<const float*>(static_cast<const char*>(map) + header->headerBytes);
+    return true;
+#else
+    Q_UNUSED(name);
+    return fail(error, QStringLiteral("Shared-memory output is only available on Linux"));
+#endif
+}
+
+void SharedOutputReader::close()
+{
+#if defined(__linux__)
+    if (m_map)
+        munmap(m_map, m_mapSize);
+#endif
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_header = nullptr;
+    m_samples = nullptr;
+}
+
+quint64 SharedOutputReader::latestFrame() const
+{
+    return m_header ? m_header->writeFrame.load(std::memory_order_acquire) : 0;
+}
+
+quint64 SharedOutputReader::wait(quint64 cursor, int timeoutMs)
+{
+    if (!m_header)
+        return 0;
+    quint64 latest = latestFrame();
+    if (latest > cursor)
+        return latest;
+
+#if defined(__linux__)
+    const quint32 sequence = m_header->wakeSequence.load(std::memory_order_seq_cst);
+    m_header->waiters.fetch_add(1, std::memory_order_seq_cst);
+    // A publish between the first check and the registration bumped the
+    // sequence, so FUTEX_WAIT returns at once instead of missing it
+    if (latestFrame() <= cursor) {
+        timespec timeout;
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_nsec = static_cast<long>(timeoutMs % 1000) * 1000000;
+        futex(&m_header->wakeSequence, FUTEX_WAIT, sequence, &timeout);
+    }
+    m_header->waiters.fetch_sub(1, std::memory_order_seq_cst);
+#else
+    Q_UNUSED(timeoutMs);
+#endif
+    return latestFrame();
+}
+
+int SharedOutputReader::peek(quint64 cursor, const float** frames, int maxFrames) const
+{
+    if (!m_header || !frames || maxFrames <= 0)
+        return 0;
+    const quint64 latest = latestFrame();
+    if (latest <= cursor || !valid(cursor))
+        return 0;
+
+    const quint32 capacity = m_header->capacityFrames;
+    const quint32 slot = static_cast<quint32>(cursor) & (capacity - 1);
+    const quint64 count = std::min<quint64>({latest - cursor, capacity - slot, static_cast<quint64>(maxFrames)});
+    *frames = m_samples + static_cast<std::size_t>(slot) * m_header->channels;
+    return static_cast<int>(count);
+}
+
+bool SharedOutputReader::writerClosed() const
+{
+    return !m_header || m_header->state.load(std::memory_order_acquire) == SharedOutputHeader::kStateClosed;
+}
+
+bool SharedOutputReader::valid(quint64 cursor) const
+{
+    if (!m_header)
+        return false;
+    const quint64 latest = latestFrame();
+    return cursor >= latest || latest - cursor <= m_header->capacityFrames / 2;
+}
@@ -0,0 +1,186 @@
+// sharedoutput.h
+#ifndef SHAREDOUTPUT_H
+#define SHAREDOUTPUT_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <cstddef>
+
+// ----------------------------------------------------------
+// Shared-memory ring layout
+// ----------------------------------------------------------
+
+/**
+ * @brief Header at the start of the POSIX shared-memory object
+ * /dev/shm/<name>. Samples start headerBytes into the object.
+ *
+ * The samples are interleaved little-endian float32 frames in a ring of
+ * capacityFrames (a power of two): frame f lives at index
+ * f & (capacityFrames - 1). writeFrame counts every frame ever published
+ * and is stored with release semantics after the samples; a reader loads
+ * it with acquire semantics, reads the frames it has not seen yet and
+ * then re-reads writeFrame. Frames more than half a ring behind it are
+ * treated as lost (the other half is the margin for the block the writer
+ * may be copying at that moment) and must be discarded.
+ *
+ * To sleep instead of poll, a reader increments waiters, re-checks
+ * writeFrame and calls FUTEX_WAIT (shared, not FUTEX_PRIVATE) on
+ * wakeSequence with the value it saw; the writer bumps wakeSequence after
+ * every publish and only calls FUTEX_WAKE while waiters is non-zero.
+ *
+ * state is stored last, with release semantics, once everything else is
+ * valid; a reader loads it with acquire semantics before looking at any
+ * other field. When the writer closes, state becomes kStateClosed after
+ * the last publish and sleeping readers are woken. Each open() creates a
+ * fresh object, so readers of an earlier one keep their mapping and see it
+ * closed rather than overwritten.
+ */
+struct SharedOutputHeader
+{
+    static constexpr quint32 kVersion = 2;
+    static constexpr quint32 kFormatFloat32 = 1;
+
+    static constexpr quint32 kStateStarting = 0;    ///< Being set up; no other field is valid yet
+    static constexpr quint32 kStateLive     = 1;
+    static constexpr quint32 kStateClosed   = 2;    ///< The writer is gone; no more frames will come
+
+    char magic[8];                          ///< "AMSHMOUT"
+    std::atomic<quint32> state;             ///< kState*
+    quint32 version;
+    quint32 headerBytes;                    ///< Offset of the first sample (a page)
+    quint32 sampleRate;
+    quint32 channels;
+    quint32 sampleFormat;                   ///< kFormatFloat32
+    quint32 capacityFrames;                 ///< Power of two
+    std::atomic<quint64> writeFrame;        ///< Frames published so far
+    std::atomic<quint32> wakeSequence;      ///< Futex word, bumped on every publish
+    std::atomic<quint32> waiters;           ///< Readers blocked in FUTEX_WAIT
+    qint64 createdNs;                       ///< CLOCK_MONOTONIC time of creation
+};
+
+static_assert(std::atomic<quint64>::is_always_lock_free, "the ring index must be lock-free across processes");
+static_assert(std::atomic<quint32>::is_always_lock_free, "the futex word must be lock-free across processes");
+
+// ----------------------------------------------------------
+// SharedOutput Class Declaration
+// ----------------------------------------------------------
+
+/**
+ * @brief Publishes the processed stream in a shared-memory ring that any
+ * number of local processes can read without a copy and without the
+ * sound server (see SharedOutputHeader, or SharedOutputReader).
+ *
+ * write() costs the audio thread one memcpy into the ring plus, only if a
+ * reader is asleep, one FUTEX_WAKE; the number of readers makes no
+ * difference, as each keeps its own position. Linux only; open() fails
+ * elsewhere.
+ */
+class SharedOutput
+{
+public:
+    SharedOutput();
+    ~SharedOutput();
+
+    SharedOutput(const SharedOutput&) = delete;
+    SharedOutput& operator=(const SharedOutput&) = delete;
+
+    /**
+     * @brief Not real-time safe. Creates the shared-memory object @p name,
+     * unlinking any earlier one first (its readers keep their mapping).
+     * @param seconds Ring length; rounded up to a power-of-two frame count.
+     */
+    bool open(const QString& name, int channels, int sampleRate, double seconds = 2.0,
+              QString* error = nullptr);
+
+    /// Not real-time safe. Marks the ring closed, wakes sleeping readers, unmaps and removes the object.
+    void close();
+
+    bool isOpen() const { return m_header != nullptr; }
+
+    /// Audio thread. Interleaved frames with the channel count given to open().
+    void write(const float* samples, int frames);
+
+private:
+    QString m_name;
+    quint64 m_inode;                        ///< Of our object; a later writer may reuse the name
+    void* m_map;
+    std::size_t m_mapSize;
+    SharedOutputHeader* m_header;
+    float* m_samples;
+    int m_channels;
+    quint32 m_mask;
+};
+
+// ----------------------------------------------------------
+// SharedOutputReader Class Declaration
+// ----------------------------------------------------------
+
+/**
+ * @brief Consumer side of SharedOutput, for C++ clients.
+ *
+ * Typical loop:
+ * @code
+ *   quint64 cursor = reader.latestFrame();
+ *   while (running) {
+ *       const bool closed = reader.writerClosed();  // checked first: the frames before it still drain
+ *       if (!closed)
+ *           reader.wait(cursor, 100);
+ *       const float* frames;
+ *       int count;
+ *       while ((count = reader.peek(cursor, &frames, 4096)) > 0) {
+ *           consume(frames, count);             // zero copy, straight from the ring
+ *           if (!reader.valid(cursor)) { ... }  // writer lapped us while consuming: torn
+ *           cursor += count;
+ *       }
+ *       if (!reader.valid(cursor))
+ *           cursor = reader.latestFrame();      // fell behind by more than the ring
+ *       if (closed)
+ *           break;
+ *   }
+ * @endcode
+ */
+class SharedOutputReader
+{
+public:
+    SharedOutputReader();
+    ~SharedOutputReader();
+
+    SharedOutputReader(const SharedOutputReader&) = delete;
+    SharedOutputReader& operator=(const SharedOutputReader&) = delete;
+
+    bool open(const QString& name, QString* error = nullptr);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    const SharedOutputHeader* header() const { return m_header; }
+
+    /// Frames published so far.
+    quint64 latestFrame() const;
+
+    /**
+     * @brief Sleeps until frames past @p cursor are published or @p timeoutMs passes.
+     * @return latestFrame() on return.
+     */
+    quint64 wait(quint64 cursor, int timeoutMs);
+
+    /**
+     * @brief Contiguous published frames from @p cursor on, up to @p maxFrames.
+     * @return Frame count at @p frames; 0 if nothing new or @p cursor is no longer valid.
+     */
+    int peek(quint64 cursor, const float** frames, int maxFrames) const;
+
+    /// False once the frame at @p cursor is more than half a ring behind the writer.
+    bool valid(quint64 cursor) const;
+
+    /// True once the writer has closed the ring; frames published before stay readable.
+    bool writerClosed() const;
+
+private:
+    void* m_map;
+    std::size_t m_mapSize;
+    SharedOutputHeader* m_header;           ///< Writable: readers register in waiters
+    const float* m_samples;
+};
+
+#endif // SHAREDOUTPUT_H
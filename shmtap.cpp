@@ -0,0 +1,103 @@
+// shmtap.cpp
+//
+// Reference consumer of the shared-memory output (--shm-output): follows the
+// ring of a running AudioModifier and either streams the raw float frames to
+// stdout (e.g. into ffmpeg -f f32le) or prints a level line per second.
+
+#include "sharedoutput.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+// Frames taken from the ring per copy
+const int kChunkFrames = 4096;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("name", "Shared-memory name given to --shm-output.");
+    QCommandLineOption meterOption("meter", "Print the RMS level once per second instead of writing samples.");
+    parser.addOption(meterOption);
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.isEmpty())
+        parser.showHelp(1);
+
+    SharedOutputReader reader;
+    QString error;
+    if (!reader.open(arguments.first(), &error)) {
+        std::fprintf(stderr, "%s\n", error.toLocal8Bit().constData());
+        return 1;
+    }
+    const SharedOutputHeader* header = reader.header();
+    const int channels = static_cast<int>(header->channels);
+    std::fprintf(stderr, "%u Hz, %d channels, ring of %u frames\n",
+                 header->sampleRate, channels, header->capacityFrames);
+
+    const bool meter = parser.isSet(meterOption);
+    quint64 cursor = reader.latestFrame();
+    double sumSquares = 0.0;
+    quint64 meterFrames = 0;
+    quint64 lost = 0;
+    std::vector<float> chunk(static_cast<size_t>(kChunkFrames) * channels);
+    while (true) {
+        // Checked before draining: whatever the writer published before
+        // closing is still played out
+        const bool closed = reader.writerClosed();
+        if (!closed)
+            reader.wait(cursor, 500);
+
+        const float* frames = nullptr;
+        int count;
+        while ((count = reader.peek(cursor, &frames, kChunkFrames)) > 0) {
+            // Copied out first: only frames still valid after the copy are
+            // known not to have been overwritten mid-read
+            std::copy(frames, frames + static_cast<size_t>(count) * channels, chunk.begin());
+            if (!reader.valid(cursor)) {
+                // The writer lapped these frames while we read them: torn
+                lost += count;
+                cursor += count;
+                break;
+            }
+            cursor += count;
+            if (!meter) {
+                if (std::fwrite(chunk.data(), sizeof(float) * channels, count, stdout) != static_cast<size_t>(count))
+                    return 0;   // Reader of the pipe went away
+                continue;
+            }
+            for (int i = 0; i < count * channels; ++i)
+                sumSquares += static_cast<double>(chunk[i]) * chunk[i];
+            meterFrames += count;
+            if (meterFrames >= header->sampleRate) {
+                const double rms = std::sqrt(sumSquares / (meterFrames * channels));
+                std::printf("%7.1f dBFS rms, %llu frames lost\n",
+                            20.0 * std::log10(std::max(rms, 1e-9)), static_cast<unsigned long long>(lost));
+                std::fflush(stdout);
+                sumSquares = 0.0;
+                meterFrames = 0;
+            }
+        }
+        if (!reader.valid(cursor)) {
+            // Fell more than half a ring behind: skip to the present
+            const quint64 latest = reader.latestFrame();
+            lost += latest - cursor;
+            cursor = latest;
+        }
+        if (closed) {
+            std::fflush(stdout);
+            std::fprintf(stderr, "Writer closed, %llu frames lost\n", static_cast<unsigned long long>(lost));
+            return 0;
+        }
+    }
+}
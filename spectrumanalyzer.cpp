@@ -0,0 +1,157 @@
+#include "spectrumanalyzer.h"
+#include "realtime.h"
+
+#include <QLoggingCategory>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPECTRUM_SSE 1
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+
+namespace {
+const double kPi = 3.14159265358979323846;
+
+// Floor of the displayed range; also what silence decays to.
+const float kFloorDb = -120.0f;
+// Fall-back per analysis frame (~94 frames/s at 48 kHz), i.e. ~50 dB/s.
+const float kDecayDbPerFrame = 0.5f;
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(QObject* parent)
+    : QThread(parent)
+    , m_running(false)
+    , m_sampleRate(48000)
+    , m_fft(kFftSize)
+    , m_window(kFftSize)
+    , m_history(kFftSize, 0.0f)
+    , m_frame(kFftSize)
+    , m_re(kBins)
+    , m_im(kBins)
+    , m_smoothed(kBins, kFloorDb)
+    , m_pending(0)
+    , m_normalization(1.0f)
+    , m_result(kBins, kFloorDb)
+    , m_resultFresh(false)
+{
+    double windowSum = 0.0;
+    for (int i = 0; i < kFftSize; ++i) {
+        m_window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * i / kFftSize));
+        windowSum += m_window[i];
+    }
+    // Full-scale sine reads 0 dB: amplitude A gives |X| = A * sum(w) / 2
+    m_normalization = static_cast<float>(2.0 / windowSum);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    stop();
+    wait();
+}
+
+void SpectrumAnalyzer::stop()
+{
+    m_running = false;
+}
+
+void SpectrumAnalyzer::pushSamples(const float* interleaved, int frames, int channels)
+{
+    while (frames > 0) {
+        AudioBlock* block = m_ring.beginWrite();
+        if (!block)
+            return; // worker is behind; a dropped block only costs one spectrum
+        int used = block->assign(interleaved, frames, channels);
+        m_ring.commitWrite();
+        interleaved += static_cast<size_t>(used) * std::max(channels, 1);
+        frames -= used;
+    }
+}
+
+bool SpectrumAnalyzer::takeSpectrum(std::vector<float>& magnitudesDb)
+{
+    QMutexLocker lock(&m_resultMutex);
+    if (!m_resultFresh)
+        return false;
+    magnitudesDb = m_result;
+    m_resultFresh = false;
+    return true;
+}
+
+void SpectrumAnalyzer::run()
+{
+    m_running = true;
+    Realtime::flushDenormals();
+    qCDebug(audioCategory) << "SpectrumAnalyzer started";
+
+    while (m_running) {
+        const AudioBlock* block = m_ring.beginRead();
+        if (!block) {
+            QThread::msleep(10);
+            continue;
+        }
+
+        // Slide the history window and append the new samples
+        int n = std::min(block->frames, kFftSize);
+        std::memmove(m_history.data(), m_history.data() + n, (kFftSize - n) * sizeof(float));
+        std::memcpy(m_history.data() + kFftSize - n, block->samples + block->frames - n, n * sizeof(float));
+        m_ring.commitRead();
+
+        m_pending += n;
+        if (m_pending >= kHop) {
+            m_pending = 0;
+            analyze();
+        }
+    }
+
+    qCDebug(audioCategory) << "SpectrumAnalyzer stopped";
+}
+
+void SpectrumAnalyzer::analyze()
+{
+    const float* x = m_history.data();
+    const float* w = m_window.data();
+    float* f = m_frame.data();
+
+    int i = 0;
+#ifdef SPECTRUM_SSE
+    for (; i + 4 <= kFftSize; i += 4) {
+        _mm_storeu_ps(f + i, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(w + i)));
+    }
+#endif
+    for (; i < kFftSize; ++i) {
+        f[i] = x[i] * w[i];
+    }
+
+    m_fft.forward(m_frame.data(), m_re.data(), m_im.data());
+
+    // Power spectrum, reusing m_re for |X|^2
+    const float norm2 = m_normalization * m_normalization;
+    i = 0;
+#ifdef SPECTRUM_SSE
+    const __m128 vNorm = _mm_set1_ps(norm2);
+    for (; i + 4 <= kBins; i += 4) {
+        __m128 re = _mm_loadu_ps(&m_re[i]);
+        __m128 im = _mm_loadu_ps(&m_im[i]);
+        __m128 p  = _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im));
+        _mm_storeu_ps(&m_re[i], _mm_mul_ps(p, vNorm));
+    }
+#endif
+    for (; i < kBins; ++i) {
+        m_re[i] = (m_re[i] * m_re[i] + m_im[i] * m_im[i]) * norm2;
+    }
+
+    for (i = 0; i < kBins; ++i) {
+        float db = 10.0f * std::log10(m_re[i] + 1e-12f);
+        db = std::max(db, kFloorDb);
+        // Instant rise, slow fall keeps the display readable
+        m_smoothed[i] = std::max(db, m_smoothed[i] - kDecayDbPerFrame);
+    }
+
+    QMutexLocker lock(&m_resultMutex);
+    m_result = m_smoothed;
+    m_resultFresh = true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QThread>
+#include <QMutex>
+#include <atomic>
+#include <vector>
+
+#include "audioblock.h"
+#include "fft.h"
+#include "spscring.h"
+
+/**
+ * @brief Background FFT worker feeding the SpectrumWidget.
+ *
+ * The AudioThread only copies each processed block into a lock-free ring
+ * (pushSamples()). This low-priority thread drains the ring, runs a
+ * Hann-windowed FFT every kHop samples and publishes smoothed magnitudes
+ * in dB for the UI to pick up with takeSpectrum().
+ */
+class SpectrumAnalyzer : public QThread
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kFftSize = 2048;
+    static constexpr int kHop     = 512;
+    static constexpr int kBins    = kFftSize / 2 + 1;
+
+    explicit SpectrumAnalyzer(QObject* parent = nullptr);
+    ~SpectrumAnalyzer();
+
+    void stop();
+
+    /// Sample rate of the pushed stream; read by the UI for the frequency axis.
+    void setSampleRate(int sampleRate) { m_sampleRate.store(sampleRate); }
+    int sampleRate() const { return m_sampleRate.load(); }
+
+    /**
+     * @brief Audio thread: queues interleaved samples (downmixed to mono).
+     * Never blocks; drops data if the worker falls behind.
+     */
+    void pushSamples(const float* interleaved, int frames, int channels);
+
+    /**
+     * @brief UI thread: copies the latest spectrum (kBins values in dB).
+     * @return false if nothing new was computed since the last call.
+     */
+    bool takeSpectrum(std::vector<float>& magnitudesDb);
+
+protected:
+    void run() override;
+
+private:
+    void analyze();
+
+    std::atomic<bool> m_running;
+    std::atomic<int> m_sampleRate;
+
+    SpscRing<AudioBlock, 64> m_ring;
+
+    // Worker-thread state
+    RealFft m_fft;
+    std::vector<float> m_window;
+    std::vector<float> m_history;   ///< Last kFftSize input samples, oldest first
+    std::vector<float> m_frame;     ///< Windowed copy handed to the FFT
+    std::vector<float> m_re;
+    std::vector<float> m_im;
+    std::vector<float> m_smoothed;  ///< Peak-decay smoothed magnitudes in dB
+    int m_pending;                  ///< New samples since the last FFT
+    float m_normalization;
+
+    // Hand-off to the UI (worker and UI are not real-time, a mutex is fine)
+    QMutex m_resultMutex;
+    std::vector<float> m_result;
+    bool m_resultFresh;
+};
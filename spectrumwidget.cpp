@@ -0,0 +1,180 @@
+#include "spectrumwidget.h"
+#include "spectrumanalyzer.h"
+
+#include <QPainter>
+#include <QPainterPath>
+#include <QResizeEvent>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+const float kMinFreq  = 20.0f;
+const float kTopDb    = 0.0f;
+const float kBottomDb = -100.0f;
+// Fraction of the widget height used by the spectrum curve; the waterfall
+// spectrogram fills the rest.
+const float kCurveFraction = 0.45f;
+}
+
+SpectrumWidget::SpectrumWidget(QWidget *parent)
+    : QWidget(parent)
+    , m_analyzer(nullptr)
+    , m_mappedSampleRate(0)
+    , m_filterIdx(0)
+    , m_lowFreq(0.0f)
+    , m_highFreq(0.0f)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+
+    // Black -> blue -> cyan -> yellow -> red
+    for (int i = 0; i < 256; ++i) {
+        float t = i / 255.0f;
+        int r = 0, g = 0, b = 0;
+        if (t < 0.25f) {
+            b = static_cast<int>(255 * t / 0.25f);
+        } else if (t < 0.5f) {
+            g = static_cast<int>(255 * (t - 0.25f) / 0.25f);
+            b = 255;
+        } else if (t < 0.75f) {
+            r = static_cast<int>(255 * (t - 0.5f) / 0.25f);
+            g = 255;
+            b = static_cast<int>(255 * (0.75f - t) / 0.25f);
+        } else {
+            r = 255;
+            g = static_cast<int>(255 * (1.0f - t) / 0.25f);
+        }
+        m_palette[i] = qRgb(r, g, b);
+    }
+}
+
+void SpectrumWidget::setBandMarkers(int filterIdx, float lowFreq, float highFreq, int /*sampleRate*/)
+{
+    m_filterIdx = filterIdx;
+    m_lowFreq   = lowFreq;
+    m_highFreq  = highFreq;
+    update();
+}
+
+void SpectrumWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+
+    int curveHeight = static_cast<int>(height() * kCurveFraction);
+    m_spectrogram = QImage(std::max(width(), 1),
+                           std::max(height() - curveHeight, 1),
+                           QImage::Format_RGB32);
+    m_spectrogram.fill(Qt::black);
+    m_mappedSampleRate = 0;     // force a new column map
+}
+
+void SpectrumWidget::rebuildColumnMap(int sampleRate)
+{
+    const int w = std::max(width(), 1);
+    const float maxFreq = sampleRate * 0.5f;
+    const float binHz = static_cast<float>(sampleRate) / SpectrumAnalyzer::kFftSize;
+
+    m_columnBins.resize(w + 1);
+    for (int x = 0; x <= w; ++x) {
+        float freq = kMinFreq * std::pow(maxFreq / kMinFreq, static_cast<float>(x) / w);
+        int bin = static_cast<int>(freq / binHz);
+        m_columnBins[x] = std::clamp(bin, 0, SpectrumAnalyzer::kBins - 1);
+    }
+    m_columns.assign(w, kBottomDb);
+    m_mappedSampleRate = sampleRate;
+}
+
+float SpectrumWidget::frequencyToX(float freq) const
+{
+    const int sampleRate = m_mappedSampleRate > 0 ? m_mappedSampleRate : 48000;
+    const float maxFreq = sampleRate * 0.5f;
+    if (freq <= kMinFreq) return 0.0f;
+    return width() * std::log(freq / kMinFreq) / std::log(maxFreq / kMinFreq);
+}
+
+void SpectrumWidget::poll()
+{
+    if (!m_analyzer || !isVisible())
+        return;
+    if (!m_analyzer->takeSpectrum(m_spectrum))
+        return;
+
+    const int sampleRate = m_analyzer->sampleRate();
+    if (sampleRate <= 0)
+        return;
+    if (sampleRate != m_mappedSampleRate || static_cast<int>(m_columns.size()) != width())
+        rebuildColumnMap(sampleRate);
+
+    // Reduce bins to one value per pixel column (max over the covered bins)
+    for (size_t x = 0; x < m_columns.size(); ++x) {
+        int first = m_columnBins[x];
+        int last  = std::max(first, m_columnBins[x + 1] - 1);
+        float v = kBottomDb;
+        for (int b = first; b <= last; ++b)
+            v = std::max(v, m_spectrum[b]);
+        m_columns[x] = v;
+    }
+
+    scrollSpectrogram();
+    update();
+}
+
+void SpectrumWidget::scrollSpectrogram()
+{
+    if (m_spectrogram.isNull())
+        return;
+
+    // Waterfall: shift every row down by one and draw the newest on top.
+    // Rows are contiguous in memory, so this is a single memmove.
+    const int rows = m_spectrogram.height();
+    const qsizetype stride = m_spectrogram.bytesPerLine();
+    uchar* bits = m_spectrogram.bits();
+    if (rows > 1)
+        std::memmove(bits + stride, bits, stride * (rows - 1));
+
+    QRgb* top = reinterpret_cast<QRgb*>(m_spectrogram.scanLine(0));
+    const int cols = std::min(m_spectrogram.width(), static_cast<int>(m_columns.size()));
+    for (int x = 0; x < cols; ++x) {
+        float t = (m_columns[x] - kBottomDb) / (kTopDb - kBottomDb);
+        int index = std::clamp(static_cast<int>(t * 255.0f), 0, 255);
+        top[x] = m_palette[index];
+    }
+}
+
+void SpectrumWidget::paintEvent(QPaintEvent * /*event*/)
+{
+    QPainter painter(this);
+
+    const int w = width();
+    const int curveHeight = static_cast<int>(height() * kCurveFraction);
+
+    painter.fillRect(QRect(0, 0, w, curveHeight), Qt::black);
+    painter.drawImage(0, curveHeight, m_spectrogram);
+
+    // Spectrum curve
+    if (!m_columns.empty()) {
+        QPainterPath path;
+        for (size_t x = 0; x < m_columns.size(); ++x) {
+            float t = (m_columns[x] - kBottomDb) / (kTopDb - kBottomDb);
+            t = std::clamp(t, 0.0f, 1.0f);
+            float y = curveHeight - t * curveHeight;
+            if (x == 0)
+                path.moveTo(0, y);
+            else
+                path.lineTo(static_cast<qreal>(x), y);
+        }
+        painter.setPen(QPen(Qt::green, 1));
+        painter.drawPath(path);
+    }
+
+    // Band filter markers (1 = low pass, 2 = high pass, 3/4 = band)
+    painter.setPen(QPen(Qt::yellow, 1, Qt::DashLine));
+    if (m_filterIdx == 1 || m_filterIdx == 3 || m_filterIdx == 4) {
+        float x = frequencyToX(m_lowFreq);
+        painter.drawLine(QPointF(x, 0), QPointF(x, height()));
+    }
+    if (m_filterIdx == 2 || m_filterIdx == 3 || m_filterIdx == 4) {
+        float x = frequencyToX(m_highFreq);
+        painter.drawLine(QPointF(x, 0), QPointF(x, height()));
+    }
+}
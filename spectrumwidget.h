@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QWidget>
+#include <QImage>
+#include <vector>
+
+class SpectrumAnalyzer;
+
+/**
+ * @brief Spectrum curve plus scrolling spectrogram, drawn with QPainter.
+ *
+ * poll() is driven by the MainWindow display-rate timer. The widget only
+ * repaints when the analyzer produced a new frame; the spectrogram is kept
+ * in a QImage that is scrolled by one column per frame, so only the new
+ * column has to be computed.
+ */
+class SpectrumWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit SpectrumWidget(QWidget *parent = nullptr);
+
+    void setAnalyzer(SpectrumAnalyzer* analyzer) { m_analyzer = analyzer; }
+
+public slots:
+    /// Fetches the latest spectrum from the analyzer and repaints if it changed.
+    void poll();
+
+    /// Shows the band filter edges so the sliders can be tuned by eye.
+    void setBandMarkers(int filterIdx, float lowFreq, float highFreq, int sampleRate);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    void rebuildColumnMap(int sampleRate);
+    void scrollSpectrogram();
+    float frequencyToX(float freq) const;
+
+    SpectrumAnalyzer* m_analyzer;
+    std::vector<float> m_spectrum;      ///< Latest magnitudes in dB
+    std::vector<float> m_columns;       ///< Max dB per pixel column (log frequency axis)
+    std::vector<int> m_columnBins;      ///< First bin of each column, size width + 1
+    int m_mappedSampleRate;
+
+    QImage m_spectrogram;
+    QRgb m_palette[256];
+
+    int m_filterIdx;
+    float m_lowFreq;
+    float m_highFreq;
+};
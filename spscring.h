@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief Fixed-capacity, wait-free single-producer/single-consumer ring.
+ *
+ * Used to hand data from the real-time AudioThread to other threads without
+ * locks or allocations. push() is only ever called by the producer and
+ * pop() only by the consumer. When the ring is full, push() fails and the
+ * item is dropped; the producer never waits for the consumer.
+ *
+ * @tparam T        Trivially copyable item type.
+ * @tparam Capacity Number of slots, must be a power of two.
+ */
+template <typename T, std::size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : m_head(0), m_tail(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /// Producer side. Returns false (and drops @p item) when full.
+    bool push(const T& item)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= Capacity)
+            return false;
+        m_items[head & kMask] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Producer side, zero-copy variant: returns the next free slot
+     * (or nullptr when full). Fill it, then call commitWrite().
+     */
+    T* beginWrite()
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= Capacity)
+            return nullptr;
+        return &m_items[head & kMask];
+    }
+
+    void commitWrite()
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// Consumer side. Returns false when empty.
+    bool pop(T& item)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head.load(std::memory_order_acquire) == tail)
+            return false;
+        item = m_items[tail & kMask];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Consumer side, zero-copy variant: returns the oldest item
+     * (or nullptr when empty). Release it with commitRead().
+     */
+    const T* beginRead() const
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head.load(std::memory_order_acquire) == tail)
+            return nullptr;
+        return &m_items[tail & kMask];
+    }
+
+    void commitRead()
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// Approximate number of queued items (exact from either endpoint's own thread).
+    std::size_t size() const
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+    static constexpr std::size_t kMask = Capacity - 1;
+
+    T m_items[Capacity];
+    alignas(64) std::atomic<std::size_t> m_head;  ///< Written by the producer only
+    alignas(64) std::atomic<std::size_t> m_tail;  ///< Written by the consumer only
+};
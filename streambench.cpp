@@ -0,0 +1,123 @@
+// streambench.cpp
+//
+// Headless throughput test of the multi-stream server: runs a number of
+// voice streams with mixed effect settings through StreamServer and reports
+// how many real-time streams one core sustains at the given block size.
+
+#include "streamserver.h"
+#include "pitchengine.h"
+#include "realtime.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+#include <QThread>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+const float kPi = 3.14159265f;
+
+// Every stream gets the gate and band filter; a share of them distortion or pitch
+DspParameters streamParameters(int index, double pitchedShare)
+{
+    DspParameters p;
+    p.gateEnabled = true;
+    p.gateThresholdDb = -45.0f;
+    p.filter = DspFilter::BandPass;
+    p.lowFreq = 300.0f;
+    p.highFreq = 3400.0f;
+    if (index % 2 == 1)
+        p.distortionGain = 2.0f;
+    const int pitchEvery = pitchedShare > 0.0 ? static_cast<int>(std::lround(1.0 / pitchedShare)) : 0;
+    if (pitchEvery > 0 && index % pitchEvery == 0)
+        p.pitchSemitones = (index / pitchEvery) % 2 ? 3.0f : -4.0f;
+    return p;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    SoundTouchPitchEngine::setInterpolation(SoundTouchInterpolation::Shannon);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption streamsOption("streams", "Number of concurrent streams.", "count", "256");
+    QCommandLineOption rateOption("rate", "Sample rate of the streams.", "Hz", "16000");
+    QCommandLineOption blockOption("block", "Frames per block.", "frames", "160");
+    QCommandLineOption workersOption("workers", "Pool threads besides the main thread (-1 = one per core).",
+                                     "count", "-1");
+    QCommandLineOption cpusOption("cpus", "Pin the workers to the comma-separated <cpus>.", "cpus");
+    QCommandLineOption secondsOption("seconds", "Seconds of audio per stream.", "seconds", "10");
+    QCommandLineOption pitchedOption("pitched", "Share of pitch-shifted streams, 0..1.", "share", "0.25");
+    QCommandLineOption realtimeOption("realtime", "Pace the ticks at the block rate instead of running flat out.");
+    parser.addOption(streamsOption);
+    parser.addOption(rateOption);
+    parser.addOption(blockOption);
+    parser.addOption(workersOption);
+    parser.addOption(cpusOption);
+    parser.addOption(secondsOption);
+    parser.addOption(pitchedOption);
+    parser.addOption(realtimeOption);
+    parser.process(app);
+
+    StreamServerConfig config;
+    const int streams = std::max(parser.value(streamsOption).toInt(), 1);
+    config.sampleRate = std::max(parser.value(rateOption).toInt(), 8000);
+    config.blockFrames = std::max(parser.value(blockOption).toInt(), 16);
+    config.maxStreams = streams;
+    config.workers = parser.value(workersOption).toInt();
+    for (const QString& cpu : parser.value(cpusOption).split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const int index = cpu.trimmed().toInt(&ok);
+        if (ok)
+            config.cpus.push_back(index);
+    }
+    const double pitchedShare = parser.value(pitchedOption).toDouble();
+    const bool paced = parser.isSet(realtimeOption);
+
+    StreamServer server(config);
+    std::vector<int> ids;
+    for (int i = 0; i < streams; ++i)
+        ids.push_back(server.addStream(streamParameters(i, pitchedShare)));
+
+    // A vowel-like test signal per stream, detuned so no two lanes match
+    const int frames = config.blockFrames;
+    std::vector<float> block(frames);
+    std::vector<double> phase(streams, 0.0);
+    const qint64 blockNs = server.stats().blockNs;
+    const int ticks = static_cast<int>(parser.value(secondsOption).toDouble() * config.sampleRate / frames);
+
+    qint64 deadline = StreamServer::clockNs() + blockNs;
+    const qint64 start = StreamServer::clockNs();
+    for (int tick = 0; tick < ticks; ++tick) {
+        for (int s = 0; s < streams; ++s) {
+            const double step = 2.0 * kPi * (110.0 + s) / config.sampleRate;
+            for (int i = 0; i < frames; ++i) {
+                block[i] = 0.3f * static_cast<float>(std::sin(phase[s]) + 0.5 * std::sin(3.0 * phase[s]));
+                phase[s] += step;
+            }
+            server.submit(ids[s], block.data(), paced ? deadline : 0);
+        }
+        server.process();
+
+        if (paced) {
+            while (StreamServer::clockNs() < deadline)
+                QThread::usleep(200);
+            deadline += blockNs;
+        }
+    }
+    const double wallSeconds = (StreamServer::clockNs() - start) * 1e-9;
+
+    const StreamServerStats stats = server.stats();
+    std::printf("%d streams, %d frames per block (%.1f ms) at %d Hz, %.0f%% pitched\n",
+                streams, frames, blockNs * 1e-6, config.sampleRate, pitchedShare * 100.0);
+    std::printf("%lld stream blocks in %.2f s wall, %.0f ns per stream block\n",
+                static_cast<long long>(stats.streamBlocks), wallSeconds,
+                stats.streamBlocks > 0 ? static_cast<double>(stats.busyNs) / stats.streamBlocks : 0.0);
+    std::printf("%.0f streams per core, %lld missed deadlines\n",
+                stats.streamsPerCore(), static_cast<long long>(stats.missedDeadlines));
+    return 0;
+}
@@ -0,0 +1,392 @@
+// streamserver.cpp
+
+#include "streamserver.h"
+#include "realtime.h"
+
+#include <QLoggingCategory>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+
+Q_DECLARE_LOGGING_CATEGORY(audioCategory)
+
+// ----------------------------------------------------------
+// 1. Worker threads
+// ----------------------------------------------------------
+
+/**
+ * @brief Pool thread that takes batches off the current tick until none are
+ * left. Sleeps on a semaphore between ticks.
+ */
+class StreamWorker : public QThread
+{
+public:
+    StreamWorker(StreamServer* owner, int executor, int cpu)
+        : m_owner(owner)
+        , m_executor(executor)
+        , m_cpu(cpu)
+        , m_running(true)
+    {
+    }
+
+    void wake() { m_start.release(); }
+
+    void stop()
+    {
+        m_running = false;
+        m_start.release();
+    }
+
+protected:
+    void run() override
+    {
+        Realtime::promoteCurrentThread("Stream worker", m_cpu);
+        while (true) {
+            m_start.acquire();
+            if (!m_running)
+                break;
+            m_owner->runBatches(m_executor);
+            m_owner->m_done.release();
+        }
+    }
+
+private:
+    StreamServer* m_owner;
+    int m_executor;
+    int m_cpu;
+    std::atomic<bool> m_running;
+    QSemaphore m_start;
+};
+
+// ----------------------------------------------------------
+// 2. Setup
+// ----------------------------------------------------------
+
+StreamServer::StreamServer(const StreamServerConfig& config)
+    : m_config(config)
+    , m_streamCount(0)
+    , m_batchCount(0)
+    , m_nextBatch(0)
+    , m_busyNs(0)
+    , m_tickMissed(0)
+    , m_missed(0)
+    , m_ticks(0)
+    , m_streamBlocks(0)
+{
+    m_config.sampleRate  = std::max(m_config.sampleRate, 1);
+    m_config.blockFrames = std::max(m_config.blockFrames, 1);
+    m_config.maxStreams  = std::max(m_config.maxStreams, 1);
+    m_blockNs = static_cast<qint64>(m_config.blockFrames) * 1000000000 / m_config.sampleRate;
+
+    m_slots.resize(m_config.maxStreams);
+    m_ready.resize(m_config.maxStreams);
+    m_batches.resize((m_config.maxStreams + kChainLanes - 1) / kChainLanes);
+
+    int workers = m_config.workers;
+    if (workers < 0)
+        workers = QThread::idealThreadCount() - 1;
+    workers = std::clamp(workers, 0, static_cast<int>(m_batches.size()) - 1);
+
+    m_scratch.resize(workers + 1);
+    for (std::vector<float>& scratch : m_scratch)
+        scratch.assign(static_cast<size_t>(m_config.blockFrames) * kChainLanes, 0.0f);
+
+    for (int i = 0; i < workers; ++i) {
+        const int cpu = m_config.cpus.empty() ? -1 : m_config.cpus[i % m_config.cpus.size()];
+        m_workers.emplace_back(new StreamWorker(this, i + 1, cpu));
+        m_workers.back()->start(QThread::TimeCriticalPriority);
+    }
+    qCDebug(audioCategory) << "Stream server:" << m_config.maxStreams << "streams max,"
+                           << m_config.blockFrames << "frames at" << m_config.sampleRate << "Hz,"
+                           << workers << "worker threads";
+}
+
+StreamServer::~StreamServer()
+{
+    for (auto& worker : m_workers) {
+        worker->stop();
+        worker->wait();
+    }
+}
+
+qint64 StreamServer::clockNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::unique_ptr<PitchEngine> StreamServer::createPitchEngine() const
+{
+    std::unique_ptr<PitchEngine> engine = PitchEngine::create(m_config.pitchEngine);
+    engine->setFormat(1, m_config.sampleRate);
+    return engine;
+}
+
+int StreamServer::addStream(const DspParameters& parameters)
+{
+    // Built before taking the lock, so a running tick never waits for it
+    std::unique_ptr<Stream> stream(new Stream);
+    stream->parameters = parameters;
+    stream->stages = designChainState(parameters, m_config.sampleRate, stream->state);
+    stream->input.assign(m_config.blockFrames, 0.0f);
+    stream->output.assign(m_config.blockFrames, 0.0f);
+    if (parameters.pitchSemitones != 0.0f)
+        stream->pitchEngine = createPitchEngine();
+
+    QMutexLocker lock(&m_streamsMutex);
+    for (size_t id = 0; id < m_slots.size(); ++id) {
+        if (!m_slots[id]) {
+            m_slots[id] = std::move(stream);
+            ++m_streamCount;
+            return static_cast<int>(id);
+        }
+    }
+    return -1;
+}
+
+void StreamServer::removeStream(int id)
+{
+    // Freed after the lock is released
+    std::unique_ptr<Stream> removed;
+    QMutexLocker lock(&m_streamsMutex);
+    if (id < 0 || id >= static_cast<int>(m_slots.size()) || !m_slots[id])
+        return;
+    removed = std::move(m_slots[id]);
+    --m_streamCount;
+}
+
+int StreamServer::streamCount() const
+{
+    QMutexLocker lock(&m_streamsMutex);
+    return m_streamCount;
+}
+
+bool StreamServer::setParameters(int id, const DspParameters& parameters)
+{
+    if (id < 0 || id >= static_cast<int>(m_slots.size()))
+        return false;
+
+    std::unique_ptr<PitchEngine> engine;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        QMutexLocker lock(&m_streamsMutex);
+        Stream* stream = m_slots[id].get();
+        if (!stream)
+            return false;
+        if (parameters.pitchSemitones != 0.0f && !stream->pitchEngine) {
+            if (!engine) {
+                // First pitched block of this stream: build the engine unlocked
+                lock.unlock();
+                engine = createPitchEngine();
+                continue;
+            }
+            stream->pitchEngine = std::move(engine);
+        }
+        stream->parameters = parameters;
+        stream->dirty = true;
+        return true;
+    }
+    return false;
+}
+
+// ----------------------------------------------------------
+// 3. Ticks
+// ----------------------------------------------------------
+
+bool StreamServer::submit(int id, const float* samples, qint64 deadlineNs)
+{
+    if (!samples || id < 0 || id >= static_cast<int>(m_slots.size()))
+        return false;
+    QMutexLocker lock(&m_streamsMutex);
+    Stream* stream = m_slots[id].get();
+    if (!stream)
+        return false;
+    std::copy(samples, samples + m_config.blockFrames, stream->input.begin());
+    stream->deadline = deadlineNs > 0 ? deadlineNs : clockNs() + m_blockNs;
+    stream->submitted = true;
+    return true;
+}
+
+bool StreamServer::fetch(int id, float* samples) const
+{
+    if (!samples || id < 0 || id >= static_cast<int>(m_slots.size()))
+        return false;
+    QMutexLocker lock(&m_streamsMutex);
+    const Stream* stream = m_slots[id].get();
+    if (!stream)
+        return false;
+    std::copy(stream->output.begin(), stream->output.end(), samples);
+    return true;
+}
+
+int StreamServer::process()
+{
+    QMutexLocker lock(&m_streamsMutex);
+
+    // Collect this tick's blocks and apply parameter changes
+    int ready = 0;
+    for (auto& slot : m_slots) {
+        Stream* stream = slot.get();
+        if (!stream || !stream->submitted)
+            continue;
+        if (stream->dirty) {
+            stream->stages = designChainState(stream->parameters, m_config.sampleRate, stream->state);
+            stream->dirty = false;
+        }
+        m_ready[ready++] = stream;
+    }
+    if (ready == 0)
+        return 0;
+
+    // Earliest deadline first: batches are formed and claimed in deadline
+    // order, so the most urgent streams also share their lanes
+    std::sort(m_ready.begin(), m_ready.begin() + ready,
+              [](const Stream* a, const Stream* b) { return a->deadline < b->deadline; });
+    m_batchCount = 0;
+    for (int i = 0; i < ready; i += kChainLanes) {
+        Batch& batch = m_batches[m_batchCount++];
+        batch.count = std::min(kChainLanes, ready - i);
+        std::copy(m_ready.begin() + i, m_ready.begin() + i + batch.count, batch.lanes);
+    }
+
+    // Fork: the semaphore release publishes the tick to the workers
+    m_nextBatch.store(0, std::memory_order_relaxed);
+    m_tickMissed.store(0, std::memory_order_relaxed);
+    const int woken = std::min(static_cast<int>(m_workers.size()), m_batchCount - 1);
+    for (int w = 0; w < woken; ++w)
+        m_workers[w]->wake();
+
+    runBatches(0);
+
+    // Join; a tick takes milliseconds, so sleep rather than spin
+    m_done.acquire(woken);
+
+    for (int i = 0; i < ready; ++i)
+        m_ready[i]->submitted = false;
+
+    const int missed = m_tickMissed.load(std::memory_order_relaxed);
+    ++m_ticks;
+    m_streamBlocks += ready;
+    m_missed += missed;
+    return missed;
+}
+
+StreamServerStats StreamServer::stats() const
+{
+    QMutexLocker lock(&m_streamsMutex);
+    StreamServerStats stats;
+    stats.ticks = m_ticks;
+    stats.streamBlocks = m_streamBlocks;
+    stats.missedDeadlines = m_missed;
+    stats.busyNs = m_busyNs.load(std::memory_order_relaxed);
+    stats.blockNs = m_blockNs;
+    return stats;
+}
+
+void StreamServer::resetStats()
+{
+    QMutexLocker lock(&m_streamsMutex);
+    m_ticks = 0;
+    m_streamBlocks = 0;
+    m_missed = 0;
+    m_busyNs.store(0, std::memory_order_relaxed);
+}
+
+// ----------------------------------------------------------
+// 4. Batch processing (caller and workers)
+// ----------------------------------------------------------
+
+void StreamServer::runBatches(int executor)
+{
+    float* lanes = m_scratch[executor].data();
+    const qint64 start = clockNs();
+    int late = 0;
+    while (true) {
+        const int index = m_nextBatch.fetch_add(1, std::memory_order_relaxed);
+        if (index >= m_batchCount)
+            break;
+        const Batch& batch = m_batches[index];
+        processBatch(batch, lanes);
+
+        const qint64 now = clockNs();
+        for (int l = 0; l < batch.count; ++l) {
+            if (now > batch.lanes[l]->deadline)
+                ++late;
+        }
+    }
+    m_busyNs.fetch_add(clockNs() - start, std::memory_order_relaxed);
+    if (late > 0)
+        m_tickMissed.fetch_add(late, std::memory_order_relaxed);
+}
+
+void StreamServer::processBatch(const Batch& batch, float* lanes)
+{
+    const int frames = m_config.blockFrames;
+
+    // Unused lanes run on zeros with a neutral state of their own
+    ChainState idle;
+    idle.drive = 0.0f;
+
+    ChainState* states[kChainLanes];
+    bool gate = false;
+    bool distortion = false;
+    bool filter = false;
+    bool pitched = false;
+    for (int l = 0; l < kChainLanes; ++l) {
+        if (l >= batch.count) {
+            states[l] = &idle;
+            for (int i = 0; i < frames; ++i)
+                lanes[i * kChainLanes + l] = 0.0f;
+            continue;
+        }
+        Stream* stream = batch.lanes[l];
+        states[l] = &stream->state;
+        gate |= stream->stages.gate;
+        distortion |= stream->stages.distortion;
+        filter |= stream->stages.filter;
+        pitched |= stream->parameters.pitchSemitones != 0.0f && stream->pitchEngine;
+
+        const float* in = stream->input.data();
+        for (int i = 0; i < frames; ++i)
+            lanes[i * kChainLanes + l] = in[i];
+    }
+
+    if (!pitched) {
+        // Gate, distortion and band filter in one lane-batched pass
+        if (BatchKernelFn kernel = selectBatchKernel(gate, distortion, filter))
+            kernel(states, lanes, frames);
+    } else {
+        if (BatchKernelFn kernel = selectBatchKernel(gate, false, false))
+            kernel(states, lanes, frames);
+
+        // Pitch per stream, on the stream's output block as scratch
+        for (int l = 0; l < batch.count; ++l) {
+            Stream* stream = batch.lanes[l];
+            const float semitones = stream->parameters.pitchSemitones;
+            if (semitones == 0.0f || !stream->pitchEngine) {
+                stream->pitchEngaged = false;
+                continue;
+            }
+            float* voice = stream->output.data();
+            for (int i = 0; i < frames; ++i)
+                voice[i] = lanes[i * kChainLanes + l];
+            // Whatever was buffered before a bypass is stale by now
+            if (!stream->pitchEngaged) {
+                stream->pitchEngine->reset();
+                stream->pitchEngaged = true;
+            }
+            stream->pitchEngine->setPitchSemiTones(semitones);
+            stream->pitchEngine->process(voice, frames);
+            for (int i = 0; i < frames; ++i)
+                lanes[i * kChainLanes + l] = voice[i];
+        }
+
+        if (BatchKernelFn kernel = selectBatchKernel(false, distortion, filter))
+            kernel(states, lanes, frames);
+    }
+
+    for (int l = 0; l < batch.count; ++l) {
+        float* out = batch.lanes[l]->output.data();
+        for (int i = 0; i < frames; ++i)
+            out[i] = lanes[i * kChainLanes + l];
+    }
+}
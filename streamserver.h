@@ -0,0 +1,159 @@
+// streamserver.h
+#ifndef STREAMSERVER_H
+#define STREAMSERVER_H
+
+#include "dspchain.h"
+#include "effectchain.h"
+#include "pitchengine.h"
+
+#include <QMutex>
+#include <QSemaphore>
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class StreamWorker;
+
+// ----------------------------------------------------------
+// StreamServer Class Declaration
+// ----------------------------------------------------------
+
+struct StreamServerConfig
+{
+    int sampleRate  = 16000;
+    int blockFrames = 160;          ///< Frames per stream and tick (10 ms at 16 kHz)
+    int maxStreams  = 512;
+    int workers     = -1;           ///< Pool threads besides the caller of process(); -1 = one per core
+    std::vector<int> cpus;          ///< Worker i is pinned to cpus[i % size]; empty = no pinning
+    PitchEngineType pitchEngine = PitchEngineType::SoundTouch;
+};
+
+struct StreamServerStats
+{
+    qint64 ticks = 0;               ///< process() calls that had work
+    qint64 streamBlocks = 0;        ///< Blocks processed over all streams
+    qint64 missedDeadlines = 0;     ///< Stream blocks finished after their deadline
+    qint64 busyNs = 0;              ///< Processing time summed over all executors
+    qint64 blockNs = 0;             ///< Real-time duration of one block
+
+    /// Real-time streams one core sustains at this block size.
+    double streamsPerCore() const
+    {
+        return busyNs > 0 ? static_cast<double>(blockNs) * streamBlocks / busyNs : 0.0;
+    }
+};
+
+/**
+ * @brief Runs the gate / pitch / distortion / band filter chain on many
+ * independent mono voice streams, e.g. one per call-center seat.
+ *
+ * Per-stream state is compact: the ChainState (a few dozen floats), one
+ * input and one output block, and a pitch engine only for streams that
+ * were ever pitched. Every tick, process() orders the submitted streams by
+ * deadline, groups them into batches of kChainLanes and lets a pinned worker
+ * pool plus the calling thread take the batches earliest deadline first.
+ * Gate, distortion and band filter run lane-batched (BatchKernel), one
+ * stream per SIMD lane; pitch shifting runs per stream between them.
+ *
+ * addStream(), removeStream() and setParameters() may be called from a
+ * control thread; they allocate outside the stream table lock and only
+ * swap pointers under it. submit(), process() and fetch() belong to the
+ * host thread that drives the ticks.
+ */
+class StreamServer
+{
+public:
+    explicit StreamServer(const StreamServerConfig& config);
+    ~StreamServer();
+
+    StreamServer(const StreamServer&) = delete;
+    StreamServer& operator=(const StreamServer&) = delete;
+
+    const StreamServerConfig& config() const { return m_config; }
+
+    /// Returns the new stream's id, or -1 when all maxStreams slots are taken.
+    int addStream(const DspParameters& parameters);
+    void removeStream(int id);
+    int streamCount() const;
+
+    /// Takes effect with the stream's next block.
+    bool setParameters(int id, const DspParameters& parameters);
+
+    /**
+     * @brief Queues one block (blockFrames samples) of a stream for the next tick.
+     * @param deadlineNs clockNs() time the processed block is due; 0 = one block from now.
+     */
+    bool submit(int id, const float* samples, qint64 deadlineNs = 0);
+
+    /// Copies the stream's last processed block (blockFrames samples).
+    bool fetch(int id, float* samples) const;
+
+    /**
+     * @brief Processes every block submitted since the last call and returns
+     * once all are done.
+     * @return Stream blocks that finished after their deadline.
+     */
+    int process();
+
+    StreamServerStats stats() const;
+    void resetStats();
+
+    /// Monotonic clock the deadlines refer to.
+    static qint64 clockNs();
+
+private:
+    friend class StreamWorker;
+
+    struct Stream
+    {
+        DspParameters parameters;
+        bool dirty = false;                     ///< parameters changed since the last block
+        ChainState state;
+        DspStages stages;
+        std::unique_ptr<PitchEngine> pitchEngine;
+        bool pitchEngaged = false;
+        std::vector<float> input;
+        std::vector<float> output;
+        qint64 deadline = 0;
+        bool submitted = false;
+    };
+
+    struct Batch
+    {
+        Stream* lanes[kChainLanes];
+        int count = 0;
+    };
+
+    std::unique_ptr<PitchEngine> createPitchEngine() const;
+    void runBatches(int executor);
+    void processBatch(const Batch& batch, float* lanes);
+
+    StreamServerConfig m_config;
+    qint64 m_blockNs;
+
+    // Stream table, locked by control calls and for the duration of a tick
+    mutable QMutex m_streamsMutex;
+    std::vector<std::unique_ptr<Stream>> m_slots;   ///< Indexed by stream id
+    int m_streamCount;
+
+    // Current tick, shared with the workers
+    std::vector<Stream*> m_ready;                   ///< Submitted streams, earliest deadline first
+    std::vector<Batch> m_batches;
+    int m_batchCount;
+    std::atomic<int> m_nextBatch;
+    std::vector<std::vector<float>> m_scratch;      ///< Lane-interleaved block per executor
+
+    // Worker pool; executor 0 is the caller of process()
+    std::vector<std::unique_ptr<StreamWorker>> m_workers;
+    QSemaphore m_done;
+
+    // Statistics
+    std::atomic<qint64> m_busyNs;
+    std::atomic<int> m_tickMissed;                  ///< Late blocks of the current tick
+    qint64 m_missed;
+    qint64 m_ticks;
+    qint64 m_streamBlocks;
+};
+
+#endif // STREAMSERVER_H
@@ -157,8 +157,8 @@ namespace soundtouch
             int numsamples                    ///< Number of samples in buffer
         );
 
-        /// remove constant bias from xcorr data
-        void removeBias();
+        /// remove constant bias from a copy of xcorr data
+        void removeBias(float *data);
 
         // Detect individual beat positions
         void updateBeatPos(int process_samples);
@@ -185,7 +185,8 @@ namespace soundtouch
 
         /// Analyzes the results and returns the BPM rate. Use this function to read result
         /// after whole song data has been input to the class by consecutive calls of
-        /// 'inputSamples' function.
+        /// 'inputSamples' function. The analysis doesn't alter the accumulated data, so
+        /// the function may also be polled periodically while a stream is being input.
         ///
         /// \return Beats-per-minute rate, or zero if detection failed.
         float getBpm();
@@ -200,6 +201,13 @@ namespace soundtouch
         ///
         /// \return number of beats in the arrays.
         int getBeats(float *pos, float *strength, int max_num);
+
+        /// Same as 'getBeats', but removes the returned beats (the oldest ones) from
+        /// the collection. Use this when analyzing a live stream to consume beats as
+        /// they get detected.
+        ///
+        /// \return number of beats returned in the arrays.
+        int takeBeats(float *pos, float *strength, int max_num);
     };
 }
 #endif // _BPMDetect_H_
@@ -49,12 +49,27 @@ namespace soundtouch
 ///
 /// Notice that in case of stereo audio, one sample is considered to consist of 
 /// both channel data.
+///
+/// Where the platform allows it, the storage is a ring buffer whose pages are
+/// mapped twice back to back, so 'ptrBegin()' and 'ptrEnd()' always see
+/// contiguous memory without the data ever being moved. Otherwise the
+/// classic linear buffer with rewinding is used.
 class FIFOSampleBuffer : public FIFOSamplePipe
 {
 private:
     /// Sample buffer.
     SAMPLETYPE *buffer;
 
+    /// Nonzero when 'buffer' is a double-mapped ring: the 'sizeInBytes' bytes
+    /// following the buffer are the same memory as the buffer itself.
+    bool mirrored;
+
+    /// Platform handle of the mirrored mapping, if any.
+    void *mirrorHandle;
+
+    /// Read position in bytes inside a mirrored ring (unused otherwise).
+    uint readOffset;
+
     // Raw unaligned buffer memory. 'buffer' is made aligned by pointing it to first
     // 16-byte aligned location of this buffer
     SAMPLETYPE *bufferUnaligned;
@@ -83,6 +98,9 @@ private:
     /// Returns current capacity.
     uint getCapacity() const;
 
+    /// Frees the current storage, mirrored or not.
+    void releaseBuffer();
+
 public:
 
     /// Constructor
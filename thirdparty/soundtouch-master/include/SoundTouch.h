@@ -165,6 +165,14 @@ namespace soundtouch
 #define SETTING_INITIAL_LATENCY             8
 
 
+/// Coarse-to-fine seeking in tempo changer routine: number of candidate 
+/// positions (1 .. 8) that are refined at full resolution after a search on
+/// decimated signals. Gives nearly the quality of the full search at a fraction
+/// of its CPU cost. Zero (default) disables it, in which case SETTING_USE_QUICKSEEK
+/// selects between the quick and full search.
+#define SETTING_SEEK_CANDIDATES             9
+
+
 class SoundTouch : public FIFOProcessor
 {
 private:
@@ -58,6 +58,11 @@
 #include "PeakFinder.h"
 #include "BPMDetect.h"
 
+#if defined(SOUNDTOUCH_FLOAT_SAMPLES) && defined(SOUNDTOUCH_ALLOW_SSE)
+    #include <xmmintrin.h>
+    #define BPM_USE_SSE
+#endif
+
 using namespace soundtouch;
 
 // algorithm input sample block size
@@ -289,12 +294,35 @@ int BPMDetect::decimate(SAMPLETYPE *dest, const SAMPLETYPE *src, int numsamples)
 }
 
 
+#ifdef BPM_USE_SSE
+
+// Correlates 'tmp' with 'data' at eight consecutive offsets:
+// sums[k] = sum(i) tmp[i] * data[k + i]. Each SSE lane adds up its products
+// in the same order as the scalar loops below, so the results are identical.
+static void correlate8SSE(float *sums, const float *tmp, const float *data, int count)
+{
+    __m128 sum1 = _mm_setzero_ps();
+    __m128 sum2 = _mm_setzero_ps();
+
+    for (int i = 0; i < count; i ++)
+    {
+        __m128 t = _mm_set1_ps(tmp[i]);
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(t, _mm_loadu_ps(data + i)));
+        sum2 = _mm_add_ps(sum2, _mm_mul_ps(t, _mm_loadu_ps(data + i + 4)));
+    }
+    _mm_storeu_ps(sums, sum1);
+    _mm_storeu_ps(sums + 4, sum2);
+}
+
+#endif // BPM_USE_SSE
+
+
 // Calculates autocorrelation function of the sample history buffer
 void BPMDetect::updateXCorr(int process_samples)
 {
     int offs;
     SAMPLETYPE *pBuffer;
-    
+
     assert(buffer->numSamples() >= (uint)(process_samples + windowLen));
     assert(process_samples == XCORR_UPDATE_SEQUENCE);
 
@@ -310,8 +338,28 @@ void BPMDetect::updateXCorr(int process_samples)
         tmp[i] = hamw[i] * hamw[i] * pBuffer[i];
     }
 
+    int start = windowStart;
+#ifdef BPM_USE_SSE
+    // eight correlation offsets at a time
+    int end8 = windowStart + ((windowLen - windowStart) & -8);
+
+    #pragma omp parallel for
+    for (offs = windowStart; offs < end8; offs += 8)
+    {
+        float sums[8];
+
+        correlate8SSE(sums, tmp, pBuffer + offs, process_samples);
+        for (int k = 0; k < 8; k ++)
+        {
+            xcorr[offs + k] *= xcorr_decay;
+            xcorr[offs + k] += (float)fabs(sums[k]);
+        }
+    }
+    start = end8;
+#endif // BPM_USE_SSE
+
     #pragma omp parallel for
-    for (offs = windowStart; offs < windowLen; offs ++) 
+    for (offs = start; offs < windowLen; offs ++) 
     {
         float sum;
         int i;
@@ -349,8 +397,28 @@ void BPMDetect::updateBeatPos(int process_samples)
         tmp[i] = hamw2[i] * hamw2[i] * pBuffer[i];
     }
 
+    int start = windowStart;
+#ifdef BPM_USE_SSE
+    // eight correlation offsets at a time
+    int end8 = windowStart + ((windowLen - windowStart) & -8);
+
+    #pragma omp parallel for
+    for (int offs = windowStart; offs < end8; offs += 8)
+    {
+        float sums[8];
+
+        correlate8SSE(sums, tmp, pBuffer + offs, process_samples);
+        for (int k = 0; k < 8; k ++)
+        {
+            float sum = sums[k];
+            beatcorr_ringbuff[(beatcorr_ringbuffpos + offs + k) % windowLen] += (float)((sum > 0) ? sum : 0); // accumulate only positive correlations
+        }
+    }
+    start = end8;
+#endif // BPM_USE_SSE
+
     #pragma omp parallel for
-    for (int offs = windowStart; offs < windowLen; offs++)
+    for (int offs = start; offs < windowLen; offs++)
     {
         float sum = 0;
         for (int i = 0; i < process_samples; i++)
@@ -446,7 +514,7 @@ void BPMDetect::inputSamples(const SAMPLETYPE *samples, int numSamples)
 }
 
 
-void BPMDetect::removeBias()
+void BPMDetect::removeBias(float *data)
 {
     int i;
 
@@ -456,7 +524,7 @@ void BPMDetect::removeBias()
     double mean_x = 0;
     for (i = windowStart; i < windowLen; i++)
     {
-        mean_x += xcorr[i];
+        mean_x += data[i];
     }
     mean_x /= (windowLen - windowStart);
     mean_i = 0.5 * (windowLen - 1 + windowStart);
@@ -466,7 +534,7 @@ void BPMDetect::removeBias()
     double div = 0;
     for (i = windowStart; i < windowLen; i++)
     {
-        double xt = xcorr[i] - mean_x;
+        double xt = data[i] - mean_x;
         double xi = i - mean_i;
         b += xt * xi;
         div += xi * xi;
@@ -477,17 +545,17 @@ void BPMDetect::removeBias()
     float minval = FLT_MAX;   // arbitrary large number
     for (i = windowStart; i < windowLen; i ++)
     {
-        xcorr[i] -= (float)(b * i);
-        if (xcorr[i] < minval)
+        data[i] -= (float)(b * i);
+        if (data[i] < minval)
         {
-            minval = xcorr[i];
+            minval = data[i];
         }
     }
 
     // subtract min.value
     for (i = windowStart; i < windowLen; i ++)
     {
-        xcorr[i] -= minval;
+        data[i] -= minval;
     }
 }
 
@@ -518,8 +586,11 @@ float BPMDetect::getBpm()
     double coeff;
     PeakFinder peakFinder;
 
-    // remove bias from xcorr data
-    removeBias();
+    // remove bias from a copy of the xcorr data, so that the accumulated
+    // correlation is left intact and the bpm can be polled during a stream
+    float *corr = new float[windowLen];
+    memcpy(corr, xcorr, sizeof(float) * windowLen);
+    removeBias(corr);
 
     coeff = 60.0 * ((double)sampleRate / (double)decimateBy);
 
@@ -529,7 +600,7 @@ float BPMDetect::getBpm()
     // Smoothen by N-point moving-average
     float *data = new float[windowLen];
     memset(data, 0, sizeof(float) * windowLen);
-    MAFilter(data, xcorr, windowStart, windowLen, MOVING_AVERAGE_N);
+    MAFilter(data, corr, windowStart, windowLen, MOVING_AVERAGE_N);
 
     // find peak position
     peakPos = peakFinder.detectPeak(data, windowStart, windowLen);
@@ -538,6 +609,7 @@ float BPMDetect::getBpm()
     _SaveDebugData("soundtouch-bpm-smoothed.txt", data, windowStart, windowLen, coeff);
 
     delete[] data;
+    delete[] corr;
 
     assert(decimateBy != 0);
     if (peakPos < 1e-9) return 0.0; // detection failed.
@@ -571,3 +643,21 @@ int BPMDetect::getBeats(float *pos, float *values, int max_num)
     }
     return num;
 }
+
+
+/// Get beat position arrays and remove the returned beats from the collection,
+/// so that a live stream can consume beats as they are detected.
+int BPMDetect::takeBeats(float *pos, float *values, int max_num)
+{
+    int num = (int)beats.size();
+    if (num > max_num) num = max_num;
+    if ((!pos) || (!values) || (num <= 0)) return 0;
+
+    for (int i = 0; i < num; i++)
+    {
+        pos[i] = beats[i].pos;
+        values[i] = beats[i].strength;
+    }
+    beats.erase(beats.begin(), beats.begin() + num);
+    return num;
+}
@@ -9,6 +9,13 @@
 /// outputted samples from the buffer, as well as grows the buffer size 
 /// whenever necessary.
 ///
+/// On Windows, Linux and other Unix systems the buffer is a ring whose
+/// memory is mapped twice in a row, so that reads and writes that run past
+/// the end of the ring continue seamlessly at its beginning. Receiving
+/// samples then only advances a read offset: no data is ever moved, and the
+/// buffer is preallocated large enough that steady-state processing never
+/// reallocates.
+///
 /// Author        : Copyright (c) Olli Parviainen
 /// Author e-mail : oparviai 'at' iki.fi
 /// SoundTouch WWW: http://www.surina.net/soundtouch
@@ -43,8 +50,128 @@
 
 #include "FIFOSampleBuffer.h"
 
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+    #define SOUNDTOUCH_MIRRORED_FIFO 1
+#elif defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <stdio.h>
+    #include <unistd.h>
+    #define SOUNDTOUCH_MIRRORED_FIFO 1
+#endif
+
+/// Mirrored rings are preallocated with at least this many bytes, which
+/// covers the working set of the RateTransposer and TDStretch buffers at
+/// common settings, so they do not grow while processing.
+#define MIRRORED_FIFO_MIN_BYTES 65536
+
 using namespace soundtouch;
 
+
+#ifdef SOUNDTOUCH_MIRRORED_FIFO
+
+// Size granularity of a mirrored mapping: the page size on Unix, the
+// allocation granularity (64kB) on Windows
+static uint mirrorGranularity()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (uint)info.dwAllocationGranularity;
+#else
+    long page = sysconf(_SC_PAGESIZE);
+    return (page > 0) ? (uint)page : 4096;
+#endif
+}
+
+
+// Maps 'size' bytes twice back to back, so that base[i] and base[size + i]
+// address the same memory. Returns NULL if the platform refuses.
+static void *mapMirrored(uint size, void **handle)
+{
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, size, NULL);
+    if (mapping == NULL) return NULL;
+
+    // Find a free address range, release it and map both views into it.
+    // Another thread may take the range in between, hence the retries.
+    for (int attempt = 0; attempt < 16; attempt ++)
+    {
+        char *base = (char *)VirtualAlloc(NULL, 2 * (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS);
+        if (base == NULL) break;
+        VirtualFree(base, 0, MEM_RELEASE);
+
+        void *lo = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size, base);
+        void *hi = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size, base + size);
+        if (lo == base && hi == base + size)
+        {
+            *handle = mapping;
+            return base;
+        }
+        if (lo) UnmapViewOfFile(lo);
+        if (hi) UnmapViewOfFile(hi);
+    }
+    CloseHandle(mapping);
+    return NULL;
+#else
+    int fd = -1;
+#if defined(__linux__)
+    #ifdef MFD_CLOEXEC
+    fd = memfd_create("soundtouch-fifo", MFD_CLOEXEC);
+    #endif
+#else
+    char name[64];
+    snprintf(name, sizeof(name), "/soundtouch-%ld-%lx", (long)getpid(), (unsigned long)(size_t)&fd);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) shm_unlink(name);
+#endif
+    if (fd < 0) return NULL;
+
+    if (ftruncate(fd, (off_t)size) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    // Reserve 2*size of address space, then map the same file into both halves
+    char *base = (char *)mmap(NULL, 2 * (size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == (char *)MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(base, 2 * (size_t)size);
+        close(fd);
+        return NULL;
+    }
+    close(fd);      // the mappings keep the memory alive
+    *handle = NULL;
+    return base;
+#endif
+}
+
+
+static void unmapMirrored(void *base, uint size, void *handle)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+    UnmapViewOfFile((char *)base + size);
+    CloseHandle((HANDLE)handle);
+#else
+    (void)handle;
+    munmap(base, 2 * (size_t)size);
+#endif
+}
+
+#endif // SOUNDTOUCH_MIRRORED_FIFO
+
 // Constructor
 FIFOSampleBuffer::FIFOSampleBuffer(int numChannels)
 {
@@ -52,6 +179,9 @@ FIFOSampleBuffer::FIFOSampleBuffer(int numChannels)
     sizeInBytes = 0; // reasonable initial value
     buffer = NULL;
     bufferUnaligned = NULL;
+    mirrored = false;
+    mirrorHandle = NULL;
+    readOffset = 0;
     samplesInBuffer = 0;
     bufferPos = 0;
     channels = (uint)numChannels;
@@ -62,6 +192,21 @@ FIFOSampleBuffer::FIFOSampleBuffer(int numChannels)
 // destructor
 FIFOSampleBuffer::~FIFOSampleBuffer()
 {
+    releaseBuffer();
+}
+
+
+// Frees the storage in whichever form it was allocated
+void FIFOSampleBuffer::releaseBuffer()
+{
+#ifdef SOUNDTOUCH_MIRRORED_FIFO
+    if (mirrored)
+    {
+        unmapMirrored(buffer, sizeInBytes, mirrorHandle);
+        mirrored = false;
+        mirrorHandle = NULL;
+    }
+#endif
     delete[] bufferUnaligned;
     bufferUnaligned = NULL;
     buffer = NULL;
@@ -83,10 +228,10 @@ void FIFOSampleBuffer::setChannels(int numChannels)
 
 // if output location pointer 'bufferPos' isn't zero, 'rewinds' the buffer and
 // zeroes this pointer by copying samples from the 'bufferPos' pointer 
-// location on to the beginning of the buffer.
+// location on to the beginning of the buffer. A mirrored ring never needs this.
 void FIFOSampleBuffer::rewind()
 {
-    if (buffer && bufferPos) 
+    if (buffer && bufferPos && !mirrored) 
     {
         memmove(buffer, ptrBegin(), sizeof(SAMPLETYPE) * channels * samplesInBuffer);
         bufferPos = 0;
@@ -134,6 +279,11 @@ void FIFOSampleBuffer::putSamples(uint nSamples)
 SAMPLETYPE *FIFOSampleBuffer::ptrEnd(uint slackCapacity) 
 {
     ensureCapacity(samplesInBuffer + slackCapacity);
+    if (mirrored)
+    {
+        // may point into the mirror half; the writes land at the ring start
+        return ptrBegin() + samplesInBuffer * channels;
+    }
     return buffer + samplesInBuffer * channels;
 }
 
@@ -148,6 +298,10 @@ SAMPLETYPE *FIFOSampleBuffer::ptrEnd(uint slackCapacity)
 SAMPLETYPE *FIFOSampleBuffer::ptrBegin()
 {
     assert(buffer);
+    if (mirrored)
+    {
+        return (SAMPLETYPE *)((char *)buffer + readOffset);
+    }
     return buffer + bufferPos * channels;
 }
 
@@ -156,16 +310,47 @@ SAMPLETYPE *FIFOSampleBuffer::ptrBegin()
 // 'capacityRequirement' number of samples. The buffer is grown in steps of
 // 4 kilobytes to eliminate the need for frequently growing up the buffer,
 // as well as to round the buffer size up to the virtual memory page size.
+// Mirrored rings are sized in mapping granularity steps instead, and are only
+// reallocated if the requirement exceeds the preallocated capacity.
 void FIFOSampleBuffer::ensureCapacity(uint capacityRequirement)
 {
     SAMPLETYPE *tempUnaligned, *temp;
 
+#ifdef SOUNDTOUCH_MIRRORED_FIFO
+    if (capacityRequirement > getCapacity() && (mirrored || buffer == NULL))
+    {
+        uint granularity = mirrorGranularity();
+        uint newSize = capacityRequirement * channels * sizeof(SAMPLETYPE);
+        if (newSize < MIRRORED_FIFO_MIN_BYTES) newSize = MIRRORED_FIFO_MIN_BYTES;
+        newSize = (newSize + granularity - 1) / granularity * granularity;
+
+        void *handle = NULL;
+        temp = (SAMPLETYPE *)mapMirrored(newSize, &handle);
+        if (temp != NULL)
+        {
+            if (samplesInBuffer)
+            {
+                memcpy(temp, ptrBegin(), samplesInBuffer * channels * sizeof(SAMPLETYPE));
+            }
+            releaseBuffer();
+            buffer = temp;
+            mirrored = true;
+            mirrorHandle = handle;
+            sizeInBytes = newSize;
+            readOffset = 0;
+            bufferPos = 0;
+            return;
+        }
+        // mapping not available: continue with a linear buffer below
+    }
+#endif
+
     if (capacityRequirement > getCapacity()) 
     {
         // enlarge the buffer in 4kbyte steps (round up to next 4k boundary)
-        sizeInBytes = (capacityRequirement * channels * sizeof(SAMPLETYPE) + 4095) & (uint)-4096;
-        assert(sizeInBytes % 2 == 0);
-        tempUnaligned = new SAMPLETYPE[sizeInBytes / sizeof(SAMPLETYPE) + 16 / sizeof(SAMPLETYPE)];
+        uint newSize = (capacityRequirement * channels * sizeof(SAMPLETYPE) + 4095) & (uint)-4096;
+        assert(newSize % 2 == 0);
+        tempUnaligned = new SAMPLETYPE[newSize / sizeof(SAMPLETYPE) + 16 / sizeof(SAMPLETYPE)];
         if (tempUnaligned == NULL)
         {
             ST_THROW_RT_ERROR("Couldn't allocate memory!\n");
@@ -176,10 +361,12 @@ void FIFOSampleBuffer::ensureCapacity(uint capacityRequirement)
         {
             memcpy(temp, ptrBegin(), samplesInBuffer * channels * sizeof(SAMPLETYPE));
         }
-        delete[] bufferUnaligned;
+        releaseBuffer();
         buffer = temp;
         bufferUnaligned = tempUnaligned;
+        sizeInBytes = newSize;
         bufferPos = 0;
+        readOffset = 0;
     } 
     else 
     {
@@ -230,11 +417,19 @@ uint FIFOSampleBuffer::receiveSamples(uint maxSamples)
 
         temp = samplesInBuffer;
         samplesInBuffer = 0;
+        readOffset = 0;
         return temp;
     }
 
     samplesInBuffer -= maxSamples;
-    bufferPos += maxSamples;
+    if (mirrored)
+    {
+        readOffset = (readOffset + maxSamples * channels * sizeof(SAMPLETYPE)) % sizeInBytes;
+    }
+    else
+    {
+        bufferPos += maxSamples;
+    }
 
     return maxSamples;
 }
@@ -252,6 +447,7 @@ void FIFOSampleBuffer::clear()
 {
     samplesInBuffer = 0;
     bufferPos = 0;
+    readOffset = 0;
 }
 
 
@@ -124,7 +124,14 @@ public:
         float *filterCoeffsUnalign;
         float *filterCoeffsAlign;
 
+        /// Coefficients replicated into all four lanes (c0 c0 c0 c0 c1 c1 ...),
+        /// aligned to 16 bytes, for the mono and multichannel routines
+        float *filterCoeffsQuadUnalign;
+        float *filterCoeffsQuad;
+
         virtual uint evaluateFilterStereo(float *dest, const float *src, uint numSamples) const;
+        virtual uint evaluateFilterMono(float *dest, const float *src, uint numSamples) const;
+        virtual uint evaluateFilterMulti(float *dest, const float *src, uint numSamples, uint numChannels);
     public:
         FIRFilterSSE();
         ~FIRFilterSSE();
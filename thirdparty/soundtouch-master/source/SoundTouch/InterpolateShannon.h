@@ -59,6 +59,9 @@ protected:
 
     double fract;
 
+    /// Shared precomputed kernel table, see InterpolateShannon.cpp
+    const float *table;
+
 public:
     InterpolateShannon();
 };
@@ -61,6 +61,8 @@ RateTransposer::RateTransposer() : FIFOProcessor(&outputBuffer)
     // Instantiates the anti-alias filter
     pAAFilter = new AAFilter(64);
     pTransposer = TransposerBase::newInstance();
+
+    pDest = &outputBuffer;
 }
 
 
@@ -129,18 +131,23 @@ void RateTransposer::putSamples(const SAMPLETYPE *samples, uint nSamples)
 // the 'set_returnBuffer_size' function.
 void RateTransposer::processSamples(const SAMPLETYPE *src, uint nSamples)
 {
-    uint count;
-
     if (nSamples == 0) return;
 
     // Store samples to input buffer
     inputBuffer.putSamples(src, nSamples);
 
+    processInput();
+}
+
+
+// Transposes the samples in the input buffer into 'pDest'
+void RateTransposer::processInput()
+{
     // If anti-alias filter is turned off, simply transpose without applying
     // the filter
     if (bUseAAFilter == false) 
     {
-        count = pTransposer->transpose(outputBuffer, inputBuffer);
+        pTransposer->transpose(*pDest, inputBuffer);
         return;
     }
 
@@ -156,7 +163,7 @@ void RateTransposer::processSamples(const SAMPLETYPE *src, uint nSamples)
         pTransposer->transpose(midBuffer, inputBuffer);
 
         // Apply the anti-alias filter for transposed samples in midBuffer
-        pAAFilter->evaluate(outputBuffer, midBuffer);
+        pAAFilter->evaluate(*pDest, midBuffer);
     } 
     else  
     {
@@ -168,11 +175,18 @@ void RateTransposer::processSamples(const SAMPLETYPE *src, uint nSamples)
         pAAFilter->evaluate(midBuffer, inputBuffer);
 
         // Transpose the AA-filtered samples in "midBuffer"
-        pTransposer->transpose(outputBuffer, midBuffer);
+        pTransposer->transpose(*pDest, midBuffer);
     }
 }
 
 
+// Sets the buffer where the transposed samples are written
+void RateTransposer::setDestination(FIFOSampleBuffer *dest)
+{
+    pDest = dest ? dest : &outputBuffer;
+}
+
+
 // Sets the number of channels, 1 = mono, 2 = stereo
 void RateTransposer::setChannels(int nChannels)
 {
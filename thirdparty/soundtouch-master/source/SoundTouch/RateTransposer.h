@@ -111,6 +111,10 @@ protected:
     /// Output sample buffer
     FIFOSampleBuffer outputBuffer;
 
+    /// Buffer the last processing stage writes into: 'outputBuffer', or the
+    /// input buffer of the next stage when chained with 'setDestination'
+    FIFOSampleBuffer *pDest;
+
     bool bUseAAFilter;
 
 
@@ -128,6 +132,18 @@ public:
     /// Returns the output buffer object
     FIFOSamplePipe *getOutput() { return &outputBuffer; };
 
+    /// Returns the input buffer object
+    FIFOSampleBuffer *getInput() { return &inputBuffer; };
+
+    /// Makes the transposer write its result directly to the end of 'dest'
+    /// (typically the input buffer of the following stage) instead of its own
+    /// output buffer, saving a copy per batch. NULL restores the own buffer.
+    void setDestination(FIFOSampleBuffer *dest);
+
+    /// Processes samples that a preceding stage has written directly into
+    /// the input buffer (see 'getInput' and TDStretch::setDestination).
+    void processInput();
+
     /// Return anti-alias filter object
     AAFilter *getAAFilter();
 
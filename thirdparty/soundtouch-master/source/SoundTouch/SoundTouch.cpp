@@ -94,6 +94,8 @@ SoundTouch::SoundTouch()
     pTDStretch = TDStretch::newInstance();
 
     setOutPipe(pTDStretch);
+    // rate transposer feeds the tempo changer's input buffer directly
+    pRateTransposer->setDestination(pTDStretch->getInput());
 
     rate = tempo = 0;
 
@@ -234,12 +236,16 @@ void SoundTouch::calcEffectiveRateAndTempo()
             FIFOSamplePipe *tempoOut;
 
             assert(output == pRateTransposer);
+            // tempo changer is now the last stage and outputs to its own buffer
+            pTDStretch->setDestination(NULL);
             // move samples in the current output buffer to the output of pTDStretch
             tempoOut = pTDStretch->getOutput();
             tempoOut->moveSamples(*output);
             // move samples in pitch transposer's store buffer to tempo changer's input
             // deprecated : pTDStretch->moveSamples(*pRateTransposer->getStore());
 
+            // rate transposer feeds the tempo changer's input buffer directly
+            pRateTransposer->setDestination(pTDStretch->getInput());
             output = pTDStretch;
         }
     }
@@ -251,12 +257,16 @@ void SoundTouch::calcEffectiveRateAndTempo()
             FIFOSamplePipe *transOut;
 
             assert(output == pTDStretch);
+            // rate transposer is now the last stage and outputs to its own buffer
+            pRateTransposer->setDestination(NULL);
             // move samples in the current output buffer to the output of pRateTransposer
             transOut = pRateTransposer->getOutput();
             transOut->moveSamples(*output);
             // move samples in tempo changer's input to pitch transposer's input
             pRateTransposer->moveSamples(*pTDStretch->getInput());
 
+            // tempo changer feeds the rate transposer's input buffer directly
+            pTDStretch->setDestination(pRateTransposer->getInput());
             output = pRateTransposer;
         }
     } 
@@ -292,18 +302,20 @@ void SoundTouch::putSamples(const SAMPLETYPE *samples, uint nSamples)
 #ifndef SOUNDTOUCH_PREVENT_CLICK_AT_RATE_CROSSOVER
     if (rate <= 1.0f) 
     {
-        // transpose the rate down, output the transposed sound to tempo changer buffer
+        // transpose the rate down, the transposed sound lands directly in
+        // the tempo changer's input buffer
         assert(output == pTDStretch);
         pRateTransposer->putSamples(samples, nSamples);
-        pTDStretch->moveSamples(*pRateTransposer);
+        pTDStretch->processInput();
     } 
     else 
 #endif
     {
-        // evaluate the tempo changer, then transpose the rate up, 
+        // evaluate the tempo changer straight into the rate transposer's
+        // input buffer, then transpose the rate up
         assert(output == pRateTransposer);
         pTDStretch->putSamples(samples, nSamples);
-        pRateTransposer->moveSamples(*pTDStretch);
+        pRateTransposer->processInput();
     }
 }
 
@@ -372,6 +384,11 @@ bool SoundTouch::setSetting(int settingId, int value)
             pTDStretch->enableQuickSeek((value != 0) ? true : false);
             return true;
 
+        case SETTING_SEEK_CANDIDATES :
+            // sets the number of candidates of the coarse-to-fine seek, 0 = disabled
+            pTDStretch->setSeekCandidates(value);
+            return true;
+
         case SETTING_SEQUENCE_MS:
             // change time-stretch sequence duration parameter
             pTDStretch->setParameters(sampleRate, value, seekWindowMs, overlapMs);
@@ -412,6 +429,9 @@ int SoundTouch::getSetting(int settingId) const
         case SETTING_USE_QUICKSEEK :
             return (uint)pTDStretch->isQuickSeekEnabled();
 
+        case SETTING_SEEK_CANDIDATES :
+            return pTDStretch->getSeekCandidates();
+
         case SETTING_SEQUENCE_MS:
             pTDStretch->getParameters(NULL, &temp, NULL, NULL);
             return temp;
@@ -84,12 +84,18 @@ const short _scanOffsets[5][24]={
 TDStretch::TDStretch() : FIFOProcessor(&outputBuffer)
 {
     bQuickSeek = false;
+    seekCandidates = 0;
+    seekDecimation = 1;
     channels = 2;
 
     pMidBuffer = NULL;
     pMidBufferUnaligned = NULL;
+    pSeekBuffer = NULL;
+    seekBufferSize = 0;
     overlapLength = 0;
 
+    pDest = &outputBuffer;
+
     bAutoSeqSetting = true;
     bAutoSeekSetting = true;
 
@@ -110,6 +116,7 @@ TDStretch::TDStretch() : FIFOProcessor(&outputBuffer)
 TDStretch::~TDStretch()
 {
     delete[] pMidBufferUnaligned;
+    delete[] pSeekBuffer;
 }
 
 
@@ -227,6 +234,13 @@ void TDStretch::clearInput()
 }
 
 
+// Sets the buffer where the stretched samples are written
+void TDStretch::setDestination(FIFOSampleBuffer *dest)
+{
+    pDest = dest ? dest : &outputBuffer;
+}
+
+
 // Clears the sample buffers
 void TDStretch::clear()
 {
@@ -251,10 +265,30 @@ bool TDStretch::isQuickSeekEnabled() const
 }
 
 
+// Sets the number of candidates refined by the coarse-to-fine seek, zero disables it
+void TDStretch::setSeekCandidates(int count)
+{
+    if (count < 0) count = 0;
+    if (count > TDSTRETCH_MAX_SEEK_CANDIDATES) count = TDSTRETCH_MAX_SEEK_CANDIDATES;
+    seekCandidates = count;
+}
+
+
+// Returns the number of refined seek candidates, zero if disabled
+int TDStretch::getSeekCandidates() const
+{
+    return seekCandidates;
+}
+
+
 // Seeks for the optimal overlap-mixing position.
 int TDStretch::seekBestOverlapPosition(const SAMPLETYPE *refPos)
 {
-    if (bQuickSeek) 
+    if (seekCandidates > 0)
+    {
+        return seekBestOverlapPositionHierarchical(refPos);
+    }
+    else if (bQuickSeek) 
     {
         return seekBestOverlapPositionQuick(refPos);
     }
@@ -475,6 +509,167 @@ int TDStretch::seekBestOverlapPositionQuick(const SAMPLETYPE *refPos)
 }
 
 
+// Averages 'frames' blocks of 'factor' frames of all channels into one value
+// each; a cheap low-pass plus decimation for the coarse seek pass.
+static void decimateForSeek(float *dest, const SAMPLETYPE *src, int frames, int factor, int channels)
+{
+    const int block = factor * channels;
+    const float scale = 1.0f / (float)block;
+    int i, k;
+
+    for (i = 0; i < frames; i ++)
+    {
+        float sum = 0;
+        for (k = 0; k < block; k ++)
+        {
+            sum += (float)src[k];
+        }
+        dest[i] = sum * scale;
+        src += block;
+    }
+}
+
+
+// Coarse-to-fine seek algorithm: correlates decimated versions of the seek
+// range and the overlap buffer at every coarse lag, picks the 'seekCandidates'
+// highest local maxima, and then evaluates the full-resolution correlation in
+// the neighbourhood of each of them. The same mid-range weighting as in the
+// full search is applied on both levels.
+//
+// The coarse pass costs about 1/decimation^2 of the full search; refining each
+// candidate costs 2*decimation - 1 full correlations.
+int TDStretch::seekBestOverlapPositionHierarchical(const SAMPLETYPE *refPos)
+{
+    const int factor = seekDecimation;
+    const int ovlCoarse = overlapLength / factor;
+    const int lagsCoarse = seekLength / factor;
+    int candidates[TDSTRETCH_MAX_SEEK_CANDIDATES];
+    float candCorr[TDSTRETCH_MAX_SEEK_CANDIDATES];
+    int numCand;
+    float *midCoarse;
+    float *refCoarse;
+    float *scores;
+    int bestOffs;
+    double bestCorr;
+    double norm;
+    int i, c, k;
+
+    if ((ovlCoarse < 4) || (lagsCoarse < 2))
+    {
+        return seekBestOverlapPositionFull(refPos);
+    }
+
+    // (re)allocate the work area when the processing parameters have grown
+    int need = ovlCoarse + (lagsCoarse + ovlCoarse) + lagsCoarse;
+    if (need > seekBufferSize)
+    {
+        delete[] pSeekBuffer;
+        pSeekBuffer = new float[need];
+        seekBufferSize = need;
+    }
+    midCoarse = pSeekBuffer;
+    refCoarse = midCoarse + ovlCoarse;
+    scores = refCoarse + lagsCoarse + ovlCoarse;
+
+    // the last coarse lag reads up to frame (lagsCoarse + ovlCoarse - 1) * factor,
+    // which is within the range that the full search reads
+    decimateForSeek(midCoarse, pMidBuffer, ovlCoarse, factor, channels);
+    decimateForSeek(refCoarse, refPos, lagsCoarse - 1 + ovlCoarse, factor, channels);
+
+    // coarse pass with running normalizer
+    float cnorm = 0;
+    for (k = 0; k < ovlCoarse; k ++)
+    {
+        cnorm += refCoarse[k] * refCoarse[k];
+    }
+    for (c = 0; c < lagsCoarse; c ++)
+    {
+        const float *pRef = refCoarse + c;
+        float corr = 0;
+
+        if (c > 0)
+        {
+            cnorm += pRef[ovlCoarse - 1] * pRef[ovlCoarse - 1] - pRef[-1] * pRef[-1];
+        }
+        for (k = 0; k < ovlCoarse; k ++)
+        {
+            corr += pRef[k] * midCoarse[k];
+        }
+        corr /= (float)sqrt((cnorm < 1e-9f) ? 1.0f : cnorm);
+
+        // heuristic rule to slightly favour values close to mid of the range
+        float tmp = (float)(2 * c * factor - seekLength) / (float)seekLength;
+        scores[c] = (corr + 0.1f) * (1.0f - 0.25f * tmp * tmp);
+    }
+
+    // keep the highest local maxima, sorted by descending score
+    numCand = 0;
+    for (c = 0; c < lagsCoarse; c ++)
+    {
+        float sc = scores[c];
+        if ((c > 0 && scores[c - 1] > sc) || (c < lagsCoarse - 1 && scores[c + 1] > sc)) continue;
+        if (numCand == seekCandidates && sc <= candCorr[numCand - 1]) continue;
+
+        if (numCand < seekCandidates) numCand ++;
+        for (k = numCand - 1; k > 0 && candCorr[k - 1] < sc; k --)
+        {
+            candCorr[k] = candCorr[k - 1];
+            candidates[k] = candidates[k - 1];
+        }
+        candCorr[k] = sc;
+        candidates[k] = c;
+    }
+
+    // refine around the candidates in ascending lag order so that
+    // overlapping neighbourhoods are evaluated only once
+    for (i = 1; i < numCand; i ++)
+    {
+        int lag = candidates[i];
+        for (k = i; k > 0 && candidates[k - 1] > lag; k --)
+        {
+            candidates[k] = candidates[k - 1];
+        }
+        candidates[k] = lag;
+    }
+
+    bestCorr = -FLT_MAX;
+    bestOffs = (numCand > 0) ? candidates[0] * factor : 0;
+    int next = 0;
+    for (c = 0; c < numCand; c ++)
+    {
+        int start = candidates[c] * factor - factor + 1;
+        int end = candidates[c] * factor + factor;
+        if (start < next) start = next;
+        if (start < 0) start = 0;
+        if (end > seekLength) end = seekLength;
+
+        for (i = start; i < end; i ++)
+        {
+            double corr = calcCrossCorr(refPos + channels * i, pMidBuffer, norm);
+            // heuristic rule to slightly favour values close to mid of the range
+            double tmp = (double)(2 * i - seekLength) / (double)seekLength;
+            corr = ((corr + 0.1) * (1.0 - 0.25 * tmp * tmp));
+
+            if (corr > bestCorr)
+            {
+                bestCorr = corr;
+                bestOffs = i;
+            }
+        }
+        next = end;
+    }
+
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    adaptNormalizer();
+#endif
+
+    // clear cross correlation routine state if necessary (is so e.g. in MMX routines).
+    clearCrossCorrState();
+
+    return bestOffs;
+}
+
+
 
 
 /// For integer algorithm: adapt normalization factor divider with music so that 
@@ -558,6 +753,9 @@ void TDStretch::calcSeqParameters()
         seekWindowLength = 2 * overlapLength;
     }
     seekLength = (sampleRate * seekWindowMs) / 1000;
+
+    // decimation factor of the coarse-to-fine seek
+    seekDecimation = CHECK_LIMITS(sampleRate / TDSTRETCH_COARSE_SEEK_RATE, 1, 8);
 }
 
 
@@ -635,7 +833,7 @@ void TDStretch::processNominalTempo()
 
 
 // Processes as many processing frames of the samples 'inputBuffer', store
-// the result into 'outputBuffer'
+// the result into 'pDest'
 void TDStretch::processSamples()
 {
     int ovlSkip;
@@ -666,8 +864,8 @@ void TDStretch::processSamples()
             // samples in 'midBuffer' using sliding overlapping
             // ... first partially overlap with the end of the previous sequence
             // (that's in 'midBuffer')
-            overlap(outputBuffer.ptrEnd((uint)overlapLength), inputBuffer.ptrBegin(), (uint)offset);
-            outputBuffer.putSamples((uint)overlapLength);
+            overlap(pDest->ptrEnd((uint)overlapLength), inputBuffer.ptrBegin(), (uint)offset);
+            pDest->putSamples((uint)overlapLength);
             offset += overlapLength;
         }
         else
@@ -704,7 +902,7 @@ void TDStretch::processSamples()
 
         // length of sequence
         temp = (seekWindowLength - 2 * overlapLength);
-        outputBuffer.putSamples(inputBuffer.ptrBegin() + channels * offset, (uint)temp);
+        pDest->putSamples(inputBuffer.ptrBegin() + channels * offset, (uint)temp);
 
         // Copies the end of the current sequence from 'inputBuffer' to 
         // 'midBuffer' for being mixed with the beginning of the next 
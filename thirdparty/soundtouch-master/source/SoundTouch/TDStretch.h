@@ -97,6 +97,13 @@ namespace soundtouch
 /// Increasing this value increases computational burden & vice versa.
 #define DEFAULT_OVERLAP_MS      8
 
+/// Upper limit for the number of candidates refined by the coarse-to-fine seek
+#define TDSTRETCH_MAX_SEEK_CANDIDATES   8
+
+/// Approximate sample rate (Hz) of the decimated signals in the coarse-to-fine
+/// seek. Lower values are faster but resolve less of the waveform detail.
+#define TDSTRETCH_COARSE_SEEK_RATE      8000
+
 
 /// Class that does the time-stretch (tempo change) effect for the processed
 /// sound.
@@ -125,6 +132,8 @@ protected:
     double skipFract;
 
     bool bQuickSeek;
+    int seekCandidates;
+    int seekDecimation;
     bool bAutoSeqSetting;
     bool bAutoSeekSetting;
     bool isBeginning;
@@ -132,9 +141,18 @@ protected:
     SAMPLETYPE *pMidBuffer;
     SAMPLETYPE *pMidBufferUnaligned;
 
+    /// Work area of the coarse-to-fine seek: decimated mid buffer, decimated
+    /// seek range and coarse correlation scores
+    float *pSeekBuffer;
+    int seekBufferSize;
+
     FIFOSampleBuffer outputBuffer;
     FIFOSampleBuffer inputBuffer;
 
+    /// Buffer the stretched samples are written into: 'outputBuffer', or the
+    /// input buffer of the next stage when chained with 'setDestination'
+    FIFOSampleBuffer *pDest;
+
     void acceptNewOverlapLength(int newOverlapLength);
 
     virtual void clearCrossCorrState();
@@ -145,6 +163,7 @@ protected:
 
     virtual int seekBestOverlapPositionFull(const SAMPLETYPE *refPos);
     virtual int seekBestOverlapPositionQuick(const SAMPLETYPE *refPos);
+    virtual int seekBestOverlapPositionHierarchical(const SAMPLETYPE *refPos);
     virtual int seekBestOverlapPosition(const SAMPLETYPE *refPos);
 
     virtual void overlapStereo(SAMPLETYPE *output, const SAMPLETYPE *input) const;
@@ -180,7 +199,19 @@ public:
     FIFOSamplePipe *getOutput() { return &outputBuffer; };
 
     /// Returns the input buffer object
-    FIFOSamplePipe *getInput() { return &inputBuffer; };
+    FIFOSampleBuffer *getInput() { return &inputBuffer; };
+
+    /// Makes the stretcher write its result directly to the end of 'dest'
+    /// (typically the input buffer of the following stage) instead of its own
+    /// output buffer, saving a copy per batch. NULL restores the own buffer.
+    void setDestination(FIFOSampleBuffer *dest);
+
+    /// Processes samples that a preceding stage has written directly into
+    /// the input buffer (see 'getInput' and RateTransposer::setDestination).
+    void processInput()
+    {
+        processSamples();
+    }
 
     /// Sets new target tempo. Normal tempo = 'SCALE', smaller values represent slower 
     /// tempo, larger faster tempo.
@@ -202,6 +233,15 @@ public:
     /// Returns nonzero if the quick seeking algorithm is enabled.
     bool isQuickSeekEnabled() const;
 
+    /// Enables the coarse-to-fine seeking algorithm: correlation is first
+    /// evaluated on decimated signals, then the 'count' best peaks are refined
+    /// at full resolution. Zero disables it (quick or full seek is used),
+    /// the maximum is TDSTRETCH_MAX_SEEK_CANDIDATES.
+    void setSeekCandidates(int count);
+
+    /// Returns the number of refined seek candidates, zero if disabled.
+    int getSeekCandidates() const;
+
     /// Sets routine control parameters. These control are certain time constants
     /// defining how the sound is stretched to the desired duration.
     //
@@ -197,6 +197,8 @@ FIRFilterSSE::FIRFilterSSE() : FIRFilter()
 {
     filterCoeffsAlign = NULL;
     filterCoeffsUnalign = NULL;
+    filterCoeffsQuad = NULL;
+    filterCoeffsQuadUnalign = NULL;
 }
 
 
@@ -205,6 +207,9 @@ FIRFilterSSE::~FIRFilterSSE()
     delete[] filterCoeffsUnalign;
     filterCoeffsAlign = NULL;
     filterCoeffsUnalign = NULL;
+    delete[] filterCoeffsQuadUnalign;
+    filterCoeffsQuad = NULL;
+    filterCoeffsQuadUnalign = NULL;
 }
 
 
@@ -231,6 +236,116 @@ void FIRFilterSSE::setCoefficients(const float *coeffs, uint newLength, uint uRe
         filterCoeffsAlign[2 * i + 0] =
         filterCoeffsAlign[2 * i + 1] = coeffs[i + 0] / fDivider;
     }
+
+    // same scaled coefficients, each one splatted over a whole SSE register
+    delete[] filterCoeffsQuadUnalign;
+    filterCoeffsQuadUnalign = new float[4 * newLength + 4];
+    filterCoeffsQuad = (float *)SOUNDTOUCH_ALIGN_POINTER_16(filterCoeffsQuadUnalign);
+
+    for (i = 0; i < newLength; i ++)
+    {
+        filterCoeffsQuad[4 * i + 0] =
+        filterCoeffsQuad[4 * i + 1] =
+        filterCoeffsQuad[4 * i + 2] =
+        filterCoeffsQuad[4 * i + 3] = coeffs[i] / fDivider;
+    }
+}
+
+
+// Filters a stream whose consecutive filter taps are 'stride' floats apart:
+//
+//   dest[k] = sum(i) coeffs[i] * src[k + i * stride],  k = 0 .. count - 1
+//
+// Mono sound is stride 1. Interleaved sound of N channels is stride N: the
+// output index then runs over all channels of consecutive frames, so every
+// SSE lane does useful work whatever the channel count. Eight outputs are
+// evaluated per pass with the coefficients pre-splatted in 'quadCoeffs'.
+static void firStridedSSE(float *dest, const float *src, int count, uint stride,
+                          const float *quadCoeffs, uint length)
+{
+    int end8 = count & -8;
+    int j;
+
+    #pragma omp parallel for
+    for (j = 0; j < end8; j += 8)
+    {
+        const float *pSrc = src + j;
+        const __m128 *pFil = (const __m128*)quadCoeffs;
+        __m128 sum1, sum2;
+        uint i;
+
+        sum1 = sum2 = _mm_setzero_ps();
+        for (i = 0; i < length; i ++)
+        {
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(pSrc)    , pFil[i]));
+            sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(pSrc + 4), pFil[i]));
+            pSrc += stride;
+        }
+        _mm_storeu_ps(dest + j, sum1);
+        _mm_storeu_ps(dest + j + 4, sum2);
+    }
+
+    // remaining outputs: one register at a time, then one by one so that
+    // the source is never read past its last sample
+    for (j = end8; j + 4 <= count; j += 4)
+    {
+        const float *pSrc = src + j;
+        const __m128 *pFil = (const __m128*)quadCoeffs;
+        __m128 sum = _mm_setzero_ps();
+        uint i;
+
+        for (i = 0; i < length; i ++)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pSrc), pFil[i]));
+            pSrc += stride;
+        }
+        _mm_storeu_ps(dest + j, sum);
+    }
+
+    for (; j < count; j ++)
+    {
+        const float *pSrc = src + j;
+        float sum = 0;
+        uint i;
+
+        for (i = 0; i < length; i ++)
+        {
+            sum += pSrc[0] * quadCoeffs[4 * i];
+            pSrc += stride;
+        }
+        dest[j] = sum;
+    }
+}
+
+
+// SSE-optimized version of the filter routine for mono sound
+uint FIRFilterSSE::evaluateFilterMono(float *dest, const float *source, uint numSamples) const
+{
+    int count = (int)(numSamples - length);
+
+    assert(source != NULL);
+    assert(dest != NULL);
+    assert(filterCoeffsQuad != NULL);
+    assert(((ulongptr)filterCoeffsQuad) % 16 == 0);
+
+    firStridedSSE(dest, source, count, 1, filterCoeffsQuad, length);
+    return (uint)count;
+}
+
+
+// SSE-optimized version of the filter routine for any number of channels
+uint FIRFilterSSE::evaluateFilterMulti(float *dest, const float *source, uint numSamples, uint numChannels)
+{
+    int count = (int)(numSamples - length);
+
+    assert(source != NULL);
+    assert(dest != NULL);
+    assert(numChannels > 0);
+    assert(filterCoeffsQuad != NULL);
+    assert(((ulongptr)filterCoeffsQuad) % 16 == 0);
+
+    firStridedSSE(dest, source, count * (int)numChannels, numChannels, filterCoeffsQuad, length);
+    return (uint)count;
 }
 
 
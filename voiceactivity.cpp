@@ -0,0 +1,52 @@
+// voiceactivity.cpp
+
+#include "voiceactivity.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+// Lowest usable threshold: one LSB of dither still counts as silence
+const int kMinThreshold = 2;
+}
+
+VoiceActivityDetector::VoiceActivityDetector()
+    : m_threshold(kMinThreshold)
+    , m_hangoverFrames(0)
+    , m_quietFrames(0)
+    , m_active(true)
+{
+}
+
+void VoiceActivityDetector::setThreshold(float dB)
+{
+    const float linear = std::pow(10.0f, dB / 20.0f) * 32768.0f;
+    m_threshold = std::max(kMinThreshold, static_cast<int>(std::min(linear, 32767.0f)));
+}
+
+void VoiceActivityDetector::reset()
+{
+    m_quietFrames = m_hangoverFrames;
+    m_active = false;
+}
+
+bool VoiceActivityDetector::process(const qint16* samples, int count, int channels)
+{
+    if (!samples || count <= 0)
+        return m_active;
+
+    // Plain max-of-abs loop; compilers vectorise this
+    int peak = 0;
+    for (int i = 0; i < count; ++i)
+        peak = std::max(peak, std::abs(static_cast<int>(samples[i])));
+
+    if (peak >= m_threshold) {
+        m_quietFrames = 0;
+        m_active = true;
+    } else {
+        m_quietFrames = std::min(m_quietFrames + count / std::max(channels, 1), m_hangoverFrames + 1);
+        m_active = m_quietFrames <= m_hangoverFrames;
+    }
+    return m_active;
+}
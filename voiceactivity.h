@@ -0,0 +1,48 @@
+// voiceactivity.h
+#ifndef VOICEACTIVITY_H
+#define VOICEACTIVITY_H
+
+#include <QtGlobal>
+
+// ----------------------------------------------------------
+// VoiceActivityDetector Class Declaration
+// ----------------------------------------------------------
+
+/**
+ * @brief Block level detector that tells the audio loop when the effect
+ * chain can be skipped.
+ *
+ * A block is active if its sample peak reaches the threshold (just above
+ * digital silence, or the level of a noise gate that mutes). After the last
+ * active block the detector keeps reporting activity for a hangover period,
+ * so filters, pitch buffers and reverb tails ring out before the chain is
+ * bypassed. Works on the raw Int16 capture blocks, ahead of any conversion.
+ * Real-time safe.
+ */
+class VoiceActivityDetector
+{
+public:
+    VoiceActivityDetector();
+
+    /// Peak level in dBFS below which a block counts as silence.
+    void setThreshold(float dB);
+
+    /// Frames to stay active after the last block above the threshold.
+    void setHangover(int frames) { m_hangoverFrames = frames > 0 ? frames : 0; }
+
+    /// Classifies one interleaved block. Returns true while the chain must run.
+    bool process(const qint16* samples, int count, int channels);
+
+    bool isActive() const { return m_active; }
+
+    /// Forgets the hangover state; the next quiet block is idle at once.
+    void reset();
+
+private:
+    int m_threshold;        ///< Peak threshold in Int16 steps
+    int m_hangoverFrames;
+    int m_quietFrames;      ///< Frames since the last active block
+    bool m_active;
+};
+
+#endif // VOICEACTIVITY_H
@@ -0,0 +1,166 @@
+// wavfile.cpp
+
+#include "wavfile.h"
+
+#include <QFile>
+#include <cstring>
+
+namespace {
+const int kFormatPcm        = 0x0001;
+const int kFormatFloat      = 0x0003;
+const int kFormatExtensible = 0xFFFE;
+
+quint16 readLe16(const uchar* p) { return static_cast<quint16>(p[0] | (p[1] << 8)); }
+quint32 readLe32(const uchar* p)
+{
+    return static_cast<quint32>(p[0]) | (static_cast<quint32>(p[1]) << 8)
+         | (static_cast<quint32>(p[2]) << 16) | (static_cast<quint32>(p[3]) << 24);
+}
+quint64 readLe64(const uchar* p)
+{
+    return static_cast<quint64>(readLe32(p)) | (static_cast<quint64>(readLe32(p + 4)) << 32);
+}
+
+bool fail(QString* error, const QString& message)
+{
+    if (error)
+        *error = message;
+    return false;
+}
+}
+
+// ----------------------------------------------------------
+// 1. Header parsing
+// ----------------------------------------------------------
+
+bool parseWavHeader(const uchar* data, qint64 size, WavFormat& format, QString* error)
+{
+    if (!data || size < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0) {
+        // RF64 files use the same layout with a ds64 chunk; the 32-bit sizes
+        // are 0xFFFFFFFF and the data chunk simply runs to the end of the file
+        if (!data || size < 12 || std::memcmp(data, "RF64", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0)
+            return fail(error, QStringLiteral("Not a RIFF/WAVE file"));
+    }
+
+    bool haveFormat = false;
+    int formatTag = 0;
+    qint64 ds64DataBytes = -1;
+    qint64 pos = 12;
+    while (pos + 8 <= size) {
+        const uchar* chunk = data + pos;
+        const quint32 chunkSize = readLe32(chunk + 4);
+        const qint64 body = pos + 8;
+
+        if (std::memcmp(chunk, "ds64", 4) == 0 && chunkSize >= 16 && body + 16 <= size) {
+            // 64-bit RIFF and data sizes of an RF64 file
+            ds64DataBytes = static_cast<qint64>(readLe64(data + body + 8));
+        } else if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || body + 16 > size)
+                return fail(error, QStringLiteral("Truncated fmt chunk"));
+            formatTag            = readLe16(data + body);
+            format.channels      = readLe16(data + body + 2);
+            format.sampleRate    = static_cast<int>(readLe32(data + body + 4));
+            format.bitsPerSample = readLe16(data + body + 14);
+            if (formatTag == kFormatExtensible && chunkSize >= 40 && body + 26 <= size) {
+                // The sub-format GUID starts with the actual format tag
+                formatTag = readLe16(data + body + 24);
+            }
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat)
+                return fail(error, QStringLiteral("data chunk before fmt chunk"));
+            format.dataOffset = body;
+            qint64 available = size - body;
+            if (chunkSize != 0xFFFFFFFFu)
+                format.dataBytes = qMin<qint64>(chunkSize, available);
+            else
+                format.dataBytes = ds64DataBytes >= 0 ? qMin(ds64DataBytes, available) : available;
+            break;
+        }
+
+        // Chunks are padded to an even size
+        pos = body + chunkSize + (chunkSize & 1);
+    }
+
+    if (!haveFormat || format.dataOffset == 0)
+        return fail(error, QStringLiteral("Missing fmt or data chunk"));
+    if (format.channels <= 0 || format.sampleRate <= 0)
+        return fail(error, QStringLiteral("Invalid channel count or sample rate"));
+
+    format.isFloat = (formatTag == kFormatFloat);
+    if (formatTag == kFormatPcm) {
+        if (format.bitsPerSample != 8 && format.bitsPerSample != 16
+            && format.bitsPerSample != 24 && format.bitsPerSample != 32)
+            return fail(error, QStringLiteral("Unsupported PCM bit depth %1").arg(format.bitsPerSample));
+    } else if (formatTag == kFormatFloat) {
+        if (format.bitsPerSample != 32 && format.bitsPerSample != 64)
+            return fail(error, QStringLiteral("Unsupported float bit depth %1").arg(format.bitsPerSample));
+    } else {
+        return fail(error, QStringLiteral("Unsupported WAV format tag 0x%1").arg(formatTag, 0, 16));
+    }
+    return true;
+}
+
+// ----------------------------------------------------------
+// 2. Sample conversion
+// ----------------------------------------------------------
+
+void convertWavSamples(const uchar* src, const WavFormat& format, qint64 frames, float* dst)
+{
+    const qint64 count = frames * format.channels;
+
+    if (format.isFloat && format.bitsPerSample == 32) {
+        std::memcpy(dst, src, static_cast<size_t>(count) * sizeof(float));
+        return;
+    }
+
+    for (qint64 i = 0; i < count; ++i) {
+        switch (format.bitsPerSample) {
+        case 8:
+            dst[i] = (static_cast<int>(src[i]) - 128) / 128.0f;
+            break;
+        case 16:
+            dst[i] = static_cast<qint16>(readLe16(src + 2 * i)) / 32768.0f;
+            break;
+        case 24: {
+            const uchar* p = src + 3 * i;
+            qint32 v = static_cast<qint32>((p[0] << 8) | (p[1] << 16) | (static_cast<quint32>(p[2]) << 24)) >> 8;
+            dst[i] = v / 8388608.0f;
+            break;
+        }
+        case 32:
+            dst[i] = static_cast<qint32>(readLe32(src + 4 * i)) / 2147483648.0f;
+            break;
+        case 64: {
+            double v;
+            std::memcpy(&v, src + 8 * i, sizeof(v));
+            dst[i] = static_cast<float>(v);
+            break;
+        }
+        default:
+            dst[i] = 0.0f;
+            break;
+        }
+    }
+}
+
+// ----------------------------------------------------------
+// 3. Whole-file reader
+// ----------------------------------------------------------
+
+bool readWavFile(const QString& path, std::vector<float>& samples, WavFormat& format, QString* error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return fail(error, file.errorString());
+
+    const QByteArray bytes = file.readAll();
+    const uchar* data = reinterpret_cast<const uchar*>(bytes.constData());
+    if (!parseWavHeader(data, bytes.size(), format, error))
+        return false;
+
+    const qint64 frames = format.frames();
+    samples.resize(static_cast<size_t>(frames * format.channels));
+    convertWavSamples(data + format.dataOffset, format, frames, samples.data());
+    return true;
+}
@@ -0,0 +1,51 @@
+// wavfile.h
+#ifndef WAVFILE_H
+#define WAVFILE_H
+
+#include <QString>
+#include <QtGlobal>
+#include <vector>
+
+// ----------------------------------------------------------
+// WAV parsing helpers
+// ----------------------------------------------------------
+
+/**
+ * @brief Layout of the sample data in a RIFF/WAVE file.
+ *
+ * Integer PCM (8/16/24/32 bit) and IEEE float (32/64 bit) are supported,
+ * including WAVE_FORMAT_EXTENSIBLE headers.
+ */
+struct WavFormat
+{
+    int channels      = 0;
+    int sampleRate    = 0;
+    int bitsPerSample = 0;
+    bool isFloat      = false;
+    qint64 dataOffset = 0;   ///< Byte offset of the first sample
+    qint64 dataBytes  = 0;   ///< Size of the data chunk (clamped to the file)
+
+    int bytesPerFrame() const { return channels * (bitsPerSample / 8); }
+    qint64 frames() const { return bytesPerFrame() > 0 ? dataBytes / bytesPerFrame() : 0; }
+};
+
+/**
+ * @brief Parses the RIFF header and locates the data chunk.
+ * @param data Start of the file contents (at least the header must be present).
+ * @param size Number of valid bytes at @p data.
+ * @return false with a message in @p error if the file is not a supported WAV.
+ */
+bool parseWavHeader(const uchar* data, qint64 size, WavFormat& format, QString* error = nullptr);
+
+/**
+ * @brief Converts @p frames interleaved frames starting at @p src to float in [-1, 1).
+ */
+void convertWavSamples(const uchar* src, const WavFormat& format, qint64 frames, float* dst);
+
+/**
+ * @brief Reads a whole WAV file into interleaved float samples. Not real-time safe.
+ */
+bool readWavFile(const QString& path, std::vector<float>& samples, WavFormat& format,
+                 QString* error = nullptr);
+
+#endif // WAVFILE_H